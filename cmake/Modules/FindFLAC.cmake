@@ -0,0 +1,49 @@
+# Try to find libFLAC
+# This will define the following variables:
+#
+#  FLAC_FOUND - Whether libFLAC was found.
+#  FLAC_INCLUDE_DIRS - libFLAC include directories.
+#  FLAC_LIBRARIES - libFLAC libraries.
+
+include(FindPackageHandleStandardArgs)
+
+if(FLAC_LIBRARIES AND FLAC_INCLUDE_DIRS)
+
+  # in cache already
+  set(FLAC_FOUND TRUE)
+
+else()
+
+  find_package(PkgConfig)
+  if(PKG_CONFIG_FOUND)
+    pkg_check_modules(_FLAC flac)
+  endif(PKG_CONFIG_FOUND)
+
+  find_path(FLAC_INCLUDE_DIR
+    NAMES
+      FLAC/stream_encoder.h
+    PATHS
+      ${_FLAC_INCLUDEDIR}
+  )
+  
+  find_library(FLAC_LIBRARY
+    NAMES
+      FLAC libFLAC
+    PATHS
+      ${_FLAC_LIBDIR}
+  )
+
+  set(FLAC_INCLUDE_DIRS
+    ${FLAC_INCLUDE_DIR}
+  )
+
+  set(FLAC_LIBRARIES
+    ${FLAC_LIBRARY}
+  )
+
+  find_package_handle_standard_args(FLAC DEFAULT_MSG FLAC_LIBRARIES FLAC_INCLUDE_DIRS)
+
+  # show the FLAC_INCLUDE_DIRS and FLAC_LIBRARIES variables only in the advanced view
+  mark_as_advanced(FLAC_INCLUDE_DIR FLAC_LIBRARY FLAC_INCLUDE_DIRS FLAC_LIBRARIES)
+
+endif()
@@ -1,5 +1,9 @@
 #include "AppConfig.h"
 #include "CubicSDR.h"
+#include "PipelineStats.h"
+#include "IQRecorderThread.h"
+#include "AudioRecorderThread.h"
+#include "WaterfallHistory.h"
 
 DeviceConfig::DeviceConfig() : deviceId("") {
 	ppm.store(0);
@@ -58,12 +62,31 @@ std::string DeviceConfig::getDeviceName() {
     return tmp;
 }
 
+void DeviceConfig::setStreamFormat(std::string streamFormat) {
+    busy_lock.lock();
+    this->streamFormat = streamFormat;
+    busy_lock.unlock();
+}
+
+std::string DeviceConfig::getStreamFormat() {
+    std::string tmp;
+    
+    busy_lock.lock();
+    tmp = streamFormat;
+    busy_lock.unlock();
+    
+    return tmp;
+}
+
 void DeviceConfig::save(DataNode *node) {
     busy_lock.lock();
     *node->newChild("id") = deviceId;
     *node->newChild("name") = deviceName;
     *node->newChild("ppm") = (int)ppm;
     *node->newChild("offset") = offset;
+    if (streamFormat != "") {
+        *node->newChild("stream_format") = streamFormat;
+    }
     DataNode *streamOptsNode = node->newChild("streamOpts");
     for (ConfigSettings::const_iterator opt_i = streamOpts.begin(); opt_i != streamOpts.end(); opt_i++) {
         *streamOptsNode->newChild(opt_i->first.c_str()) = opt_i->second;
@@ -100,6 +123,10 @@ void DeviceConfig::load(DataNode *node) {
         setOffset(offsetValue);
         std::cout << "Loaded offset for device '" << deviceId << "' at " << offsetValue << "Hz" << std::endl;
     }
+    if (node->hasAnother("stream_format")) {
+        streamFormat = node->getNext("stream_format")->element()->toString();
+        std::cout << "Loaded stream format for device '" << deviceId << "' as " << streamFormat << std::endl;
+    }
     if (node->hasAnother("streamOpts")) {
         DataNode *streamOptsNode = node->getNext("streamOpts");
         for (int i = 0, iMax = streamOptsNode->numChildren(); i<iMax; i++) {
@@ -203,7 +230,23 @@ AppConfig::AppConfig() : configName("") {
     snap.store(1);
     centerFreq.store(100000000);
     waterfallLinesPerSec.store(DEFAULT_WATERFALL_LPS);
+    waterfallHistorySeconds.store(WATERFALL_HISTORY_DEFAULT_SECONDS);
+    waterfallHistoryMemory.store(WATERFALL_HISTORY_DEFAULT_MB);
     spectrumAvgSpeed.store(0.65f);
+    spectrumWelch.store(false);
+    spectrumWindow = "Hann";
+    spectrumOverlap.store(0.5f);
+    spectrumFFTLength.store(0);
+    demodThreadPool.store(true);
+    fastChannelizer.store(false);
+    statsInterval.store(PIPELINE_STATS_DEFAULT_INTERVAL);
+    recordingFormat = "CF32";
+    recordingRotateSize.store(IQ_RECORD_DEFAULT_ROTATE_MB);
+    recordingRotateSeconds.store(IQ_RECORD_DEFAULT_ROTATE_SECONDS);
+    audioRecordingFormat = "WAV";
+    audioRecordingSquelchHang.store(AUDIO_RECORD_DEFAULT_SQUELCH_HANG_MS);
+    fftPlannerLevel = "ESTIMATE";
+    fftThreads.store(0);
 #ifdef USE_HAMLIB
     rigEnabled.store(false);
     rigModel.store(1);
@@ -307,6 +350,22 @@ int AppConfig::getWaterfallLinesPerSec() {
     return waterfallLinesPerSec.load();
 }
 
+void AppConfig::setWaterfallHistorySeconds(int seconds) {
+    waterfallHistorySeconds.store(seconds);
+}
+
+int AppConfig::getWaterfallHistorySeconds() {
+    return waterfallHistorySeconds.load();
+}
+
+void AppConfig::setWaterfallHistoryMemory(int megabytes) {
+    waterfallHistoryMemory.store(megabytes);
+}
+
+int AppConfig::getWaterfallHistoryMemory() {
+    return waterfallHistoryMemory.load();
+}
+
 void AppConfig::setSpectrumAvgSpeed(float avgSpeed) {
     spectrumAvgSpeed.store(avgSpeed);
 }
@@ -315,6 +374,142 @@ float AppConfig::getSpectrumAvgSpeed() {
     return spectrumAvgSpeed.load();
 }
 
+void AppConfig::setSpectrumWelch(bool welch) {
+    spectrumWelch.store(welch);
+}
+
+bool AppConfig::getSpectrumWelch() {
+    return spectrumWelch.load();
+}
+
+void AppConfig::setSpectrumWindow(std::string window) {
+    spectrumWindow = window;
+}
+
+std::string AppConfig::getSpectrumWindow() {
+    return spectrumWindow;
+}
+
+void AppConfig::setSpectrumOverlap(float overlap) {
+    spectrumOverlap.store(overlap);
+}
+
+float AppConfig::getSpectrumOverlap() {
+    return spectrumOverlap.load();
+}
+
+void AppConfig::setSpectrumFFTLength(int fftLength) {
+    spectrumFFTLength.store(fftLength);
+}
+
+int AppConfig::getSpectrumFFTLength() {
+    return spectrumFFTLength.load();
+}
+
+void AppConfig::setDemodThreadPool(bool pooled) {
+    demodThreadPool.store(pooled);
+}
+
+bool AppConfig::getDemodThreadPool() {
+    return demodThreadPool.load();
+}
+
+void AppConfig::setFastChannelizer(bool fastCh) {
+    fastChannelizer.store(fastCh);
+}
+
+bool AppConfig::getFastChannelizer() {
+    return fastChannelizer.load();
+}
+
+void AppConfig::setStatsFile(std::string statsFile) {
+    this->statsFile = statsFile;
+}
+
+std::string AppConfig::getStatsFile() {
+    return statsFile;
+}
+
+void AppConfig::setStatsInterval(int intervalMs) {
+    statsInterval.store(intervalMs);
+}
+
+int AppConfig::getStatsInterval() {
+    return statsInterval.load();
+}
+
+void AppConfig::setRecordingPath(std::string recordingPath) {
+    this->recordingPath = recordingPath;
+}
+
+std::string AppConfig::getRecordingPath() {
+    return recordingPath;
+}
+
+void AppConfig::setRecordingFormat(std::string recordingFormat) {
+    this->recordingFormat = recordingFormat;
+}
+
+std::string AppConfig::getRecordingFormat() {
+    return recordingFormat;
+}
+
+void AppConfig::setRecordingRotateSize(int megabytes) {
+    recordingRotateSize.store(megabytes);
+}
+
+int AppConfig::getRecordingRotateSize() {
+    return recordingRotateSize.load();
+}
+
+void AppConfig::setRecordingRotateSeconds(int seconds) {
+    recordingRotateSeconds.store(seconds);
+}
+
+int AppConfig::getRecordingRotateSeconds() {
+    return recordingRotateSeconds.load();
+}
+
+void AppConfig::setAudioRecordingFormat(std::string audioRecordingFormat) {
+    this->audioRecordingFormat = audioRecordingFormat;
+}
+
+std::string AppConfig::getAudioRecordingFormat() {
+    return audioRecordingFormat;
+}
+
+void AppConfig::setAudioRecordingSquelchHang(int milliseconds) {
+    audioRecordingSquelchHang.store(milliseconds);
+}
+
+int AppConfig::getAudioRecordingSquelchHang() {
+    return audioRecordingSquelchHang.load();
+}
+
+void AppConfig::setFFTPlannerLevel(std::string level) {
+    fftPlannerLevel = level;
+}
+
+std::string AppConfig::getFFTPlannerLevel() {
+    return fftPlannerLevel;
+}
+
+void AppConfig::setFFTThreads(int threads) {
+    fftThreads.store(threads);
+}
+
+int AppConfig::getFFTThreads() {
+    return fftThreads.load();
+}
+
+void AppConfig::setThreadPolicy(std::string role, IOThreadPolicy policy) {
+    IOThread::setThreadPolicy(role, policy);
+}
+
+IOThreadPolicy AppConfig::getThreadPolicy(std::string role) {
+    return IOThread::getThreadPolicy(role);
+}
+
 void AppConfig::setManualDevices(std::vector<SDRManualDef> manuals) {
     manualDevices = manuals;
 }
@@ -364,7 +559,29 @@ bool AppConfig::save() {
         *window_node->newChild("snap") = snap.load();
         *window_node->newChild("center_freq") = centerFreq.load();
         *window_node->newChild("waterfall_lps") = waterfallLinesPerSec.load();
+        *window_node->newChild("waterfall_history_sec") = waterfallHistorySeconds.load();
+        *window_node->newChild("waterfall_history_mb") = waterfallHistoryMemory.load();
         *window_node->newChild("spectrum_avg") = spectrumAvgSpeed.load();
+        *window_node->newChild("spectrum_welch") = spectrumWelch.load();
+        *window_node->newChild("spectrum_window") = spectrumWindow;
+        *window_node->newChild("spectrum_overlap") = spectrumOverlap.load();
+        *window_node->newChild("spectrum_fft_length") = spectrumFFTLength.load();
+        *window_node->newChild("demod_pool") = demodThreadPool.load();
+        *window_node->newChild("fast_channelizer") = fastChannelizer.load();
+        if (statsFile != "") {
+            *window_node->newChild("stats_file") = statsFile;
+        }
+        *window_node->newChild("stats_interval") = statsInterval.load();
+        if (recordingPath != "") {
+            *window_node->newChild("recording_path") = recordingPath;
+        }
+        *window_node->newChild("recording_format") = recordingFormat;
+        *window_node->newChild("recording_rotate_mb") = recordingRotateSize.load();
+        *window_node->newChild("recording_rotate_sec") = recordingRotateSeconds.load();
+        *window_node->newChild("audio_recording_format") = audioRecordingFormat;
+        *window_node->newChild("audio_recording_squelch_hang") = audioRecordingSquelchHang.load();
+        *window_node->newChild("fft_planner") = fftPlannerLevel;
+        *window_node->newChild("fft_threads") = fftThreads.load();
     }
     
     DataNode *devices_node = cfg.rootNode()->newChild("devices");
@@ -375,6 +592,20 @@ bool AppConfig::save() {
         device_config_i->second->save(device_node);
     }
 
+    DataNode *threads_node = cfg.rootNode()->newChild("thread_policies");
+    
+    std::vector<std::string> roles = IOThread::getThreadRoles();
+    for (std::vector<std::string>::iterator i = roles.begin(); i != roles.end(); i++) {
+        IOThreadPolicy threadPolicy = IOThread::getThreadPolicy(*i);
+        DataNode *thread_node = threads_node->newChild("thread");
+        *thread_node->newChild("role") = *i;
+        *thread_node->newChild("policy") = threadPolicy.policy;
+        *thread_node->newChild("priority") = threadPolicy.priority;
+        if (threadPolicy.affinity != "") {
+            *thread_node->newChild("affinity") = threadPolicy.affinity;
+        }
+    }
+
     if (manualDevices.size()) {
         DataNode *manual_node = cfg.rootNode()->newChild("manual_devices");
         for (std::vector<SDRManualDef>::const_iterator i = manualDevices.begin(); i != manualDevices.end(); i++) {
@@ -493,12 +724,108 @@ bool AppConfig::load() {
             win_node->getNext("waterfall_lps")->element()->get(lpsVal);
             waterfallLinesPerSec.store(lpsVal);
         }
+
+        if (win_node->hasAnother("waterfall_history_sec")) {
+            int historyVal;
+            win_node->getNext("waterfall_history_sec")->element()->get(historyVal);
+            waterfallHistorySeconds.store(historyVal);
+        }
+
+        if (win_node->hasAnother("waterfall_history_mb")) {
+            int historyMemVal;
+            win_node->getNext("waterfall_history_mb")->element()->get(historyMemVal);
+            waterfallHistoryMemory.store(historyMemVal);
+        }
         
         if (win_node->hasAnother("spectrum_avg")) {
             float avgVal;
             win_node->getNext("spectrum_avg")->element()->get(avgVal);
             spectrumAvgSpeed.store(avgVal);
         }
+
+        if (win_node->hasAnother("spectrum_welch")) {
+            int welchVal;
+            win_node->getNext("spectrum_welch")->element()->get(welchVal);
+            spectrumWelch.store(welchVal?true:false);
+        }
+
+        if (win_node->hasAnother("spectrum_window")) {
+            spectrumWindow = win_node->getNext("spectrum_window")->element()->toString();
+        }
+
+        if (win_node->hasAnother("spectrum_overlap")) {
+            float overlapVal;
+            win_node->getNext("spectrum_overlap")->element()->get(overlapVal);
+            spectrumOverlap.store(overlapVal);
+        }
+
+        if (win_node->hasAnother("spectrum_fft_length")) {
+            int lengthVal;
+            win_node->getNext("spectrum_fft_length")->element()->get(lengthVal);
+            spectrumFFTLength.store(lengthVal);
+        }
+
+        if (win_node->hasAnother("demod_pool")) {
+            int poolVal;
+            win_node->getNext("demod_pool")->element()->get(poolVal);
+            demodThreadPool.store(poolVal?true:false);
+        }
+
+        if (win_node->hasAnother("fast_channelizer")) {
+            int fastVal;
+            win_node->getNext("fast_channelizer")->element()->get(fastVal);
+            fastChannelizer.store(fastVal?true:false);
+        }
+
+        if (win_node->hasAnother("stats_file")) {
+            statsFile = win_node->getNext("stats_file")->element()->toString();
+        }
+
+        if (win_node->hasAnother("stats_interval")) {
+            int intervalVal;
+            win_node->getNext("stats_interval")->element()->get(intervalVal);
+            statsInterval.store(intervalVal);
+        }
+
+        if (win_node->hasAnother("recording_path")) {
+            recordingPath = win_node->getNext("recording_path")->element()->toString();
+        }
+
+        if (win_node->hasAnother("recording_format")) {
+            recordingFormat = win_node->getNext("recording_format")->element()->toString();
+        }
+
+        if (win_node->hasAnother("recording_rotate_mb")) {
+            int rotateVal;
+            win_node->getNext("recording_rotate_mb")->element()->get(rotateVal);
+            recordingRotateSize.store(rotateVal);
+        }
+
+        if (win_node->hasAnother("recording_rotate_sec")) {
+            int rotateVal;
+            win_node->getNext("recording_rotate_sec")->element()->get(rotateVal);
+            recordingRotateSeconds.store(rotateVal);
+        }
+
+        if (win_node->hasAnother("audio_recording_format")) {
+            audioRecordingFormat = win_node->getNext("audio_recording_format")->element()->toString();
+        }
+
+        if (win_node->hasAnother("audio_recording_squelch_hang")) {
+            int hangVal;
+            win_node->getNext("audio_recording_squelch_hang")->element()->get(hangVal);
+            audioRecordingSquelchHang.store(hangVal);
+        }
+
+        if (win_node->hasAnother("fft_planner")) {
+            fftPlannerLevel = win_node->getNext("fft_planner")->element()->toString();
+        }
+
+        if (win_node->hasAnother("fft_threads")) {
+            int threadsVal;
+            win_node->getNext("fft_threads")->element()->get(threadsVal);
+            fftThreads.store(threadsVal);
+        }
     }
     
     if (cfg.rootNode()->hasAnother("devices")) {
@@ -514,6 +841,32 @@ bool AppConfig::load() {
         }
     }
     
+    if (cfg.rootNode()->hasAnother("thread_policies")) {
+        DataNode *threads_node = cfg.rootNode()->getNext("thread_policies");
+        
+        while (threads_node->hasAnother("thread")) {
+            DataNode *thread_node = threads_node->getNext("thread");
+            if (thread_node->hasAnother("role")) {
+                IOThreadPolicy threadPolicy;
+                std::string role = thread_node->getNext("role")->element()->toString();
+                
+                if (thread_node->hasAnother("policy")) {
+                    threadPolicy.policy = thread_node->getNext("policy")->element()->toString();
+                }
+                if (thread_node->hasAnother("priority")) {
+                    int prioVal;
+                    thread_node->getNext("priority")->element()->get(prioVal);
+                    threadPolicy.priority = prioVal;
+                }
+                if (thread_node->hasAnother("affinity")) {
+                    threadPolicy.affinity = thread_node->getNext("affinity")->element()->toString();
+                }
+                
+                IOThread::setThreadPolicy(role, threadPolicy);
+            }
+        }
+    }
+    
     if (cfg.rootNode()->hasAnother("manual_devices")) {
         DataNode *manuals_node = cfg.rootNode()->getNext("manual_devices");
         
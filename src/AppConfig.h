@@ -10,6 +10,7 @@
 #include "DataTree.h"
 #include "CubicSDRDefs.h"
 #include "SDRDeviceInfo.h"
+#include "IOThread.h"
 
 typedef std::map<std::string, std::string> ConfigSettings;
 
@@ -30,6 +31,10 @@ public:
     void setDeviceName(std::string deviceName);
     std::string getDeviceName();
 
+    // "" picks the device's native format, otherwise CF32, CS16 or CS8
+    void setStreamFormat(std::string streamFormat);
+    std::string getStreamFormat();
+
     void setStreamOpts(ConfigSettings opts);
     ConfigSettings getStreamOpts();
     void setStreamOpt(std::string key, std::string value);
@@ -49,6 +54,7 @@ public:
 private:
     std::string deviceId;
     std::string deviceName;
+    std::string streamFormat;
     std::mutex busy_lock;
 
     std::atomic_int ppm;
@@ -84,9 +90,67 @@ public:
     
     void setWaterfallLinesPerSec(int lps);
     int getWaterfallLinesPerSec();
+
+    void setWaterfallHistorySeconds(int seconds);
+    int getWaterfallHistorySeconds();
+
+    void setWaterfallHistoryMemory(int megabytes);
+    int getWaterfallHistoryMemory();
     
     void setSpectrumAvgSpeed(float avgSpeed);
     float getSpectrumAvgSpeed();
+
+    void setSpectrumWelch(bool welch);
+    bool getSpectrumWelch();
+
+    void setSpectrumWindow(std::string window);
+    std::string getSpectrumWindow();
+
+    void setSpectrumOverlap(float overlap);
+    float getSpectrumOverlap();
+
+    // main spectrum FFT length in bins, 0 follows the display size
+    void setSpectrumFFTLength(int fftLength);
+    int getSpectrumFFTLength();
+    
+    void setDemodThreadPool(bool pooled);
+    bool getDemodThreadPool();
+    
+    void setFastChannelizer(bool fastCh);
+    bool getFastChannelizer();
+    
+    void setStatsFile(std::string statsFile);
+    std::string getStatsFile();
+    
+    void setStatsInterval(int intervalMs);
+    int getStatsInterval();
+    
+    void setRecordingPath(std::string recordingPath);
+    std::string getRecordingPath();
+    
+    void setRecordingFormat(std::string recordingFormat);
+    std::string getRecordingFormat();
+    
+    void setRecordingRotateSize(int megabytes);
+    int getRecordingRotateSize();
+    
+    void setRecordingRotateSeconds(int seconds);
+    int getRecordingRotateSeconds();
+    
+    void setAudioRecordingFormat(std::string audioRecordingFormat);
+    std::string getAudioRecordingFormat();
+    
+    void setAudioRecordingSquelchHang(int milliseconds);
+    int getAudioRecordingSquelchHang();
+    
+    void setFFTPlannerLevel(std::string level);
+    std::string getFFTPlannerLevel();
+
+    void setFFTThreads(int threads);
+    int getFFTThreads();
+
+    void setThreadPolicy(std::string role, IOThreadPolicy policy);
+    IOThreadPolicy getThreadPolicy(std::string role);
     
     void setManualDevices(std::vector<SDRManualDef> manuals);
     std::vector<SDRManualDef> getManualDevices();
@@ -132,7 +196,22 @@ private:
     std::atomic_llong snap;
     std::atomic_llong centerFreq;
     std::atomic_int waterfallLinesPerSec;
+    std::atomic_int waterfallHistorySeconds, waterfallHistoryMemory;
     std::atomic<float> spectrumAvgSpeed;
+    std::atomic_bool spectrumWelch;
+    std::string spectrumWindow;
+    std::atomic<float> spectrumOverlap;
+    std::atomic_int spectrumFFTLength;
+    std::atomic_bool demodThreadPool;
+    std::atomic_bool fastChannelizer;
+    std::string statsFile;
+    std::atomic_int statsInterval;
+    std::string recordingPath, recordingFormat;
+    std::atomic_int recordingRotateSize, recordingRotateSeconds;
+    std::string audioRecordingFormat;
+    std::atomic_int audioRecordingSquelchHang;
+    std::string fftPlannerLevel;
+    std::atomic_int fftThreads;
     std::vector<SDRManualDef> manualDevices;
 #if USE_HAMLIB
     std::atomic_int rigModel, rigRate;
@@ -8,6 +8,7 @@
 
 #include "wx/numdlg.h"
 #include "wx/filedlg.h"
+#include "wx/dirdlg.h"
 
 #if !wxUSE_GLCANVAS
 #error "OpenGL required: set wxUSE_GLCANVAS to 1 and rebuild the library"
@@ -323,6 +324,9 @@ AppFrame::AppFrame() :
     menu->AppendSeparator();
     menu->Append(wxID_SDR_START_STOP, "Stop / Start Device");
     menu->AppendSeparator();
+    iqRecordMenuItem = menu->Append(wxID_IQ_RECORD, "Start IQ Recording");
+    menu->Append(wxID_IQ_RECORD_PATH, "IQ Recording Folder..");
+    menu->AppendSeparator();
     menu->Append(wxID_OPEN, "&Open Session");
     menu->Append(wxID_SAVE, "&Save Session");
     menu->Append(wxID_SAVEAS, "Save Session &As..");
@@ -443,6 +447,17 @@ AppFrame::AppFrame() :
 
     menuBar->Append(menu, wxT("Audio &Sample Rate"));
 
+    menu = new wxMenu;
+
+    int fftLength = wxGetApp().getConfig()->getSpectrumFFTLength();
+
+    menu->AppendRadioItem(wxID_SPECTRUM_FFT_LENGTH_AUTO, "FFT Length: Auto")->Check(fftLength==0);
+    menu->AppendRadioItem(wxID_SPECTRUM_FFT_LENGTH_256K, "FFT Length: 256K bins")->Check(fftLength==(1 << 18));
+    menu->AppendRadioItem(wxID_SPECTRUM_FFT_LENGTH_512K, "FFT Length: 512K bins")->Check(fftLength==(1 << 19));
+    menu->AppendRadioItem(wxID_SPECTRUM_FFT_LENGTH_1M, "FFT Length: 1M bins")->Check(fftLength==(1 << 20));
+
+    menuBar->Append(menu, wxT("S&pectrum"));
+
 #ifdef USE_HAMLIB
             
     rigModel = wxGetApp().getConfig()->getRigModel();
@@ -548,12 +563,21 @@ AppFrame::AppFrame() :
             
     spectrumAvgMeter->setLevel(spectrumAvg);
     wxGetApp().getSpectrumProcessor()->setFFTAverageRate(spectrumAvg);
+
+    SpectrumVisualProcessor *welchProcs[2] = { wxGetApp().getSpectrumProcessor(), waterfallDataThread->getProcessor() };
+    for (int i = 0; i < 2; i++) {
+        welchProcs[i]->setWelchWindow(wxGetApp().getConfig()->getSpectrumWindow());
+        welchProcs[i]->setWelchOverlap(wxGetApp().getConfig()->getSpectrumOverlap());
+        welchProcs[i]->setWelch(wxGetApp().getConfig()->getSpectrumWelch());
+    }
+    wxGetApp().getSpectrumProcessor()->setFFTLength(wxGetApp().getConfig()->getSpectrumFFTLength());
             
     int wflps =wxGetApp().getConfig()->getWaterfallLinesPerSec();
             
     waterfallSpeedMeter->setLevel(sqrt(wflps));
     waterfallDataThread->setLinesPerSecond(wflps);
     waterfallCanvas->setLinesPerSecond(wflps);
+    waterfallCanvas->setHistory(wxGetApp().getConfig()->getWaterfallHistorySeconds(), wxGetApp().getConfig()->getWaterfallHistoryMemory());
             
     ThemeMgr::mgr.setTheme(wxGetApp().getConfig()->getTheme());
             
@@ -779,6 +803,19 @@ void AppFrame::OnMenu(wxCommandEvent& event) {
                 wxGetApp().setDevice(dev);
             }
         }
+        iqRecordMenuItem->SetItemLabel("Start IQ Recording");
+    } else if (event.GetId() == wxID_IQ_RECORD) {
+        if (wxGetApp().isIQRecording()) {
+            wxGetApp().stopIQRecording();
+        } else if (!wxGetApp().startIQRecording()) {
+            wxMessageBox("Start a device before recording.", "IQ Recording", wxOK | wxICON_INFORMATION, this);
+        }
+        iqRecordMenuItem->SetItemLabel(wxGetApp().isIQRecording()?"Stop IQ Recording":"Start IQ Recording");
+    } else if (event.GetId() == wxID_IQ_RECORD_PATH) {
+        wxString recordingPath = wxDirSelector("Choose a folder for IQ recordings", wxGetApp().getConfig()->getRecordingPath(), wxDD_DEFAULT_STYLE, wxDefaultPosition, this);
+        if (!recordingPath.empty()) {
+            wxGetApp().getConfig()->setRecordingPath(recordingPath.ToStdString());
+        }
     } else if (event.GetId() == wxID_SET_TIPS ) {
         if (wxGetApp().getConfig()->getShowTips()) {
             wxGetApp().getConfig()->setShowTips(false);
@@ -879,6 +916,11 @@ void AppFrame::OnMenu(wxCommandEvent& event) {
         ThemeMgr::mgr.setTheme(COLOR_THEME_HD);
     } else if (event.GetId() == wxID_THEME_RADAR) {
         ThemeMgr::mgr.setTheme(COLOR_THEME_RADAR);
+    } else if (event.GetId() >= wxID_SPECTRUM_FFT_LENGTH_AUTO && event.GetId() <= wxID_SPECTRUM_FFT_LENGTH_1M) {
+        // main spectrum only, the waterfall keeps the display size
+        int fftLength = (event.GetId() == wxID_SPECTRUM_FFT_LENGTH_AUTO)?0:((1 << 18) << (event.GetId() - wxID_SPECTRUM_FFT_LENGTH_256K));
+        wxGetApp().getConfig()->setSpectrumFFTLength(fftLength);
+        wxGetApp().getSpectrumProcessor()->setFFTLength(fftLength);
     }
 
     if (event.GetId() >= wxID_SETTINGS_BASE && event.GetId() < settingsIdMax) {
@@ -1522,6 +1564,7 @@ void AppFrame::saveSession(std::string fileName) {
         *demod->newChild("output_device") = outputDevices[(*instance_i)->getOutputDevice()].name;
         *demod->newChild("gain") = (*instance_i)->getGain();
         *demod->newChild("muted") = (*instance_i)->isMuted() ? 1 : 0;
+        *demod->newChild("recording") = (*instance_i)->isRecording() ? 1 : 0;
         if ((*instance_i)->isDeltaLock()) {
             *demod->newChild("delta_lock") = (*instance_i)->isDeltaLock() ? 1 : 0;
             *demod->newChild("delta_ofs") = (*instance_i)->getDeltaLockOfs();
@@ -1599,6 +1642,7 @@ bool AppFrame::loadSession(std::string fileName) {
             float squelch_level = demod->hasAnother("squelch_level") ? (float) *demod->getNext("squelch_level") : 0;
             int squelch_enabled = demod->hasAnother("squelch_enabled") ? (int) *demod->getNext("squelch_enabled") : 0;
             int muted = demod->hasAnother("muted") ? (int) *demod->getNext("muted") : 0;
+            int recording = demod->hasAnother("recording") ? (int) *demod->getNext("recording") : 0;
             int delta_locked = demod->hasAnother("delta_lock") ? (int) *demod->getNext("delta_lock") : 0;
             int delta_ofs = demod->hasAnother("delta_ofs") ? (int) *demod->getNext("delta_ofs") : 0;
             std::string output_device = demod->hasAnother("output_device") ? string(*(demod->getNext("output_device"))) : "";
@@ -1663,6 +1707,9 @@ bool AppFrame::loadSession(std::string fileName) {
             newDemod->setGain(gain);
             newDemod->updateLabel(freq);
             newDemod->setMuted(muted?true:false);
+            if (recording) {
+                newDemod->setRecording(true);
+            }
             if (delta_locked) {
                 newDemod->setDeltaLock(true);
                 newDemod->setDeltaLockOfs(delta_ofs);
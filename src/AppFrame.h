@@ -31,6 +31,8 @@
 #define wxID_SDR_DEVICES 2008
 #define wxID_AGC_CONTROL 2009
 #define wxID_SDR_START_STOP 2010
+#define wxID_IQ_RECORD 2011
+#define wxID_IQ_RECORD_PATH 2012
 
 #define wxID_MAIN_SPLITTER 2050
 #define wxID_VIS_SPLITTER 2051
@@ -43,6 +45,11 @@
 #define wxID_THEME_HD 2105
 #define wxID_THEME_RADAR 2106
 
+#define wxID_SPECTRUM_FFT_LENGTH_AUTO 2110
+#define wxID_SPECTRUM_FFT_LENGTH_256K 2111
+#define wxID_SPECTRUM_FFT_LENGTH_512K 2112
+#define wxID_SPECTRUM_FFT_LENGTH_1M 2113
+
 #define wxID_BANDWIDTH_BASE 2150
 #define wxID_BANDWIDTH_MANUAL 2200
 
@@ -134,6 +141,7 @@ private:
     wxMenu *sampleRateMenu;
     wxMenuItem *agcMenuItem;
     wxMenuItem *iqSwapMenuItem;
+    wxMenuItem *iqRecordMenuItem;
     wxMenu *settingsMenu;
     SoapySDR::ArgInfoList settingArgs;
     int settingsIdMax;
@@ -13,6 +13,9 @@
 
 #include "CubicSDR.h"
 #include <iomanip>
+#include "PipelineStats.h"
+#include "FFTPlanner.h"
+#include <wx/stdpaths.h>
 
 #ifdef _OSX_APP_
 #include "CoreFoundation/CoreFoundation.h"
@@ -131,7 +134,7 @@ long long strToFrequency(std::string freqStr) {
 
 
 CubicSDR::CubicSDR() : appframe(NULL), m_glContext(NULL), frequency(0), offset(0), ppm(0), snap(1), sampleRate(DEFAULT_SAMPLE_RATE),
-    sdrThread(NULL), sdrPostThread(NULL), spectrumVisualThread(NULL), demodVisualThread(NULL), pipeSDRIQData(NULL), pipeIQVisualData(NULL), pipeAudioVisualData(NULL), t_SDR(NULL), t_PostSDR(NULL) {
+    sdrThread(NULL), sdrPostThread(NULL), iqRecorderThread(NULL), audioRecorderThread(NULL), spectrumVisualThread(NULL), demodVisualThread(NULL), pipeSDRIQData(NULL), pipeIQRecordData(NULL), pipeIQVisualData(NULL), pipeAudioVisualData(NULL), t_SDR(NULL), t_PostSDR(NULL), t_IQRecorder(NULL), t_AudioRecorder(NULL) {
         sampleRateInitialized.store(false);
         agcMode.store(true);
         soloMode.store(false);
@@ -233,7 +236,7 @@ bool CubicSDR::OnInit() {
     scopeProcessor.setInput(pipeAudioVisualData);
     
     // I/Q Data
-    pipeSDRIQData = new SDRThreadIQDataQueue();
+    pipeSDRIQData = new SDRThreadIQDataQueue(SDR_IQ_PIPE_RING_SIZE);
     pipeSDRIQData->set_max_num_items(100);
     
     sdrThread = new SDRThread();
@@ -245,7 +248,19 @@ bool CubicSDR::OnInit() {
     sdrPostThread->setOutputQueue("IQDataOutput", pipeWaterfallIQVisualData);
     sdrPostThread->setOutputQueue("IQActiveDemodVisualDataOutput", pipeDemodIQVisualData);
     
+    // raw IQ recording; the post thread hands blocks over through a ring and never waits on it
+    pipeIQRecordData = new SDRThreadIQDataQueue(IQ_RECORD_QUEUE_SIZE);
+    sdrPostThread->setOutputQueue("IQRecordDataOutput", pipeIQRecordData);
+
+    iqRecorderThread = new IQRecorderThread();
+    iqRecorderThread->setInputQueue("IQDataInput", pipeIQRecordData);
+    
     t_PostSDR = new std::thread(&SDRPostThread::threadMain, sdrPostThread);
+    t_IQRecorder = new std::thread(&IQRecorderThread::threadMain, iqRecorderThread);
+
+    // shared writer for per-demodulator audio recording, see DemodulatorInstance::setRecording()
+    audioRecorderThread = new AudioRecorderThread();
+    t_AudioRecorder = new std::thread(&AudioRecorderThread::threadMain, audioRecorderThread);
     t_SpectrumVisual = new std::thread(&SpectrumVisualDataThread::threadMain, spectrumVisualThread);
     t_DemodVisual = new std::thread(&SpectrumVisualDataThread::threadMain, demodVisualThread);
 
@@ -270,6 +285,8 @@ bool CubicSDR::OnInit() {
 }
 
 int CubicSDR::OnExit() {
+    PipelineStats::stopDump();
+
 #if USE_HAMLIB
     if (rigIsActive()) {
         std::cout << "Terminating Rig thread.." << std::endl;
@@ -290,6 +307,14 @@ int CubicSDR::OnExit() {
     sdrPostThread->terminate();
     t_PostSDR->join();
     
+    std::cout << "Terminating IQ recorder thread.." << std::endl;
+    iqRecorderThread->terminate();
+    t_IQRecorder->join();
+
+    std::cout << "Terminating audio recorder thread.." << std::endl;
+    audioRecorderThread->terminate();
+    t_AudioRecorder->join();
+    
     std::cout << "Terminating Visual Processor threads.." << std::endl;
     spectrumVisualThread->terminate();
     t_SpectrumVisual->join();
@@ -297,11 +322,19 @@ int CubicSDR::OnExit() {
     demodVisualThread->terminate();
     t_DemodVisual->join();
 
+    FFTPlanner::saveWisdom(config.getConfigDir());
+
     delete sdrThread;
 
     delete sdrPostThread;
     delete t_PostSDR;
 
+    delete iqRecorderThread;
+    delete t_IQRecorder;
+
+    delete audioRecorderThread;
+    delete t_AudioRecorder;
+
     delete t_SpectrumVisual;
     delete spectrumVisualThread;
     delete t_DemodVisual;
@@ -310,6 +343,7 @@ int CubicSDR::OnExit() {
     delete pipeIQVisualData;
     delete pipeAudioVisualData;
     delete pipeSDRIQData;
+    delete pipeIQRecordData;
 
     delete m_glContext;
 
@@ -345,6 +379,22 @@ bool CubicSDR::OnCmdLineParsed(wxCmdLineParser& parser) {
     
     config.load();
 
+    // before any visual processor or channelizer plans its FFTs
+    FFTPlanner::setLevel(config.getFFTPlannerLevel());
+    FFTPlanner::setThreads(config.getFFTThreads());
+    FFTPlanner::loadWisdom(config.getConfigDir());
+
+    std::string statsFile = config.getStatsFile();
+    wxString *statsName = new wxString;
+    if (parser.Found("s",statsName)) {
+        if (statsName) {
+            statsFile = statsName->ToStdString();
+        }
+    }
+    if (statsFile != "") {
+        PipelineStats::startDump(statsFile, config.getStatsInterval());
+    }
+
 #ifdef BUNDLE_SOAPY_MODS
     if (parser.Found("b")) {
         useLocalMod.store(false);
@@ -505,6 +555,7 @@ void CubicSDR::stopDevice(bool store) {
     } else {
         stoppedDev = nullptr;
     }
+    stopIQRecording();
     sdrThread->setDevice(nullptr);
 
     if (!sdrThread->isTerminated()) {
@@ -563,6 +614,12 @@ void CubicSDR::setDevice(SDRDeviceInfo *dev) {
             frequency = sampleRate/2;
         }
 
+        // file playback starts at the frequency it was recorded at
+        SoapySDR::Kwargs devArgs = dev->getDeviceArgs();
+        if (dev->getDriver() == SDR_FILE_DEVICE_DRIVER && devArgs.count("freq")) {
+            frequency = (long long)atof(devArgs["freq"].c_str());
+        }
+
         setFrequency(frequency);
         setSampleRate(sampleRate);
 
@@ -619,6 +676,42 @@ SDRThread *CubicSDR::getSDRThread() {
     return sdrThread;
 }
 
+bool CubicSDR::startIQRecording() {
+    if (sdrThread->isTerminated()) {
+        return false;
+    }
+
+    SDRDeviceInfo *dev = getDevice();
+    iqRecorderThread->setDeviceInfo(dev?dev->getName():"", sdrThread->getGains());
+    iqRecorderThread->setFormat(config.getRecordingFormat());
+    iqRecorderThread->setRotateSize(config.getRecordingRotateSize());
+    iqRecorderThread->setRotateSeconds(config.getRecordingRotateSeconds());
+    iqRecorderThread->startRecording(getIQRecordingPath());
+
+    sdrPostThread->setIQRecording(true);
+    return true;
+}
+
+void CubicSDR::stopIQRecording() {
+    sdrPostThread->setIQRecording(false);
+    iqRecorderThread->stopRecording();
+}
+
+bool CubicSDR::isIQRecording() {
+    return iqRecorderThread->isRecording();
+}
+
+std::string CubicSDR::getIQRecordingPath() {
+    std::string recordingPath = config.getRecordingPath();
+    if (recordingPath == "") {
+        recordingPath = wxStandardPaths::Get().GetDocumentsDir().ToStdString();
+    }
+    return recordingPath;
+}
+
+AudioRecorderThread *CubicSDR::getAudioRecorderThread() {
+    return audioRecorderThread;
+}
 
 void CubicSDR::bindDemodulator(DemodulatorInstance *demod) {
     if (!demod) {
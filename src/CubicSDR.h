@@ -17,6 +17,9 @@
     #include "SDREnumerator.h"
 #endif
 #include "SDRPostThread.h"
+#include "IQRecorderThread.h"
+#include "AudioRecorderThread.h"
+#include "SDRFileDevice.h"
 #include "AudioThread.h"
 #include "DemodulatorMgr.h"
 #include "AppConfig.h"
@@ -113,6 +116,13 @@ public:
     SDRPostThread *getSDRPostThread();
     SDRThread *getSDRThread();
 
+    bool startIQRecording();
+    void stopIQRecording();
+    bool isIQRecording();
+    std::string getIQRecordingPath();
+
+    AudioRecorderThread *getAudioRecorderThread();
+
     void bindDemodulator(DemodulatorInstance *demod);
     void removeDemodulator(DemodulatorInstance *demod);
 
@@ -185,10 +195,13 @@ private:
     SDRThread *sdrThread;
     SDREnumerator *sdrEnum;
     SDRPostThread *sdrPostThread;
+    IQRecorderThread *iqRecorderThread;
+    AudioRecorderThread *audioRecorderThread;
     SpectrumVisualDataThread *spectrumVisualThread;
     SpectrumVisualDataThread *demodVisualThread;
 
     SDRThreadIQDataQueue* pipeSDRIQData;
+    SDRThreadIQDataQueue* pipeIQRecordData;
     DemodulatorThreadInputQueue* pipeIQVisualData;
     DemodulatorThreadOutputQueue* pipeAudioVisualData;
     DemodulatorThreadInputQueue* pipeDemodIQVisualData;
@@ -202,7 +215,7 @@ private:
     SoapySDR::Kwargs streamArgs;
     SoapySDR::Kwargs settingArgs;
     
-    std::thread *t_SDR, *t_SDREnum, *t_PostSDR, *t_SpectrumVisual, *t_DemodVisual;
+    std::thread *t_SDR, *t_SDREnum, *t_PostSDR, *t_IQRecorder, *t_AudioRecorder, *t_SpectrumVisual, *t_DemodVisual;
     std::atomic_bool devicesReady;
     std::atomic_bool devicesFailed;
     std::atomic_bool deviceSelectorOpen;
@@ -227,6 +240,7 @@ static const wxCmdLineEntryDesc commandLineInfo [] =
 {
     { wxCMD_LINE_SWITCH, "h", "help", "Command line parameter help", wxCMD_LINE_VAL_NONE, wxCMD_LINE_OPTION_HELP },
     { wxCMD_LINE_OPTION, "c", "config", "Specify a named configuration to use, i.e. '-c ham'", wxCMD_LINE_VAL_STRING, 0 },
+    { wxCMD_LINE_OPTION, "s", "stats", "Append pipeline statistics to a file periodically, i.e. '-s stats.txt'", wxCMD_LINE_VAL_STRING, 0 },
     { wxCMD_LINE_OPTION, "m", "modpath", "Load modules from suppplied path, i.e. '-m ~/SoapyMods/'", wxCMD_LINE_VAL_STRING, 0 },
 #ifdef BUNDLE_SOAPY_MODS
     { wxCMD_LINE_SWITCH, "b", "bundled", "Use bundled SoapySDR modules first instead of local.", wxCMD_LINE_VAL_NONE, 0 },
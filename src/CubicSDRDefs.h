@@ -37,4 +37,12 @@ const char filePathSeparator =
 
 #define CHANNELIZER_RATE_MAX 500000
 
+// slot counts for the ring-backed sample pipes (SDR -> post -> demod pre -> demod -> audio)
+#define SDR_IQ_PIPE_RING_SIZE 128
+#define DEMOD_IQ_PIPE_RING_SIZE 256
+#define DEMOD_AUDIO_PIPE_RING_SIZE 256
+
+// max IQ blocks a pooled demodulator handles per scheduling turn before yielding its worker
+#define DEMOD_POOL_TASK_BATCH 8
+
 
@@ -1,4 +1,93 @@
 #include "IOThread.h"
+#include "PipelineStats.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#endif
+
+std::mutex ReBufferBase::registry_busy;
+std::vector<ReBufferBase *> ReBufferBase::registry;
+
+std::mutex IOThread::policy_busy;
+std::map<std::string, IOThreadPolicy, map_string_less> IOThread::policies;
+
+ReBufferBase::ReBufferBase(std::string bufferId) : bufferId(bufferId) {
+    returnedBuffers.store(nullptr);
+    allocatedCount.store(0);
+    inFlightCount.store(0);
+    peakCount.store(0);
+    trimmedCount.store(0);
+    highWaterCount.store(REBUFFER_GC_LIMIT);
+
+    std::lock_guard < std::mutex > lock(registry_busy);
+    registry.push_back(this);
+}
+
+ReBufferBase::~ReBufferBase() {
+    std::lock_guard < std::mutex > lock(registry_busy);
+    std::vector<ReBufferBase *>::iterator i = std::find(registry.begin(), registry.end(), this);
+    if (i != registry.end()) {
+        registry.erase(i);
+    }
+}
+
+void ReBufferBase::pushReturned(ReferenceCounter *buf) {
+    ReferenceCounter *head = returnedBuffers.load(std::memory_order_relaxed);
+    do {
+        buf->poolNext = head;
+    } while (!returnedBuffers.compare_exchange_weak(head, buf, std::memory_order_release, std::memory_order_relaxed));
+    inFlightCount--;
+}
+
+void ReBufferBase::setHighWater(size_t highWater) {
+    highWaterCount.store(highWater);
+}
+
+size_t ReBufferBase::getHighWater() {
+    return highWaterCount.load();
+}
+
+std::string ReBufferBase::getBufferId() {
+    return bufferId;
+}
+
+ReBufferStats ReBufferBase::getStats() {
+    ReBufferStats stats;
+    stats.bufferId = bufferId;
+    stats.pools = 1;
+    stats.allocated = allocatedCount.load();
+    stats.inFlight = inFlightCount.load();
+    stats.peak = peakCount.load();
+    stats.trimmed = trimmedCount.load();
+    return stats;
+}
+
+std::vector<ReBufferStats> ReBufferBase::getAllStats() {
+    std::map<std::string, ReBufferStats, map_string_less> statsById;
+
+    registry_busy.lock();
+    for (std::vector<ReBufferBase *>::iterator i = registry.begin(); i != registry.end(); i++) {
+        ReBufferStats poolStats = (*i)->getStats();
+        ReBufferStats &idStats = statsById[poolStats.bufferId];
+        idStats.bufferId = poolStats.bufferId;
+        idStats.pools += poolStats.pools;
+        idStats.allocated += poolStats.allocated;
+        idStats.inFlight += poolStats.inFlight;
+        idStats.peak += poolStats.peak;
+        idStats.trimmed += poolStats.trimmed;
+    }
+    registry_busy.unlock();
+
+    std::vector<ReBufferStats> result;
+    for (std::map<std::string, ReBufferStats, map_string_less>::iterator i = statsById.begin(); i != statsById.end(); i++) {
+        result.push_back(i->second);
+    }
+    return result;
+}
 
 IOThread::IOThread() {
     terminated.store(false);
@@ -12,6 +101,7 @@ IOThread::~IOThread() {
 void *IOThread::threadMain() {
     terminated.store(false);
     run();
+    PipelineStats::threadEnd();
     return this;
 };
 
@@ -22,6 +112,7 @@ void *IOThread::pthread_helper(void *context) {
 void IOThread::threadMain() {
     terminated.store(false);
     run();
+    PipelineStats::threadEnd();
 };
 #endif
 
@@ -47,6 +138,9 @@ void IOThread::onBindInput(std::string /* name */, ThreadQueueBase* /* threadQue
 
 void IOThread::setInputQueue(std::string qname, ThreadQueueBase *threadQueue) {
     input_queues[qname] = threadQueue;
+    if (threadQueue && threadQueue->get_stats_name().empty()) {
+        threadQueue->set_stats_name(qname);
+    }
     this->onBindInput(qname, threadQueue);
 };
 
@@ -56,6 +150,9 @@ void *IOThread::getInputQueue(std::string qname) {
 
 void IOThread::setOutputQueue(std::string qname, ThreadQueueBase *threadQueue) {
     output_queues[qname] = threadQueue;
+    if (threadQueue && threadQueue->get_stats_name().empty()) {
+        threadQueue->set_stats_name(qname);
+    }
     this->onBindOutput(qname, threadQueue);
 };
 
@@ -66,3 +163,142 @@ void *IOThread::getOutputQueue(std::string qname) {
 bool IOThread::isTerminated() {
     return terminated.load();
 }
+
+
+std::vector<std::string> IOThread::getThreadRoles() {
+    std::vector<std::string> roles;
+    roles.push_back("sdr");
+    roles.push_back("post");
+    // ignored while the demodulator thread pool is on: its workers run both stages as "demod"
+    roles.push_back("demod-pre");
+    roles.push_back("demod");
+    roles.push_back("audio");
+    roles.push_back("visual");
+    roles.push_back("record");
+    return roles;
+}
+
+void IOThread::setThreadPolicy(std::string role, IOThreadPolicy policy) {
+    std::lock_guard < std::mutex > lock(policy_busy);
+    policies[role] = policy;
+}
+
+IOThreadPolicy IOThread::getThreadPolicy(std::string role) {
+    std::lock_guard < std::mutex > lock(policy_busy);
+    std::map<std::string, IOThreadPolicy, map_string_less>::iterator i = policies.find(role);
+    if (i != policies.end()) {
+        return i->second;
+    }
+    return IOThreadPolicy();
+}
+
+#ifndef _WIN32
+static bool parseCPUList(std::string list, std::vector<int> &cpus) {
+    size_t pos = 0;
+    while (pos < list.length()) {
+        size_t next = list.find(',', pos);
+        if (next == std::string::npos) {
+            next = list.length();
+        }
+        std::string item = list.substr(pos, next - pos);
+        pos = next + 1;
+        if (item.empty()) {
+            continue;
+        }
+        size_t dash = item.find('-');
+        char *end;
+        int first = (int)strtol(item.c_str(), &end, 10);
+        int last = first;
+        if (dash != std::string::npos) {
+            last = (int)strtol(item.c_str() + dash + 1, &end, 10);
+        }
+        if (*end != '\0' || first < 0 || last < first) {
+            return false;
+        }
+        for (int c = first; c <= last; c++) {
+            cpus.push_back(c);
+        }
+    }
+    return !cpus.empty();
+}
+#endif
+
+void IOThread::applyThreadPolicy(std::string role) {
+    IOThreadPolicy threadPolicy = getThreadPolicy(role);
+
+    PipelineStats::threadBegin(role);
+
+#ifndef _WIN32
+    pthread_t tID = pthread_self();
+    std::string threadName = "cubic-" + role;
+
+#if defined(__APPLE__)
+    pthread_setname_np(threadName.c_str());
+#elif defined(__linux__)
+    // Linux limits names to 15 characters plus terminator
+    pthread_setname_np(tID, threadName.substr(0, 15).c_str());
+#endif
+
+    std::string policyName = threadPolicy.policy;
+#ifdef __APPLE__
+    // keep the real-time priorities these threads have always had on OSX
+    if (policyName == "default") {
+        if (role == "post" || role == "demod-pre" || role == "demod") {
+            policyName = "fifo";
+            threadPolicy.priority = (role == "post")?0:-1;
+        } else if (role == "audio") {
+            policyName = "rr";
+            threadPolicy.priority = -1;
+        }
+    }
+#endif
+
+    if (policyName == "fifo" || policyName == "rr") {
+        int policy = (policyName == "fifo")?SCHED_FIFO:SCHED_RR;
+        int prioMax = sched_get_priority_max(policy);
+        int prioMin = sched_get_priority_min(policy);
+        int priority = (threadPolicy.priority <= 0)?(prioMax + threadPolicy.priority):threadPolicy.priority;
+        priority = std::max(prioMin, std::min(prioMax, priority));
+
+        sched_param prio;
+        memset(&prio, 0, sizeof(prio));
+        prio.sched_priority = priority;
+
+        int err = pthread_setschedparam(tID, policy, &prio);
+        if (err) {
+            std::cout << "Thread '" << role << "': unable to set " << policyName << " priority " << priority << " (" << strerror(err) << "), using default scheduling." << std::endl;
+        } else {
+            std::cout << "Thread '" << role << "': " << policyName << " priority " << priority << std::endl;
+        }
+    } else if (policyName != "default") {
+        std::cout << "Thread '" << role << "': unknown scheduling policy '" << policyName << "', using default scheduling." << std::endl;
+    }
+
+    if (!threadPolicy.affinity.empty()) {
+        std::vector<int> cpus;
+        if (!parseCPUList(threadPolicy.affinity, cpus)) {
+            std::cout << "Thread '" << role << "': invalid CPU list '" << threadPolicy.affinity << "', affinity not set." << std::endl;
+        } else {
+#ifdef __linux__
+            cpu_set_t cpuSet;
+            CPU_ZERO(&cpuSet);
+            for (std::vector<int>::iterator i = cpus.begin(); i != cpus.end(); i++) {
+                if (*i < CPU_SETSIZE) {
+                    CPU_SET(*i, &cpuSet);
+                }
+            }
+            int err = pthread_setaffinity_np(tID, sizeof(cpuSet), &cpuSet);
+            if (err) {
+                std::cout << "Thread '" << role << "': unable to set CPU affinity '" << threadPolicy.affinity << "' (" << strerror(err) << ")." << std::endl;
+            }
+#else
+            std::cout << "Thread '" << role << "': CPU affinity is not supported on this platform." << std::endl;
+#endif
+        }
+    }
+#else
+    if (threadPolicy.policy != "default" || !threadPolicy.affinity.empty()) {
+        std::cout << "Thread '" << role << "': custom thread policies are not supported on this platform." << std::endl;
+    }
+#endif
+}
@@ -1,9 +1,12 @@
 #pragma once
 
 #include <mutex>
+#include <thread>
 #include <atomic>
 #include <deque>
+#include <vector>
 #include <map>
+#include <algorithm>
 #include <string>
 #include <iostream>
 
@@ -19,81 +22,259 @@ struct map_string_less : public std::binary_function<std::string,std::string,boo
 };
 
 
+class ReBufferBase;
+
 class ReferenceCounter {
 public:
     mutable std::mutex m_mutex;
     
+    ReferenceCounter() : poolNext(nullptr), poolIndex(0) {
+        refCount.store(0);
+        pool.store(nullptr);
+        poolFree.store(false);
+        poolReleasing.store(false);
+    }
+    
     void setRefCount(int rc) {
-        refCount.store(rc);
+        int prevCount = refCount.exchange(rc);
+        if (rc <= 0 && prevCount > 0) {
+            releaseToPool();
+        }
     }
     
     void decRefCount() {
-        refCount.store(refCount.load()-1);
+        if (refCount.fetch_sub(1) == 1) {
+            releaseToPool();
+        }
     }
     
     int getRefCount() {
         return refCount.load();
     }
+
+    // gives a buffer that was never handed a reference (count still zero) back to its pool
+    void discard() {
+        if (refCount.load() <= 0) {
+            releaseToPool();
+        }
+    }
 protected:
     std::atomic_int refCount;
+
+private:
+    friend class ReBufferBase;
+    template<class BufferType> friend class ReBuffer;
+
+    void releaseToPool();
+
+    std::atomic<ReBufferBase *> pool;
+    ReferenceCounter *poolNext;
+    // slot in the owning pool's buffer list, only touched by the owning thread
+    size_t poolIndex;
+    std::atomic_bool poolFree;
+    // set while releaseToPool() may still touch the owning pool
+    std::atomic_bool poolReleasing;
 };
 
 
 #define REBUFFER_GC_LIMIT 100
+#define REBUFFER_WARNING_THRESHOLD 100
+
+class ReBufferStats {
+public:
+    std::string bufferId;
+    size_t pools;
+    size_t allocated;
+    size_t inFlight;
+    size_t peak;
+    size_t trimmed;
+
+    ReBufferStats() : pools(0), allocated(0), inFlight(0), peak(0), trimmed(0) {
+        
+    }
+};
+
+/**
+ * Non-template part of ReBuffer: the lock-free return stack that buffers push themselves
+ * onto when their reference count drops to zero, plus per-pool counters.
+ */
+class ReBufferBase {
+public:
+    ReBufferBase(std::string bufferId);
+    virtual ~ReBufferBase();
+    
+    void setHighWater(size_t highWater);
+    size_t getHighWater();
+    
+    std::string getBufferId();
+    ReBufferStats getStats();
+    
+    // counters of all live pools, summed per buffer id
+    static std::vector<ReBufferStats> getAllStats();
+
+protected:
+    std::string bufferId;
+    std::atomic<ReferenceCounter *> returnedBuffers;
+    std::atomic_size_t allocatedCount, inFlightCount, peakCount, trimmedCount, highWaterCount;
+    
+private:
+    friend class ReferenceCounter;
 
+    // push onto the return stack, from any thread
+    void pushReturned(ReferenceCounter *buf);
+
+    static std::mutex registry_busy;
+    static std::vector<ReBufferBase *> registry;
+};
+
+inline void ReferenceCounter::releaseToPool() {
+    // raised before the owner is read: a pool that is going away either is not seen here
+    // or sees the flag and waits until the push is done
+    poolReleasing.store(true);
+    ReBufferBase *owner = pool.load();
+    if (owner && !poolFree.exchange(true)) {
+        owner->pushReturned(this);
+    }
+    poolReleasing.store(false);
+}
+
+/**
+ * Pool of reference counted buffers.  getBuffer() is O(1) and must only be called from the
+ * owning thread; buffers may be released (refcount reaching zero) from any thread.  Free
+ * buffers in excess of the high-water mark are deleted instead of being reused.
+ *
+ * A buffer only comes back to the pool through a release, never by being found idle, so every
+ * buffer from getBuffer() must end in exactly one of:
+ *  - setRefCount(n > 0) and one decRefCount() per reference; a reference whose push() to a
+ *    queue fails must be dropped with decRefCount() on the spot,
+ *  - returnBuffer() on the owning thread, or discard() elsewhere, if it was never handed out.
+ * A caller that bails out between getBuffer() and setRefCount() without one of these leaks
+ * the buffer for the life of the pool.
+ *
+ * purge() and the destructor delete the free buffers and detach the ones still in flight:
+ * those stay valid for their holders and are freed with neither the pool nor their last
+ * decRefCount() (the pool may already be gone), i.e. they leak rather than dangle.
+ */
 template<class BufferType = ReferenceCounter>
-class ReBuffer {
+class ReBuffer : public ReBufferBase {
     
 public:
-    ReBuffer(std::string bufferId) : bufferId(bufferId) {
+    ReBuffer(std::string bufferId) : ReBufferBase(bufferId), freeBuffers(nullptr) {
         
     }
     
+    ~ReBuffer() {
+        purge();
+    }
+    
     BufferType *getBuffer() {
-        BufferType* buf = NULL;
-        for (outputBuffersI = outputBuffers.begin(); outputBuffersI != outputBuffers.end(); outputBuffersI++) {
-            if (!buf && (*outputBuffersI)->getRefCount() <= 0) {
-                buf = (*outputBuffersI);
-                (*outputBuffersI)->setRefCount(0);
-            } else if ((*outputBuffersI)->getRefCount() <= 0) {
-                (*outputBuffersI)->decRefCount();
-            }
+        if (!freeBuffers) {
+            freeBuffers = returnedBuffers.exchange(nullptr);
+        }
+
+        size_t highWater = highWaterCount.load();
+        while (highWater && freeBuffers && allocatedCount.load() > highWater) {
+            BufferType *ref = static_cast<BufferType *>(freeBuffers);
+            freeBuffers = ref->poolNext;
+            removeBuffer(ref);
+            delete ref;
+            allocatedCount--;
+            trimmedCount++;
         }
         
-        if (buf) {
-            if (outputBuffers.back()->getRefCount() < -REBUFFER_GC_LIMIT) {
-                BufferType *ref = outputBuffers.back();
-                outputBuffers.pop_back();
-                delete ref;
+        BufferType* buf = NULL;
+
+        if (freeBuffers) {
+            buf = static_cast<BufferType *>(freeBuffers);
+            freeBuffers = buf->poolNext;
+            buf->poolNext = nullptr;
+        } else {
+            if (outputBuffers.size() > REBUFFER_WARNING_THRESHOLD) {
+                std::cout << "Warning: ReBuffer '" << bufferId << "' count '" << outputBuffers.size() << "' exceeds threshold of '" << REBUFFER_WARNING_THRESHOLD << "'" << std::endl;
             }
-            return buf;
+
+            buf = new BufferType();
+            buf->pool.store(this);
+            buf->poolIndex = outputBuffers.size();
+            outputBuffers.push_back(buf);
+            allocatedCount++;
         }
         
-#define REBUFFER_WARNING_THRESHOLD 100
-        if (outputBuffers.size() > REBUFFER_WARNING_THRESHOLD) {
-            std::cout << "Warning: ReBuffer '" << bufferId << "' count '" << outputBuffers.size() << "' exceeds threshold of '" << REBUFFER_WARNING_THRESHOLD << "'" << std::endl;
+        buf->refCount.store(0);
+        buf->poolFree.store(false);
+        
+        size_t inFlight = ++inFlightCount;
+        if (inFlight > peakCount.load()) {
+            peakCount.store(inFlight);
         }
-
-        buf = new BufferType();
-        outputBuffers.push_back(buf);
         
         return buf;
     }
     
+    // gives back a buffer from getBuffer() that was never handed out, whatever its count (owning thread only)
+    void returnBuffer(BufferType *buf) {
+        if (buf->pool.load() == this && !buf->poolFree.exchange(true)) {
+            buf->poolNext = freeBuffers;
+            freeBuffers = buf;
+            inFlightCount--;
+        }
+    }
+
     void purge() {
-        while (!outputBuffers.empty()) {
-            BufferType *ref = outputBuffers.front();
-            outputBuffers.pop_front();
-            delete ref;
+        // detach everything first so no new release can reach this pool, then wait out the
+        // releases that already saw it before deleting what has come back
+        for (outputBuffersI = outputBuffers.begin(); outputBuffersI != outputBuffers.end(); outputBuffersI++) {
+            (*outputBuffersI)->pool.store(nullptr);
         }
+        for (outputBuffersI = outputBuffers.begin(); outputBuffersI != outputBuffers.end(); outputBuffersI++) {
+            BufferType *buf = (*outputBuffersI);
+            while (buf->poolReleasing.load()) {
+                std::this_thread::yield();
+            }
+            if (buf->poolFree.load()) {
+                delete buf;
+            }
+        }
+        outputBuffers.clear();
+        freeBuffers = nullptr;
+        returnedBuffers.store(nullptr);
+        allocatedCount.store(0);
+        inFlightCount.store(0);
     }
 private:
-    std::string bufferId;
-    std::deque<BufferType*> outputBuffers;
-    typename std::deque<BufferType*>::iterator outputBuffersI;
+    // the last buffer takes over the removed one's slot
+    void removeBuffer(BufferType *buf) {
+        BufferType *last = outputBuffers.back();
+        outputBuffers[buf->poolIndex] = last;
+        last->poolIndex = buf->poolIndex;
+        outputBuffers.pop_back();
+    }
+
+    ReferenceCounter *freeBuffers;
+    std::vector<BufferType*> outputBuffers;
+    typename std::vector<BufferType*>::iterator outputBuffersI;
 };
 
 
+/**
+ * Scheduling applied to a thread role (sdr, post, demod-pre, demod, audio, visual).
+ * policy is "default", "fifo" or "rr"; priority <= 0 is relative to the policy maximum,
+ * > 0 is absolute.  affinity is a CPU list such as "2,3" or "0-3", empty for no pinning.
+ */
+class IOThreadPolicy {
+public:
+    std::string policy;
+    int priority;
+    std::string affinity;
+
+    IOThreadPolicy() : policy("default"), priority(0) {
+        
+    }
+    IOThreadPolicy(std::string policy, int priority, std::string affinity = "") : policy(policy), priority(priority), affinity(affinity) {
+        
+    }
+};
+
 class IOThread {
 public:
     IOThread();
@@ -119,9 +300,19 @@ public:
     void setOutputQueue(std::string qname, ThreadQueueBase *threadQueue);
     void *getOutputQueue(std::string qname);
     
+    static std::vector<std::string> getThreadRoles();
+    static void setThreadPolicy(std::string role, IOThreadPolicy policy);
+    static IOThreadPolicy getThreadPolicy(std::string role);
+    // name, schedule and pin the calling thread according to its role; its CPU time is reported under the role
+    static void applyThreadPolicy(std::string role);
+
 protected:
     std::map<std::string, ThreadQueueBase *, map_string_less> input_queues;
     std::map<std::string, ThreadQueueBase *, map_string_less> output_queues;
     std::atomic_bool terminated;
     Timer gTimer;
+
+private:
+    static std::mutex policy_busy;
+    static std::map<std::string, IOThreadPolicy, map_string_less> policies;
 };
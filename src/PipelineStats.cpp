@@ -0,0 +1,295 @@
+#include "PipelineStats.h"
+#include "IOThread.h"
+
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#if defined(__linux__) || defined(__FreeBSD__)
+#include <pthread.h>
+#endif
+
+std::atomic<uint64_t> PipelineStats::latencyBuckets[PIPELINE_LATENCY_BUCKETS];
+std::atomic<uint64_t> PipelineStats::latencyCount(0);
+std::atomic<uint64_t> PipelineStats::latencySumUs(0);
+std::atomic<uint64_t> PipelineStats::latencyMaxUs(0);
+std::atomic<uint64_t> PipelineStats::audioUnderflows(0);
+std::atomic<uint64_t> PipelineStats::audioDropouts(0);
+std::atomic<uint64_t> PipelineStats::audioStarvedFrames(0);
+std::atomic<uint64_t> PipelineStats::waterfallDrops(0);
+
+std::mutex PipelineStats::threads_busy;
+std::vector<PipelineStats::ThreadEntry *> PipelineStats::threads;
+std::map<std::string, double> PipelineStats::finishedCPU;
+thread_local PipelineStats::ThreadEntry *PipelineStats::currentThreadEntry = nullptr;
+
+std::mutex PipelineStats::dump_busy;
+std::condition_variable PipelineStats::dumpCondition;
+std::thread *PipelineStats::dumpThread = nullptr;
+bool PipelineStats::dumpRunning = false;
+
+double PipelineLatencyStats::percentileMs(double fraction) {
+    uint64_t target = (uint64_t)ceil((double)count * fraction);
+    uint64_t seen = 0;
+
+    if (!count) {
+        return 0;
+    }
+    for (size_t i = 0; i < buckets.size(); i++) {
+        seen += buckets[i];
+        if (seen >= target) {
+            return (double)(1ULL << i) / 1000.0;
+        }
+    }
+    return maxMs;
+}
+
+long long PipelineStats::now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void PipelineStats::recordLatency(long long captureTime) {
+    if (captureTime <= 0) {
+        return;
+    }
+
+    long long elapsed = now() - captureTime;
+    if (elapsed < 0) {
+        elapsed = 0;
+    }
+    uint64_t us = (uint64_t)elapsed;
+
+    int bucket = 0;
+    while (bucket < PIPELINE_LATENCY_BUCKETS - 1 && (us >> bucket) != 0) {
+        bucket++;
+    }
+
+    latencyBuckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    latencyCount.fetch_add(1, std::memory_order_relaxed);
+    latencySumUs.fetch_add(us, std::memory_order_relaxed);
+
+    uint64_t maxUs = latencyMaxUs.load(std::memory_order_relaxed);
+    while (us > maxUs && !latencyMaxUs.compare_exchange_weak(maxUs, us, std::memory_order_relaxed)) { }
+}
+
+PipelineLatencyStats PipelineStats::getLatencyStats() {
+    PipelineLatencyStats stats;
+
+    stats.buckets.resize(PIPELINE_LATENCY_BUCKETS);
+    for (int i = 0; i < PIPELINE_LATENCY_BUCKETS; i++) {
+        stats.buckets[i] = latencyBuckets[i].load(std::memory_order_relaxed);
+        stats.count += stats.buckets[i];
+    }
+    if (stats.count) {
+        stats.meanMs = (double)latencySumUs.load(std::memory_order_relaxed) / (double)latencyCount.load(std::memory_order_relaxed) / 1000.0;
+    }
+    stats.maxMs = (double)latencyMaxUs.load(std::memory_order_relaxed) / 1000.0;
+
+    return stats;
+}
+
+void PipelineStats::recordAudioUnderflow() {
+    audioUnderflows.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PipelineStats::recordAudioDropout(uint64_t starvedFrames) {
+    audioDropouts.fetch_add(1, std::memory_order_relaxed);
+    audioStarvedFrames.fetch_add(starvedFrames, std::memory_order_relaxed);
+}
+
+PipelineAudioStats PipelineStats::getAudioStats() {
+    PipelineAudioStats stats;
+
+    stats.underflows = audioUnderflows.load(std::memory_order_relaxed);
+    stats.dropouts = audioDropouts.load(std::memory_order_relaxed);
+    stats.starvedFrames = audioStarvedFrames.load(std::memory_order_relaxed);
+
+    return stats;
+}
+
+void PipelineStats::recordWaterfallDrop() {
+    waterfallDrops.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t PipelineStats::getWaterfallDrops() {
+    return waterfallDrops.load(std::memory_order_relaxed);
+}
+
+void PipelineStats::threadBegin(std::string role) {
+    std::lock_guard < std::mutex > lock(threads_busy);
+
+    ThreadEntry *entry = currentThreadEntry;
+    if (!entry) {
+        entry = new ThreadEntry;
+        entry->threadId = std::this_thread::get_id();
+#if defined(__linux__) || defined(__FreeBSD__)
+        if (pthread_getcpuclockid(pthread_self(), &entry->cpuClock) != 0) {
+            entry->cpuClock = CLOCK_THREAD_CPUTIME_ID;
+        }
+#endif
+        threads.push_back(entry);
+        currentThreadEntry = entry;
+    }
+    entry->role = role;
+}
+
+void PipelineStats::threadEnd() {
+    ThreadEntry *entry = currentThreadEntry;
+    if (!entry) {
+        return;
+    }
+
+    std::lock_guard < std::mutex > lock(threads_busy);
+
+    finishedCPU[entry->role] += threadCPUSeconds(entry);
+    threads.erase(std::find(threads.begin(), threads.end(), entry));
+    currentThreadEntry = nullptr;
+    delete entry;
+}
+
+double PipelineStats::threadCPUSeconds(ThreadEntry *entry) {
+#if defined(__linux__) || defined(__FreeBSD__)
+    struct timespec ts;
+    if (clock_gettime(entry->cpuClock, &ts) == 0) {
+        return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+    }
+#endif
+    return 0;
+}
+
+std::vector<PipelineThreadStats> PipelineStats::getThreadStats() {
+    std::map<std::string, PipelineThreadStats> statsByRole;
+
+    threads_busy.lock();
+    for (std::map<std::string, double>::iterator i = finishedCPU.begin(); i != finishedCPU.end(); i++) {
+        statsByRole[i->first].role = i->first;
+        statsByRole[i->first].cpuSeconds += i->second;
+    }
+    for (std::vector<ThreadEntry *>::iterator i = threads.begin(); i != threads.end(); i++) {
+        PipelineThreadStats &roleStats = statsByRole[(*i)->role];
+        roleStats.role = (*i)->role;
+        roleStats.threads++;
+        roleStats.cpuSeconds += threadCPUSeconds(*i);
+    }
+    threads_busy.unlock();
+
+    std::vector<PipelineThreadStats> result;
+    for (std::map<std::string, PipelineThreadStats>::iterator i = statsByRole.begin(); i != statsByRole.end(); i++) {
+        result.push_back(i->second);
+    }
+    return result;
+}
+
+void PipelineStats::dump(std::ostream &out) {
+    dumpSnapshot(out, nullptr, 0);
+}
+
+void PipelineStats::dumpSnapshot(std::ostream &out, std::map<std::string, uint64_t> *prevPopped, double elapsed) {
+    std::time_t wallTime = std::time(nullptr);
+    char timeStr[32];
+    std::strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", std::localtime(&wallTime));
+
+    out << "=== pipeline stats " << timeStr << " ===" << std::endl;
+
+    out << "queues: name count pushed popped dropped depth high_water" << (prevPopped?" popped/s":"") << std::endl;
+    std::vector<ThreadQueueStats> queueStats = ThreadQueueBase::get_all_stats();
+    for (std::vector<ThreadQueueStats>::iterator i = queueStats.begin(); i != queueStats.end(); i++) {
+        out << "  " << i->name << " " << i->queues << " " << i->pushed << " " << i->popped << " " << i->dropped << " " << i->depth << " " << i->highWater;
+        if (prevPopped) {
+            uint64_t prev = (*prevPopped)[i->name];
+            double rate = (elapsed > 0 && i->popped >= prev)?(double)(i->popped - prev) / elapsed:0;
+            out << " " << std::fixed << std::setprecision(1) << rate;
+            (*prevPopped)[i->name] = i->popped;
+        }
+        out << std::endl;
+    }
+
+    out << "buffers: id pools allocated in_flight peak trimmed" << std::endl;
+    std::vector<ReBufferStats> bufferStats = ReBufferBase::getAllStats();
+    for (std::vector<ReBufferStats>::iterator i = bufferStats.begin(); i != bufferStats.end(); i++) {
+        out << "  " << i->bufferId << " " << i->pools << " " << i->allocated << " " << i->inFlight << " " << i->peak << " " << i->trimmed << std::endl;
+    }
+
+    out << "threads: role count cpu_seconds" << std::endl;
+    std::vector<PipelineThreadStats> threadStats = getThreadStats();
+    for (std::vector<PipelineThreadStats>::iterator i = threadStats.begin(); i != threadStats.end(); i++) {
+        out << "  " << i->role << " " << i->threads << " " << std::fixed << std::setprecision(3) << i->cpuSeconds << std::endl;
+    }
+
+    PipelineLatencyStats latency = getLatencyStats();
+    out << "latency (capture to audio): blocks " << latency.count << std::fixed << std::setprecision(2)
+        << " mean_ms " << latency.meanMs << " p50_ms " << latency.percentileMs(0.5)
+        << " p99_ms " << latency.percentileMs(0.99) << " max_ms " << latency.maxMs << std::endl;
+    out << "  histogram_us:";
+    for (size_t i = 0; i < latency.buckets.size(); i++) {
+        if (latency.buckets[i]) {
+            out << " <" << (1ULL << i) << ":" << latency.buckets[i];
+        }
+    }
+    out << std::endl;
+
+    PipelineAudioStats audio = getAudioStats();
+    out << "audio: underflows " << audio.underflows << " dropouts " << audio.dropouts << " starved_frames " << audio.starvedFrames << std::endl;
+    out << "waterfall: dropped_lines " << getWaterfallDrops() << std::endl;
+    out << std::endl;
+}
+
+void PipelineStats::startDump(std::string fileName, int intervalMs) {
+    stopDump();
+
+    if (intervalMs <= 0) {
+        intervalMs = PIPELINE_STATS_DEFAULT_INTERVAL;
+    }
+
+    std::lock_guard < std::mutex > lock(dump_busy);
+    dumpRunning = true;
+    dumpThread = new std::thread(&PipelineStats::dumpMain, fileName, intervalMs);
+
+    std::cout << "Writing pipeline stats to '" << fileName << "' every " << intervalMs << "ms." << std::endl;
+}
+
+void PipelineStats::stopDump() {
+    std::thread *stopThread;
+    {
+        std::lock_guard < std::mutex > lock(dump_busy);
+        stopThread = dumpThread;
+        dumpThread = nullptr;
+        dumpRunning = false;
+    }
+    dumpCondition.notify_all();
+
+    if (stopThread) {
+        stopThread->join();
+        delete stopThread;
+    }
+}
+
+void PipelineStats::dumpMain(std::string fileName, int intervalMs) {
+    std::map<std::string, uint64_t> prevPopped;
+    long long lastDump = now();
+
+    std::unique_lock < std::mutex > lock(dump_busy);
+
+    while (dumpRunning) {
+        dumpCondition.wait_for(lock, std::chrono::milliseconds(intervalMs));
+        if (!dumpRunning) {
+            break;
+        }
+
+        lock.unlock();
+
+        long long dumpTime = now();
+        std::ofstream statsFile(fileName.c_str(), std::ios::out | std::ios::app);
+        if (statsFile.is_open()) {
+            dumpSnapshot(statsFile, &prevPopped, (double)(dumpTime - lastDump) / 1000000.0);
+        } else {
+            std::cout << "Unable to write pipeline stats to '" << fileName << "'." << std::endl;
+        }
+        lastDump = dumpTime;
+
+        lock.lock();
+    }
+}
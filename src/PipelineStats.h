@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <string>
+#include <vector>
+#include <map>
+#include <ostream>
+#include <cstdint>
+#include <ctime>
+
+// log2 microsecond buckets: [0] < 1us, [n] < 2^n us, last bucket catches everything above ~8s
+#define PIPELINE_LATENCY_BUCKETS 24
+#define PIPELINE_STATS_DEFAULT_INTERVAL 5000
+
+class PipelineThreadStats {
+public:
+    std::string role;
+    int threads;
+    double cpuSeconds;
+
+    PipelineThreadStats() : threads(0), cpuSeconds(0) {
+
+    }
+};
+
+class PipelineLatencyStats {
+public:
+    uint64_t count;
+    double meanMs;
+    double maxMs;
+    std::vector<uint64_t> buckets;
+
+    PipelineLatencyStats() : count(0), meanMs(0), maxMs(0) {
+
+    }
+
+    // upper bound of the bucket holding the given fraction of blocks
+    double percentileMs(double fraction);
+};
+
+class PipelineAudioStats {
+public:
+    uint64_t underflows;
+    uint64_t dropouts;
+    uint64_t starvedFrames;
+
+    PipelineAudioStats() : underflows(0), dropouts(0), starvedFrames(0) {
+
+    }
+};
+
+/**
+ * Process-wide pipeline counters that don't belong to a single queue or buffer pool:
+ * block latency from SDR capture to the audio callback, audio output underflows,
+ * waterfall lines dropped before display and CPU time per thread role.
+ * Recording is lock-free; the snapshot/dump side takes a mutex.
+ */
+class PipelineStats {
+public:
+    // steady clock in microseconds, used to stamp blocks at capture
+    static long long now();
+
+    static void recordLatency(long long captureTime);
+    static PipelineLatencyStats getLatencyStats();
+
+    // from the audio callback: an underflow reported by the device, or a stream that ran
+    // dry mid-playback leaving starvedFrames of its callback buffer silent
+    static void recordAudioUnderflow();
+    static void recordAudioDropout(uint64_t starvedFrames);
+    static PipelineAudioStats getAudioStats();
+
+    // from the waterfall panels: a line overwritten in the staging ring before it was drawn
+    static void recordWaterfallDrop();
+    static uint64_t getWaterfallDrops();
+
+    // account the calling thread's CPU time under role until threadEnd()
+    static void threadBegin(std::string role);
+    static void threadEnd();
+    static std::vector<PipelineThreadStats> getThreadStats();
+
+    // human readable snapshot of queues, buffer pools, threads and latency
+    static void dump(std::ostream &out);
+
+    // append a dump to fileName every intervalMs from a background thread
+    static void startDump(std::string fileName, int intervalMs);
+    static void stopDump();
+
+private:
+    class ThreadEntry {
+    public:
+        std::string role;
+        std::thread::id threadId;
+#if defined(__linux__) || defined(__FreeBSD__)
+        clockid_t cpuClock;
+#endif
+    };
+
+    static double threadCPUSeconds(ThreadEntry *entry);
+    // prevPopped/elapsed turn the queue pop counters into per-second rates when given
+    static void dumpSnapshot(std::ostream &out, std::map<std::string, uint64_t> *prevPopped, double elapsed);
+    static void dumpMain(std::string fileName, int intervalMs);
+
+    static std::atomic<uint64_t> latencyBuckets[PIPELINE_LATENCY_BUCKETS];
+    static std::atomic<uint64_t> latencyCount, latencySumUs, latencyMaxUs;
+    static std::atomic<uint64_t> audioUnderflows, audioDropouts, audioStarvedFrames;
+    static std::atomic<uint64_t> waterfallDrops;
+
+    static std::mutex threads_busy;
+    static std::vector<ThreadEntry *> threads;
+    static thread_local ThreadEntry *currentThreadEntry;
+    static std::map<std::string, double> finishedCPU;
+
+    static std::mutex dump_busy;
+    static std::condition_variable dumpCondition;
+    static std::thread *dumpThread;
+    static bool dumpRunning;
+};
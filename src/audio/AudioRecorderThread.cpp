@@ -0,0 +1,382 @@
+#include "AudioRecorderThread.h"
+#include "PipelineStats.h"
+
+#include <ctime>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+AudioRecordFile::AudioRecordFile() : fileFormat(AUDIO_RECORD_WAV), sampleRate(0), channels(0), dataBytes(0), fp(nullptr) {
+#if USE_FLAC
+    flacEncoder = nullptr;
+#endif
+}
+
+AudioRecordFile::~AudioRecordFile() {
+    close();
+}
+
+static void writeLE16(FILE *fp, uint16_t val) {
+    unsigned char b[2] = { (unsigned char)(val & 0xff), (unsigned char)(val >> 8) };
+    fwrite(b, 1, 2, fp);
+}
+
+static void writeLE32(FILE *fp, uint32_t val) {
+    unsigned char b[4] = { (unsigned char)(val & 0xff), (unsigned char)((val >> 8) & 0xff), (unsigned char)((val >> 16) & 0xff), (unsigned char)(val >> 24) };
+    fwrite(b, 1, 4, fp);
+}
+
+static void writeWavHeader(FILE *fp, int sampleRate, int channels, uint32_t dataBytes) {
+    fwrite("RIFF", 1, 4, fp);
+    writeLE32(fp, 36 + dataBytes);
+    fwrite("WAVEfmt ", 1, 8, fp);
+    writeLE32(fp, 16);
+    writeLE16(fp, 1);   // PCM
+    writeLE16(fp, channels);
+    writeLE32(fp, sampleRate);
+    writeLE32(fp, sampleRate * channels * 2);
+    writeLE16(fp, channels * 2);
+    writeLE16(fp, 16);
+    fwrite("data", 1, 4, fp);
+    writeLE32(fp, dataBytes);
+}
+
+bool AudioRecordFile::open(std::string fileName, AudioRecordFormat format, int sampleRate, int channels) {
+    close();
+
+    this->sampleRate = sampleRate;
+    this->channels = channels;
+    dataBytes = 0;
+
+#if USE_FLAC
+    if (format == AUDIO_RECORD_FLAC) {
+        flacEncoder = FLAC__stream_encoder_new();
+        if (!flacEncoder) {
+            return false;
+        }
+        FLAC__stream_encoder_set_channels(flacEncoder, channels);
+        FLAC__stream_encoder_set_bits_per_sample(flacEncoder, 16);
+        FLAC__stream_encoder_set_sample_rate(flacEncoder, sampleRate);
+        FLAC__stream_encoder_set_compression_level(flacEncoder, 5);
+        if (FLAC__stream_encoder_init_file(flacEncoder, fileName.c_str(), nullptr, nullptr) != FLAC__STREAM_ENCODER_INIT_STATUS_OK) {
+            FLAC__stream_encoder_delete(flacEncoder);
+            flacEncoder = nullptr;
+            return false;
+        }
+        fileFormat = format;
+        return true;
+    }
+#endif
+
+    fileFormat = AUDIO_RECORD_WAV;
+    fp = fopen(fileName.c_str(), "wb");
+    if (!fp) {
+        return false;
+    }
+    fileBuffer.resize(AUDIO_RECORD_FILE_BUFFER);
+    setvbuf(fp, &fileBuffer[0], _IOFBF, fileBuffer.size());
+    writeWavHeader(fp, sampleRate, channels, 0);
+
+    return !ferror(fp);
+}
+
+bool AudioRecordFile::write(const float *data, size_t numSamples) {
+#if USE_FLAC
+    if (flacEncoder) {
+        if (flacBuffer.size() < numSamples) {
+            flacBuffer.resize(numSamples);
+        }
+        for (size_t i = 0; i < numSamples; i++) {
+            flacBuffer[i] = (FLAC__int32)std::max(-32768.0f, std::min(32767.0f, std::round(data[i] * 32767.0f)));
+        }
+        return FLAC__stream_encoder_process_interleaved(flacEncoder, &flacBuffer[0], (unsigned)(numSamples / channels)) != 0;
+    }
+#endif
+    if (!fp) {
+        return false;
+    }
+    // keep the RIFF sizes within 32 bits
+    if (dataBytes + numSamples * 2 > 0xFFFFFFFFULL - 36) {
+        return false;
+    }
+    if (pcmBuffer.size() < numSamples) {
+        pcmBuffer.resize(numSamples);
+    }
+    for (size_t i = 0; i < numSamples; i++) {
+        pcmBuffer[i] = (int16_t)std::max(-32768.0f, std::min(32767.0f, std::round(data[i] * 32767.0f)));
+    }
+    // WAV is little-endian, as are all supported targets
+    if (fwrite(&pcmBuffer[0], 2, numSamples, fp) != numSamples) {
+        return false;
+    }
+    dataBytes += numSamples * 2;
+    return true;
+}
+
+void AudioRecordFile::close() {
+#if USE_FLAC
+    if (flacEncoder) {
+        FLAC__stream_encoder_finish(flacEncoder);
+        FLAC__stream_encoder_delete(flacEncoder);
+        flacEncoder = nullptr;
+    }
+#endif
+    if (!fp) {
+        return;
+    }
+    fseek(fp, 0, SEEK_SET);
+    writeWavHeader(fp, sampleRate, channels, (uint32_t)dataBytes);
+    fclose(fp);
+    fp = nullptr;
+}
+
+bool AudioRecordFile::isOpen() {
+#if USE_FLAC
+    if (flacEncoder) {
+        return true;
+    }
+#endif
+    return fp != nullptr;
+}
+
+int AudioRecordFile::getSampleRate() {
+    return sampleRate;
+}
+
+int AudioRecordFile::getChannels() {
+    return channels;
+}
+
+
+AudioRecordSink::AudioRecordSink() : queue(AUDIO_RECORD_QUEUE_SIZE), fileFrequency(0), squelchClosed(false), squelchClosedTime(0) {
+    recording.store(false);
+    removed.store(false);
+    queue.set_stats_name("AudioRecordQueue");
+}
+
+AudioRecordSink::~AudioRecordSink() {
+
+}
+
+void AudioRecordSink::setRecording(bool state) {
+    recording.store(state);
+}
+
+bool AudioRecordSink::isRecording() {
+    return recording.load();
+}
+
+bool AudioRecordSink::push(AudioThreadInput *data) {
+    return queue.push(data);
+}
+
+void AudioRecordSink::pushSquelchClosed() {
+    queue.push(nullptr);
+}
+
+
+AudioRecorderThread::AudioRecorderThread() : IOThread() {
+    format.store(AudioRecordFile::AUDIO_RECORD_WAV);
+    squelchHang.store(AUDIO_RECORD_DEFAULT_SQUELCH_HANG_MS);
+}
+
+AudioRecorderThread::~AudioRecorderThread() {
+    std::lock_guard < std::mutex > lock(sinks_busy);
+    for (std::vector<AudioRecordSink *>::iterator i = sinks.begin(); i != sinks.end(); i++) {
+        (*i)->file.close();
+        releaseQueue(*i);
+    }
+    sinks.clear();
+    retireSinks(retired);
+}
+
+void AudioRecorderThread::addSink(AudioRecordSink *sink) {
+    std::lock_guard < std::mutex > lock(sinks_busy);
+    if (std::find(sinks.begin(), sinks.end(), sink) == sinks.end()) {
+        sinks.push_back(sink);
+    }
+}
+
+void AudioRecorderThread::removeSink(AudioRecordSink *sink) {
+    sink->removed.store(true);
+
+    std::lock_guard < std::mutex > lock(sinks_busy);
+    std::vector<AudioRecordSink *>::iterator i = std::find(sinks.begin(), sinks.end(), sink);
+    if (i != sinks.end()) {
+        sinks.erase(i);
+    }
+    retired.push_back(sink);
+}
+
+void AudioRecorderThread::retireSinks(std::vector<AudioRecordSink *> &retiring) {
+    for (std::vector<AudioRecordSink *>::iterator i = retiring.begin(); i != retiring.end(); i++) {
+        (*i)->file.close();
+        releaseQueue(*i);
+        delete (*i);
+    }
+    retiring.clear();
+}
+
+void AudioRecorderThread::releaseQueue(AudioRecordSink *sink) {
+    AudioThreadInput *data;
+    while (sink->queue.try_pop(data)) {
+        if (data) {
+            data->decRefCount();
+        }
+    }
+}
+
+void AudioRecorderThread::setPath(std::string path) {
+    std::lock_guard < std::mutex > lock(setting_busy);
+    recordPath = path;
+}
+
+void AudioRecorderThread::setFormat(std::string format) {
+#if USE_FLAC
+    if (format == "FLAC") {
+        this->format.store(AudioRecordFile::AUDIO_RECORD_FLAC);
+        return;
+    }
+#endif
+    this->format.store(AudioRecordFile::AUDIO_RECORD_WAV);
+}
+
+std::string AudioRecorderThread::getFormat() {
+    return (format.load() == AudioRecordFile::AUDIO_RECORD_FLAC)?"FLAC":"WAV";
+}
+
+void AudioRecorderThread::setSquelchHang(int milliseconds) {
+    squelchHang.store(milliseconds);
+}
+
+bool AudioRecorderThread::openFile(AudioRecordSink *sink, AudioThreadInput *data) {
+    std::string path;
+    {
+        std::lock_guard < std::mutex > lock(setting_busy);
+        path = recordPath;
+    }
+
+    std::time_t now = std::time(nullptr);
+    struct tm utc;
+#ifdef _WIN32
+    gmtime_s(&utc, &now);
+#else
+    gmtime_r(&now, &utc);
+#endif
+    char timeStr[32];
+    std::strftime(timeStr, sizeof(timeStr), "%Y%m%d_%H%M%S", &utc);
+
+    AudioRecordFile::AudioRecordFormat fileFormat = format.load();
+
+    std::stringstream baseName;
+    baseName << path;
+    if (path != "" && path[path.length() - 1] != '/' && path[path.length() - 1] != '\\') {
+        baseName << "/";
+    }
+    baseName << "audio_" << timeStr << "_" << data->frequency << "Hz";
+
+    // several demodulators may share a frequency and open within the same second
+    std::string ext = (fileFormat == AudioRecordFile::AUDIO_RECORD_FLAC)?".flac":".wav";
+    std::string fileName = baseName.str() + ext;
+    for (int n = 1; n < 100; n++) {
+        FILE *exists = fopen(fileName.c_str(), "rb");
+        if (!exists) {
+            break;
+        }
+        fclose(exists);
+        std::stringstream altName;
+        altName << baseName.str() << "_" << n << ext;
+        fileName = altName.str();
+    }
+
+    if (!sink->file.open(fileName, fileFormat, data->sampleRate, data->channels)) {
+        std::cout << "Audio recording: unable to create '" << fileName << "'." << std::endl;
+        return false;
+    }
+
+    sink->fileFrequency = data->frequency;
+    std::cout << "Audio recording to '" << fileName << "'." << std::endl;
+    return true;
+}
+
+bool AudioRecorderThread::drain(AudioRecordSink *sink, long long now) {
+    bool busy = false;
+    AudioThreadInput *data;
+
+    while (sink->queue.try_pop(data)) {
+        busy = true;
+
+        if (!data) {
+            if (!sink->squelchClosed) {
+                sink->squelchClosed = true;
+                sink->squelchClosedTime = now;
+            }
+            continue;
+        }
+
+        sink->squelchClosed = false;
+
+        if (data->channels > 0 && data->sampleRate > 0 && data->data.size()) {
+            if (sink->file.isOpen() && (data->sampleRate != sink->file.getSampleRate() || data->channels != sink->file.getChannels() || data->frequency != sink->fileFrequency)) {
+                sink->file.close();
+            }
+            if (sink->file.isOpen() || openFile(sink, data)) {
+                if (!sink->file.write(&data->data[0], data->data.size())) {
+                    // disk full or WAV size limit; the next buffer starts a new file
+                    sink->file.close();
+                }
+            } else {
+                sink->setRecording(false);
+            }
+        }
+
+        data->decRefCount();
+    }
+
+    if (sink->file.isOpen()) {
+        if (!sink->isRecording()) {
+            sink->file.close();
+        } else if (sink->squelchClosed && (now - sink->squelchClosedTime) >= (long long)squelchHang.load() * 1000) {
+            sink->file.close();
+        }
+    }
+
+    return busy;
+}
+
+void AudioRecorderThread::run() {
+    applyThreadPolicy("record");
+
+    // sinks removed before a pass are only deleted here, once no pass can still hold them
+    std::vector<AudioRecordSink *> active, retiring;
+
+    while (!terminated) {
+        {
+            std::lock_guard < std::mutex > lock(sinks_busy);
+            active = sinks;
+            retiring.swap(retired);
+        }
+
+        retireSinks(retiring);
+
+        bool busy = false;
+        long long now = PipelineStats::now();
+        for (std::vector<AudioRecordSink *>::iterator i = active.begin(); i != active.end(); i++) {
+            if (!(*i)->removed.load() && drain(*i, now)) {
+                busy = true;
+            }
+        }
+        if (!busy) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(AUDIO_RECORD_POLL_MS));
+        }
+    }
+
+    std::lock_guard < std::mutex > lock(sinks_busy);
+    for (std::vector<AudioRecordSink *>::iterator i = sinks.begin(); i != sinks.end(); i++) {
+        (*i)->file.close();
+        releaseQueue(*i);
+    }
+    retireSinks(retired);
+}
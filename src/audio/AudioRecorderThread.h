@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
+#include "AudioThread.h"
+
+#if USE_FLAC
+#include <FLAC/stream_encoder.h>
+#endif
+
+// audio buffers in flight per demodulator, a few seconds at the usual buffer rate
+#define AUDIO_RECORD_QUEUE_SIZE 256
+// writer sleep between passes when every sink queue was empty
+#define AUDIO_RECORD_POLL_MS 50
+// squelch must stay closed this long before the recording is split into a new file
+#define AUDIO_RECORD_DEFAULT_SQUELCH_HANG_MS 2000
+#define AUDIO_RECORD_FILE_BUFFER (256 * 1024)
+
+/**
+ * 16-bit PCM audio file, either WAV or (when built with USE_FLAC) FLAC.
+ * The WAV header is written with placeholder sizes and patched on close.
+ */
+class AudioRecordFile {
+public:
+    enum AudioRecordFormat { AUDIO_RECORD_WAV, AUDIO_RECORD_FLAC };
+
+    AudioRecordFile();
+    ~AudioRecordFile();
+
+    bool open(std::string fileName, AudioRecordFormat format, int sampleRate, int channels);
+    bool write(const float *data, size_t numSamples);
+    void close();
+
+    bool isOpen();
+    int getSampleRate();
+    int getChannels();
+
+private:
+    AudioRecordFormat fileFormat;
+    int sampleRate, channels;
+    uint64_t dataBytes;
+    FILE *fp;
+    std::vector<char> fileBuffer;
+    std::vector<int16_t> pcmBuffer;
+#if USE_FLAC
+    FLAC__StreamEncoder *flacEncoder;
+    std::vector<FLAC__int32> flacBuffer;
+#endif
+};
+
+/**
+ * Per-demodulator tap into the shared AudioRecorderThread.  DemodulatorThread hands
+ * over a second reference to each audio buffer through a lock-free ring and drops it
+ * if the ring is full, so disk I/O never reaches the demodulator or the audio mixer.
+ * A nullptr in the ring marks the squelch closing.
+ */
+class AudioRecordSink {
+public:
+    AudioRecordSink();
+    ~AudioRecordSink();
+
+    void setRecording(bool state);
+    bool isRecording();
+
+    // demodulator thread side
+    bool push(AudioThreadInput *data);
+    void pushSquelchClosed();
+
+private:
+    friend class AudioRecorderThread;
+
+    AudioThreadInputQueue queue;
+    std::atomic_bool recording;
+    // set by removeSink(); the writer skips the sink and deletes it on its next pass
+    std::atomic_bool removed;
+
+    // owned by the writer thread
+    AudioRecordFile file;
+    long long fileFrequency;
+    bool squelchClosed;
+    long long squelchClosedTime;
+};
+
+/**
+ * Single background writer shared by all recording demodulators.  Each pass drains
+ * every registered sink, writes the batched buffers and closes a sink's file when
+ * its squelch has been closed for the hang time, when it's retuned or when recording
+ * stops; the next buffer opens a new file.
+ */
+class AudioRecorderThread : public IOThread {
+public:
+    AudioRecorderThread();
+    ~AudioRecorderThread();
+
+    void run();
+
+    void addSink(AudioRecordSink *sink);
+    // hands the sink over without waiting for the writer: its file is closed, its queued
+    // buffers released and the sink deleted by the writer thread after the pass in progress
+    void removeSink(AudioRecordSink *sink);
+
+    void setPath(std::string path);
+    void setFormat(std::string format);
+    std::string getFormat();
+    void setSquelchHang(int milliseconds);
+
+private:
+    bool drain(AudioRecordSink *sink, long long now);
+    bool openFile(AudioRecordSink *sink, AudioThreadInput *data);
+    static void releaseQueue(AudioRecordSink *sink);
+    static void retireSinks(std::vector<AudioRecordSink *> &retiring);
+
+    // only held to copy or edit the lists, never across file I/O
+    std::mutex sinks_busy;
+    std::vector<AudioRecordSink *> sinks, retired;
+
+    std::mutex setting_busy;
+    std::string recordPath;
+    std::atomic<AudioRecordFile::AudioRecordFormat> format;
+    std::atomic_int squelchHang;
+};
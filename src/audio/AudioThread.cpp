@@ -6,38 +6,68 @@
 #include "DemodulatorThread.h"
 #include "DemodulatorInstance.h"
 #include <memory.h>
+#include "PipelineStats.h"
+#include "SignalLevel.h"
+#include "DSPKernels.h"
 
 std::map<int, AudioThread *> AudioThread::deviceController;
 std::map<int, int> AudioThread::deviceSampleRate;
 std::map<int, std::thread *> AudioThread::deviceThread;
 
 AudioThread::AudioThread() : IOThread(),
-        currentInput(NULL), inputQueue(NULL), nBufferFrames(1024), threadQueueNotify(NULL), sampleRate(0) {
+        currentInput(NULL), audioQueuePtr(0), playing(false), inputQueue(NULL), nBufferFrames(1024), threadQueueNotify(NULL), sampleRate(0) {
 
-	audioQueuePtr.store(0); 
 	underflowCount.store(0);
+	dropoutCount.store(0);
 	active.store(false);
 	outputDevice.store(-1);
     gain.store(1.0);
 
-    boundThreads.store(new std::vector<AudioThread *>);
+    for (int i = 0; i < AUDIO_THREAD_MAX_STREAMS; i++) {
+        boundThreads[i].store(NULL);
+    }
+    mixing.store(false);
 }
 
 AudioThread::~AudioThread() {
-    delete boundThreads.load();
+
 }
 
 void AudioThread::bindThread(AudioThread *other) {
-    if (std::find(boundThreads.load()->begin(), boundThreads.load()->end(), other) == boundThreads.load()->end()) {
-        boundThreads.load()->push_back(other);
+    std::lock_guard < std::mutex > lock(boundThreadsBusy);
+
+    int freeSlot = -1;
+    for (int i = 0; i < AUDIO_THREAD_MAX_STREAMS; i++) {
+        AudioThread *bound = boundThreads[i].load();
+        if (bound == other) {
+            return;
+        }
+        if (!bound && freeSlot == -1) {
+            freeSlot = i;
+        }
     }
+
+    if (freeSlot == -1) {
+        std::cout << "Audio device is already mixing " << AUDIO_THREAD_MAX_STREAMS << " streams, output not bound." << std::endl;
+        return;
+    }
+    boundThreads[freeSlot].store(other);
 }
 
 void AudioThread::removeThread(AudioThread *other) {
-    std::vector<AudioThread *>::iterator i;
-    i = std::find(boundThreads.load()->begin(), boundThreads.load()->end(), other);
-    if (i != boundThreads.load()->end()) {
-        boundThreads.load()->erase(i);
+    {
+        std::lock_guard < std::mutex > lock(boundThreadsBusy);
+        for (int i = 0; i < AUDIO_THREAD_MAX_STREAMS; i++) {
+            if (boundThreads[i].load() == other) {
+                boundThreads[i].store(NULL);
+            }
+        }
+    }
+
+    // a callback that picked up the stream before it was cleared may still be mixing it;
+    // once that pass is over the caller owns the stream's mixer state again
+    while (mixing.load()) {
+        std::this_thread::yield();
     }
 }
 
@@ -49,147 +79,131 @@ void AudioThread::deviceCleanup() {
     }
 }
 
-static int audioCallback(void *outputBuffer, void * /* inputBuffer */, unsigned int nBufferFrames, double /* streamTime */, RtAudioStreamStatus status,
-        void *userData) {
-    AudioThread *src = (AudioThread *) userData;
-    float *out = (float*) outputBuffer;
-    memset(out, 0, nBufferFrames * 2 * sizeof(float));
-
-    if (src->isTerminated()) {
-        return 1;
-    }
-
-    if (status) {
-        std::cout << "Audio buffer underflow.." << (src->underflowCount++) << std::endl;
-    }
-
-    if (src->boundThreads.load()->empty()) {
-        return 0;
+// capture-to-playback latency of each block as the callback picks it up
+static inline void recordInputLatency(AudioThreadInput *input) {
+    if (input) {
+        PipelineStats::recordLatency(input->captureTime);
     }
+}
 
+// Mix up to nBufferFrames of one stream into the stereo output, moving on through its queued
+// blocks as they run out; returns the stream's gain-scaled peak. Blocks at another sample rate
+// (queued before a rate change) or without samples are dropped. Runs on the realtime thread:
+// only the non-waiting ring pop, atomics and the mix kernels.
+static float mixStream(AudioThread *srcmix, float *out, unsigned int nBufferFrames, int sampleRate) {
+    float gain = srcmix->gain.load();
     float peak = 0.0;
+    unsigned int frame = 0;
 
-    for (size_t j = 0; j < src->boundThreads.load()->size(); j++) {
-        AudioThread *srcmix = (*(src->boundThreads.load()))[j];
-        if (srcmix->isTerminated() || !srcmix->inputQueue || srcmix->inputQueue->empty() || !srcmix->isActive()) {
-            continue;
-        }
+    while (frame < nBufferFrames) {
+        AudioThreadInput *input = srcmix->currentInput;
 
-        if (!srcmix->currentInput) {
+        if (!input || srcmix->audioQueuePtr >= input->data.size()) {
+            if (input) {
+                input->decRefCount();
+                srcmix->currentInput = NULL;
+            }
             srcmix->audioQueuePtr = 0;
-            if (srcmix->isTerminated() || srcmix->inputQueue->empty()) {
+
+            if (!srcmix->inputQueue->try_pop_nowait(input)) {
+                break;
+            }
+            recordInputLatency(input);
+            if (!input) {
                 continue;
             }
-            srcmix->inputQueue->pop(srcmix->currentInput);
-            if (srcmix->isTerminated()) {
+            if (input->sampleRate != sampleRate || input->channels == 0 || input->data.empty()) {
+                input->decRefCount();
                 continue;
             }
-            continue;
+            srcmix->currentInput = input;
         }
 
-//        std::lock_guard < std::mutex > lock(srcmix->currentInput->m_mutex);
-
-        if (srcmix->currentInput->sampleRate != src->getSampleRate()) {
-            while (srcmix->inputQueue->size()) {
-                srcmix->inputQueue->pop(srcmix->currentInput);
-                if (srcmix->currentInput) {
-                    if (srcmix->currentInput->sampleRate == src->getSampleRate()) {
-                        break;
-                    }
-                    srcmix->currentInput->decRefCount();
-                }
-                srcmix->currentInput = NULL;
-            }
+        float inputPeak = input->peak * gain;
+        if (inputPeak > peak) {
+            peak = inputPeak;
+        }
 
-            srcmix->audioQueuePtr = 0;
+        const float *data = &input->data[srcmix->audioQueuePtr];
+        size_t available = input->data.size() - srcmix->audioQueuePtr;
+        unsigned int frames = nBufferFrames - frame;
 
-            if (!srcmix->currentInput) {
+        if (input->channels == 1) {
+            if (frames > available) {
+                frames = (unsigned int)available;
+            }
+            dspMixGainMonoToStereo(data, gain, out + frame * 2, frames);
+            srcmix->audioQueuePtr += frames;
+        } else {
+            if (frames > available / 2) {
+                frames = (unsigned int)(available / 2);
+            }
+            if (!frames) {
+                // odd trailing sample, nothing left to pair it with
+                srcmix->audioQueuePtr = input->data.size();
                 continue;
             }
+            dspMixGain(data, gain, out + frame * 2, frames * 2);
+            srcmix->audioQueuePtr += frames * 2;
         }
+        frame += frames;
+    }
 
+    if (frame == nBufferFrames) {
+        srcmix->playing = true;
+    } else if (srcmix->playing) {
+        // ran dry mid-playback; an idle stream that never started isn't counted
+        srcmix->playing = false;
+        srcmix->dropoutCount++;
+        PipelineStats::recordAudioDropout(nBufferFrames - frame);
+    }
 
-        if (srcmix->currentInput->channels == 0 || !srcmix->currentInput->data.size()) {
-            if (!srcmix->inputQueue->empty()) {
-                srcmix->audioQueuePtr = 0;
-                if (srcmix->currentInput) {
-                    srcmix->currentInput->decRefCount();
-                    srcmix->currentInput = NULL;
-                }
-                if (srcmix->isTerminated() || srcmix->inputQueue->empty()) {
-                    continue;
-                }
-                srcmix->inputQueue->pop(srcmix->currentInput);
-                if (srcmix->isTerminated()) {
-                    continue;
-                }
-            }
-            continue;
-        }
+    return peak;
+}
 
-        float mixPeak = srcmix->currentInput->peak * srcmix->gain;
-
-        if (srcmix->currentInput->channels == 1) {
-            for (unsigned int i = 0; i < nBufferFrames; i++) {
-                if (srcmix->audioQueuePtr >= srcmix->currentInput->data.size()) {
-                    srcmix->audioQueuePtr = 0;
-                    if (srcmix->currentInput) {
-                        srcmix->currentInput->decRefCount();
-                        srcmix->currentInput = NULL;
-                    }
-                    if (srcmix->isTerminated() || srcmix->inputQueue->empty()) {
-                        break;
-                    }
-                    srcmix->inputQueue->pop(srcmix->currentInput);
-                    if (srcmix->isTerminated()) {
-                        break;
-                    }
-                    float srcPeak = srcmix->currentInput->peak * srcmix->gain;
-                    if (mixPeak < srcPeak) {
-                        mixPeak = srcPeak;
-                    }
-                }
-                if (srcmix->currentInput && srcmix->currentInput->data.size()) {
-                    float v = srcmix->currentInput->data[srcmix->audioQueuePtr] * srcmix->gain;
-                    out[i * 2] += v;
-                    out[i * 2 + 1] += v;
-                }
-                srcmix->audioQueuePtr++;
-            }
-        } else {
-            for (int i = 0, iMax = srcmix->currentInput->channels * nBufferFrames; i < iMax; i++) {
-                if (srcmix->audioQueuePtr >= srcmix->currentInput->data.size()) {
-                    srcmix->audioQueuePtr = 0;
-                    if (srcmix->currentInput) {
-                        srcmix->currentInput->decRefCount();
-                        srcmix->currentInput = NULL;
-                    }
-                    if (srcmix->isTerminated() || srcmix->inputQueue->empty()) {
-                        break;
-                    }
-                    srcmix->inputQueue->pop(srcmix->currentInput);
-                    if (srcmix->isTerminated()) {
-                        break;
-                    }
-                    float srcPeak = srcmix->currentInput->peak * srcmix->gain;
-                    if (mixPeak < srcPeak) {
-                        mixPeak = srcPeak;
-                    }
-                }
-                if (srcmix->currentInput && srcmix->currentInput->data.size()) {
-                    out[i] = out[i] + srcmix->currentInput->data[srcmix->audioQueuePtr] * srcmix->gain;
-                }
-                srcmix->audioQueuePtr++;
-            }
-        }
+static int audioCallback(void *outputBuffer, void * /* inputBuffer */, unsigned int nBufferFrames, double /* streamTime */, RtAudioStreamStatus status,
+        void *userData) {
+    AudioThread *src = (AudioThread *) userData;
+    float *out = (float*) outputBuffer;
+    memset(out, 0, nBufferFrames * 2 * sizeof(float));
 
-        peak += mixPeak;
+    // mixing happens on the backend's callback thread, so the "audio" policy belongs here and not
+    // on the command loop; applied once per callback thread (the one-off lock and log line are fine
+    // on the first buffer, every later callback skips it)
+    static thread_local bool policyApplied = false;
+    if (!policyApplied) {
+        policyApplied = true;
+        IOThread::applyThreadPolicy("audio");
     }
 
-    if (peak > 1.0) {
-        for (unsigned int i = 0; i < nBufferFrames * 2; i++) {
-            out[i] /= peak;
+    if (src->isTerminated()) {
+        return 1;
+    }
+
+    if (status) {
+        // counted, not printed: console I/O from here would cause the next underflow
+        src->underflowCount++;
+        PipelineStats::recordAudioUnderflow();
+    }
+
+    float peak = 0.0;
+    int sampleRate = src->getSampleRate();
+
+    // paired with removeThread(): a stream is either seen in its slot here or waited for there
+    src->mixing.store(true);
+
+    for (int j = 0; j < AUDIO_THREAD_MAX_STREAMS; j++) {
+        AudioThread *srcmix = src->boundThreads[j].load();
+        if (!srcmix || srcmix->isTerminated() || !srcmix->inputQueue || !srcmix->isActive()) {
+            continue;
         }
+        peak += mixStream(srcmix, out, nBufferFrames, sampleRate);
+    }
+
+    src->mixing.store(false);
+
+    if (peak > 1.0) {
+        signalScale(out, nBufferFrames * 2, 1.0f / peak);
     }
     return 0;
 }
@@ -262,9 +276,11 @@ void AudioThread::setSampleRate(int sampleRate) {
         dac.stopStream();
         dac.closeStream();
 
-        for (size_t j = 0; j < boundThreads.load()->size(); j++) {
-            AudioThread *srcmix = (*(boundThreads.load()))[j];
-            srcmix->setSampleRate(sampleRate);
+        for (int j = 0; j < AUDIO_THREAD_MAX_STREAMS; j++) {
+            AudioThread *srcmix = boundThreads[j].load();
+            if (srcmix) {
+                srcmix->setSampleRate(sampleRate);
+            }
         }
 
         std::vector<DemodulatorInstance *>::iterator demod_i;
@@ -359,12 +375,7 @@ void AudioThread::setInitOutputDevice(int deviceId, int sampleRate) {
 }
 
 void AudioThread::run() {
-#ifdef __APPLE__
-    pthread_t tID = pthread_self();	 // ID of this thread
-    int priority = sched_get_priority_max( SCHED_RR) - 1;
-    sched_param prio = {priority}; // scheduling priority of thread
-    pthread_setschedparam(tID, SCHED_RR, &prio);
-#endif
+    // the command loop only opens/closes streams; the "audio" policy is applied in audioCallback()
 
     std::cout << "Audio thread initializing.." << std::endl;
 
@@ -438,6 +449,12 @@ void AudioThread::setActive(bool state) {
         deviceController[parameters.deviceId]->bindThread(this);
     } else if (!state && active) {
         deviceController[parameters.deviceId]->removeThread(this);
+        if (currentInput) {
+            currentInput->decRefCount();
+            currentInput = NULL;
+        }
+        audioQueuePtr = 0;
+        playing = false;
         if(inputQueue) {
             while (!inputQueue->empty()) {  // flush queue
                 inputQueue->pop(dummy);
@@ -467,3 +484,11 @@ void AudioThread::setGain(float gain_in) {
 float AudioThread::getGain() {
     return gain;
 }
+
+unsigned int AudioThread::getUnderflowCount() {
+    return underflowCount.load();
+}
+
+uint64_t AudioThread::getDropoutCount() {
+    return dropoutCount.load();
+}
@@ -19,11 +19,12 @@ public:
     int channels;
     float peak;
     int type;
+    long long captureTime;
     std::vector<float> data;
     std::mutex busy_update;
 
     AudioThreadInput() :
-            frequency(0), sampleRate(0), channels(0), peak(0) {
+            frequency(0), sampleRate(0), channels(0), peak(0), captureTime(0) {
 
     }
 
@@ -46,15 +47,22 @@ public:
     int int_value;
 };
 
+// streams one output device can mix at once, slots are scanned by every audio callback
+#define AUDIO_THREAD_MAX_STREAMS 64
+
 typedef ThreadQueue<AudioThreadInput *> AudioThreadInputQueue;
 typedef ThreadQueue<AudioThreadCommand> AudioThreadCommandQueue;
 
 class AudioThread : public IOThread {
 public:
+    // mixer state, only touched by the device's audio callback while the stream is bound
     AudioThreadInput *currentInput;
+    size_t audioQueuePtr;
+    bool playing;
+
     AudioThreadInputQueue *inputQueue;
-    std::atomic_uint audioQueuePtr;
     std::atomic_uint underflowCount;
+    std::atomic<uint64_t> dropoutCount;
     std::atomic_bool initialized;
     std::atomic_bool active;
     std::atomic_int outputDevice;
@@ -79,6 +87,11 @@ public:
     void setGain(float gain_in);
     float getGain();
 
+    // underflows reported by the output device (device controller only)
+    unsigned int getUnderflowCount();
+    // times this stream ran out of queued audio mid-playback
+    uint64_t getDropoutCount();
+
     AudioThreadCommandQueue *getCommandQueue();
 
 private:
@@ -99,6 +112,13 @@ public:
     static std::map<int,std::thread *> deviceThread;
     static void deviceCleanup();
     static void setDeviceSampleRate(int deviceId, int sampleRate);
-    std::atomic<std::vector<AudioThread *> *> boundThreads;
+
+    // streams mixed by this device controller; written under boundThreadsBusy, read lock-free by the callback
+    std::atomic<AudioThread *> boundThreads[AUDIO_THREAD_MAX_STREAMS];
+    // set for the duration of each mixing pass so removeThread() can wait it out
+    std::atomic_bool mixing;
+
+private:
+    std::mutex boundThreadsBusy;
 };
 
@@ -0,0 +1,152 @@
+#include "BenchIQSource.h"
+#include "IQConvert.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+
+#ifndef M_PI
+#define M_PI        3.14159265358979323846
+#endif
+
+BenchIQSource::BenchIQSource() : readPos(0), rngState(0x12345678) {
+
+}
+
+float BenchIQSource::nextGaussian() {
+    // xorshift + Box-Muller; quality is irrelevant, speed and determinism are not
+    float u1, u2;
+    do {
+        rngState ^= rngState << 13;
+        rngState ^= rngState >> 17;
+        rngState ^= rngState << 5;
+        u1 = (float)(rngState & 0xFFFFFF) / 16777216.0f;
+    } while (u1 <= 0);
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    u2 = (float)(rngState & 0xFFFFFF) / 16777216.0f;
+
+    return sqrtf(-2.0f * logf(u1)) * cosf(2.0f * (float)M_PI * u2);
+}
+
+void BenchIQSource::generate(int sampleRate, SignalType type, std::vector<long long> &offsets, float noiseLevel) {
+    size_t periodSize = sampleRate / BENCH_SOURCE_PERIOD_HZ;
+
+    period.assign(periodSize, liquid_float_complex());
+    readPos = 0;
+
+    float noiseScale = noiseLevel / sqrtf(2.0f);
+    if (type == BENCH_SIGNAL_NOISE && noiseScale <= 0) {
+        noiseScale = 0.25f;
+    }
+
+    for (size_t i = 0; i < periodSize; i++) {
+        period[i].real = nextGaussian() * noiseScale;
+        period[i].imag = nextGaussian() * noiseScale;
+    }
+
+    if (type == BENCH_SIGNAL_NOISE || offsets.empty()) {
+        return;
+    }
+
+    float carrierGain = 0.5f / (float)offsets.size();
+
+    for (size_t c = 0; c < offsets.size(); c++) {
+        // rounded to the period rate so the loop point is phase continuous
+        long long offset = (offsets[c] / BENCH_SOURCE_PERIOD_HZ) * BENCH_SOURCE_PERIOD_HZ;
+        double carrierStep = 2.0 * M_PI * (double)offset / (double)sampleRate;
+        double fmPhase = 0;
+
+        for (size_t i = 0; i < periodSize; i++) {
+            double t = (double)i / (double)sampleRate;
+            double phase = carrierStep * (double)i;
+
+            if (type == BENCH_SIGNAL_FM) {
+                // two program tones plus a 19kHz pilot at 75kHz peak deviation
+                double m = 0.45 * sin(2.0 * M_PI * 1000.0 * t) + 0.45 * sin(2.0 * M_PI * 3300.0 * t) + 0.1 * sin(2.0 * M_PI * 19000.0 * t);
+                fmPhase += 2.0 * M_PI * 75000.0 * m / (double)sampleRate;
+                phase += fmPhase;
+            }
+
+            period[i].real += carrierGain * (float)cos(phase);
+            period[i].imag += carrierGain * (float)sin(phase);
+        }
+    }
+}
+
+bool BenchIQSource::loadFile(std::string fileName, std::string format) {
+    int elemBytes;
+    if (format == "CF32") {
+        elemBytes = 2 * sizeof(float);
+    } else if (format == "CS16") {
+        elemBytes = 2 * sizeof(int16_t);
+    } else if (format == "CS8") {
+        elemBytes = 2 * sizeof(int8_t);
+    } else {
+        std::cout << "Unknown IQ file format '" << format << "', expected CF32, CS16 or CS8." << std::endl;
+        return false;
+    }
+
+    FILE *fp = fopen(fileName.c_str(), "rb");
+    if (!fp) {
+        std::cout << "Unable to open IQ file '" << fileName << "'." << std::endl;
+        return false;
+    }
+
+    std::vector<char> raw((size_t)BENCH_SOURCE_FILE_MAX * elemBytes);
+    size_t numElems = fread(&raw[0], elemBytes, BENCH_SOURCE_FILE_MAX, fp);
+    fclose(fp);
+
+    if (!numElems) {
+        std::cout << "IQ file '" << fileName << "' is empty." << std::endl;
+        return false;
+    }
+
+    period.resize(numElems);
+    readPos = 0;
+
+    if (format == "CF32") {
+        memcpy(&period[0], &raw[0], numElems * elemBytes);
+    } else if (format == "CS16") {
+        iqConvertCS16((const int16_t *)&raw[0], &period[0], numElems, 1.0f / 32768.0f);
+    } else {
+        iqConvertCS8((const int8_t *)&raw[0], &period[0], numElems, 1.0f / 128.0f);
+    }
+
+    return true;
+}
+
+void BenchIQSource::read(liquid_float_complex *out, size_t numElems) {
+    size_t periodSize = period.size();
+
+    while (numElems) {
+        size_t n = periodSize - readPos;
+        if (n > numElems) {
+            n = numElems;
+        }
+        memcpy(out, &period[readPos], n * sizeof(liquid_float_complex));
+        out += n;
+        numElems -= n;
+        readPos = (readPos + n) % periodSize;
+    }
+}
+
+size_t BenchIQSource::getPeriodSize() {
+    return period.size();
+}
+
+bool BenchIQSource::parseSignalType(std::string name, SignalType &type) {
+    if (name == "tones") {
+        type = BENCH_SIGNAL_TONES;
+    } else if (name == "noise") {
+        type = BENCH_SIGNAL_NOISE;
+    } else if (name == "fm") {
+        type = BENCH_SIGNAL_FM;
+    } else {
+        return false;
+    }
+    return true;
+}
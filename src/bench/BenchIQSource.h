@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+#include "liquid/liquid.h"
+
+// synthetic signals are rendered once for this long and then looped seamlessly
+#define BENCH_SOURCE_PERIOD_HZ 10
+// recorded input is loaded into memory up to this many samples, then looped
+#define BENCH_SOURCE_FILE_MAX (1 << 25)
+
+/**
+ * IQ generator for the headless benchmark.  Produces tones, noise or broadcast-FM-like
+ * carriers at the requested offsets, or loops a raw CF32/CS16/CS8 recording.  Everything
+ * is rendered up front so the source thread only copies and never limits throughput.
+ */
+class BenchIQSource {
+public:
+    enum SignalType { BENCH_SIGNAL_TONES, BENCH_SIGNAL_NOISE, BENCH_SIGNAL_FM };
+
+    BenchIQSource();
+
+    void generate(int sampleRate, SignalType type, std::vector<long long> &offsets, float noiseLevel);
+    bool loadFile(std::string fileName, std::string format);
+
+    void read(liquid_float_complex *out, size_t numElems);
+    size_t getPeriodSize();
+
+    static bool parseSignalType(std::string name, SignalType &type);
+
+private:
+    std::vector<liquid_float_complex> period;
+    size_t readPos;
+    unsigned int rngState;
+
+    float nextGaussian();
+};
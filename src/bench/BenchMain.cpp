@@ -0,0 +1,587 @@
+// Headless DSP benchmark: drives source -> post (DC block + channelizer) -> demodulators
+// without wx, a device or audio output and reports throughput, CPU per stage and latency.
+
+#include "BenchPipeline.h"
+#include "BenchIQSource.h"
+#include "PipelineStats.h"
+#include "IQConvert.h"
+#include "SignalLevel.h"
+#include "DSPKernels.h"
+#include "ThreadQueue.h"
+#include "FFTPlanner.h"
+#include "WorkerGroup.h"
+
+#include "ModemFM.h"
+#include "ModemFMStereo.h"
+#include "ModemAM.h"
+#include "ModemLSB.h"
+#include "ModemUSB.h"
+#include "ModemDSB.h"
+#include "ModemIQ.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI        3.14159265358979323846
+#endif
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+#define BENCH_MICRO_ITEMS 2000000
+#define BENCH_MICRO_CONVERT_SIZE 65536
+#define BENCH_MICRO_CONVERT_PASSES 500
+#define BENCH_FMS_SECONDS 10
+// outputs are compared after the pilot PLLs have settled
+#define BENCH_FMS_SETTLE_SECONDS 1
+// bins processed per spectrum size, spread over as many frames as that takes
+#define BENCH_SPECTRUM_TOTAL_BINS (64 << 20)
+#define BENCH_SPECTRUM_AVERAGE_RATE 0.65f
+// display points the bins are reduced to, as for a typical spectrum panel width
+#define BENCH_SPECTRUM_POINTS 2048
+// as SPECTRUM_MAX_WORKERS, for sizes from FFT_PLANNER_THREADED_MIN up
+#define BENCH_SPECTRUM_MAX_WORKERS 8
+// the bound documented for dspFastAtan2, checked over this many angles per radius
+#define BENCH_ATAN2_MAX_ERROR 1e-5
+#define BENCH_ATAN2_ANGLES 1000000
+#define BENCH_WAKE_ITEMS 200
+// off the 10 ms grid so the polling consumer sees every phase of its sleep
+#define BENCH_WAKE_INTERVAL_US 4700
+#define BENCH_WAKE_POLL_MS 10
+#define BENCH_WAKE_IDLE_US 250000
+
+static void printUsage() {
+    std::cout << "Usage: cubicsdr_bench [options]" << std::endl
+              << "  --rate <sps>              source sample rate (default 2400000)" << std::endl
+              << "  --demods <n>              number of demodulators (default 4)" << std::endl
+              << "  --modem <name>            modem type, e.g. FM, FMS, AM, USB (default FM)" << std::endl
+              << "  --channelizer fast|bank   channelizer used by the post stage (default bank)" << std::endl
+              << "  --signal fm|tones|noise   synthetic source signal (default fm)" << std::endl
+              << "  --noise <level>           noise RMS added to the synthetic signal (default 0.01)" << std::endl
+              << "  --file <path>             loop a raw IQ recording instead" << std::endl
+              << "  --format CF32|CS16|CS8    sample format of --file (default CF32)" << std::endl
+              << "  --seconds <s>             run time (default 10)" << std::endl
+              << "  --realtime                pace the source to the sample rate instead of free-running" << std::endl
+              << "  --micro                   run the queue, visual wake, IQ conversion, signal level, atan2, FM stereo and spectrum microbenchmarks first (exits on an accuracy failure)" << std::endl
+              << "  --dump                    print the full pipeline stats snapshot at the end" << std::endl;
+}
+
+static double elapsedSeconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double benchQueue(ThreadQueue<int> &queue) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    std::thread producer([&queue]() {
+        for (int i = 0; i < BENCH_MICRO_ITEMS; i++) {
+            while (!queue.push(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    int item;
+    for (int i = 0; i < BENCH_MICRO_ITEMS; i++) {
+        while (!queue.try_pop(item)) {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+
+    return (double)BENCH_MICRO_ITEMS / elapsedSeconds(start);
+}
+
+// delivery latency of a visual thread's input: the former 10 ms sleep-and-poll loop against
+// blocking in wait_not_empty(), with the producer at a steady rate like the SDR post thread
+static void runVisualWakeBenchmark() {
+    for (int mode = 0; mode < 2; mode++) {
+        bool polling = (mode == 0);
+        ThreadQueue<std::chrono::steady_clock::time_point> queue;
+
+        int received = 0;
+        long wakeups = 0;
+        double latencySum = 0, latencyMax = 0;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        std::thread consumer([&]() {
+            while (received < BENCH_WAKE_ITEMS) {
+                if (polling) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(BENCH_WAKE_POLL_MS));
+                } else if (!queue.wait_not_empty(BENCH_WAKE_IDLE_US)) {
+                    wakeups++;
+                    continue;
+                }
+                wakeups++;
+
+                std::chrono::steady_clock::time_point sent;
+                while (queue.try_pop(sent)) {
+                    double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sent).count();
+                    latencySum += latency;
+                    latencyMax = std::max(latencyMax, latency);
+                    received++;
+                }
+            }
+        });
+
+        for (int i = 0; i < BENCH_WAKE_ITEMS; i++) {
+            std::this_thread::sleep_for(std::chrono::microseconds(BENCH_WAKE_INTERVAL_US));
+            queue.push(std::chrono::steady_clock::now());
+        }
+        consumer.join();
+
+        double seconds = elapsedSeconds(start);
+        std::cout << "  visual wake " << (polling?"10 ms poll:":"blocking:  ") << " "
+                  << latencySum / received << " ms mean, " << latencyMax << " ms max latency, "
+                  << wakeups / seconds << " wakeups/s" << std::endl;
+    }
+}
+
+// scalar reference for the estimator as DemodulatorThread computed it before the SIMD kernels
+static float scalarMagnitudeMean(const std::vector<liquid_float_complex> &data) {
+    double accum = 0;
+    for (size_t i = 0; i < data.size(); i++) {
+        double absI = fabs(data[i].real), absQ = fabs(data[i].imag);
+        accum += (absI > absQ)?(SIGNAL_LEVEL_ALPHA * absI + SIGNAL_LEVEL_BETA * absQ):(SIGNAL_LEVEL_ALPHA * absQ + SIGNAL_LEVEL_BETA * absI);
+    }
+    return (float)(accum / data.size());
+}
+
+static void runSignalLevelBenchmarks(std::vector<liquid_float_complex> &cf32) {
+    // odd lengths so the scalar tails are exercised too
+    size_t numElems = cf32.size() - 3;
+    for (size_t i = 0; i < cf32.size(); i++) {
+        cf32[i].real = sinf((float)i * 0.01f) * 0.8f;
+        cf32[i].imag = cosf((float)i * 0.013f) * -0.6f;
+    }
+    std::vector<liquid_float_complex> ref(cf32.begin(), cf32.begin() + numElems);
+    float *samples = (float *)&cf32[0];
+    size_t numSamples = numElems * 2 + 1;
+
+    float refMag = scalarMagnitudeMean(ref), refPeak = 0, refMax = 0;
+    double refPower = 0;
+    for (size_t i = 0; i < numSamples; i++) {
+        refPeak = std::max(refPeak, (float)fabs(samples[i]));
+        refMax = std::max(refMax, samples[i]);
+    }
+    for (size_t i = 0; i < numElems; i++) {
+        refPower += ref[i].real * ref[i].real + ref[i].imag * ref[i].imag;
+    }
+    refPower /= numElems;
+
+    bool match = fabs(signalMagnitudeMean(&cf32[0], numElems) - refMag) <= 1e-4f * refMag
+              && fabs(signalPowerMean(&cf32[0], numElems) - refPower) <= 1e-4f * refPower
+              && signalPeakAbs(samples, numSamples) == refPeak
+              && signalMax(samples, numSamples, 0) == refMax;
+
+    double totalSamples = (double)numElems * BENCH_MICRO_CONVERT_PASSES / 1000000.0;
+    volatile float sink = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_MICRO_CONVERT_PASSES; i++) {
+        sink = scalarMagnitudeMean(ref);
+    }
+    std::cout << "  magnitude (scalar):  " << totalSamples / elapsedSeconds(start) << " MS/s" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_MICRO_CONVERT_PASSES; i++) {
+        sink = signalMagnitudeMean(&cf32[0], numElems);
+    }
+    std::cout << "  signalMagnitudeMean: " << totalSamples / elapsedSeconds(start) << " MS/s" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_MICRO_CONVERT_PASSES; i++) {
+        sink = signalPowerMean(&cf32[0], numElems);
+    }
+    std::cout << "  signalPowerMean:     " << totalSamples / elapsedSeconds(start) << " MS/s" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_MICRO_CONVERT_PASSES; i++) {
+        sink = signalPeakAbs(samples, numSamples);
+    }
+    std::cout << "  signalPeakAbs:       " << totalSamples * 2 / elapsedSeconds(start) << " M floats/s" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_MICRO_CONVERT_PASSES; i++) {
+        signalScale(samples, numSamples, (i & 1)?2.0f:0.5f);
+    }
+    std::cout << "  signalScale:         " << totalSamples * 2 / elapsedSeconds(start) << " M floats/s" << std::endl;
+    std::cout << "  signal level kernels " << (match?"match":"DO NOT match") << " the scalar reference" << std::endl;
+    (void)sink;
+}
+
+static bool runAtan2Check() {
+    const float radii[] = { 1e-6f, 1.0f, 3.7f, 1e6f };
+    double maxError = 0;
+    volatile float sink = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < sizeof(radii) / sizeof(radii[0]); r++) {
+        for (int i = 0; i <= BENCH_ATAN2_ANGLES; i++) {
+            double t = -M_PI + 2.0 * M_PI * i / BENCH_ATAN2_ANGLES;
+            float y = radii[r] * (float)sin(t), x = radii[r] * (float)cos(t);
+            float approx = dspFastAtan2(y, x);
+            // +-pi are the same angle
+            double error = fabs(approx - atan2((double)y, (double)x));
+            error = std::min(error, 2.0 * M_PI - error);
+            maxError = std::max(maxError, error);
+            sink = approx;
+        }
+    }
+    double seconds = elapsedSeconds(start);
+    (void)sink;
+
+    bool withinBound = (maxError <= BENCH_ATAN2_MAX_ERROR);
+    std::cout << "  dspFastAtan2:        " << std::scientific << std::setprecision(2) << maxError << " rad max error ("
+              << (withinBound?"within":"EXCEEDS") << " " << BENCH_ATAN2_MAX_ERROR << "), " << std::fixed
+              << (double)BENCH_ATAN2_ANGLES * 4 / seconds / 1000000.0 << " M calls/s incl. reference" << std::endl;
+    return withinBound;
+}
+
+// FM stereo multiplex (L = 1 kHz, R = 2.5 kHz tone, 19 kHz pilot) FM-modulated at the default modem rate
+static void generateStereoFM(std::vector<liquid_float_complex> &data, long long sampleRate, double &fmPhase, long long &sampleIndex) {
+    for (size_t i = 0; i < data.size(); i++, sampleIndex++) {
+        double t = (double)sampleIndex / (double)sampleRate;
+        double left = sin(2.0 * M_PI * 1000.0 * t), right = sin(2.0 * M_PI * 2500.0 * t);
+        double pilot = 2.0 * M_PI * 19000.0 * t;
+        double mpx = 0.45 * (left + right) + 0.1 * sin(pilot) + 0.45 * (left - right) * sin(2.0 * pilot);
+        fmPhase += 2.0 * M_PI * 75000.0 * mpx / (double)sampleRate;
+        data[i].real = cos(fmPhase);
+        data[i].imag = sin(fmPhase);
+    }
+}
+
+static double runStereoDecoder(bool blockDecoder, std::vector<float> &audio) {
+    ModemFMStereo modem;
+    modem.setBlockDecoder(blockDecoder);
+    long long sampleRate = modem.getDefaultSampleRate();
+    ModemKit *kit = modem.buildKit(sampleRate, 48000);
+
+    ModemIQData input;
+    input.sampleRate = sampleRate;
+    input.data.resize(sampleRate / BENCH_BLOCKS_PER_SEC);
+    AudioThreadInput output;
+
+    double fmPhase = 0, seconds = 0;
+    long long sampleIndex = 0;
+    audio.clear();
+    for (int i = 0; i < BENCH_FMS_SECONDS * BENCH_BLOCKS_PER_SEC; i++) {
+        generateStereoFM(input.data, sampleRate, fmPhase, sampleIndex);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        modem.demodulate(kit, &input, &output);
+        seconds += elapsedSeconds(start);
+        audio.insert(audio.end(), output.data.begin(), output.data.end());
+    }
+
+    modem.disposeKit(kit);
+    return seconds;
+}
+
+static void runStereoBenchmark() {
+    std::vector<float> legacyAudio, blockAudio;
+    double legacySeconds = runStereoDecoder(false, legacyAudio);
+    double blockSeconds = runStereoDecoder(true, blockAudio);
+
+    size_t settle = 48000 * 2 * BENCH_FMS_SETTLE_SECONDS;
+    size_t numSamples = std::min(legacyAudio.size(), blockAudio.size());
+    double diffPower = 0, refPower = 0, maxDiff = 0;
+    for (size_t i = settle; i < numSamples; i++) {
+        double diff = blockAudio[i] - legacyAudio[i];
+        diffPower += diff * diff;
+        refPower += legacyAudio[i] * legacyAudio[i];
+        maxDiff = std::max(maxDiff, fabs(diff));
+    }
+
+    std::cout << "  FMS legacy decoder:  " << legacySeconds * 100.0 / BENCH_FMS_SECONDS << " % of a core per channel" << std::endl;
+    std::cout << "  FMS block decoder:   " << blockSeconds * 100.0 / BENCH_FMS_SECONDS << " % of a core per channel" << std::endl;
+    if (refPower > 0) {
+        std::cout << "  FMS block vs legacy: " << 10.0 * log10(std::max(diffPower, 1e-30) / refPower) << " dB difference, max " << maxDiff << std::endl;
+    }
+}
+
+// double precision post-FFT pass as SpectrumVisualProcessor ran it before dspSpectrumAccumulate
+static void scalarSpectrumAccumulate(const std::vector<float> &fftOut, size_t fftSize, std::vector<double> &result,
+                                     std::vector<double> &ma, std::vector<double> &maa, std::vector<double> &peak, float &ceil, float &floor) {
+    for (size_t i = 0, iMax = fftSize / 2; i < iMax; i++) {
+        float a = fftOut[i * 2], b = fftOut[i * 2 + 1];
+        float x = fftOut[(fftSize / 2 + i) * 2], y = fftOut[(fftSize / 2 + i) * 2 + 1];
+        result[i] = sqrt(x * x + y * y);
+        result[fftSize / 2 + i] = sqrt(a * a + b * b);
+    }
+    for (size_t i = 0; i < fftSize; i++) {
+        if (maa[i] != maa[i]) maa[i] = result[i];
+        maa[i] += (ma[i] - maa[i]) * BENCH_SPECTRUM_AVERAGE_RATE;
+        if (ma[i] != ma[i]) ma[i] = result[i];
+        ma[i] += (result[i] - ma[i]) * BENCH_SPECTRUM_AVERAGE_RATE;
+        if (maa[i] > ceil || ceil != ceil) {
+            ceil = maa[i];
+        }
+        if (maa[i] < floor || floor != floor) {
+            floor = maa[i];
+        }
+        if (maa[i] > peak[i]) {
+            peak[i] = maa[i];
+        }
+    }
+}
+
+// unzoomed display point reduction as SpectrumVisualProcessor runs it after the averaging pass
+static void spectrumPoints(const std::vector<float> &maa, std::vector<float> &points, float offset) {
+    size_t numPoints = points.size(), binsPerPoint = maa.size() / numPoints;
+    for (size_t x = 0; x < numPoints; x++) {
+        float sum = dspSum(&maa[x * binsPerPoint], binsPerPoint);
+        points[x] = log10f(sum / (float)binsPerPoint + offset);
+    }
+}
+
+static void runSpectrumBenchmark() {
+    WorkerGroup workers("visual");
+
+    for (size_t fftSize = 2048; fftSize <= (1 << 20); fftSize *= 8) {
+        std::vector<float> fftOut(fftSize * 2);
+        for (size_t i = 0; i < fftOut.size(); i++) {
+            fftOut[i] = sinf((float)i * 0.37f) * (1.0f + (float)(i % 97));
+        }
+        int frames = (int)std::max((size_t)4, (size_t)BENCH_SPECTRUM_TOTAL_BINS / fftSize);
+
+        std::vector<double> result(fftSize), refMa(fftSize, 0), refMaa(fftSize, 0), refPeak(fftSize, 0);
+        float refCeil = 0, refFloor = 1;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int f = 0; f < frames; f++) {
+            refCeil = 0;
+            refFloor = 1;
+            scalarSpectrumAccumulate(fftOut, fftSize, result, refMa, refMaa, refPeak, refCeil, refFloor);
+        }
+        double refSeconds = elapsedSeconds(start);
+
+        std::vector<float> ma(fftSize, 0), maa(fftSize, 0), peak(fftSize, 0);
+        float ceil = 0, floor = 1;
+        start = std::chrono::steady_clock::now();
+        for (int f = 0; f < frames; f++) {
+            ceil = 0;
+            floor = 1;
+            dspSpectrumAccumulate(&fftOut[0], fftSize, 0, fftSize, BENCH_SPECTRUM_AVERAGE_RATE, &ma[0], &maa[0], &peak[0], ceil, floor);
+        }
+        double kernelSeconds = elapsedSeconds(start);
+
+        double maxError = fabs(ceil - refCeil) / std::max(1.0f, refCeil);
+        for (size_t i = 0; i < fftSize; i++) {
+            maxError = std::max(maxError, fabs(maa[i] - refMaa[i]) / std::max(1.0, fabs(refMaa[i])));
+            maxError = std::max(maxError, fabs(peak[i] - refPeak[i]) / std::max(1.0, fabs(refPeak[i])));
+        }
+
+        std::vector<float> points(BENCH_SPECTRUM_POINTS);
+        start = std::chrono::steady_clock::now();
+        for (int f = 0; f < frames; f++) {
+            spectrumPoints(maa, points, 0.5f);
+        }
+        double pointsSeconds = elapsedSeconds(start);
+
+        std::cout << "  spectrum " << std::setw(7) << fftSize << " bins: "
+                  << frames / refSeconds << " fps double, " << frames / kernelSeconds << " fps float kernel, max rel. error " << std::scientific << maxError << std::fixed
+                  << ", " << BENCH_SPECTRUM_POINTS << " points " << frames / pointsSeconds << " fps";
+
+        // the split SpectrumVisualProcessor uses for the large main spectrum FFT lengths
+        int parts = std::min(FFTPlanner::getThreads(), BENCH_SPECTRUM_MAX_WORKERS);
+        if (fftSize >= FFT_PLANNER_THREADED_MIN && parts > 1) {
+            std::vector<float> partCeil(parts), partFloor(parts);
+            start = std::chrono::steady_clock::now();
+            for (int f = 0; f < frames; f++) {
+                workers.run(parts, [&](int part) {
+                    size_t partStart = (fftSize * part) / parts, partEnd = (fftSize * (part + 1)) / parts;
+                    partCeil[part] = 0;
+                    partFloor[part] = 1;
+                    dspSpectrumAccumulate(&fftOut[0], fftSize, partStart, partEnd, BENCH_SPECTRUM_AVERAGE_RATE, &ma[0], &maa[0], &peak[0], partCeil[part], partFloor[part]);
+                });
+            }
+            std::cout << ", " << frames / elapsedSeconds(start) << " fps on " << parts << " workers";
+        }
+        std::cout << std::endl;
+    }
+}
+
+// false if an approximation is outside its documented bound
+static bool runMicroBenchmarks() {
+    std::cout << "Microbenchmarks:" << std::endl;
+    std::cout << "  SIMD kernels:        " << dspKernelsIsa() << std::endl;
+
+    ThreadQueue<int> mutexQueue;
+    mutexQueue.set_max_num_items(1024);
+    ThreadQueue<int> ringQueue(1024);
+
+    std::cout << "  ThreadQueue mutex:   " << std::fixed << std::setprecision(2) << benchQueue(mutexQueue) / 1000000.0 << " M items/s" << std::endl;
+    std::cout << "  ThreadQueue ring:    " << benchQueue(ringQueue) / 1000000.0 << " M items/s" << std::endl;
+
+    runVisualWakeBenchmark();
+
+    std::vector<int16_t> cs16(BENCH_MICRO_CONVERT_SIZE * 2);
+    std::vector<int8_t> cs8(BENCH_MICRO_CONVERT_SIZE * 2);
+    std::vector<liquid_float_complex> cf32(BENCH_MICRO_CONVERT_SIZE);
+    for (size_t i = 0; i < cs16.size(); i++) {
+        cs16[i] = (int16_t)(i * 37);
+        cs8[i] = (int8_t)(i * 37);
+    }
+
+    double totalSamples = (double)BENCH_MICRO_CONVERT_SIZE * BENCH_MICRO_CONVERT_PASSES / 1000000.0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_MICRO_CONVERT_PASSES; i++) {
+        iqConvertCS16(&cs16[0], &cf32[0], BENCH_MICRO_CONVERT_SIZE, 1.0f / 32768.0f);
+    }
+    std::cout << "  iqConvertCS16:       " << totalSamples / elapsedSeconds(start) << " MS/s" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_MICRO_CONVERT_PASSES; i++) {
+        iqConvertCS8(&cs8[0], &cf32[0], BENCH_MICRO_CONVERT_SIZE, 1.0f / 128.0f);
+    }
+    std::cout << "  iqConvertCS8:        " << totalSamples / elapsedSeconds(start) << " MS/s" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_MICRO_CONVERT_PASSES; i++) {
+        iqSwap(&cf32[0], BENCH_MICRO_CONVERT_SIZE);
+    }
+    std::cout << "  iqSwap:              " << totalSamples / elapsedSeconds(start) << " MS/s" << std::endl;
+
+    runSignalLevelBenchmarks(cf32);
+    bool withinBounds = runAtan2Check();
+    runStereoBenchmark();
+    runSpectrumBenchmark();
+    std::cout << std::endl;
+    return withinBounds;
+}
+
+int main(int argc, char *argv[]) {
+    BenchConfig config;
+    std::string signalName = "fm", fileName, fileFormat = "CF32";
+    float noiseLevel = 0.01f;
+    bool micro = false, dump = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if (arg == "-h" || arg == "--help") {
+            printUsage();
+            return 0;
+        } else if (arg == "--realtime") {
+            config.realtime = true;
+        } else if (arg == "--micro") {
+            micro = true;
+        } else if (arg == "--dump") {
+            dump = true;
+        } else if (!hasValue) {
+            std::cout << "Missing or unknown option '" << arg << "'." << std::endl;
+            printUsage();
+            return 1;
+        } else if (arg == "--rate") {
+            config.sampleRate = atoi(argv[++i]);
+        } else if (arg == "--demods") {
+            config.numDemods = atoi(argv[++i]);
+        } else if (arg == "--modem") {
+            config.modemName = argv[++i];
+        } else if (arg == "--channelizer") {
+            config.fastChannelizer = (std::string(argv[++i]) == "fast");
+        } else if (arg == "--signal") {
+            signalName = argv[++i];
+        } else if (arg == "--noise") {
+            noiseLevel = (float)atof(argv[++i]);
+        } else if (arg == "--file") {
+            fileName = argv[++i];
+        } else if (arg == "--format") {
+            fileFormat = argv[++i];
+        } else if (arg == "--seconds") {
+            config.seconds = atof(argv[++i]);
+        } else {
+            std::cout << "Unknown option '" << arg << "'." << std::endl;
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (config.sampleRate < BENCH_BLOCKS_PER_SEC || config.numDemods < 1 || config.seconds <= 0) {
+        std::cout << "Sample rate, demodulator count and run time must be positive." << std::endl;
+        return 1;
+    }
+
+    BenchIQSource::SignalType signalType;
+    if (!BenchIQSource::parseSignalType(signalName, signalType)) {
+        std::cout << "Unknown signal type '" << signalName << "'." << std::endl;
+        return 1;
+    }
+
+    if (micro && !runMicroBenchmarks()) {
+        std::cout << "Microbenchmark accuracy check failed." << std::endl;
+        return 1;
+    }
+
+    Modem::addModemFactory(new ModemFM);
+    Modem::addModemFactory(new ModemFMStereo);
+    Modem::addModemFactory(new ModemAM);
+    Modem::addModemFactory(new ModemLSB);
+    Modem::addModemFactory(new ModemUSB);
+    Modem::addModemFactory(new ModemDSB);
+    Modem::addModemFactory(new ModemIQ);
+
+    BenchIQSource source;
+    BenchPipeline pipeline(config, source);
+
+    if (!pipeline.init()) {
+        return 1;
+    }
+
+    if (fileName != "") {
+        if (!source.loadFile(fileName, fileFormat)) {
+            return 1;
+        }
+    } else {
+        std::vector<long long> offsets = pipeline.getChannelOffsets();
+        source.generate(config.sampleRate, signalType, offsets, noiseLevel);
+    }
+
+    std::cout << "Running " << config.numDemods << " x " << config.modemName << " at " << config.sampleRate << " sps, "
+              << (config.fastChannelizer?"fast channelizer":"channel bank") << ", "
+              << (config.realtime?"realtime":"free-running") << ", " << config.seconds << "s" << std::endl;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    pipeline.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds((long long)(config.seconds * 1000.0)));
+
+    // sample the thread CPU clocks while the threads are still alive
+    std::vector<PipelineThreadStats> threadStats = PipelineStats::getThreadStats();
+    double elapsed = elapsedSeconds(start);
+    pipeline.stop();
+
+    double msps = (double)pipeline.getSamplesProcessed() / elapsed / 1000000.0;
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Throughput: " << msps << " MS/s (" << msps * 1000000.0 / (double)config.sampleRate << "x realtime), "
+              << pipeline.getAudioSamples() << " audio samples" << std::endl;
+
+    std::cout << "CPU by stage:" << std::endl;
+    for (std::vector<PipelineThreadStats>::iterator i = threadStats.begin(); i != threadStats.end(); i++) {
+        std::cout << "  " << std::setw(8) << std::left << i->role << std::right << " " << i->threads << " thread(s) "
+                  << std::setprecision(3) << i->cpuSeconds << "s " << std::setprecision(1) << i->cpuSeconds * 100.0 / elapsed << "%" << std::endl;
+    }
+
+    PipelineLatencyStats latency = PipelineStats::getLatencyStats();
+    std::cout << std::setprecision(2) << "Latency (source to demodulated audio): mean " << latency.meanMs << "ms p50 " << latency.percentileMs(0.5)
+              << "ms p99 " << latency.percentileMs(0.99) << "ms max " << latency.maxMs << "ms over " << latency.count << " blocks" << std::endl;
+
+    std::vector<ThreadQueueStats> queueStats = ThreadQueueBase::get_all_stats();
+    for (std::vector<ThreadQueueStats>::iterator i = queueStats.begin(); i != queueStats.end(); i++) {
+        if (i->dropped) {
+            std::cout << "Dropped " << i->dropped << " blocks at " << i->name << std::endl;
+        }
+    }
+
+    if (dump) {
+        std::cout << std::endl;
+        PipelineStats::dump(std::cout);
+    }
+
+    return 0;
+}
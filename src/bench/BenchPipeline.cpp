@@ -0,0 +1,320 @@
+#include "BenchPipeline.h"
+#include "PipelineStats.h"
+
+#include <cmath>
+#include <chrono>
+#include <iostream>
+
+BenchSourceThread::BenchSourceThread(BenchConfig &config, BenchIQSource &source) : IOThread(), config(config), source(source), buffers("BenchSourceBuffers") {
+    samplesOut.store(0);
+}
+
+void BenchSourceThread::run() {
+    applyThreadPolicy("sdr");
+
+    DemodulatorThreadInputQueue *iqDataOutQueue = (DemodulatorThreadInputQueue *)getOutputQueue("IQDataOutput");
+    size_t blockSize = config.sampleRate / BENCH_BLOCKS_PER_SEC;
+
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    uint64_t numBlocks = 0;
+
+    while (!terminated) {
+        if (config.realtime) {
+            std::this_thread::sleep_until(startTime + std::chrono::microseconds((long long)((double)numBlocks * 1000000.0 / (double)BENCH_BLOCKS_PER_SEC)));
+        } else {
+            while (iqDataOutQueue->full() && !terminated) {
+                std::this_thread::yield();
+            }
+            if (terminated) {
+                break;
+            }
+        }
+
+        DemodulatorThreadIQData *dataOut = buffers.getBuffer();
+        if (dataOut->data.size() != blockSize) {
+            dataOut->data.resize(blockSize);
+        }
+        source.read(&dataOut->data[0], blockSize);
+
+        dataOut->frequency = config.centerFreq;
+        dataOut->sampleRate = config.sampleRate;
+        dataOut->captureTime = PipelineStats::now();
+        dataOut->setRefCount(1);
+
+        if (!iqDataOutQueue->push(dataOut)) {
+            dataOut->setRefCount(0);
+        }
+
+        numBlocks++;
+        samplesOut += blockSize;
+    }
+}
+
+BenchPostThread::BenchPostThread(BenchConfig &config, std::vector<DemodulatorChannelSpec> &channels) : IOThread(), config(config), channels(channels), buffers("BenchPostBuffers") {
+    samplesIn.store(0);
+    dcFilter = iirfilt_crcf_create_dc_blocker(0.0005);
+}
+
+BenchPostThread::~BenchPostThread() {
+    iirfilt_crcf_destroy(dcFilter);
+}
+
+void BenchPostThread::addDemodQueue(DemodulatorThreadInputQueue *demodQueue) {
+    demodQueues.push_back(demodQueue);
+    demodQueue->set_stats_name("DemodIQDataInput");
+}
+
+void BenchPostThread::pushOutput(DemodulatorThreadInputQueue *queue, DemodulatorThreadIQData *data) {
+    if (!config.realtime) {
+        while (queue->full() && !terminated) {
+            std::this_thread::yield();
+        }
+    }
+    if (terminated || !queue->push(data)) {
+        data->decRefCount();
+    }
+}
+
+void BenchPostThread::run() {
+    applyThreadPolicy("post");
+
+    DemodulatorThreadInputQueue *iqDataInQueue = (DemodulatorThreadInputQueue *)getInputQueue("IQDataInput");
+    size_t numDemods = channels.size();
+
+    while (!terminated) {
+        DemodulatorThreadIQData *data_in;
+
+        if (!iqDataInQueue->timeout_pop(data_in, 100000)) {
+            continue;
+        }
+
+        size_t dataSize = data_in->data.size();
+        samplesIn += dataSize;
+
+        DemodulatorThreadIQData *demodDataOut = buffers.getBuffer();
+        demodDataOut->frequency = data_in->frequency;
+        demodDataOut->sampleRate = data_in->sampleRate;
+        demodDataOut->captureTime = data_in->captureTime;
+        if (demodDataOut->data.size() != dataSize) {
+            demodDataOut->data.resize(dataSize);
+        }
+
+        iirfilt_crcf_execute_block(dcFilter, &data_in->data[0], dataSize, &demodDataOut->data[0]);
+        data_in->decRefCount();
+
+        if (config.fastChannelizer) {
+            fastChannelizer.process(demodDataOut->frequency, (int)demodDataOut->sampleRate, &demodDataOut->data[0], dataSize, channels, numDemods, outputs);
+        } else {
+            channelBank.process(demodDataOut->frequency, (int)demodDataOut->sampleRate, &demodDataOut->data[0], dataSize, channels, numDemods, outputs);
+        }
+
+        // the bank leaves demodulators it can't narrow on the full-rate block, as in SDRPostThread
+        int fullRateUsers = 0;
+        for (size_t i = 0; i < numDemods; i++) {
+            if (outputs[i] == nullptr && !config.fastChannelizer) {
+                fullRateUsers++;
+            }
+        }
+        demodDataOut->setRefCount(fullRateUsers + 1);
+
+        for (size_t i = 0; i < numDemods; i++) {
+            if (outputs[i] != nullptr) {
+                outputs[i]->captureTime = demodDataOut->captureTime;
+                pushOutput(demodQueues[i], outputs[i]);
+                outputs[i] = nullptr;
+            } else if (!config.fastChannelizer) {
+                pushOutput(demodQueues[i], demodDataOut);
+            }
+        }
+
+        demodDataOut->decRefCount();
+    }
+}
+
+BenchDemodThread::BenchDemodThread(BenchConfig &config, int bandwidth) : IOThread(), config(config), bandwidth(bandwidth), inputRate(0), modemKit(nullptr), iqResampler(nullptr) {
+    samplesIn.store(0);
+    audioOut.store(0);
+    modem = Modem::makeModem(config.modemName);
+}
+
+BenchDemodThread::~BenchDemodThread() {
+    if (modemKit) {
+        modem->disposeKit(modemKit);
+    }
+    if (iqResampler) {
+        msresamp_crcf_destroy(iqResampler);
+    }
+    delete modem;
+}
+
+void BenchDemodThread::process(DemodulatorThreadIQData *inp) {
+    size_t bufSize = inp->data.size();
+    samplesIn += bufSize;
+
+    if (inp->sampleRate != inputRate || !modemKit) {
+        inputRate = inp->sampleRate;
+        bandwidth = modem->checkSampleRate(bandwidth, BENCH_AUDIO_RATE);
+
+        if (modemKit) {
+            modem->disposeKit(modemKit);
+        }
+        if (iqResampler) {
+            msresamp_crcf_destroy(iqResampler);
+        }
+        modemKit = modem->buildKit(bandwidth, BENCH_AUDIO_RATE);
+        iqResampler = msresamp_crcf_create((float)((double)bandwidth / (double)inputRate), 60.0f);
+    }
+
+    size_t out_size = ceil((double)bufSize * (double)bandwidth / (double)inputRate) + 512;
+    if (resampledData.size() < out_size) {
+        resampledData.resize(out_size);
+    }
+
+    unsigned int numWritten;
+    msresamp_crcf_execute(iqResampler, &inp->data[0], bufSize, &resampledData[0], &numWritten);
+
+    modemData.sampleRate = bandwidth;
+    modemData.data.assign(resampledData.begin(), resampledData.begin() + numWritten);
+    modemData.setRefCount(1);
+
+    modem->demodulate(modemKit, &modemData, &audioData);
+    audioOut += audioData.data.size();
+
+    PipelineStats::recordLatency(inp->captureTime);
+    inp->decRefCount();
+}
+
+void BenchDemodThread::run() {
+    applyThreadPolicy("demod");
+
+    DemodulatorThreadInputQueue *iqInputQueue = (DemodulatorThreadInputQueue *)getInputQueue("IQDataInput");
+
+    while (!terminated) {
+        DemodulatorThreadIQData *inp;
+
+        if (iqInputQueue->timeout_pop(inp, 100000)) {
+            process(inp);
+        }
+    }
+}
+
+BenchPipeline::BenchPipeline(BenchConfig &config, BenchIQSource &source) : config(config), source(source), iqQueue(nullptr), sourceThread(nullptr), postThread(nullptr) {
+
+}
+
+BenchPipeline::~BenchPipeline() {
+    stop();
+
+    delete sourceThread;
+    delete postThread;
+    for (size_t i = 0; i < demodThreads.size(); i++) {
+        delete demodThreads[i];
+        delete demodQueues[i];
+    }
+    delete iqQueue;
+}
+
+bool BenchPipeline::init() {
+    int bandwidth = Modem::getModemDefaultSampleRate(config.modemName);
+    if (!bandwidth) {
+        std::cout << "Unknown modem '" << config.modemName << "'." << std::endl;
+        return false;
+    }
+
+    // spread the demodulators evenly across the band, clear of DC and the edges
+    long long spacing = config.sampleRate / (config.numDemods + 1);
+    if (bandwidth > spacing) {
+        bandwidth = (int)spacing;
+    }
+
+    channels.resize(config.numDemods);
+    for (int i = 0; i < config.numDemods; i++) {
+        long long offset = (i + 1) * spacing - config.sampleRate / 2;
+        if (offset == 0) {
+            offset = spacing / 2;
+        }
+        channels[i].owner = &channels[i];
+        channels[i].frequency = config.centerFreq + offset;
+        channels[i].bandwidth = bandwidth;
+    }
+
+    iqQueue = new DemodulatorThreadInputQueue(BENCH_QUEUE_SIZE);
+
+    sourceThread = new BenchSourceThread(config, source);
+    sourceThread->setOutputQueue("IQDataOutput", iqQueue);
+
+    postThread = new BenchPostThread(config, channels);
+    postThread->setInputQueue("IQDataInput", iqQueue);
+
+    for (int i = 0; i < config.numDemods; i++) {
+        DemodulatorThreadInputQueue *demodQueue = new DemodulatorThreadInputQueue(BENCH_QUEUE_SIZE);
+        BenchDemodThread *demodThread = new BenchDemodThread(config, bandwidth);
+
+        postThread->addDemodQueue(demodQueue);
+        demodThread->setInputQueue("IQDataInput", demodQueue);
+
+        demodQueues.push_back(demodQueue);
+        demodThreads.push_back(demodThread);
+    }
+
+    return true;
+}
+
+std::vector<long long> BenchPipeline::getChannelOffsets() {
+    std::vector<long long> offsets;
+    for (size_t i = 0; i < channels.size(); i++) {
+        offsets.push_back(channels[i].frequency - config.centerFreq);
+    }
+    return offsets;
+}
+
+void BenchPipeline::start() {
+    for (size_t i = 0; i < demodThreads.size(); i++) {
+        threads.push_back(new std::thread(&BenchDemodThread::threadMain, demodThreads[i]));
+    }
+    threads.push_back(new std::thread(&BenchPostThread::threadMain, postThread));
+    threads.push_back(new std::thread(&BenchSourceThread::threadMain, sourceThread));
+}
+
+void BenchPipeline::stop() {
+    if (threads.empty()) {
+        return;
+    }
+
+    // upstream first so nothing is left waiting on a full queue
+    sourceThread->terminate();
+    threads.back()->join();
+    postThread->terminate();
+    threads[threads.size() - 2]->join();
+    for (size_t i = 0; i < demodThreads.size(); i++) {
+        demodThreads[i]->terminate();
+        threads[i]->join();
+    }
+
+    for (size_t i = 0; i < threads.size(); i++) {
+        delete threads[i];
+    }
+    threads.clear();
+
+    DemodulatorThreadIQData *leftover;
+    while (iqQueue->try_pop(leftover)) {
+        leftover->decRefCount();
+    }
+    for (size_t i = 0; i < demodQueues.size(); i++) {
+        while (demodQueues[i]->try_pop(leftover)) {
+            leftover->decRefCount();
+        }
+    }
+}
+
+uint64_t BenchPipeline::getSamplesProcessed() {
+    return postThread?postThread->samplesIn.load():0;
+}
+
+uint64_t BenchPipeline::getAudioSamples() {
+    uint64_t total = 0;
+    for (size_t i = 0; i < demodThreads.size(); i++) {
+        total += demodThreads[i]->audioOut.load();
+    }
+    return total;
+}
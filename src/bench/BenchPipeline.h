@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <string>
+
+#include "IOThread.h"
+#include "DemodDefs.h"
+#include "Modem.h"
+#include "SDRChannelBank.h"
+#include "SDRFastChannelizer.h"
+#include "BenchIQSource.h"
+
+#define BENCH_QUEUE_SIZE 32
+#define BENCH_BLOCKS_PER_SEC 60
+#define BENCH_AUDIO_RATE 48000
+
+class BenchConfig {
+public:
+    int sampleRate;
+    long long centerFreq;
+    int numDemods;
+    std::string modemName;
+    bool fastChannelizer;
+    bool realtime;
+    double seconds;
+
+    BenchConfig() : sampleRate(2400000), centerFreq(100000000), numDemods(4), modemName("FM"), fastChannelizer(false), realtime(false), seconds(10) {
+
+    }
+};
+
+/**
+ * Stands in for SDRThread: hands out source blocks stamped with their capture time.
+ * Free-running by default (waits on a full queue so nothing is dropped); in realtime
+ * mode blocks are paced to the sample rate and dropped like a device would.
+ */
+class BenchSourceThread : public IOThread {
+public:
+    BenchSourceThread(BenchConfig &config, BenchIQSource &source);
+
+    void run();
+
+    std::atomic<uint64_t> samplesOut;
+
+private:
+    BenchConfig &config;
+    BenchIQSource &source;
+    ReBuffer<DemodulatorThreadIQData> buffers;
+};
+
+/**
+ * Stands in for SDRPostThread: DC block, then the same channel bank or fast channelizer
+ * the app uses to feed each demodulator at its own rate.
+ */
+class BenchPostThread : public IOThread {
+public:
+    BenchPostThread(BenchConfig &config, std::vector<DemodulatorChannelSpec> &channels);
+    ~BenchPostThread();
+
+    void run();
+    void addDemodQueue(DemodulatorThreadInputQueue *demodQueue);
+
+    std::atomic<uint64_t> samplesIn;
+
+private:
+    void pushOutput(DemodulatorThreadInputQueue *queue, DemodulatorThreadIQData *data);
+
+    BenchConfig &config;
+    std::vector<DemodulatorChannelSpec> &channels;
+    std::vector<DemodulatorThreadInputQueue *> demodQueues;
+    std::vector<DemodulatorThreadIQData *> outputs;
+    ReBuffer<DemodulatorThreadIQData> buffers;
+    SDRChannelBank channelBank;
+    SDRFastChannelizer fastChannelizer;
+    iirfilt_crcf dcFilter;
+};
+
+/**
+ * Stands in for DemodulatorPreThread + DemodulatorThread: resample the channel to the
+ * modem rate and run the real Modem implementation; the output is discarded after
+ * recording the block's capture-to-audio latency.
+ */
+class BenchDemodThread : public IOThread {
+public:
+    BenchDemodThread(BenchConfig &config, int bandwidth);
+    ~BenchDemodThread();
+
+    void run();
+
+    std::atomic<uint64_t> samplesIn;
+    std::atomic<uint64_t> audioOut;
+
+private:
+    void process(DemodulatorThreadIQData *inp);
+
+    BenchConfig &config;
+    int bandwidth;
+    long long inputRate;
+    Modem *modem;
+    ModemKit *modemKit;
+    msresamp_crcf iqResampler;
+    ModemIQData modemData;
+    AudioThreadInput audioData;
+    std::vector<liquid_float_complex> resampledData;
+};
+
+class BenchPipeline {
+public:
+    BenchPipeline(BenchConfig &config, BenchIQSource &source);
+    ~BenchPipeline();
+
+    bool init();
+    void start();
+    void stop();
+
+    std::vector<long long> getChannelOffsets();
+    uint64_t getSamplesProcessed();
+    uint64_t getAudioSamples();
+
+private:
+    BenchConfig &config;
+    BenchIQSource &source;
+
+    std::vector<DemodulatorChannelSpec> channels;
+    DemodulatorThreadInputQueue *iqQueue;
+    std::vector<DemodulatorThreadInputQueue *> demodQueues;
+
+    BenchSourceThread *sourceThread;
+    BenchPostThread *postThread;
+    std::vector<BenchDemodThread *> demodThreads;
+    std::vector<std::thread *> threads;
+};
@@ -48,21 +48,35 @@ public:
     std::string demodType;
 };
 
+// What a channelizer needs to know about one demodulator; owner keys its channel state.
+class DemodulatorChannelSpec {
+public:
+    const void *owner;
+    long long frequency;
+    int bandwidth;
+
+    DemodulatorChannelSpec() :
+            owner(nullptr), frequency(0), bandwidth(0) {
+    }
+};
+
 class DemodulatorThreadIQData: public ReferenceCounter {
 public:
     long long frequency;
     long long sampleRate;
+    long long captureTime;
     std::vector<liquid_float_complex> data;
     std::mutex busy_rw;
 
     DemodulatorThreadIQData() :
-            frequency(0), sampleRate(0) {
+            frequency(0), sampleRate(0), captureTime(0) {
 
     }
 
     DemodulatorThreadIQData & operator=(const DemodulatorThreadIQData &other) {
         frequency = other.frequency;
         sampleRate = other.sampleRate;
+        captureTime = other.captureTime;
         data.assign(other.data.begin(), other.data.end());
         return *this;
     }
@@ -79,13 +93,14 @@ class DemodulatorThreadPostIQData: public ReferenceCounter {
 public:
     std::vector<liquid_float_complex> data;
     long long sampleRate;
+    long long captureTime;
     std::string modemName;
     std::string modemType;
     Modem *modem;
     ModemKit *modemKit;
 
     DemodulatorThreadPostIQData() :
-            sampleRate(0), modem(nullptr), modemKit(nullptr) {
+            sampleRate(0), captureTime(0), modem(nullptr), modemKit(nullptr) {
 
     }
 
@@ -6,7 +6,7 @@
 #endif
 
 DemodulatorInstance::DemodulatorInstance() :
-        t_PreDemod(nullptr), t_Demod(nullptr), t_Audio(nullptr) {
+        t_PreDemod(nullptr), t_Demod(nullptr), t_Audio(nullptr), threadPool(nullptr), recordSink(nullptr) {
 
 #if ENABLE_DIGITAL_LAB
     activeOutput = nullptr;
@@ -22,10 +22,11 @@ DemodulatorInstance::DemodulatorInstance() :
 	follow.store(false);
 	currentOutputDevice.store(-1);
     currentAudioGain.store(1.0);
+    threadPooled = wxGetApp().getConfig()->getDemodThreadPool();
 
     label = new std::string("Unnamed");
-    pipeIQInputData = new DemodulatorThreadInputQueue;
-    pipeIQDemodData = new DemodulatorThreadPostInputQueue;
+    pipeIQInputData = new DemodulatorThreadInputQueue(DEMOD_IQ_PIPE_RING_SIZE);
+    pipeIQDemodData = new DemodulatorThreadPostInputQueue(DEMOD_IQ_PIPE_RING_SIZE);
     pipeDemodNotify = new DemodulatorThreadCommandQueue;
     
     audioThread = new AudioThread();
@@ -35,7 +36,7 @@ DemodulatorInstance::DemodulatorInstance() :
     demodulatorPreThread->setOutputQueue("IQDataOutput",pipeIQDemodData);
     demodulatorPreThread->setOutputQueue("NotifyQueue",pipeDemodNotify);
             
-    pipeAudioData = new AudioThreadInputQueue;
+    pipeAudioData = new AudioThreadInputQueue(DEMOD_AUDIO_PIPE_RING_SIZE);
     threadQueueControl = new DemodulatorThreadControlCommandQueue;
 
     demodulatorThread = new DemodulatorThread(this);
@@ -52,6 +53,10 @@ DemodulatorInstance::~DemodulatorInstance() {
 #if ENABLE_DIGITAL_LAB
     delete activeOutput;
 #endif
+    if (recordSink) {
+        demodulatorThread->setRecordSink(nullptr);
+        wxGetApp().getAudioRecorderThread()->removeSink(recordSink);
+    }
     delete audioThread;
     delete demodulatorThread;
     delete demodulatorPreThread;
@@ -72,6 +77,17 @@ void DemodulatorInstance::run() {
     }
 
     t_Audio = new std::thread(&AudioThread::threadMain, audioThread);
+
+    if (threadPooled) {
+        // pre-demod and demod stages run inline on the shared pool, see runPoolTask()
+        threadPool = wxGetApp().getDemodMgr().getThreadPool();
+        demodulatorPreThread->init();
+        demodulatorThread->init();
+
+        active = true;
+        audioTerminated = demodTerminated = preDemodTerminated = terminated = false;
+        return;
+    }
     
 #ifdef __APPLE__    // Already using pthreads, might as well do some custom init..
     pthread_attr_t attr;
@@ -109,8 +125,24 @@ void DemodulatorInstance::updateLabel(long long freq) {
 }
 
 void DemodulatorInstance::terminate() {
+    if (recordSink) {
+        // detach first: after this no push can land behind removeSink()'s drain
+        demodulatorThread->setRecordSink(nullptr);
+        // the recorder deletes the sink once its writer is done with it
+        wxGetApp().getAudioRecorderThread()->removeSink(recordSink);
+        recordSink = nullptr;
+    }
     std::cout << "Terminating demodulator audio thread.." << std::endl;
     audioThread->terminate();
+    if (threadPooled && threadPool) {
+        std::cout << "Removing demodulator from thread pool.." << std::endl;
+        threadPool->remove(this);
+        demodulatorThread->terminate();
+        demodulatorThread->deinit();
+        demodulatorPreThread->terminate();
+        demodulatorPreThread->deinit();
+        return;
+    }
     std::cout << "Terminating demodulator thread.." << std::endl;
     demodulatorThread->terminate();
     std::cout << "Terminating demodulator preprocessor thread.." << std::endl;
@@ -142,6 +174,15 @@ bool DemodulatorInstance::isTerminated() {
             delete t_Audio;
             break;
         case DemodulatorThreadCommand::DEMOD_THREAD_CMD_DEMOD_TERMINATED:
+            if (threadPooled) {
+#if ENABLE_DIGITAL_LAB
+                if (activeOutput) {
+                    closeOutput();
+                }
+#endif
+                demodTerminated = true;
+                break;
+            }
 #ifdef __APPLE__
             pthread_join(t_Demod, NULL);
 #else
@@ -156,6 +197,10 @@ bool DemodulatorInstance::isTerminated() {
             demodTerminated = true;
             break;
         case DemodulatorThreadCommand::DEMOD_THREAD_CMD_DEMOD_PREPROCESS_TERMINATED:
+            if (threadPooled) {
+                preDemodTerminated = true;
+                break;
+            }
 #ifdef __APPLE__
             pthread_join(t_PreDemod, NULL);
 #else
@@ -407,10 +452,77 @@ void DemodulatorInstance::setMuted(bool muted) {
     wxGetApp().getDemodMgr().setLastMuted(muted);
 }
 
+bool DemodulatorInstance::isRecording() {
+    return recordSink && recordSink->isRecording();
+}
+
+void DemodulatorInstance::setRecording(bool recording) {
+    if (recording && !recordSink) {
+        recordSink = new AudioRecordSink();
+        wxGetApp().getAudioRecorderThread()->addSink(recordSink);
+        demodulatorThread->setRecordSink(recordSink);
+    }
+    if (!recordSink) {
+        return;
+    }
+    if (recording) {
+        AudioRecorderThread *recorder = wxGetApp().getAudioRecorderThread();
+        recorder->setPath(wxGetApp().getIQRecordingPath());
+        recorder->setFormat(wxGetApp().getConfig()->getAudioRecordingFormat());
+        recorder->setSquelchHang(wxGetApp().getConfig()->getAudioRecordingSquelchHang());
+    }
+    recordSink->setRecording(recording);
+}
+
 DemodulatorThreadInputQueue *DemodulatorInstance::getIQInputDataPipe() {
     return pipeIQInputData;
 }
 
+bool DemodulatorInstance::pushIQInput(DemodulatorThreadIQData *inp) {
+    if (!pipeIQInputData->push(inp)) {
+        return false;
+    }
+    if (threadPooled && threadPool) {
+        threadPool->schedule(this);
+    }
+    return true;
+}
+
+bool DemodulatorInstance::isThreadPooled() {
+    return threadPooled;
+}
+
+void DemodulatorInstance::runPoolTask() {
+    for (int i = 0; i < DEMOD_POOL_TASK_BATCH; i++) {
+        bool busy = false;
+
+        if (!pipeIQInputData->empty()) {
+            DemodulatorThreadIQData *inp;
+            if (pipeIQInputData->try_pop(inp)) {
+                demodulatorPreThread->process(inp);
+                busy = true;
+            }
+        }
+
+        while (!pipeIQDemodData->empty()) {
+            DemodulatorThreadPostIQData *inp;
+            if (!pipeIQDemodData->try_pop(inp)) {
+                break;
+            }
+            demodulatorThread->process(inp);
+            busy = true;
+        }
+
+        if (!busy) {
+            break;
+        }
+    }
+}
+
+bool DemodulatorInstance::hasPoolInput() {
+    return !pipeIQInputData->empty() || !pipeIQDemodData->empty();
+}
+
 ModemArgInfoList DemodulatorInstance::getModemArgs() {
     Modem *m = demodulatorPreThread->getModem();
     
@@ -6,6 +6,7 @@
 
 #include "DemodulatorThread.h"
 #include "DemodulatorPreThread.h"
+#include "DemodulatorThreadPool.h"
 
 #include "ModemDigital.h"
 #include "ModemAnalog.h"
@@ -14,7 +15,7 @@
 #include "DigitalConsole.h"
 #endif
 
-class DemodulatorInstance {
+class DemodulatorInstance : public DemodulatorPoolTask {
 public:
 
 #ifdef __APPLE__
@@ -89,7 +90,15 @@ public:
     bool isMuted();
     void setMuted(bool muted);
 
+    bool isRecording();
+    void setRecording(bool recording);
+
     DemodulatorThreadInputQueue *getIQInputDataPipe();
+    bool pushIQInput(DemodulatorThreadIQData *inp);
+
+    bool isThreadPooled();
+    void runPoolTask();
+    bool hasPoolInput();
 
     ModemArgInfoList getModemArgs();
     std::string readModemSetting(std::string setting);
@@ -116,6 +125,8 @@ protected:
     DemodulatorPreThread *demodulatorPreThread;
     DemodulatorThread *demodulatorThread;
     DemodulatorThreadControlCommandQueue *threadQueueControl;
+    DemodulatorThreadPool *threadPool;
+    AudioRecordSink *recordSink;
 
 private:
 
@@ -124,6 +135,7 @@ private:
     std::atomic_bool demodTerminated; //
     std::atomic_bool audioTerminated; //
     std::atomic_bool preDemodTerminated;
+    bool threadPooled;
     std::atomic_bool active;
     std::atomic_bool squelch;
     std::atomic_bool muted;
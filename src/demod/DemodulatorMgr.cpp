@@ -14,12 +14,16 @@ bool demodFreqCompare (DemodulatorInstance *i, DemodulatorInstance *j) { return
 bool inactiveCompare (DemodulatorInstance *i, DemodulatorInstance *j) { return (i->isActive()<j->isActive()); }
 
 DemodulatorMgr::DemodulatorMgr() :
-        activeDemodulator(NULL), lastActiveDemodulator(NULL), activeVisualDemodulator(NULL), lastBandwidth(DEFAULT_DEMOD_BW), lastDemodType(
+        activeDemodulator(NULL), lastActiveDemodulator(NULL), activeVisualDemodulator(NULL), threadPool(NULL), lastBandwidth(DEFAULT_DEMOD_BW), lastDemodType(
                 DEFAULT_DEMOD_TYPE), lastSquelchEnabled(false), lastSquelch(-100), lastGain(1.0), lastMuted(false), lastDeltaLock(false) {
 }
 
 DemodulatorMgr::~DemodulatorMgr() {
     terminateAll();
+    if (threadPool) {
+        threadPool->stop();
+        delete threadPool;
+    }
 }
 
 DemodulatorInstance *DemodulatorMgr::newThread() {
@@ -42,6 +46,14 @@ void DemodulatorMgr::terminateAll() {
     }
 }
 
+DemodulatorThreadPool *DemodulatorMgr::getThreadPool() {
+    if (!threadPool) {
+        threadPool = new DemodulatorThreadPool();
+        threadPool->start();
+    }
+    return threadPool;
+}
+
 std::vector<DemodulatorInstance *> &DemodulatorMgr::getDemodulators() {
     return demods;
 }
@@ -5,6 +5,7 @@
 #include <thread>
 
 #include "DemodulatorInstance.h"
+#include "DemodulatorThreadPool.h"
 
 class DemodulatorMgr {
 public:
@@ -24,6 +25,8 @@ public:
 
     void terminateAll();
 
+    DemodulatorThreadPool *getThreadPool();
+
     void setActiveDemodulator(DemodulatorInstance *demod, bool temporary = true);
     DemodulatorInstance *getActiveDemodulator();
     DemodulatorInstance *getLastActiveDemodulator();
@@ -62,6 +65,7 @@ private:
     DemodulatorInstance *activeDemodulator;
     DemodulatorInstance *lastActiveDemodulator;
     DemodulatorInstance *activeVisualDemodulator;
+    DemodulatorThreadPool *threadPool;
 
     int lastBandwidth;
     std::string lastDemodType;
@@ -1,15 +1,11 @@
 #include "CubicSDRDefs.h"
 #include <vector>
 
-#ifdef __APPLE__
-#include <pthread.h>
-#endif
-
 #include "DemodulatorPreThread.h"
 #include "CubicSDR.h"
 #include "DemodulatorInstance.h"
 
-DemodulatorPreThread::DemodulatorPreThread(DemodulatorInstance *parent) : IOThread(), iqResampler(NULL), iqResampleRatio(1), cModem(nullptr), cModemKit(nullptr), iqInputQueue(NULL), iqOutputQueue(NULL), threadQueueNotify(NULL)
+DemodulatorPreThread::DemodulatorPreThread(DemodulatorInstance *parent) : IOThread(), iqResampler(NULL), iqResampleRatio(1), buffers("DemodulatorPreThreadBuffers"), cModem(nullptr), cModemKit(nullptr), iqInputQueue(NULL), iqOutputQueue(NULL), threadQueueNotify(NULL)
  {
 	initialized.store(false);
     this->parent = parent;
@@ -45,238 +41,244 @@ DemodulatorPreThread::~DemodulatorPreThread() {
 }
 
 void DemodulatorPreThread::run() {
-#ifdef __APPLE__
-    pthread_t tID = pthread_self();  // ID of this thread
-    int priority = sched_get_priority_max( SCHED_FIFO) - 1;
-    sched_param prio = {priority}; // scheduling priority of thread
-    pthread_setschedparam(tID, SCHED_FIFO, &prio);
-#endif
+    applyThreadPolicy("demod-pre");
 
     std::cout << "Demodulator preprocessor thread started.." << std::endl;
 
-    ReBuffer<DemodulatorThreadPostIQData> buffers("DemodulatorPreThreadBuffers");
+    init();
+    
+    while (!terminated) {
+        DemodulatorThreadIQData *inp;
+        iqInputQueue->pop(inp);
+        process(inp);
+    }
+
+    deinit();
+
+    std::cout << "Demodulator preprocessor thread done." << std::endl;
+}
 
+void DemodulatorPreThread::init() {
     iqInputQueue = (DemodulatorThreadInputQueue*)getInputQueue("IQDataInput");
     iqOutputQueue = (DemodulatorThreadPostInputQueue*)getOutputQueue("IQDataOutput");
     threadQueueNotify = (DemodulatorThreadCommandQueue*)getOutputQueue("NotifyQueue");
-    
-    std::vector<liquid_float_complex> in_buf_data;
-    std::vector<liquid_float_complex> out_buf_data;
 
     t_Worker = new std::thread(&DemodulatorWorkerThread::threadMain, workerThread);
+}
+
+void DemodulatorPreThread::deinit() {
+    buffers.purge();
+
+    DemodulatorThreadCommand tCmd(DemodulatorThreadCommand::DEMOD_THREAD_CMD_DEMOD_PREPROCESS_TERMINATED);
+    tCmd.context = this;
+    threadQueueNotify->push(tCmd);
+}
+
+void DemodulatorPreThread::process(DemodulatorThreadIQData *inp) {
     
-    while (!terminated) {
-        DemodulatorThreadIQData *inp;
-        iqInputQueue->pop(inp);
-        
-        if (frequencyChanged.load()) {
-            currentFrequency = newFrequency;
-            frequencyChanged.store(false);
+    if (frequencyChanged.load()) {
+        currentFrequency = newFrequency;
+        frequencyChanged.store(false);
+    }
+    
+    if (inp->sampleRate != currentSampleRate) {
+        newSampleRate = inp->sampleRate;
+        if (newSampleRate) {
+            sampleRateChanged.store(true);
         }
-        
-        if (inp->sampleRate != currentSampleRate) {
-            newSampleRate = inp->sampleRate;
-            if (newSampleRate) {
-                sampleRateChanged.store(true);
-            }
+    }
+    
+    if (!newAudioSampleRate) {
+        newAudioSampleRate = parent->getAudioSampleRate();
+        if (newAudioSampleRate) {
+            audioSampleRateChanged.store(true);
         }
-        
-        if (!newAudioSampleRate) {
+    } else if (parent->getAudioSampleRate() != newAudioSampleRate) {
+        int newRate;
+        if ((newRate = parent->getAudioSampleRate())) {
             newAudioSampleRate = parent->getAudioSampleRate();
-            if (newAudioSampleRate) {
-                audioSampleRateChanged.store(true);
-            }
-        } else if (parent->getAudioSampleRate() != newAudioSampleRate) {
-            int newRate;
-            if ((newRate = parent->getAudioSampleRate())) {
-                newAudioSampleRate = parent->getAudioSampleRate();
-                audioSampleRateChanged.store(true);
-            }
+            audioSampleRateChanged.store(true);
         }
-        
-        if (demodTypeChanged.load() && (newSampleRate && newAudioSampleRate && newBandwidth)) {
-            DemodulatorWorkerThreadCommand command(DemodulatorWorkerThreadCommand::DEMOD_WORKER_THREAD_CMD_MAKE_DEMOD);
-            command.frequency = newFrequency;
-            command.sampleRate = newSampleRate;
-            command.demodType = newDemodType;
-            command.bandwidth = newBandwidth;
-            command.audioSampleRate = newAudioSampleRate;
-            demodType = newDemodType;
-            sampleRateChanged.store(false);
-            audioSampleRateChanged.store(false);
-            ModemSettings lastSettings = parent->getLastModemSettings(newDemodType);
-            if (lastSettings.size() != 0) {
-                command.settings = lastSettings;
-                if (modemSettingsBuffered.size()) {
-                    for (ModemSettings::const_iterator msi = modemSettingsBuffered.begin(); msi != modemSettingsBuffered.end(); msi++) {
-                        command.settings[msi->first] = msi->second;
-                    }
+    }
+    
+    if (demodTypeChanged.load() && (newSampleRate && newAudioSampleRate && newBandwidth)) {
+        DemodulatorWorkerThreadCommand command(DemodulatorWorkerThreadCommand::DEMOD_WORKER_THREAD_CMD_MAKE_DEMOD);
+        command.frequency = newFrequency;
+        command.sampleRate = newSampleRate;
+        command.demodType = newDemodType;
+        command.bandwidth = newBandwidth;
+        command.audioSampleRate = newAudioSampleRate;
+        demodType = newDemodType;
+        sampleRateChanged.store(false);
+        audioSampleRateChanged.store(false);
+        ModemSettings lastSettings = parent->getLastModemSettings(newDemodType);
+        if (lastSettings.size() != 0) {
+            command.settings = lastSettings;
+            if (modemSettingsBuffered.size()) {
+                for (ModemSettings::const_iterator msi = modemSettingsBuffered.begin(); msi != modemSettingsBuffered.end(); msi++) {
+                    command.settings[msi->first] = msi->second;
                 }
-            } else {
-                command.settings = modemSettingsBuffered;
             }
-            modemSettingsBuffered.clear();
-            modemSettingsChanged.store(false);
-            workerQueue->push(command);
-            cModem = nullptr;
-            cModemKit = nullptr;
-            demodTypeChanged.store(false);
-            initialized.store(false);
-        }
-        else if (
-            cModemKit && cModem &&
-            (bandwidthChanged.load() || sampleRateChanged.load() || audioSampleRateChanged.load() || cModem->shouldRebuildKit()) &&
-            (newSampleRate && newAudioSampleRate && newBandwidth)
-        ) {
-            DemodulatorWorkerThreadCommand command(DemodulatorWorkerThreadCommand::DEMOD_WORKER_THREAD_CMD_BUILD_FILTERS);
-            command.frequency = newFrequency;
-            command.sampleRate = newSampleRate;
-            command.bandwidth = newBandwidth;
-            command.audioSampleRate = newAudioSampleRate;
-            bandwidthChanged.store(false);
-            sampleRateChanged.store(false);
-            audioSampleRateChanged.store(false);
-            modemSettingsBuffered.clear();
-            workerQueue->push(command);
+        } else {
+            command.settings = modemSettingsBuffered;
         }
-        
-        // Requested frequency is not center, shift it into the center!
-        if ((currentFrequency - inp->frequency) != shiftFrequency) {
-            shiftFrequency = currentFrequency - inp->frequency;
-            if (abs(shiftFrequency) <= (int) ((double) (inp->sampleRate / 2) * 1.5)) {
-                nco_crcf_set_frequency(freqShifter, (2.0 * M_PI) * (((double) abs(shiftFrequency)) / ((double) inp->sampleRate)));
-            }
+        modemSettingsBuffered.clear();
+        modemSettingsChanged.store(false);
+        workerQueue->push(command);
+        cModem = nullptr;
+        cModemKit = nullptr;
+        demodTypeChanged.store(false);
+        initialized.store(false);
+    }
+    else if (
+        cModemKit && cModem &&
+        (bandwidthChanged.load() || sampleRateChanged.load() || audioSampleRateChanged.load() || cModem->shouldRebuildKit()) &&
+        (newSampleRate && newAudioSampleRate && newBandwidth)
+    ) {
+        DemodulatorWorkerThreadCommand command(DemodulatorWorkerThreadCommand::DEMOD_WORKER_THREAD_CMD_BUILD_FILTERS);
+        command.frequency = newFrequency;
+        command.sampleRate = newSampleRate;
+        command.bandwidth = newBandwidth;
+        command.audioSampleRate = newAudioSampleRate;
+        bandwidthChanged.store(false);
+        sampleRateChanged.store(false);
+        audioSampleRateChanged.store(false);
+        modemSettingsBuffered.clear();
+        workerQueue->push(command);
+    }
+    
+    // Requested frequency is not center, shift it into the center!
+    if ((currentFrequency - inp->frequency) != shiftFrequency) {
+        shiftFrequency = currentFrequency - inp->frequency;
+        if (abs(shiftFrequency) <= (int) ((double) (inp->sampleRate / 2) * 1.5)) {
+            nco_crcf_set_frequency(freqShifter, (2.0 * M_PI) * (((double) abs(shiftFrequency)) / ((double) inp->sampleRate)));
         }
+    }
 
-        if (cModem && cModemKit && abs(shiftFrequency) > (int) ((double) (inp->sampleRate / 2) * 1.5)) {
-            inp->decRefCount();
-            continue;
-        }
+    if (cModem && cModemKit && abs(shiftFrequency) > (int) ((double) (inp->sampleRate / 2) * 1.5)) {
+        inp->decRefCount();
+        return;
+    }
 
 //        std::lock_guard < std::mutex > lock(inp->m_mutex);
-        std::vector<liquid_float_complex> *data = &inp->data;
-        if (data->size() && (inp->sampleRate == currentSampleRate) && cModem && cModemKit) {
-            size_t bufSize = data->size();
-
-            if (in_buf_data.size() != bufSize) {
-                if (in_buf_data.capacity() < bufSize) {
-                    in_buf_data.reserve(bufSize);
-                    out_buf_data.reserve(bufSize);
-                }
-                in_buf_data.resize(bufSize);
-                out_buf_data.resize(bufSize);
+    std::vector<liquid_float_complex> *data = &inp->data;
+    if (data->size() && (inp->sampleRate == currentSampleRate) && cModem && cModemKit) {
+        size_t bufSize = data->size();
+
+        if (in_buf_data.size() != bufSize) {
+            if (in_buf_data.capacity() < bufSize) {
+                in_buf_data.reserve(bufSize);
+                out_buf_data.reserve(bufSize);
             }
+            in_buf_data.resize(bufSize);
+            out_buf_data.resize(bufSize);
+        }
 
-            in_buf_data.assign(inp->data.begin(), inp->data.end());
+        in_buf_data.assign(inp->data.begin(), inp->data.end());
 
-            liquid_float_complex *in_buf = &in_buf_data[0];
-            liquid_float_complex *out_buf = &out_buf_data[0];
-            liquid_float_complex *temp_buf = NULL;
+        liquid_float_complex *in_buf = &in_buf_data[0];
+        liquid_float_complex *out_buf = &out_buf_data[0];
+        liquid_float_complex *temp_buf = NULL;
 
-            if (shiftFrequency != 0) {
-                if (shiftFrequency < 0) {
-                    nco_crcf_mix_block_up(freqShifter, in_buf, out_buf, bufSize);
-                } else {
-                    nco_crcf_mix_block_down(freqShifter, in_buf, out_buf, bufSize);
-                }
-                temp_buf = in_buf;
-                in_buf = out_buf;
-                out_buf = temp_buf;
+        if (shiftFrequency != 0) {
+            if (shiftFrequency < 0) {
+                nco_crcf_mix_block_up(freqShifter, in_buf, out_buf, bufSize);
+            } else {
+                nco_crcf_mix_block_down(freqShifter, in_buf, out_buf, bufSize);
             }
+            temp_buf = in_buf;
+            in_buf = out_buf;
+            out_buf = temp_buf;
+        }
 
-            DemodulatorThreadPostIQData *resamp = buffers.getBuffer();
+        DemodulatorThreadPostIQData *resamp = buffers.getBuffer();
 
-            size_t out_size = ceil((double) (bufSize) * iqResampleRatio) + 512;
+        size_t out_size = ceil((double) (bufSize) * iqResampleRatio) + 512;
 
-            if (resampledData.size() != out_size) {
-                if (resampledData.capacity() < out_size) {
-                    resampledData.reserve(out_size);
-                }
-                resampledData.resize(out_size);
+        if (resampledData.size() != out_size) {
+            if (resampledData.capacity() < out_size) {
+                resampledData.reserve(out_size);
             }
+            resampledData.resize(out_size);
+        }
 
-            unsigned int numWritten;
-            msresamp_crcf_execute(iqResampler, in_buf, bufSize, &resampledData[0], &numWritten);
+        unsigned int numWritten;
+        msresamp_crcf_execute(iqResampler, in_buf, bufSize, &resampledData[0], &numWritten);
 
-            resamp->setRefCount(1);
-            resamp->data.assign(resampledData.begin(), resampledData.begin() + numWritten);
+        resamp->setRefCount(1);
+        resamp->data.assign(resampledData.begin(), resampledData.begin() + numWritten);
 
-            resamp->modemType = cModem->getType();
-            resamp->modemName = cModem->getName();
-            resamp->modem = cModem;
-            resamp->modemKit = cModemKit;
-            resamp->sampleRate = currentBandwidth;
+        resamp->modemType = cModem->getType();
+        resamp->modemName = cModem->getName();
+        resamp->modem = cModem;
+        resamp->modemKit = cModemKit;
+        resamp->sampleRate = currentBandwidth;
+        resamp->captureTime = inp->captureTime;
 
-            iqOutputQueue->push(resamp);
+        if (!iqOutputQueue->push(resamp)) {
+            resamp->setRefCount(0);
         }
+    }
 
-        inp->decRefCount();
+    inp->decRefCount();
 
-        if (!terminated && !workerResults->empty()) {
-            while (!workerResults->empty()) {
-                DemodulatorWorkerThreadResult result;
-                workerResults->pop(result);
-
-                switch (result.cmd) {
-                case DemodulatorWorkerThreadResult::DEMOD_WORKER_THREAD_RESULT_FILTERS:
-                    if (result.iqResampler) {
-                        if (iqResampler) {
-                            msresamp_crcf_destroy(iqResampler);
-                        }
-                        iqResampler = result.iqResampler;
-                        iqResampleRatio = result.iqResampleRatio;
+    if (!terminated && !workerResults->empty()) {
+        while (!workerResults->empty()) {
+            DemodulatorWorkerThreadResult result;
+            workerResults->pop(result);
+
+            switch (result.cmd) {
+            case DemodulatorWorkerThreadResult::DEMOD_WORKER_THREAD_RESULT_FILTERS:
+                if (result.iqResampler) {
+                    if (iqResampler) {
+                        msresamp_crcf_destroy(iqResampler);
                     }
+                    iqResampler = result.iqResampler;
+                    iqResampleRatio = result.iqResampleRatio;
+                }
 
-                    if (result.modem != nullptr) {
-                        cModem = result.modem;
+                if (result.modem != nullptr) {
+                    cModem = result.modem;
 #if ENABLE_DIGITAL_LAB
-                        if (cModem->getType() == "digital") {
-                            ModemDigital *mDigi = (ModemDigital *)cModem;
-                            mDigi->setOutput(parent->getOutput());
-                        }
-#endif
+                    if (cModem->getType() == "digital") {
+                        ModemDigital *mDigi = (ModemDigital *)cModem;
+                        mDigi->setOutput(parent->getOutput());
                     }
+#endif
+                }
+                
+                if (result.modemKit != nullptr) {
+                    cModemKit = result.modemKit;
+                    currentAudioSampleRate = cModemKit->audioSampleRate;
+                }
                     
-                    if (result.modemKit != nullptr) {
-                        cModemKit = result.modemKit;
-                        currentAudioSampleRate = cModemKit->audioSampleRate;
-                    }
-                        
-                    if (result.bandwidth) {
-                        currentBandwidth = result.bandwidth;
-                    }
+                if (result.bandwidth) {
+                    currentBandwidth = result.bandwidth;
+                }
 
-                    if (result.sampleRate) {
-                        currentSampleRate = result.sampleRate;
-                    }
-                        
-                    if (result.modemName != "") {
-                        demodType = result.modemName;
-                        demodTypeChanged.store(false);
-                    }
-                        
-                    shiftFrequency = inp->frequency-1;
-                    initialized.store(cModem != nullptr);
-                    break;
-                default:
-                    break;
+                if (result.sampleRate) {
+                    currentSampleRate = result.sampleRate;
+                }
+                    
+                if (result.modemName != "") {
+                    demodType = result.modemName;
+                    demodTypeChanged.store(false);
                 }
+                    
+                shiftFrequency = inp->frequency-1;
+                initialized.store(cModem != nullptr);
+                break;
+            default:
+                break;
             }
         }
-        
-        if ((cModem != nullptr) && modemSettingsChanged.load()) {
-            cModem->writeSettings(modemSettingsBuffered);
-            modemSettingsBuffered.clear();
-            modemSettingsChanged.store(false);
-        }
     }
-
-    buffers.purge();
-
-    DemodulatorThreadCommand tCmd(DemodulatorThreadCommand::DEMOD_THREAD_CMD_DEMOD_PREPROCESS_TERMINATED);
-    tCmd.context = this;
-    threadQueueNotify->push(tCmd);
-    std::cout << "Demodulator preprocessor thread done." << std::endl;
+    
+    if ((cModem != nullptr) && modemSettingsChanged.load()) {
+        cModem->writeSettings(modemSettingsBuffered);
+        modemSettingsBuffered.clear();
+        modemSettingsChanged.store(false);
+    }
 }
 
 void DemodulatorPreThread::setDemodType(std::string demodType) {
@@ -338,8 +340,11 @@ int DemodulatorPreThread::getAudioSampleRate() {
 
 void DemodulatorPreThread::terminate() {
     terminated = true;
-    DemodulatorThreadIQData *inp = new DemodulatorThreadIQData;    // push dummy to nudge queue
-    iqInputQueue->push(inp);
+    // pool workers never pop a nudge, it would only leak
+    if (!parent->isThreadPooled()) {
+        DemodulatorThreadIQData *inp = new DemodulatorThreadIQData;    // push dummy to nudge queue
+        iqInputQueue->push_external(inp);
+    }
     DemodulatorWorkerThreadCommand command(DemodulatorWorkerThreadCommand::DEMOD_WORKER_THREAD_CMD_NULL);
     workerQueue->push(command);
     workerThread->terminate();
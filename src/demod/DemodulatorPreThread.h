@@ -16,6 +16,10 @@ public:
     ~DemodulatorPreThread();
 
     void run();
+
+    void init();
+    void process(DemodulatorThreadIQData *inp);
+    void deinit();
     
     void setDemodType(std::string demodType);
     std::string getDemodType();
@@ -49,6 +53,9 @@ protected:
     msresamp_crcf iqResampler;
     double iqResampleRatio;
     std::vector<liquid_float_complex> resampledData;
+    std::vector<liquid_float_complex> in_buf_data;
+    std::vector<liquid_float_complex> out_buf_data;
+    ReBuffer<DemodulatorThreadPostIQData> buffers;
 
     Modem *cModem;
     ModemKit *cModemKit;
@@ -2,9 +2,11 @@
 
 #include <queue>
 #include <vector>
+#include <mutex>
 
 #include "DemodDefs.h"
 #include "AudioThread.h"
+#include "AudioRecorderThread.h"
 #include "Modem.h"
 
 typedef ThreadQueue<AudioThreadInput *> DemodulatorThreadOutputQueue;
@@ -25,6 +27,10 @@ public:
     
     void run();
     void terminate();
+
+    void init();
+    void process(DemodulatorThreadPostIQData *inp);
+    void deinit();
     
     void setMuted(bool state);
     bool isMuted();
@@ -34,17 +40,23 @@ public:
     float getSquelchLevel();
 
     bool getSquelchBreak();
+
+    // once this returns no push into the previous sink is in flight
+    void setRecordSink(AudioRecordSink *sink);
     
 protected:
     
-    float abMagnitude(double alpha, double beta, float inphase, float quadrature);
-    float linearToDb(float linear);
-
     DemodulatorInstance *demodInstance;
     ReBuffer<AudioThreadInput> outputBuffers;
+    ReBuffer<AudioThreadInput> audioVisBuffers;
+    ModemIQData modemData;
 
     std::atomic_bool muted;
 
+    // held across each push so a detached sink can't be fed after removeSink() drains it
+    std::mutex recordSinkBusy;
+    AudioRecordSink *recordSink;
+
     std::atomic<float> squelchLevel;
     std::atomic<float> signalLevel;
     bool squelchEnabled, squelchBreak;
@@ -0,0 +1,216 @@
+#include "DemodulatorThreadPool.h"
+
+#include <iostream>
+
+#include "IOThread.h"
+#include "PipelineStats.h"
+
+DemodulatorPoolTask::DemodulatorPoolTask() {
+    taskClaimed.store(false);
+    taskRemoved.store(false);
+    taskWorker.store(-1);
+}
+
+DemodulatorPoolTask::~DemodulatorPoolTask() {
+
+}
+
+DemodulatorThreadPool::DemodulatorThreadPool(int numWorkers) {
+    if (numWorkers <= 0) {
+        numWorkers = std::thread::hardware_concurrency();
+    }
+    if (numWorkers <= 0) {
+        numWorkers = 2;
+    }
+
+    for (int i = 0; i < numWorkers; i++) {
+        workers.push_back(new PoolWorker);
+    }
+
+    pendingTasks.store(0);
+    idleWorkers.store(0);
+    nextWorker.store(0);
+    running.store(false);
+}
+
+DemodulatorThreadPool::~DemodulatorThreadPool() {
+    stop();
+    while (workers.size()) {
+        delete workers.back();
+        workers.pop_back();
+    }
+}
+
+void DemodulatorThreadPool::start() {
+    if (running.exchange(true)) {
+        return;
+    }
+
+    for (int i = 0, iMax = workers.size(); i < iMax; i++) {
+        workers[i]->thread = new std::thread(&DemodulatorThreadPool::workerMain, this, i);
+    }
+
+    std::cout << "Demodulator thread pool started with " << workers.size() << " workers." << std::endl;
+}
+
+void DemodulatorThreadPool::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+
+    {
+        std::lock_guard < std::mutex > lock(idleMutex);
+        idleCond.notify_all();
+    }
+
+    for (int i = 0, iMax = workers.size(); i < iMax; i++) {
+        workers[i]->thread->join();
+        delete workers[i]->thread;
+        workers[i]->thread = nullptr;
+    }
+
+    // release anything still queued so remove() can't wait forever
+    for (int i = 0, iMax = workers.size(); i < iMax; i++) {
+        std::lock_guard < std::mutex > lock(workers[i]->queueMutex);
+        while (!workers[i]->tasks.empty()) {
+            workers[i]->tasks.front()->taskClaimed.store(false);
+            workers[i]->tasks.pop_front();
+        }
+    }
+    pendingTasks.store(0);
+
+    std::cout << "Demodulator thread pool stopped." << std::endl;
+}
+
+int DemodulatorThreadPool::getNumWorkers() {
+    return workers.size();
+}
+
+void DemodulatorThreadPool::schedule(DemodulatorPoolTask *task) {
+    if (task->taskRemoved.load() || !running.load()) {
+        return;
+    }
+
+    // already queued or running; the worker re-checks for input when it releases the task
+    if (task->taskClaimed.exchange(true)) {
+        return;
+    }
+
+    // remove() may have flagged the task after the first check but before the claim,
+    // seen it unclaimed and returned; it must not be queued then
+    if (task->taskRemoved.load()) {
+        task->taskClaimed.store(false);
+        return;
+    }
+
+    int workerId = task->taskWorker.load();
+    if (workerId < 0) {
+        workerId = (nextWorker++) % workers.size();
+    }
+
+    {
+        std::lock_guard < std::mutex > lock(workers[workerId]->queueMutex);
+        workers[workerId]->tasks.push_back(task);
+    }
+    pendingTasks++;
+
+    if (idleWorkers.load() > 0) {
+        std::lock_guard < std::mutex > lock(idleMutex);
+        idleCond.notify_one();
+    }
+}
+
+void DemodulatorThreadPool::remove(DemodulatorPoolTask *task) {
+    task->taskRemoved.store(true);
+
+    // drop queued entries rather than waiting for a worker to pop them
+    for (int i = 0, iMax = workers.size(); i < iMax; i++) {
+        std::lock_guard < std::mutex > lock(workers[i]->queueMutex);
+        std::deque<DemodulatorPoolTask *> &tasks = workers[i]->tasks;
+        for (std::deque<DemodulatorPoolTask *>::iterator t = tasks.begin(); t != tasks.end(); ) {
+            if (*t == task) {
+                t = tasks.erase(t);
+                pendingTasks--;
+                task->taskClaimed.store(false);
+            } else {
+                t++;
+            }
+        }
+    }
+
+    // wait for any in-flight run, or a schedule() between its claim and its push, to drain
+    while (true) {
+        {
+            std::lock_guard < std::mutex > lock(task->taskMutex);
+            if (!task->taskClaimed.load()) {
+                break;
+            }
+        }
+        std::this_thread::yield();
+    }
+}
+
+bool DemodulatorThreadPool::popTask(int workerId, DemodulatorPoolTask *&task) {
+    {
+        PoolWorker *self = workers[workerId];
+        std::lock_guard < std::mutex > lock(self->queueMutex);
+        if (!self->tasks.empty()) {
+            task = self->tasks.front();
+            self->tasks.pop_front();
+            pendingTasks--;
+            return true;
+        }
+    }
+
+    for (int i = 1, iMax = workers.size(); i < iMax; i++) {
+        PoolWorker *victim = workers[(workerId + i) % iMax];
+        std::lock_guard < std::mutex > lock(victim->queueMutex);
+        if (!victim->tasks.empty()) {
+            task = victim->tasks.back();
+            victim->tasks.pop_back();
+            pendingTasks--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void DemodulatorThreadPool::runTask(int workerId, DemodulatorPoolTask *task) {
+    std::lock_guard < std::mutex > lock(task->taskMutex);
+
+    if (!task->taskRemoved.load()) {
+        task->taskWorker.store(workerId);
+        task->runPoolTask();
+    }
+
+    task->taskClaimed.exchange(false);
+
+    if (!task->taskRemoved.load() && task->hasPoolInput()) {
+        schedule(task);
+    }
+}
+
+void DemodulatorThreadPool::workerMain(int workerId) {
+    // pool workers run both the pre and demod stages, so they take the "demod" policy;
+    // the "demod-pre" policy only applies to dedicated DemodulatorPreThreads (pool off)
+    IOThread::applyThreadPolicy("demod");
+
+    while (running.load()) {
+        DemodulatorPoolTask *task;
+
+        if (popTask(workerId, task)) {
+            runTask(workerId, task);
+            continue;
+        }
+
+        std::unique_lock < std::mutex > lock(idleMutex);
+        idleWorkers++;
+        while (running.load() && pendingTasks.load() <= 0) {
+            idleCond.wait(lock);
+        }
+        idleWorkers--;
+    }
+
+    PipelineStats::threadEnd();
+}
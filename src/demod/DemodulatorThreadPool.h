@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+class DemodulatorThreadPool;
+
+// Unit of work scheduled on the pool; a task is queued at most once at a time
+// and never runs on two workers concurrently.
+class DemodulatorPoolTask {
+public:
+    DemodulatorPoolTask();
+    virtual ~DemodulatorPoolTask();
+
+    virtual void runPoolTask() = 0;
+    virtual bool hasPoolInput() = 0;
+
+private:
+    friend class DemodulatorThreadPool;
+
+    std::mutex taskMutex;
+    std::atomic_bool taskClaimed;
+    std::atomic_bool taskRemoved;
+    std::atomic_int taskWorker;
+};
+
+/**
+ * Fixed set of worker threads shared by all demodulators; each worker owns a
+ * deque of ready tasks and steals from the back of the others when its own runs dry.
+ * A task stays on the worker that last ran it unless it gets stolen.
+ */
+class DemodulatorThreadPool {
+public:
+    DemodulatorThreadPool(int numWorkers = 0);
+    ~DemodulatorThreadPool();
+
+    void start();
+    void stop();
+
+    void schedule(DemodulatorPoolTask *task);
+    void remove(DemodulatorPoolTask *task);
+
+    int getNumWorkers();
+
+private:
+    class PoolWorker {
+    public:
+        PoolWorker() : thread(nullptr) { };
+
+        std::mutex queueMutex;
+        std::deque<DemodulatorPoolTask *> tasks;
+        std::thread *thread;
+    };
+
+    void workerMain(int workerId);
+    bool popTask(int workerId, DemodulatorPoolTask *&task);
+    void runTask(int workerId, DemodulatorPoolTask *task);
+
+    std::vector<PoolWorker *> workers;
+
+    std::mutex idleMutex;
+    std::condition_variable idleCond;
+    std::atomic_int pendingTasks;
+    std::atomic_int idleWorkers;
+    std::atomic_int nextWorker;
+    std::atomic_bool running;
+};
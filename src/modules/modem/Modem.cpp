@@ -1,6 +1,4 @@
 #include "Modem.h"
-#include "CubicSDR.h"
-
 
 ModemFactoryList Modem::modemFactories;
 
@@ -1,4 +1,5 @@
 #include "ModemAnalog.h"
+#include "SignalLevel.h"
 
 ModemAnalog::ModemAnalog() : aOutputCeil(1), aOutputCeilMA(1), aOutputCeilMAA(1) {
     
@@ -67,19 +68,11 @@ void ModemAnalog::buildAudioOutput(ModemKitAnalog *akit, AudioThreadInput *audio
     if (autoGain) {
         aOutputCeilMA = aOutputCeilMA + (aOutputCeil - aOutputCeilMA) * 0.025;
         aOutputCeilMAA = aOutputCeilMAA + (aOutputCeilMA - aOutputCeilMAA) * 0.025;
-        aOutputCeil = 0;
-        
-        for (size_t i = 0; i < bufSize; i++) {
-            if (demodOutputData[i] > aOutputCeil) {
-                aOutputCeil = demodOutputData[i];
-            }
-        }
+        aOutputCeil = signalMax(demodOutputData.data(), bufSize, 0);
         
         float gain = 0.5 / aOutputCeilMAA;
         
-        for (size_t i = 0; i < bufSize; i++) {
-            demodOutputData[i] *= gain;
-        }
+        signalScale(demodOutputData.data(), bufSize, gain);
     }
     
     msresamp_rrrf_execute(akit->audioResampler, &demodOutputData[0], demodOutputData.size(), &resampledOutputData[0], &numAudioWritten);
@@ -1,6 +1,21 @@
 #include "ModemFMStereo.h"
+#include "DSPKernels.h"
 
-ModemFMStereo::ModemFMStereo() {
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI        3.14159265358979323846
+#endif
+#include <algorithm>
+
+// Hilbert transform semi-length, as for the liquid firhilbf objects (filter length 4m+1)
+#define FMSTEREO_HILBERT_M 5
+// pilot PLL update interval in samples; phase and frequency are held within a sub-block
+#define FMSTEREO_PLL_BLOCK 32
+// pilot PLL loop natural frequency [Hz]
+#define FMSTEREO_PLL_BANDWIDTH 100.0
+
+ModemFMStereo::ModemFMStereo() : blockDecoder(true) {
     demodFM = freqdem_create(0.5);
 }
 
@@ -87,6 +102,28 @@ ModemKit *ModemFMStereo::buildKit(long long sampleRate, int audioSampleRate) {
     nco_crcf_reset(kit->stereoPilot);
     nco_crcf_pll_set_bandwidth(kit->stereoPilot, 0.25f);
     
+    delete[] h;
+    
+    // analytic filter for the block decoder: half-band prototype shifted by fs/4, the
+    // imaginary (odd) taps give the quadrature branch, the real branch is a pure delay
+    unsigned int hilbertLen = 4 * FMSTEREO_HILBERT_M + 1;
+    std::vector<float> hb(hilbertLen);
+    liquid_firdes_kaiser(hilbertLen, 0.25f, 60.0f, 0.0f, &hb[0]);
+    kit->hilbertTaps.resize(hilbertLen);
+    for (unsigned int i = 0; i < hilbertLen; i++) {
+        float t = (float)i - (float)(hilbertLen - 1) / 2.0f;
+        float q = hb[i] * sinf(0.5f * M_PI * t);
+        kit->hilbertTaps[i] = (fabsf(q) < 1e-9f)?0:q;
+    }
+    kit->hilbertInput.assign(hilbertLen - 1, 0);
+    
+    // second order loop, gains per PLL_BLOCK update
+    double wnT = 2.0 * M_PI * FMSTEREO_PLL_BANDWIDTH * FMSTEREO_PLL_BLOCK / double(sampleRate);
+    kit->pllBeta = 2.0 * 0.707 * wnT;
+    kit->pllAlpha = wnT * wnT / FMSTEREO_PLL_BLOCK;
+    kit->pilotFreq = 2.0 * M_PI * 19000.0 / double(sampleRate);
+    kit->pilotPhase = 0;
+    
     return kit;
 }
 
@@ -99,14 +136,23 @@ void ModemFMStereo::disposeKit(ModemKit *kit) {
     firfilt_rrrf_destroy(fmkit->firStereoRight);
     firhilbf_destroy(fmkit->firStereoR2C);
     firhilbf_destroy(fmkit->firStereoC2R);
+    iirfilt_crcf_destroy(fmkit->iirStereoPilot);
     nco_crcf_destroy(fmkit->stereoPilot);
+    delete fmkit;
+}
+
+void ModemFMStereo::setBlockDecoder(bool blockDecoder) {
+    this->blockDecoder = blockDecoder;
+}
+
+bool ModemFMStereo::isBlockDecoder() {
+    return blockDecoder;
 }
 
 
 void ModemFMStereo::demodulate(ModemKit *kit, ModemIQData *input, AudioThreadInput *audioOut) {
     ModemKitFMStereo *fmkit = (ModemKitFMStereo *)kit;
     size_t bufSize = input->data.size();
-    liquid_float_complex u, v, w, x, y;
     
     double audio_resample_ratio = fmkit->audioResampleRatio;
     
@@ -139,6 +185,50 @@ void ModemFMStereo::demodulate(ModemKit *kit, ModemIQData *input, AudioThreadInp
         demodStereoData.resize(bufSize);
     }
     
+    if (blockDecoder) {
+        demodulateStereoBlock(fmkit, bufSize);
+    } else {
+        demodulateStereo(fmkit, bufSize);
+    }
+    
+    if (audio_out_size != resampledStereoData.size()) {
+        if (resampledStereoData.capacity() < audio_out_size) {
+            resampledStereoData.reserve(audio_out_size);
+        }
+        resampledStereoData.resize(audio_out_size);
+    }
+    
+    msresamp_rrrf_execute(fmkit->stereoResampler, &demodStereoData[0], bufSize, &resampledStereoData[0], &numAudioWritten);
+    
+    audioOut->channels = 2;
+    if (audioOut->data.capacity() < (numAudioWritten * 2)) {
+        audioOut->data.reserve(numAudioWritten * 2);
+    }
+    audioOut->data.resize(numAudioWritten * 2);
+    
+    if (mixLeft.size() < numAudioWritten) {
+        mixLeft.resize(numAudioWritten);
+        mixRight.resize(numAudioWritten);
+    }
+    for (size_t i = 0; i < numAudioWritten; i++) {
+        mixLeft[i] = 0.568 * (resampledOutputData[i] - (resampledStereoData[i]));
+        mixRight[i] = 0.568 * (resampledOutputData[i] + (resampledStereoData[i]));
+    }
+    
+    if (numAudioWritten) {
+        firfilt_rrrf_execute_block(fmkit->firStereoLeft, &mixLeft[0], numAudioWritten, &mixLeft[0]);
+        firfilt_rrrf_execute_block(fmkit->firStereoRight, &mixRight[0], numAudioWritten, &mixRight[0]);
+    }
+    
+    for (size_t i = 0; i < numAudioWritten; i++) {
+        audioOut->data[i * 2] = mixLeft[i];
+        audioOut->data[i * 2 + 1] = mixRight[i];
+    }
+}
+
+void ModemFMStereo::demodulateStereo(ModemKitFMStereo *fmkit, size_t bufSize) {
+    liquid_float_complex u, v, w, x, y;
+    
     float phase_error = 0;
     
     for (size_t i = 0; i < bufSize; i++) {
@@ -169,34 +259,75 @@ void ModemFMStereo::demodulate(ModemKit *kit, ModemIQData *input, AudioThreadInp
         // complex -> real
         firhilbf_c2r_execute(fmkit->firStereoC2R, x, &demodStereoData[i]);
     }
+}
+
+void ModemFMStereo::demodulateStereoBlock(ModemKitFMStereo *fmkit, size_t bufSize) {
+    size_t numTaps = fmkit->hilbertTaps.size();
+    size_t history = numTaps - 1;
+    size_t delay = history / 2;
     
-    //            std::cout << "[PLL] phase error: " << phase_error;
-    //            std::cout << " freq:" << (((nco_crcf_get_frequency(stereoPilot) / (2.0 * M_PI)) * inp->sampleRate)) << std::endl;
+    if (hilbertOutput.size() < bufSize) {
+        hilbertOutput.resize(bufSize);
+        analyticData.resize(bufSize);
+        pilotData.resize(bufSize);
+    }
     
-    if (audio_out_size != resampledStereoData.size()) {
-        if (resampledStereoData.capacity() < audio_out_size) {
-            resampledStereoData.reserve(audio_out_size);
-        }
-        resampledStereoData.resize(audio_out_size);
+    // real -> complex: delayed input + j * Hilbert FIR, over the whole block
+    std::vector<float> &hin = fmkit->hilbertInput;
+    hin.resize(history);
+    hin.insert(hin.end(), demodOutputData.begin(), demodOutputData.begin() + bufSize);
+    dspFirExecute(&fmkit->hilbertTaps[0], numTaps, &hin[0], &hilbertOutput[0], bufSize);
+    for (size_t i = 0; i < bufSize; i++) {
+        analyticData[i].real = hin[history - delay + i];
+        analyticData[i].imag = hilbertOutput[i];
     }
+    hin.erase(hin.begin(), hin.begin() + bufSize);
     
-    msresamp_rrrf_execute(fmkit->stereoResampler, &demodStereoData[0], bufSize, &resampledStereoData[0], &numAudioWritten);
+    // 19khz pilot band-pass
+    iirfilt_crcf_execute_block(fmkit->iirStereoPilot, &analyticData[0], bufSize, &pilotData[0]);
     
-    audioOut->channels = 2;
-    if (audioOut->data.capacity() < (numAudioWritten * 2)) {
-        audioOut->data.reserve(numAudioWritten * 2);
-    }
-    audioOut->data.resize(numAudioWritten * 2);
-    for (size_t i = 0; i < numAudioWritten; i++) {
-        float l, r;
+    // pilot PLL with one phase detector update per sub-block; the 38khz carrier is the
+    // squared pilot phasor, rotated per sample without any trig calls
+    float phase = fmkit->pilotPhase;
+    float freq = fmkit->pilotFreq;
+    
+    for (size_t start = 0; start < bufSize; start += FMSTEREO_PLL_BLOCK) {
+        size_t len = std::min((size_t)FMSTEREO_PLL_BLOCK, bufSize - start);
+        
+        float refRe = cosf(phase), refIm = -sinf(phase);
+        float stepRe = cosf(freq), stepIm = -sinf(freq);
+        float accRe = 0, accIm = 0;
         
-        firfilt_rrrf_push(fmkit->firStereoLeft, 0.568 * (resampledOutputData[i] - (resampledStereoData[i])));
-        firfilt_rrrf_execute(fmkit->firStereoLeft, &l);
+        for (size_t i = start; i < start + len; i++) {
+            const liquid_float_complex &p = pilotData[i];
+            // u = v * conjf(w)
+            accRe += p.real * refRe - p.imag * refIm;
+            accIm += p.real * refIm + p.imag * refRe;
+            
+            // advance first, the legacy decoder mixes after stepping the NCO
+            float re = refRe * stepRe - refIm * stepIm;
+            refIm = refRe * stepIm + refIm * stepRe;
+            refRe = re;
+            
+            // 38khz down-mix, complex -> real
+            float c2Re = refRe * refRe - refIm * refIm;
+            float c2Im = 2.0f * refRe * refIm;
+            const liquid_float_complex &x = analyticData[i];
+            demodStereoData[i] = x.real * c2Re - x.imag * c2Im;
+        }
+        
+        float phaseError = dspFastAtan2(accIm, accRe);
         
-        firfilt_rrrf_push(fmkit->firStereoRight, 0.568 * (resampledOutputData[i] + (resampledStereoData[i])));
-        firfilt_rrrf_execute(fmkit->firStereoRight, &r);
+        phase += freq * len + fmkit->pllBeta * phaseError;
+        freq += fmkit->pllAlpha * phaseError;
         
-        audioOut->data[i * 2] = l;
-        audioOut->data[i * 2 + 1] = r;
+        if (phase > M_PI) {
+            phase = fmodf(phase + M_PI, 2.0f * M_PI) - M_PI;
+        } else if (phase < -M_PI) {
+            phase = M_PI - fmodf(M_PI - phase, 2.0f * M_PI);
+        }
     }
+    
+    fmkit->pilotPhase = phase;
+    fmkit->pilotFreq = freq;
 }
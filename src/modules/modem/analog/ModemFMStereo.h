@@ -3,7 +3,7 @@
 
 class ModemKitFMStereo: public ModemKit {
 public:
-    ModemKitFMStereo() : audioResampler(nullptr), stereoResampler(nullptr), audioResampleRatio(0), firStereoLeft(nullptr), firStereoRight(nullptr), iirStereoPilot(nullptr) {
+    ModemKitFMStereo() : audioResampler(nullptr), stereoResampler(nullptr), audioResampleRatio(0), firStereoLeft(nullptr), firStereoRight(nullptr), iirStereoPilot(nullptr), pilotPhase(0), pilotFreq(0), pllAlpha(0), pllBeta(0) {
     }
     
     msresamp_rrrf audioResampler;
@@ -18,6 +18,12 @@ public:
     firhilbf firStereoC2R;
     
     nco_crcf stereoPilot;
+    
+    // block decoder: analytic filter taps and input history, pilot PLL state
+    std::vector<float> hilbertTaps;
+    std::vector<float> hilbertInput;
+    float pilotPhase, pilotFreq;
+    float pllAlpha, pllBeta;
 };
 
 
@@ -39,10 +45,22 @@ public:
     
     void demodulate(ModemKit *kit, ModemIQData *input, AudioThreadInput *audioOut);
     
+    // per-sample liquid PLL decoder instead of the block decoder, kept for comparison
+    void setBlockDecoder(bool blockDecoder);
+    bool isBlockDecoder();
+    
 private:
+    void demodulateStereo(ModemKitFMStereo *fmkit, size_t bufSize);
+    void demodulateStereoBlock(ModemKitFMStereo *fmkit, size_t bufSize);
+    
+    bool blockDecoder;
     std::vector<float> demodOutputData;
     std::vector<float> demodStereoData;
     std::vector<float> resampledOutputData;
     std::vector<float> resampledStereoData;
+    std::vector<float> hilbertOutput;
+    std::vector<liquid_float_complex> analyticData;
+    std::vector<liquid_float_complex> pilotData;
+    std::vector<float> mixLeft, mixRight;
     freqdem demodFM;
 };
\ No newline at end of file
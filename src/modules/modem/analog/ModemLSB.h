@@ -22,7 +22,9 @@ private:
 	iirfilt_crcf ssbFilt;
 #endif
     firhilbf c2rFilt;
-    nco_crcf ssbShift;
+    // fs/4 shift applied as a quarter-rate rotation, see dspShiftQuarterRate()
+    int ssbPhase;
+    std::vector<liquid_float_complex> ssbBuffer;
     //    firfilt_crcf ssbFilt;
     //    ampmodem demodAM_LSB;
 };
\ No newline at end of file
@@ -1,4 +1,7 @@
 #include "ModemUSB.h"
+#include "DSPKernels.h"
+
+#include <algorithm>
 
 ModemUSB::ModemUSB() : ModemAnalog() {
     // half band filter used for side-band elimination
@@ -8,8 +11,8 @@ ModemUSB::ModemUSB() : ModemAnalog() {
 #else
 	ssbFilt = iirfilt_crcf_create_lowpass(6, 0.25);
 #endif
-	ssbShift = nco_crcf_create(LIQUID_NCO);
-    nco_crcf_set_frequency(ssbShift,  (2.0 * M_PI) * 0.25);
+    // the first sample is rotated by a quarter turn, as the NCO stepped before mixing
+    ssbPhase = 1;
     c2rFilt = firhilbf_create(5, 90.0);
 }
 
@@ -27,7 +30,6 @@ ModemUSB::~ModemUSB() {
 #else
 	iirfilt_crcf_destroy(ssbFilt);
 #endif
-	nco_crcf_destroy(ssbShift);
     firhilbf_destroy(c2rFilt);
     //    ampmodem_destroy(demodAM_USB);
 }
@@ -56,20 +58,28 @@ void ModemUSB::demodulate(ModemKit *kit, ModemIQData *input, AudioThreadInput *a
         return;
     }
     
-    liquid_float_complex x, y;
-    for (size_t i = 0; i < bufSize; i++) { // Reject lower band
-        nco_crcf_step(ssbShift);
-        nco_crcf_mix_down(ssbShift, input->data[i], &x);
+    if (ssbBuffer.size() < bufSize) {
+        ssbBuffer.resize(bufSize);
+    }
+    liquid_float_complex *buf = &ssbBuffer[0];
+
+    // Reject lower band: shift by fs/4, half band filter, shift back
+    std::copy(input->data.begin(), input->data.begin() + bufSize, ssbBuffer.begin());
+    int phase = ssbPhase;
+    dspShiftQuarterRate(buf, bufSize, phase, false);
 #ifdef WIN32
-		firfilt_crcf_push(ssbFilt, x);
-		firfilt_crcf_execute(ssbFilt, &y);
+    firfilt_crcf_execute_block(ssbFilt, buf, (unsigned int)bufSize, buf);
 #else
-		iirfilt_crcf_execute(ssbFilt, x, &y);
+    iirfilt_crcf_execute_block(ssbFilt, buf, (unsigned int)bufSize, buf);
 #endif
-		nco_crcf_mix_up(ssbShift, y, &x);
+    phase = ssbPhase;
+    dspShiftQuarterRate(buf, bufSize, phase, true);
+    ssbPhase = phase;
+
+    for (size_t i = 0; i < bufSize; i++) {
         // Liquid-DSP AMPModem SSB drifts with strong signals near baseband (like a carrier?)
         // ampmodem_demodulate(demodAM_USB, y, &demodOutputData[i]);
-        firhilbf_c2r_execute(c2rFilt, x, &demodOutputData[i]);
+        firhilbf_c2r_execute(c2rFilt, buf[i], &demodOutputData[i]);
     }
     
     buildAudioOutput(akit, audioOut, true);
@@ -22,6 +22,8 @@ private:
 	iirfilt_crcf ssbFilt;
 #endif
 	firhilbf c2rFilt;
-    nco_crcf ssbShift;
+    // fs/4 shift applied as a quarter-rate rotation, see dspShiftQuarterRate()
+    int ssbPhase;
+    std::vector<liquid_float_complex> ssbBuffer;
 //    ampmodem demodAM_USB;
 };
\ No newline at end of file
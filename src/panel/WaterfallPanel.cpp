@@ -1,10 +1,27 @@
 #include "WaterfallPanel.h"
+#include "DSPKernels.h"
+#include "PipelineStats.h"
+#include <iostream>
 
-WaterfallPanel::WaterfallPanel() : GLPanel(), fft_size(0), waterfall_lines(0), waterfall_slice(NULL), activeTheme(NULL) {
+// intensity is stored as index/255, sample the centre of the matching gradient texel
+static const char *waterfallFragmentShader =
+    "#version 110\n"
+    "uniform sampler2D intensity;\n"
+    "uniform sampler2D gradient;\n"
+    "void main() {\n"
+    "    float v = texture2D(intensity, gl_TexCoord[0].st).r;\n"
+    "    gl_FragColor = texture2D(gradient, vec2(v * (255.0 / 256.0) + (0.5 / 256.0), 0.5));\n"
+    "}\n";
+
+WaterfallPanel::WaterfallPanel() : GLPanel(), fft_size(0), waterfall_lines(0), ring_lines(0), ring_ofs(0),
+    program(0), gradient(0), pbo_index(0), tex_internal_format(GL_RGB), tex_format(GL_COLOR_INDEX), shaderChecked(false), activeTheme(NULL) {
 	setFillColor(RGBA4f(0,0,0));
     for (int i = 0; i < 2; i++) {
         waterfall[i] = 0;
     }
+    for (int i = 0; i < WATERFALL_PBO_COUNT; i++) {
+        pbo[i] = 0;
+    }
 }
 
 void WaterfallPanel::setup(unsigned int fft_size_in, int num_waterfall_lines_in) {
@@ -20,7 +37,88 @@ void WaterfallPanel::setup(unsigned int fft_size_in, int num_waterfall_lines_in)
     bufferInitialized.store(false);
 }
 
+void WaterfallPanel::initShader() {
+    shaderChecked = true;
+
+    if (GLExt_pixelBuffers) {
+        GLExt_GenBuffers(WATERFALL_PBO_COUNT, pbo);
+    }
+
+    if (!GLExt_shaders) {
+        return;
+    }
+
+    GLint status = 0;
+    GLuint shader = GLExt_CreateShader(GL_FRAGMENT_SHADER);
+    GLExt_ShaderSource(shader, 1, &waterfallFragmentShader, NULL);
+    GLExt_CompileShader(shader);
+    GLExt_GetShaderiv(shader, GL_COMPILE_STATUS, &status);
+
+    if (!status) {
+        char log[1024];
+        GLExt_GetShaderInfoLog(shader, sizeof(log), NULL, log);
+        std::cout << "Waterfall shader failed to compile, using fixed function path: " << log << std::endl;
+        GLExt_DeleteShader(shader);
+        return;
+    }
+
+    program = GLExt_CreateProgram();
+    GLExt_AttachShader(program, shader);
+    GLExt_LinkProgram(program);
+    GLExt_DeleteShader(shader);
+    GLExt_GetProgramiv(program, GL_LINK_STATUS, &status);
+
+    if (!status) {
+        char log[1024];
+        GLExt_GetProgramInfoLog(program, sizeof(log), NULL, log);
+        std::cout << "Waterfall shader failed to link, using fixed function path: " << log << std::endl;
+        GLExt_DeleteProgram(program);
+        program = 0;
+        return;
+    }
+
+    GLExt_UseProgram(program);
+    GLExt_Uniform1i(GLExt_GetUniformLocation(program, "intensity"), 0);
+    GLExt_Uniform1i(GLExt_GetUniformLocation(program, "gradient"), 1);
+    GLExt_UseProgram(0);
+
+    glGenTextures(1, &gradient);
+    glBindTexture(GL_TEXTURE_2D, gradient);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (GLExt_textureRG) {
+        tex_internal_format = GL_R8;
+        tex_format = GL_RED;
+    } else {
+        tex_internal_format = GL_LUMINANCE8;
+        tex_format = GL_LUMINANCE;
+    }
+}
+
 void WaterfallPanel::refreshTheme() {
+    if (program) {
+        // theme changes only replace the 256 texel gradient, the waterfall itself is untouched
+        std::vector<float> &r = ThemeMgr::mgr.currentTheme->waterfallGradient.getRed();
+        std::vector<float> &g = ThemeMgr::mgr.currentTheme->waterfallGradient.getGreen();
+        std::vector<float> &b = ThemeMgr::mgr.currentTheme->waterfallGradient.getBlue();
+
+        float rgb[256 * 3];
+        for (int i = 0; i < 256; i++) {
+            rgb[i * 3] = r[i];
+            rgb[i * 3 + 1] = g[i];
+            rgb[i * 3 + 2] = b[i];
+        }
+
+        glBindTexture(GL_TEXTURE_2D, gradient);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 256, 1, 0, GL_RGB, GL_FLOAT, (GLvoid *) rgb);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return;
+    }
+
     glEnable (GL_TEXTURE_2D);
     
     for (int i = 0; i < 2; i++) {
@@ -44,12 +142,20 @@ void WaterfallPanel::setPoints(std::vector<float> &points) {
     }
 }
 
+std::vector<float> &WaterfallPanel::getPoints() {
+    return points;
+}
+
 void WaterfallPanel::step() {
     unsigned int half_fft_size = fft_size / 2;
 
     if (!bufferInitialized.load()) {
-        delete waterfall_slice;
-        waterfall_slice = new unsigned char[half_fft_size];
+        ring_lines = (waterfall_lines < WATERFALL_RING_LINES)?waterfall_lines:WATERFALL_RING_LINES;
+        ring_ofs = 0;
+        for (int j = 0; j < 2; j++) {
+            lineRing[j].assign(half_fft_size * ring_lines, 0);
+        }
+        lines_buffered.store(0);
         bufferInitialized.store(true);
     }
     
@@ -58,26 +164,44 @@ void WaterfallPanel::step() {
     }
     
     if (points.size() && points.size() == fft_size) {
+        // the ring fills downwards like the texture, so the pending lines are already newest first
+        ring_ofs = (ring_ofs + ring_lines - 1) % ring_lines;
         for (int j = 0; j < 2; j++) {
-            for (int i = 0, iMax = half_fft_size; i < iMax; i++) {
-                float v = points[j * half_fft_size + i];
-                
-                float wv = v < 0 ? 0 : (v > 0.99 ? 0.99 : v);
-                
-                waterfall_slice[i] = (unsigned char) floor(wv * 255.0);
-            }
-            
-            unsigned int newBufSize = (half_fft_size*lines_buffered.load()+half_fft_size);
-            if (lineBuffer[j].size() < newBufSize) {
-                lineBuffer[j].resize(newBufSize);
-                rLineBuffer[j].resize(newBufSize);
-            }
-            memcpy(&(lineBuffer[j][half_fft_size*lines_buffered.load()]), waterfall_slice, sizeof(unsigned char) * half_fft_size);
+            dspQuantizeU8(&points[j * half_fft_size], &lineRing[j][ring_ofs * half_fft_size], half_fft_size);
+        }
+        if (lines_buffered.load() < ring_lines) {
+            lines_buffered++;
+        } else {
+            // renderer is a full ring behind, the line just written replaced the oldest one
+            PipelineStats::recordWaterfallDrop();
         }
-        lines_buffered++;
     }
 }
 
+bool WaterfallPanel::setRows(const unsigned char *rows, int count) {
+    int half_fft_size = fft_size / 2;
+
+    if (!texInitialized.load()) {
+        return false;
+    }
+    if (count > waterfall_lines) {
+        count = waterfall_lines;
+    }
+
+    // each half is a column slice of the full width rows
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, fft_size);
+    for (int j = 0; j < 2; j++) {
+        glBindTexture(GL_TEXTURE_2D, waterfall[j]);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, half_fft_size, count, tex_format, GL_UNSIGNED_BYTE, (GLvoid *) (rows + j * half_fft_size));
+        waterfall_ofs[j] = waterfall_lines;
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    lines_buffered.store(0);
+    return true;
+}
+
 void WaterfallPanel::update() {
     int half_fft_size = fft_size / 2;
     
@@ -86,13 +210,17 @@ void WaterfallPanel::update() {
     }
     
     if (!texInitialized.load()) {
+        if (!shaderChecked) {
+            initShader();
+        }
+
         for (int i = 0; i < 2; i++) {
             if (waterfall[i]) {
                 glDeleteTextures(1, &waterfall[i]);
                 waterfall[i] = 0;
             }
             
-            waterfall_ofs[i] = waterfall_lines - 1;
+            waterfall_ofs[i] = waterfall_lines;
         }
 
         glGenTextures(2, waterfall);
@@ -111,7 +239,7 @@ void WaterfallPanel::update() {
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
             
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, half_fft_size, waterfall_lines, 0, GL_COLOR_INDEX, GL_UNSIGNED_BYTE, (GLvoid *) waterfall_tex);
+            glTexImage2D(GL_TEXTURE_2D, 0, tex_internal_format, half_fft_size, waterfall_lines, 0, tex_format, GL_UNSIGNED_BYTE, (GLvoid *) waterfall_tex);
         }
         
         delete[] waterfall_tex;
@@ -121,33 +249,64 @@ void WaterfallPanel::update() {
         texInitialized.store(true);
     }
     
-    for (int i = 0, iMax = lines_buffered.load(); i < iMax; i++) {
-        for (int j = 0; j < 2; j++) {
-            memcpy(&(rLineBuffer[j][i*half_fft_size]),
-                   &(lineBuffer[j][((iMax-1)*half_fft_size)-(i*half_fft_size)]), sizeof(unsigned char) * half_fft_size);
-        }
+    int pending = lines_buffered.load();
+    if (!pending) {
+        return;
     }
-    
-    int run_ofs = 0;
-    while (lines_buffered.load()) {
-        int run_lines = lines_buffered.load();
-        if (run_lines > waterfall_ofs[0]) {
-            run_lines = waterfall_ofs[0];
+
+    // newest pending line goes to the row above the current top, older ones follow below it
+    int tex_row = (waterfall_ofs[0] - pending + waterfall_lines) % waterfall_lines;
+
+    for (int k = 0; k < pending;) {
+        int ring_row = (ring_ofs + k) % ring_lines;
+        int row = (tex_row + k) % waterfall_lines;
+
+        // contiguous in both the ring and the texture
+        int run_lines = pending - k;
+        if (run_lines > ring_lines - ring_row) {
+            run_lines = ring_lines - ring_row;
+        }
+        if (run_lines > waterfall_lines - row) {
+            run_lines = waterfall_lines - row;
         }
+
         for (int j = 0; j < 2; j++) {
-            glBindTexture(GL_TEXTURE_2D, waterfall[j]);
-            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, waterfall_ofs[j]-run_lines, half_fft_size, run_lines,
-                            GL_COLOR_INDEX, GL_UNSIGNED_BYTE, (GLvoid *) &(rLineBuffer[j][run_ofs]));
-            
-            waterfall_ofs[j]-=run_lines;
-            
-            if (waterfall_ofs[j] == 0) {
-                waterfall_ofs[j] = waterfall_lines;
-            }
+            uploadLines(j, row, run_lines, ring_row);
+        }
+        k += run_lines;
+    }
+
+    for (int j = 0; j < 2; j++) {
+        waterfall_ofs[j] = tex_row ? tex_row : waterfall_lines;
+    }
+    lines_buffered -= pending;
+}
+
+void WaterfallPanel::uploadLines(int j, int row, int run_lines, int ring_row) {
+    int half_fft_size = fft_size / 2;
+    unsigned char *src = &(lineRing[j][ring_row * half_fft_size]);
+
+    glBindTexture(GL_TEXTURE_2D, waterfall[j]);
+
+    if (!pbo[0]) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, row, half_fft_size, run_lines, tex_format, GL_UNSIGNED_BYTE, (GLvoid *) src);
+        return;
+    }
+
+    GLExt_BindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo[pbo_index]);
+    // orphan the old storage so mapping never waits on a transfer still in flight
+    GLExt_BufferData(GL_PIXEL_UNPACK_BUFFER, half_fft_size * run_lines, NULL, GL_STREAM_DRAW);
+
+    unsigned char *dst = (unsigned char *) GLExt_MapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+    if (dst) {
+        memcpy(dst, src, sizeof(unsigned char) * half_fft_size * run_lines);
+        if (GLExt_UnmapBuffer(GL_PIXEL_UNPACK_BUFFER)) {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, row, half_fft_size, run_lines, tex_format, GL_UNSIGNED_BYTE, (GLvoid *) 0);
         }
-        run_ofs += run_lines*half_fft_size;
-        lines_buffered.store(lines_buffered.load()-run_lines);
     }
+
+    GLExt_BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    pbo_index = (pbo_index + 1) % WATERFALL_PBO_COUNT;
 }
 
 void WaterfallPanel::drawPanelContents() {
@@ -167,6 +326,13 @@ void WaterfallPanel::drawPanelContents() {
         activeTheme = ThemeMgr::mgr.currentTheme;
     }
     glColor3f(1.0, 1.0, 1.0);
+
+    if (program) {
+        GLExt_UseProgram(program);
+        GLExt_ActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, gradient);
+        GLExt_ActiveTexture(GL_TEXTURE0);
+    }
     
     GLint vp[4];
     glGetIntegerv(GL_VIEWPORT, vp);
@@ -205,6 +371,13 @@ void WaterfallPanel::drawPanelContents() {
     glEnd();
     
     glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (program) {
+        GLExt_ActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        GLExt_ActiveTexture(GL_TEXTURE0);
+        GLExt_UseProgram(0);
+    }
     
     glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
     glDisable(GL_TEXTURE_2D);
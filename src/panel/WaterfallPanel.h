@@ -3,30 +3,55 @@
 #include "GLPanel.h"
 #include <atomic>
 
+// line uploads rotate through this many pixel buffers so the driver can copy one
+// while the next is being filled
+#define WATERFALL_PBO_COUNT 3
+// lines held between step() and update(); if rendering falls further behind the oldest are dropped
+#define WATERFALL_RING_LINES 256
+
 class WaterfallPanel : public GLPanel {
 public:
     WaterfallPanel();
     void setup(unsigned int fft_size_in, int num_waterfall_lines_in);
     void refreshTheme();
     void setPoints(std::vector<float> &points);
+    std::vector<float> &getPoints();
     void step();
     void update();
+
+    // replace the waterfall with count quantized rows (newest first, fft_size wide) and
+    // discard pending lines; false until the textures exist
+    bool setRows(const unsigned char *rows, int count);
     
 protected:
     void drawPanelContents();
     
 private:
+    void initShader();
+    void uploadLines(int j, int row, int run_lines, int ring_row);
+
+
     std::vector<float> points;
 
     GLuint waterfall[2];
     int waterfall_ofs[2];
     unsigned int fft_size;
     int waterfall_lines;
-    unsigned char *waterfall_slice;
-    std::vector<unsigned char> lineBuffer[2];
-    std::vector<unsigned char> rLineBuffer[2];
+    // staging ring of quantized lines, written downwards from ring_ofs (the newest line)
+    std::vector<unsigned char> lineRing[2];
+    int ring_lines, ring_ofs;
     std::atomic_int lines_buffered;
     std::atomic_bool texInitialized, bufferInitialized;
+
+    // intensity textures coloured by a gradient texture in a fragment shader when
+    // available, otherwise colour index textures mapped through glPixelMap
+    GLuint program;
+    GLuint gradient;
+    GLuint pbo[WATERFALL_PBO_COUNT];
+    int pbo_index;
+    GLint tex_internal_format;
+    GLenum tex_format;
+    bool shaderChecked;
     
     ColorTheme *activeTheme;
 };
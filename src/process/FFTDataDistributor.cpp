@@ -1,6 +1,7 @@
 #include "FFTDataDistributor.h"
+#include <algorithm>
 
-FFTDataDistributor::FFTDataDistributor() : outputBuffers("FFTDataDistributorBuffers"), fftSize(DEFAULT_FFT_SIZE), linesPerSecond(DEFAULT_WATERFALL_LPS), lineRateAccum(0.0) {
+FFTDataDistributor::FFTDataDistributor() : outputBuffers("FFTDataDistributorBuffers"), fftSize(DEFAULT_FFT_SIZE), linesPerSecond(DEFAULT_WATERFALL_LPS), continuous(false), lineRateAccum(0.0) {
     bufferedItems = 0;
 }
 
@@ -16,6 +17,10 @@ unsigned int FFTDataDistributor::getLinesPerSecond() {
 	return this->linesPerSecond;
 }
 
+void FFTDataDistributor::setContinuous(bool continuous) {
+	this->continuous = continuous;
+}
+
 void FFTDataDistributor::process() {
 	while (!input->empty()) {
 		if (!isAnyOutputEmpty()) {
@@ -47,24 +52,33 @@ void FFTDataDistributor::process() {
 			continue;
 		}
 
+		// samples per emitted line; in continuous mode fftSize is the most a line can use (the Welch span),
+		// so lines take the line interval up to that, kept under half the buffer so a full line always fits;
+		// lines shorter than one FFT are collected by the processor
+		size_t lineSize = fftSize;
+		if (continuous && linesPerSecond) {
+			lineSize = std::min((size_t)fftSize, std::min((size_t)(inputBuffer.sampleRate / linesPerSecond), bufferMax / 2));
+			lineSize = std::max(lineSize, (size_t)1);
+		}
+
 		// number of seconds contained in input
 		double inputTime = (double)bufferedItems / (double)inputBuffer.sampleRate;
 		// number of lines in input
-		double inputLines = (double)bufferedItems / (double)fftSize;
+		double inputLines = (double)bufferedItems / (double)lineSize;
 
 		// ratio required to achieve the desired rate
 		double lineRateStep = ((double)linesPerSecond * inputTime)/(double)inputLines;
 
-		if (bufferedItems >= fftSize) {
+		if (bufferedItems >= lineSize) {
 			int numProcessed = 0;
 
-			if (lineRateAccum + (lineRateStep * ((double)bufferedItems/(double)fftSize)) < 1.0) {
+			if (lineRateAccum + (lineRateStep * ((double)bufferedItems/(double)lineSize)) < 1.0) {
 				// move along, nothing to see here..
-				lineRateAccum += (lineRateStep * ((double)bufferedItems/(double)fftSize));
+				lineRateAccum += (lineRateStep * ((double)bufferedItems/(double)lineSize));
 				numProcessed = bufferedItems;
 			} else {
-				for (unsigned int i = 0, iMax = bufferedItems; i < iMax; i += fftSize) {
-					if ((i + fftSize) > iMax) {
+				for (unsigned int i = 0, iMax = bufferedItems; i < iMax; i += lineSize) {
+					if ((i + lineSize) > iMax) {
 						break;
 					}
 					lineRateAccum += lineRateStep;
@@ -73,7 +87,7 @@ void FFTDataDistributor::process() {
 						DemodulatorThreadIQData *outp = outputBuffers.getBuffer();
 						outp->frequency = inputBuffer.frequency;
 						outp->sampleRate = inputBuffer.sampleRate;
-						outp->data.assign(inputBuffer.data.begin()+bufferOffset+i,inputBuffer.data.begin()+bufferOffset+i+fftSize);
+						outp->data.assign(inputBuffer.data.begin()+bufferOffset+i,inputBuffer.data.begin()+bufferOffset+i+lineSize);
 						distribute(outp);
 
 						while (lineRateAccum >= 1.0) {
@@ -81,7 +95,7 @@ void FFTDataDistributor::process() {
 						}
 					}
 
-					numProcessed += fftSize;
+					numProcessed += lineSize;
 				}
 			}
 			if (numProcessed) {
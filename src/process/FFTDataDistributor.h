@@ -11,6 +11,8 @@ public:
     void setFFTSize(unsigned int fftSize);
     void setLinesPerSecond(unsigned int lines);
     unsigned int getLinesPerSecond();
+    // each line carries all samples since the previous one (at least fftSize) instead of one FFT's worth
+    void setContinuous(bool continuous);
 
 protected:
     void process();
@@ -19,6 +21,7 @@ protected:
     ReBuffer<DemodulatorThreadIQData> outputBuffers;
     unsigned int fftSize;
     unsigned int linesPerSecond;
+    bool continuous;
     double lineRateAccum;
     size_t bufferMax, bufferOffset, bufferedItems;
 };
@@ -24,6 +24,8 @@ SpectrumVisualProcessor *FFTVisualDataThread::getProcessor() {
 }
 
 void FFTVisualDataThread::run() {
+    applyThreadPolicy("visual");
+
     DemodulatorThreadInputQueue *pipeIQDataIn = (DemodulatorThreadInputQueue *)getInputQueue("IQDataInput");
     SpectrumVisualDataQueue *pipeFFTDataOut = (SpectrumVisualDataQueue *)getOutputQueue("FFTDataOutput");
     
@@ -36,11 +38,14 @@ void FFTVisualDataThread::run() {
     wproc.setup(DEFAULT_FFT_SIZE);
 
     std::cout << "FFT visual data thread started." << std::endl;
+
+    std::chrono::steady_clock::time_point nextRun = std::chrono::steady_clock::now();
     
     while(!terminated) {
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-//        std::this_thread::yield();
+        // sleep until IQ arrives, unless lines are still waiting for the processor
+        if (wproc.isInputEmpty() && !fftDistrib.waitInput(VISUAL_THREAD_IDLE_WAIT_US)) {
+            continue;
+        }
         
         int fftSize = wproc.getDesiredInputSize();
         
@@ -49,16 +54,25 @@ void FFTVisualDataThread::run() {
         } else {
             fftDistrib.setFFTSize(DEFAULT_FFT_SIZE * SPECTRUM_VZM);
         }
+        // Welch averaging needs every sample, not one FFT's worth per line
+        fftDistrib.setContinuous(wproc.getWelch());
     
         if (lpsChanged.load()) {
             fftDistrib.setLinesPerSecond(linesPerSecond.load());
 //            pipeIQDataIn->set_max_num_items(linesPerSecond.load());
             lpsChanged.store(false);
         }
+
+        std::this_thread::sleep_until(nextRun);
+        int lps = linesPerSecond.load();
+        int pacing = (lps > 0)?(500000 / lps):FFT_VISUAL_MAX_PACING_US;
+        pacing = std::min(std::max(pacing, FFT_VISUAL_MIN_PACING_US), FFT_VISUAL_MAX_PACING_US);
+        nextRun = std::chrono::steady_clock::now() + std::chrono::microseconds(pacing);
         
         fftDistrib.run();
         
-        while (!wproc.isInputEmpty()) {
+        // a full output leaves the rest queued for the next run rather than spinning on it
+        while (!wproc.isInputEmpty() && wproc.isOutputEmpty()) {
             wproc.run();
         }
     }
@@ -66,3 +80,8 @@ void FFTVisualDataThread::run() {
     std::cout << "FFT visual data thread done." << std::endl;
 }
 
+void FFTVisualDataThread::terminate() {
+    IOThread::terminate();
+    fftDistrib.wakeInput();
+}
+
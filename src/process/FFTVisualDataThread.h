@@ -4,6 +4,11 @@
 #include "SpectrumVisualProcessor.h"
 #include "FFTDataDistributor.h"
 
+// runs are spaced half a line apart so lines leave within half a line of their data,
+// bounded so high rates don't spin and low rates don't wait longer than the old 10 ms poll
+#define FFT_VISUAL_MIN_PACING_US 1000
+#define FFT_VISUAL_MAX_PACING_US 10000
+
 class FFTVisualDataThread : public IOThread {
 public:
     FFTVisualDataThread();
@@ -14,6 +19,7 @@ public:
     SpectrumVisualProcessor *getProcessor();
     
     void run();
+    void terminate();
     
 protected:
     FFTDataDistributor fftDistrib;
@@ -11,14 +11,12 @@ ScopeVisualProcessor::ScopeVisualProcessor(): outputBuffers("ScopeVisualProcesso
 }
 
 ScopeVisualProcessor::~ScopeVisualProcessor() {
-    /*if (fftInData) {
-        free(fftInData);
+    FFTPlanner::destroyPlan(fftw_plan);
+    if (fftInData) {
+        fftwf_free(fftInData);
     }
     if (fftwOutput) {
-        free(fftwOutput);
-    }*/
-    if (fftw_plan) {
-        fftwf_destroy_plan(fftw_plan);
+        fftwf_free(fftwOutput);
     }
 }
 
@@ -27,21 +25,17 @@ void ScopeVisualProcessor::setup(int fftSize_in) {
     fftSize = fftSize_in;
     desiredInputSize = fftSize;
     
+    FFTPlanner::destroyPlan(fftw_plan);
     if (fftInData) {
-        free(fftInData);
+        fftwf_free(fftInData);
     }
     fftInData = (float*) fftwf_malloc(sizeof(float) * fftSize);
     if (fftwOutput) {
-        free(fftwOutput);
+        fftwf_free(fftwOutput);
     }
     fftwOutput = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * fftSize);
-    if (fftw_plan) {
-        fftwf_destroy_plan(fftw_plan);
-    }
-    fftw_plan = fftwf_plan_dft_r2c_1d(fftSize, fftInData, fftwOutput, FFTW_ESTIMATE);
-    //(fftSize, fftInData, fftwOutput, 0);
-    //(fftSize, fftwInput, fftwOutput, FFTW_R2HC, FFTW_ESTIMATE);
-    
+    fftw_plan = FFTPlanner::planDftR2C(fftSize, fftInData, fftwOutput);
+    memset(fftInData, 0, sizeof(float) * fftSize);
 }
 
 void ScopeVisualProcessor::setScopeEnabled(bool scopeEnable) {
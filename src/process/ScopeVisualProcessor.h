@@ -2,7 +2,7 @@
 
 #include "VisualProcessor.h"
 #include "AudioThread.h"
-#include "fftw3.h"
+#include "FFTPlanner.h"
 #include "ScopePanel.h"
 
 class ScopeRenderData: public ReferenceCounter {
@@ -2,6 +2,7 @@
 #include "CubicSDR.h"
 
 SpectrumVisualDataThread::SpectrumVisualDataThread() {
+    framesPerSecond.store(SPECTRUM_VISUAL_DEFAULT_FPS);
 }
 
 SpectrumVisualDataThread::~SpectrumVisualDataThread() {
@@ -12,15 +13,42 @@ SpectrumVisualProcessor *SpectrumVisualDataThread::getProcessor() {
     return &sproc;
 }
 
+void SpectrumVisualDataThread::setFramesPerSecond(int fps) {
+    framesPerSecond.store(fps);
+}
+
+int SpectrumVisualDataThread::getFramesPerSecond() {
+    return framesPerSecond.load();
+}
+
 void SpectrumVisualDataThread::run() {
+    applyThreadPolicy("visual");
+
     std::cout << "Spectrum visual data thread started." << std::endl;
+
+    std::chrono::steady_clock::time_point nextFrame = std::chrono::steady_clock::now();
     
     while(!terminated) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-//        std::this_thread::yield();
+        // sleep until IQ arrives instead of polling the queue
+        if (!sproc.waitInput(VISUAL_THREAD_IDLE_WAIT_US)) {
+            continue;
+        }
+
+        std::this_thread::sleep_until(nextFrame);
+        int fps = framesPerSecond.load();
+        if (fps <= 0) {
+            fps = SPECTRUM_VISUAL_DEFAULT_FPS;
+        }
+        nextFrame = std::chrono::steady_clock::now() + std::chrono::microseconds(1000000 / fps);
+
         sproc.run();
     }
     
     std::cout << "Spectrum visual data thread done." << std::endl;
 }
 
+void SpectrumVisualDataThread::terminate() {
+    IOThread::terminate();
+    sproc.wakeInput();
+}
+
@@ -3,14 +3,23 @@
 #include "IOThread.h"
 #include "SpectrumVisualProcessor.h"
 
+// spectrum averaging advances once per frame, 100 keeps the rate of the former 10 ms poll
+#define SPECTRUM_VISUAL_DEFAULT_FPS 100
+
 class SpectrumVisualDataThread : public IOThread {
 public:
     SpectrumVisualDataThread();
     ~SpectrumVisualDataThread();
     SpectrumVisualProcessor *getProcessor();
+
+    // upper bound on processed frames per second, <= 0 restores the default
+    void setFramesPerSecond(int fps);
+    int getFramesPerSecond();
     
     void run();
+    void terminate();
     
 protected:
     SpectrumVisualProcessor sproc;
+    std::atomic_int framesPerSecond;
 };
@@ -1,11 +1,13 @@
 #include "SpectrumVisualProcessor.h"
 #include "CubicSDR.h"
+#include <algorithm>
 
 
-SpectrumVisualProcessor::SpectrumVisualProcessor() : outputBuffers("SpectrumVisualProcessorBuffers"), lastInputBandwidth(0), lastBandwidth(0), fftwInput(NULL), fftwOutput(NULL), fftInData(NULL), fftLastData(NULL), lastDataSize(0), fftw_plan(NULL), resampler(NULL), resamplerRatio(0) {
+SpectrumVisualProcessor::SpectrumVisualProcessor() : outputBuffers("SpectrumVisualProcessorBuffers"), lastInputBandwidth(0), lastBandwidth(0), fftwInput(NULL), fftwOutput(NULL), fftInData(NULL), fftLastData(NULL), lastDataSize(0), lastDataPos(0), lastDataNew(0), fftw_plan(NULL), resampler(NULL), resamplerRatio(0), workers(NULL) {
     
     is_view.store(false);
     fftSize.store(0);
+    fftLength.store(0);
     centerFreq.store(0);
     bandwidth.store(0);
     hideDC.store(false);
@@ -23,10 +25,29 @@ SpectrumVisualProcessor::SpectrumVisualProcessor() : outputBuffers("SpectrumVisu
     lastView = false;
     peakHold.store(false);
     peakReset.store(false);
+    welch.store(false);
+    welchOverlap.store(0.5f);
+    welchWindowName = "Hann";
 }
 
 SpectrumVisualProcessor::~SpectrumVisualProcessor() {
     nco_crcf_destroy(freqShifter);
+    if (workers) {
+        delete workers;
+    }
+    FFTPlanner::destroyPlan(fftw_plan);
+    if (fftwInput) {
+        fftwf_free(fftwInput);
+    }
+    if (fftInData) {
+        fftwf_free(fftInData);
+    }
+    if (fftLastData) {
+        fftwf_free(fftLastData);
+    }
+    if (fftwOutput) {
+        fftwf_free(fftwOutput);
+    }
 }
 
 bool SpectrumVisualProcessor::isView() {
@@ -99,46 +120,150 @@ void SpectrumVisualProcessor::setup(unsigned int fftSize_in) {
     busy_run.lock();
 
     fftSize = fftSize_in;
-    fftSizeInternal = fftSize_in * SPECTRUM_VZM;
+    fftSizeInternal = std::max(fftSize_in * SPECTRUM_VZM, fftLength.load());
     lastDataSize = 0;
+    lastDataPos = 0;
+    lastDataNew = 0;
+    welchBuffer.clear();
     
     int memSize = sizeof(fftwf_complex) * fftSizeInternal;
     
+    FFTPlanner::destroyPlan(fftw_plan);
+
     if (fftwInput) {
-        free(fftwInput);
+        fftwf_free(fftwInput);
     }
-    //fftwInput = (fftwf_complex*) fftwf_malloc(memSize);
-	fftwInput = (fftwf_complex*)malloc(memSize);
-    memset(fftwInput,0,memSize);
+    fftwInput = (fftwf_complex*) fftwf_malloc(memSize);
 
     if (fftInData) {
-        free(fftInData);
+        fftwf_free(fftInData);
     }
-    //fftInData = (fftwf_complex*) fftwf_malloc(memSize);
-	fftInData = (fftwf_complex*)malloc(memSize);
-    memset(fftwInput,0,memSize);
+    fftInData = (fftwf_complex*) fftwf_malloc(memSize);
+    memset(fftInData,0,memSize);
     
     if (fftLastData) {
-        free(fftLastData);
+        fftwf_free(fftLastData);
     }
-    //fftLastData = (fftwf_complex*) fftwf_malloc(memSize);
-	fftLastData = (fftwf_complex*)malloc(memSize);
-    memset(fftwInput,0,memSize);
+    fftLastData = (fftwf_complex*) fftwf_malloc(memSize);
+    memset(fftLastData,0,memSize);
     
     if (fftwOutput) {
-        free(fftwOutput);
+        fftwf_free(fftwOutput);
     }
-    //fftwOutput = (fftwf_complex*) fftwf_malloc(memSize);
-	fftwOutput = (fftwf_complex*)malloc(memSize);
-	memset(fftwInput,0,memSize);
+    fftwOutput = (fftwf_complex*) fftwf_malloc(memSize);
     
-    if (fftw_plan) {
-        fftwf_destroy_plan(fftw_plan);
+    // MEASURE/PATIENT planning scribbles over the buffers, clear afterwards
+    fftw_plan = FFTPlanner::planDft(fftSizeInternal, fftwInput, fftwOutput, FFTW_FORWARD, true);
+    memset(fftwInput,0,memSize);
+    memset(fftwOutput,0,memSize);
+    busy_run.unlock();
+}
+
+void SpectrumVisualProcessor::pushLastData(const fftwf_complex *in, unsigned int count) {
+    unsigned int fftN = fftSizeInternal;
+    if (count > fftN) {
+        in += count - fftN;
+        count = fftN;
     }
-    fftw_plan = fftwf_plan_dft_1d(fftSizeInternal, fftwInput, fftwOutput, FFTW_FORWARD, FFTW_ESTIMATE);
+    unsigned int first = std::min(count, fftN - lastDataPos);
+    memcpy(fftLastData + lastDataPos, in, first * sizeof(fftwf_complex));
+    memcpy(fftLastData, in + first, (count - first) * sizeof(fftwf_complex));
+    lastDataPos = (lastDataPos + count) % fftN;
+    lastDataSize = std::min(fftN, lastDataSize + count);
+}
+
+void SpectrumVisualProcessor::readLastData(fftwf_complex *out) {
+    // oldest sample first, only used once the ring is full
+    unsigned int fftN = fftSizeInternal;
+    memcpy(out, fftLastData + lastDataPos, (fftN - lastDataPos) * sizeof(fftwf_complex));
+    memcpy(out + (fftN - lastDataPos), fftLastData, lastDataPos * sizeof(fftwf_complex));
+}
+
+void SpectrumVisualProcessor::setWelch(bool welch) {
+    this->welch.store(welch);
+}
+
+bool SpectrumVisualProcessor::getWelch() {
+    return welch.load();
+}
+
+void SpectrumVisualProcessor::setWelchWindow(std::string window) {
+    busy_run.lock();
+    welchWindowName = window;
     busy_run.unlock();
 }
 
+std::string SpectrumVisualProcessor::getWelchWindow() {
+    busy_run.lock();
+    std::string window = welchWindowName;
+    busy_run.unlock();
+    return window;
+}
+
+void SpectrumVisualProcessor::setWelchOverlap(float overlap) {
+    welchOverlap.store(std::max(0.0f, std::min(0.9f, overlap)));
+}
+
+float SpectrumVisualProcessor::getWelchOverlap() {
+    return welchOverlap.load();
+}
+
+size_t SpectrumVisualProcessor::getWelchSpan() {
+    unsigned int fftN = fftSizeInternal;
+    size_t hop = std::max(1u, (unsigned int)(fftN * (1.0f - welchOverlap.load())));
+    return fftN + (SPECTRUM_WELCH_MAX_SEGMENTS - 1) * hop;
+}
+
+void SpectrumVisualProcessor::processWelch(const liquid_float_complex *data, size_t numElems) {
+    unsigned int fftN = fftSizeInternal;
+    
+    if (welchWindow.size() != fftN || welchWindowBuilt != welchWindowName) {
+        welchWindow.resize(fftN);
+        double windowSum = 0;
+        for (unsigned int i = 0; i < fftN; i++) {
+            if (welchWindowName == "Rectangular") {
+                welchWindow[i] = 1.0f;
+            } else if (welchWindowName == "Hamming") {
+                welchWindow[i] = hamming(i, fftN);
+            } else if (welchWindowName == "Blackman-Harris") {
+                welchWindow[i] = blackmanharris(i, fftN);
+            } else {
+                welchWindow[i] = hann(i, fftN);
+            }
+            windowSum += welchWindow[i];
+        }
+        // unity coherent gain keeps levels comparable with the unwindowed single FFT
+        for (unsigned int i = 0; i < fftN; i++) {
+            welchWindow[i] *= (float)(fftN / windowSum);
+        }
+        welchWindowBuilt = welchWindowName;
+    }
+    
+    unsigned int hop = std::max(1u, (unsigned int)(fftN * (1.0f - welchOverlap.load())));
+    size_t segments = std::min((size_t)SPECTRUM_WELCH_MAX_SEGMENTS, (numElems - fftN) / hop + 1);
+    // when capped, keep the newest samples
+    size_t pos = numElems - fftN - (segments - 1) * hop;
+    
+    welchPower.assign(fftN, 0);
+    for (size_t seg = 0; seg < segments; seg++, pos += hop) {
+        dspWindowComplex(data + pos, &welchWindow[0], (float *)fftwInput, fftN);
+        fftwf_execute(fftw_plan);
+        dspPowerAccumulate((const float *)fftwOutput, &welchPower[0], fftN);
+    }
+    
+    // RMS magnitude goes back into the FFT output so the averaging pass needs no special case
+    float scale = 1.0f / (float)segments;
+    for (unsigned int i = 0; i < fftN; i++) {
+        fftwOutput[i][0] = sqrtf(welchPower[i] * scale);
+        fftwOutput[i][1] = 0;
+    }
+}
+
+void SpectrumVisualProcessor::processResultRange(unsigned int start, unsigned int end, bool doPeak, float &fft_ceil, float &fft_floor) {
+    dspSpectrumAccumulate((const float *)fftwOutput, fftSizeInternal, start, end, fft_average_rate,
+                          &fft_result_ma[0], &fft_result_maa[0], doPeak?&fft_result_peak[0]:nullptr, fft_ceil, fft_floor);
+}
+
 void SpectrumVisualProcessor::setFFTSize(unsigned int fftSize_in) {
     if (fftSize_in == fftSize) {
         return;
@@ -147,6 +272,22 @@ void SpectrumVisualProcessor::setFFTSize(unsigned int fftSize_in) {
     fftSizeChanged.store(true);
 }
 
+void SpectrumVisualProcessor::setFFTLength(unsigned int fftLength_in) {
+    fftLength.store(std::min(fftLength_in, (unsigned int)SPECTRUM_FFT_LENGTH_MAX));
+    // before the first setup() there is nothing to rebuild, setup() picks the length up
+    if (!fftSize.load()) {
+        return;
+    }
+    if (!fftSizeChanged.load()) {
+        newFFTSize = fftSize.load();
+    }
+    fftSizeChanged.store(true);
+}
+
+unsigned int SpectrumVisualProcessor::getFFTLength() {
+    return fftLength.load();
+}
+
 void SpectrumVisualProcessor::setHideDC(bool hideDC) {
     this->hideDC.store(hideDC);
 }
@@ -177,14 +318,12 @@ void SpectrumVisualProcessor::process() {
     busy_run.lock();
     bool doPeak = peakHold.load() && (peakReset.load() == 0);
     
-    if (fft_result.size() != fftSizeInternal) {
-        if (fft_result.capacity() < fftSizeInternal) {
-            fft_result.reserve(fftSizeInternal);
+    if (fft_result_ma.size() != fftSizeInternal) {
+        if (fft_result_ma.capacity() < fftSizeInternal) {
             fft_result_ma.reserve(fftSizeInternal);
             fft_result_maa.reserve(fftSizeInternal);
             fft_result_peak.reserve(fftSizeInternal);
         }
-        fft_result.resize(fftSizeInternal);
         fft_result_ma.resize(fftSizeInternal);
         fft_result_maa.resize(fftSizeInternal);
         fft_result_temp.resize(fftSizeInternal);
@@ -206,6 +345,8 @@ void SpectrumVisualProcessor::process() {
     
     if (data && data->size()) {
         unsigned int num_written;
+        const liquid_float_complex *welchData;
+        bool welchMode = welch.load();
         long resampleBw = iqData->sampleRate;
         bool newResampler = false;
         int bwDiff;
@@ -224,7 +365,8 @@ void SpectrumVisualProcessor::process() {
             
             resamplerRatio = (double) (resampleBw) / (double) iqData->sampleRate;
             
-            size_t desired_input_size = fftSizeInternal / resamplerRatio;
+            // Welch uses the whole block, up to the segment limit
+            size_t desired_input_size = (welchMode?getWelchSpan():(size_t)fftSizeInternal) / resamplerRatio;
             
             this->desiredInputSize.store(desired_input_size);
             
@@ -250,15 +392,15 @@ void SpectrumVisualProcessor::process() {
                                 
                                 if (numShift < fftSizeInternal/2 && numShift) {
                                     if (freqDiff > 0) {
-                                        memmove(&fft_result_ma[0], &fft_result_ma[numShift], (fftSizeInternal-numShift) * sizeof(double));
-                                        memmove(&fft_result_maa[0], &fft_result_maa[numShift], (fftSizeInternal-numShift) * sizeof(double));
-//                                        memmove(&fft_result_peak[0], &fft_result_peak[numShift], (fftSizeInternal-numShift) * sizeof(double));
-//                                        memset(&fft_result_peak[fftSizeInternal-numShift], 0, numShift * sizeof(double));
+                                        memmove(&fft_result_ma[0], &fft_result_ma[numShift], (fftSizeInternal-numShift) * sizeof(float));
+                                        memmove(&fft_result_maa[0], &fft_result_maa[numShift], (fftSizeInternal-numShift) * sizeof(float));
+//                                        memmove(&fft_result_peak[0], &fft_result_peak[numShift], (fftSizeInternal-numShift) * sizeof(float));
+//                                        memset(&fft_result_peak[fftSizeInternal-numShift], 0, numShift * sizeof(float));
                                     } else {
-                                        memmove(&fft_result_ma[numShift], &fft_result_ma[0], (fftSizeInternal-numShift) * sizeof(double));
-                                        memmove(&fft_result_maa[numShift], &fft_result_maa[0], (fftSizeInternal-numShift) * sizeof(double));
-//                                        memmove(&fft_result_peak[numShift], &fft_result_peak[0], (fftSizeInternal-numShift) * sizeof(double));
-//                                        memset(&fft_result_peak[0], 0, numShift * sizeof(double));
+                                        memmove(&fft_result_ma[numShift], &fft_result_ma[0], (fftSizeInternal-numShift) * sizeof(float));
+                                        memmove(&fft_result_maa[numShift], &fft_result_maa[0], (fftSizeInternal-numShift) * sizeof(float));
+//                                        memmove(&fft_result_peak[numShift], &fft_result_peak[0], (fftSizeInternal-numShift) * sizeof(float));
+//                                        memset(&fft_result_peak[0], 0, numShift * sizeof(float));
                                     }
                                 }
                             }
@@ -310,6 +452,7 @@ void SpectrumVisualProcessor::process() {
             }
             
             msresamp_crcf_execute(resampler, &shiftBuffer[0], desired_input_size, &resampleBuffer[0], &num_written);
+            welchData = &resampleBuffer[0];
             
             if (num_written < fftSizeInternal) {
                 for (unsigned int i = 0; i < num_written; i++) {
@@ -327,9 +470,10 @@ void SpectrumVisualProcessor::process() {
                 }
             }
         } else {
-            this->desiredInputSize.store(fftSizeInternal);
+            this->desiredInputSize.store(welchMode?getWelchSpan():(size_t)fftSizeInternal);
 
             num_written = data->size();
+            welchData = &(*data)[0];
             if (data->size() < fftSizeInternal) {
                 for (size_t i = 0, iMax = data->size(); i < iMax; i++) {
                     fftInData[i][0] = (*data)[i].real;
@@ -348,25 +492,41 @@ void SpectrumVisualProcessor::process() {
         }
         
         bool execute = false;
+        bool welchDone = false;
+        if (!welchMode) {
+            welchBuffer.clear();
+        }
+        // a whole new block is transformed where it is, anything else from fftwInput
+        fftwf_complex *fftSource = fftwInput;
         
-        if (num_written >= fftSizeInternal) {
-            execute = true;
-            memcpy(fftwInput, fftInData, fftSizeInternal * sizeof(fftwf_complex));
-            memcpy(fftLastData, fftwInput, fftSizeInternal * sizeof(fftwf_complex));
-            
-        } else {
-            if (lastDataSize + num_written < fftSizeInternal) { // priming
-                unsigned int num_copy = fftSizeInternal - lastDataSize;
-                if (num_written > num_copy) {
-                    num_copy = num_written;
+        if (welchMode) {
+            // blocks shorter than one segment are collected until there is one, rather than
+            // quietly turning into a single FFT
+            if (num_written < fftSizeInternal || !welchBuffer.empty()) {
+                welchBuffer.insert(welchBuffer.end(), welchData, welchData + num_written);
+                if (welchBuffer.size() >= fftSizeInternal) {
+                    welchData = &welchBuffer[0];
+                    num_written = welchBuffer.size();
+                    execute = true;
+                    welchDone = true;
                 }
-                memcpy(fftLastData, fftInData, num_copy * sizeof(fftwf_complex));
-                lastDataSize += num_copy;
             } else {
-                unsigned int num_last = (fftSizeInternal - num_written);
-                memcpy(fftwInput, fftLastData + (lastDataSize - num_last), num_last * sizeof(fftwf_complex));
-                memcpy(fftwInput + num_last, fftInData, num_written * sizeof(fftwf_complex));
-                memcpy(fftLastData, fftwInput, fftSizeInternal * sizeof(fftwf_complex));
+                execute = true;
+                welchDone = true;
+            }
+        } else if (num_written >= fftSizeInternal) {
+            execute = true;
+            fftSource = fftInData;
+            pushLastData(fftInData, fftSizeInternal);
+            lastDataNew = 0;
+        } else {
+            // short blocks only add their new samples to the ring; from FFT_PLANNER_THREADED_MIN up the
+            // transform waits for a whole new segment instead of re-running on mostly last frame's window
+            pushLastData(fftInData, num_written);
+            lastDataNew += num_written;
+            if (lastDataSize == fftSizeInternal && (fftSizeInternal < FFT_PLANNER_THREADED_MIN || lastDataNew >= fftSizeInternal)) {
+                readLastData(fftwInput);
+                lastDataNew = 0;
                 execute = true;
             }
         }
@@ -385,23 +545,15 @@ void SpectrumVisualProcessor::process() {
                 output->spectrum_hold_points.resize(0);
             }
             
-            fftwf_execute(fftw_plan);
+            if (welchDone) {
+                processWelch(welchData, num_written);
+                welchBuffer.clear();
+            } else {
+                fftwf_execute_dft(fftw_plan, fftSource, fftwOutput);
+            }
             
             float fft_ceil = 0, fft_floor = 1;
             
-            for (int i = 0, iMax = fftSizeInternal / 2; i < iMax; i++) {
-                float a = fftwOutput[i][0];
-                float b = fftwOutput[i][1];
-                float c = sqrt(a * a + b * b);
-                
-                float x = fftwOutput[fftSizeInternal / 2 + i][0];
-                float y = fftwOutput[fftSizeInternal / 2 + i][1];
-                float z = sqrt(x * x + y * y);
-                
-                fft_result[i] = (z);
-                fft_result[fftSizeInternal / 2 + i] = (c);
-            }
-            
             if (newResampler && lastView) {
                 if (bwDiff < 0) {
                     for (unsigned int i = 0, iMax = fftSizeInternal; i < iMax; i++) {
@@ -442,23 +594,34 @@ void SpectrumVisualProcessor::process() {
                 }
             }
             
-            for (int i = 0, iMax = fftSizeInternal; i < iMax; i++) {
-                if (fft_result_maa[i] != fft_result_maa[i]) fft_result_maa[i] = fft_result[i];
-                fft_result_maa[i] += (fft_result_ma[i] - fft_result_maa[i]) * fft_average_rate;
-                if (fft_result_ma[i] != fft_result_ma[i]) fft_result_ma[i] = fft_result[i];
-                fft_result_ma[i] += (fft_result[i] - fft_result_ma[i]) * fft_average_rate;
-                
-                if (fft_result_maa[i] > fft_ceil || fft_ceil != fft_ceil) {
-                    fft_ceil = fft_result_maa[i];
-                }
-                if (fft_result_maa[i] < fft_floor || fft_floor != fft_floor) {
-                    fft_floor = fft_result_maa[i];
+            // large FFTs split the magnitude/averaging pass into contiguous ranges across workers
+            unsigned int fftN = fftSizeInternal;
+            int parts = 1;
+            if (fftN >= FFT_PLANNER_THREADED_MIN) {
+                parts = std::min(FFTPlanner::getThreads(), SPECTRUM_MAX_WORKERS);
+            }
+            
+            if (parts > 1) {
+                if (!workers) {
+                    workers = new WorkerGroup("visual");
                 }
-                if (doPeak) {
-                    if (fft_result_maa[i] > fft_result_peak[i]) {
-                        fft_result_peak[i] = fft_result_maa[i];
+                partCeil.assign(parts, 0);
+                partFloor.assign(parts, 1);
+                workers->run(parts, [this, fftN, parts, doPeak](int part) {
+                    unsigned int start = (unsigned int)(((unsigned long long)fftN * part) / parts);
+                    unsigned int end = (unsigned int)(((unsigned long long)fftN * (part + 1)) / parts);
+                    processResultRange(start, end, doPeak, partCeil[part], partFloor[part]);
+                });
+                for (int p = 0; p < parts; p++) {
+                    if (partCeil[p] > fft_ceil || fft_ceil != fft_ceil) {
+                        fft_ceil = partCeil[p];
+                    }
+                    if (partFloor[p] < fft_floor || fft_floor != fft_floor) {
+                        fft_floor = partFloor[p];
                     }
                 }
+            } else {
+                processResultRange(0, fftN, doPeak, fft_ceil, fft_floor);
             }
             
             if (fft_ceil_ma != fft_ceil_ma) fft_ceil_ma = fft_ceil;
@@ -483,32 +646,46 @@ void SpectrumVisualProcessor::process() {
             float sf = scaleFactor.load();
  
             double visualRatio = (double(bandwidth) / double(resampleBw));
+            double binsPerPoint = double(fftSizeInternal) / double(fftSize);
             double visualStart = (double(fftSizeInternal) / 2.0) - (double(fftSizeInternal) * (visualRatio / 2.0));
             double visualAccum = 0;
-            double peak_acc = 0, acc = 0, accCount = 0, i = 0;
+            long long bin = (long long)round(visualStart);
+            float peak_acc = 0, acc = 0;
+            long long accCount = 0;
    
+            // dB scaling stays out of dspSpectrumAccumulate: it needs this frame's ceil/floor, which are only
+            // known once every range has run; here it runs once per display point on a dspSum of its bins
             double point_ceil = doPeak?fft_ceil_peak:fft_ceil_maa;
             double point_floor = doPeak?fft_floor_peak:fft_floor_maa;
+            // log10(avg + 0.25 - (floor - 0.75)) / log10((ceil + 0.25) - (floor - 0.75)), constant parts hoisted
+            float point_offset = 0.25f - float(point_floor - 0.75);
+            float point_scale = sf / log10f(float((point_ceil + 0.25) - (point_floor - 0.75)));
             
             for (int x = 0, xMax = output->spectrum_points.size() / 2; x < xMax; x++) {
-                visualAccum += visualRatio * double(SPECTRUM_VZM);
+                visualAccum += visualRatio * binsPerPoint;
 
-                while (visualAccum >= 1.0) {
-                    unsigned int idx = round(visualStart+i);
-                    if (idx > 0 && idx < fftSizeInternal) {
-                        acc += fft_result_maa[idx];
-                        if (doPeak) {
-                            peak_acc += fft_result_peak[idx];
-                        }
-                    } else {
-                        acc += fft_floor_maa;
-                        if (doPeak) {
-                            peak_acc += fft_floor_maa;
+                if (visualAccum >= 1.0) {
+                    // this point's whole bins; those outside 1..fftSizeInternal-1 count as the floor
+                    long long numBins = (long long)visualAccum;
+                    visualAccum -= (double)numBins;
+
+                    long long runStart = std::max(bin, 1LL);
+                    long long runEnd = std::min(bin + numBins, (long long)fftSizeInternal);
+                    long long runLen = std::max(0LL, runEnd - runStart);
+                    float fill = (float)(numBins - runLen) * fft_floor_maa;
+
+                    acc += fill;
+                    if (runLen) {
+                        acc += dspSum(&fft_result_maa[runStart], runLen);
+                    }
+                    if (doPeak) {
+                        peak_acc += fill;
+                        if (runLen) {
+                            peak_acc += dspSum(&fft_result_peak[runStart], runLen);
                         }
                     }
-                    accCount += 1.0;
-                    visualAccum -= 1.0;
-                    i++;
+                    accCount += numBins;
+                    bin += numBins;
                 }
 
                 output->spectrum_points[x * 2] = ((float) x / (float) xMax);
@@ -516,13 +693,13 @@ void SpectrumVisualProcessor::process() {
                     output->spectrum_hold_points[x * 2] = ((float) x / (float) xMax);
                 }
                 if (accCount) {
-                    output->spectrum_points[x * 2 + 1] = ((log10((acc/accCount)+0.25 - (point_floor-0.75)) / log10((point_ceil+0.25) - (point_floor-0.75))))*sf;
-                    acc = 0.0;
+                    output->spectrum_points[x * 2 + 1] = log10f(acc / accCount + point_offset) * point_scale;
+                    acc = 0;
                     if (doPeak) {
-                        output->spectrum_hold_points[x * 2 + 1] = ((log10((peak_acc/accCount)+0.25 - (point_floor-0.75)) / log10((point_ceil+0.25) - (point_floor-0.75))))*sf;
-                        peak_acc = 0.0;
+                        output->spectrum_hold_points[x * 2 + 1] = log10f(peak_acc / accCount + point_offset) * point_scale;
+                        peak_acc = 0;
                     }
-                    accCount = 0.0;
+                    accCount = 0;
                 }
             }
             
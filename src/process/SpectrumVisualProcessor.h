@@ -2,11 +2,17 @@
 
 #include "VisualProcessor.h"
 #include "DemodDefs.h"
-#include "fftw3.h"
+#include "FFTPlanner.h"
+#include "WorkerGroup.h"
+#include "DSPKernels.h"
 #include <cmath>
 
 #define SPECTRUM_VZM 2
 #define PEAK_RESET_COUNT 30
+#define SPECTRUM_MAX_WORKERS 8
+// upper bound on FFTs per displayed frame in Welch mode
+#define SPECTRUM_WELCH_MAX_SEGMENTS 64
+#define SPECTRUM_FFT_LENGTH_MAX (1 << 20)
 
 class SpectrumVisualData : public ReferenceCounter {
 public:
@@ -44,28 +50,53 @@ public:
     
     void setup(unsigned int fftSize);
     void setFFTSize(unsigned int fftSize);
+    // FFT length in bins independent of the displayed points, which average the bins they cover;
+    // 0 (default) uses fftSize * SPECTRUM_VZM, lengths of FFT_PLANNER_THREADED_MIN and up run threaded
+    void setFFTLength(unsigned int fftLength);
+    unsigned int getFFTLength();
     void setHideDC(bool hideDC);
     
     void setScaleFactor(float sf);
     float getScaleFactor();
     
+    // Welch mode averages the power of overlapping windowed FFTs over the whole input block; shorter
+    // blocks are collected until one segment is there, and getDesiredInputSize() reports the most
+    // input one average uses (SPECTRUM_WELCH_MAX_SEGMENTS segments)
+    void setWelch(bool welch);
+    bool getWelch();
+    // "Hann", "Hamming", "Blackman-Harris" or "Rectangular"
+    void setWelchWindow(std::string window);
+    std::string getWelchWindow();
+    // fraction of each segment shared with the next, 0 to 0.9
+    void setWelchOverlap(float overlap);
+    float getWelchOverlap();
+    
 protected:
     void process();
+    void processResultRange(unsigned int start, unsigned int end, bool doPeak, float &fft_ceil, float &fft_floor);
+    void processWelch(const liquid_float_complex *data, size_t numElems);
+    // input one Welch average can use at the current length and overlap
+    size_t getWelchSpan();
     
     ReBuffer<SpectrumVisualData> outputBuffers;
     std::atomic_bool is_view;
     std::atomic_uint fftSize, newFFTSize;
     std::atomic_uint fftSizeInternal;
+    std::atomic_uint fftLength;
     std::atomic_llong centerFreq;
     std::atomic_long bandwidth;
     
 private:
+    void pushLastData(const fftwf_complex *in, unsigned int count);
+    void readLastData(fftwf_complex *out);
+
     long lastInputBandwidth;
     long lastBandwidth;
     bool lastView;
     
     fftwf_complex *fftwInput, *fftwOutput, *fftInData, *fftLastData;
-    unsigned int lastDataSize;
+    // fftLastData is a ring of the newest input: valid samples, next write slot, samples since the last transform
+    unsigned int lastDataSize, lastDataPos, lastDataNew;
     fftwf_plan fftw_plan;
     
     double fft_ceil_ma, fft_ceil_maa;
@@ -73,11 +104,10 @@ private:
     double fft_ceil_peak, fft_floor_peak;
     std::atomic<float> fft_average_rate;
     
-    std::vector<double> fft_result;
-    std::vector<double> fft_result_ma;
-    std::vector<double> fft_result_maa;
-    std::vector<double> fft_result_peak;
-    std::vector<double> fft_result_temp;
+    std::vector<float> fft_result_ma;
+    std::vector<float> fft_result_maa;
+    std::vector<float> fft_result_peak;
+    std::vector<float> fft_result_temp;
     
     msresamp_crcf resampler;
     double resamplerRatio;
@@ -92,4 +122,13 @@ private:
     std::atomic_int peakReset;
     std::atomic<float> scaleFactor;
     std::atomic_bool fftSizeChanged;
+    
+    WorkerGroup *workers;
+    std::vector<float> partCeil, partFloor;
+    
+    std::atomic_bool welch;
+    std::atomic<float> welchOverlap;
+    std::string welchWindowName, welchWindowBuilt;
+    std::vector<float> welchWindow, welchPower;
+    std::vector<liquid_float_complex> welchBuffer;
 };
@@ -4,10 +4,18 @@
 #include "ThreadQueue.h"
 #include "IOThread.h"
 #include <algorithm>
+#include <chrono>
+
+// longest a visual thread sleeps on an idle input before rechecking its terminate flag
+#define VISUAL_THREAD_IDLE_WAIT_US 250000
 
 template<class InputDataType = ReferenceCounter, class OutputDataType = ReferenceCounter>
 class VisualProcessor {
 public:
+    VisualProcessor() : input(nullptr) {
+
+    }
+
 	virtual ~VisualProcessor() {
 
 	}
@@ -34,6 +42,27 @@ public:
         return false;
     }
 
+    // block until there is input, for at most timeout microseconds or until wakeInput()
+    bool waitInput(std::uint64_t timeout) {
+        busy_update.lock();
+        ThreadQueue<InputDataType *> *in = input;
+        busy_update.unlock();
+
+        if (!in) {
+            std::this_thread::sleep_for(std::chrono::microseconds(timeout));
+            return false;
+        }
+        return in->wait_not_empty(timeout);
+    }
+
+    void wakeInput() {
+        busy_update.lock();
+        if (input) {
+            input->wake();
+        }
+        busy_update.unlock();
+    }
+
     void setInput(ThreadQueue<InputDataType *> *vis_in) {
         busy_update.lock();
         input = vis_in;
@@ -72,13 +101,20 @@ protected:
     }
 
     void distribute(OutputDataType *output) {
+        if (outputs.empty()) {
+            // drop the reference passed in, or give back a buffer fresh from the pool
+            if (output->getRefCount() > 0) {
+                output->setRefCount(0);
+            } else {
+                output->discard();
+            }
+            return;
+        }
         // distribute outputs
         output->setRefCount(outputs.size());
         for (outputs_i = outputs.begin(); outputs_i != outputs.end(); outputs_i++) {
-        	if ((*outputs_i)->full()) {
+        	if ((*outputs_i)->full() || !(*outputs_i)->push(output)) {
         		output->decRefCount();
-        	} else {
-        		(*outputs_i)->push(output);
         	}
         }
     }
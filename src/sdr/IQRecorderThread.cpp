@@ -0,0 +1,531 @@
+#include "IQRecorderThread.h"
+#include "IQConvert.h"
+#include "PipelineStats.h"
+
+#include <cerrno>
+#include <ctime>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+IQRecordFile::IQRecordFile() : bytesWritten(0), diskFull(false) {
+#ifdef _WIN32
+    fp = nullptr;
+#else
+    fd = -1;
+    mapBase = nullptr;
+    mapped = false;
+    mapOffset = 0;
+    fileSize = 0;
+#endif
+}
+
+IQRecordFile::~IQRecordFile() {
+    close();
+}
+
+#ifdef _WIN32
+
+bool IQRecordFile::open(std::string fileName, uint64_t /* preallocBytes */) {
+    close();
+
+    fp = fopen(fileName.c_str(), "wb");
+    if (!fp) {
+        return false;
+    }
+    fileBuffer.resize(IQ_RECORD_CHUNK_BYTES / 16);
+    setvbuf(fp, &fileBuffer[0], _IOFBF, fileBuffer.size());
+    bytesWritten = 0;
+    diskFull = false;
+
+    return true;
+}
+
+bool IQRecordFile::write(const void *data, size_t numBytes) {
+    if (!fp || fwrite(data, 1, numBytes, fp) != numBytes) {
+        diskFull = (errno == ENOSPC);
+        return false;
+    }
+    bytesWritten += numBytes;
+    return true;
+}
+
+void IQRecordFile::close() {
+    if (fp) {
+        fclose(fp);
+        fp = nullptr;
+    }
+}
+
+bool IQRecordFile::isOpen() {
+    return fp != nullptr;
+}
+
+#else
+
+bool IQRecordFile::open(std::string fileName, uint64_t preallocBytes) {
+    close();
+
+    fd = ::open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    bytesWritten = 0;
+    diskFull = false;
+    mapOffset = 0;
+    fileSize = 0;
+
+    uint64_t initialSize = ((preallocBytes + IQ_RECORD_CHUNK_BYTES - 1) / IQ_RECORD_CHUNK_BYTES) * IQ_RECORD_CHUNK_BYTES;
+    if (initialSize < IQ_RECORD_CHUNK_BYTES) {
+        initialSize = IQ_RECORD_CHUNK_BYTES;
+    }
+
+    IQRecordExtend reserved = extend(initialSize);
+    if (reserved == IQ_RECORD_EXTEND_RESERVED) {
+        mapped = mapChunk();
+    } else if (reserved == IQ_RECORD_EXTEND_FULL && initialSize > IQ_RECORD_CHUNK_BYTES) {
+        // the whole rotate size may not fit, try for a single chunk before giving up
+        reserved = extend(IQ_RECORD_CHUNK_BYTES);
+        mapped = (reserved == IQ_RECORD_EXTEND_RESERVED) && mapChunk();
+    } else {
+        mapped = false;
+    }
+
+    if (reserved == IQ_RECORD_EXTEND_FULL) {
+        diskFull = true;
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+
+    return true;
+}
+
+IQRecordFile::IQRecordExtend IQRecordFile::extend(uint64_t newSize) {
+    int err;
+#if defined(__linux__)
+    // never let libc emulate the reservation by writing zeros, unsupported filesystems use pwrite()
+    err = (fallocate(fd, 0, fileSize, newSize - fileSize) == 0)?0:errno;
+#elif defined(_POSIX_ADVISORY_INFO) && (_POSIX_ADVISORY_INFO > 0)
+    err = posix_fallocate(fd, fileSize, newSize - fileSize);
+#else
+    err = EOPNOTSUPP;
+#endif
+
+    if (err == 0) {
+        fileSize = newSize;
+        return IQ_RECORD_EXTEND_RESERVED;
+    }
+    if (err == ENOSPC || err == EDQUOT) {
+        return IQ_RECORD_EXTEND_FULL;
+    }
+    return IQ_RECORD_EXTEND_UNSUPPORTED;
+}
+
+bool IQRecordFile::writeDirect(const char *src, size_t numBytes) {
+    while (numBytes) {
+        ssize_t n = pwrite(fd, src, numBytes, bytesWritten);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            diskFull = (errno == ENOSPC || errno == EDQUOT);
+            return false;
+        }
+        src += n;
+        numBytes -= n;
+        bytesWritten += n;
+    }
+    return true;
+}
+
+bool IQRecordFile::mapChunk() {
+    void *addr = mmap(nullptr, IQ_RECORD_CHUNK_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, mapOffset);
+    if (addr == MAP_FAILED) {
+        mapBase = nullptr;
+        return false;
+    }
+    mapBase = (char *)addr;
+    madvise(mapBase, IQ_RECORD_CHUNK_BYTES, MADV_SEQUENTIAL);
+    return true;
+}
+
+void IQRecordFile::unmapChunk() {
+    if (mapBase) {
+        // start writeback of the finished chunk now rather than when the page cache fills
+        msync(mapBase, IQ_RECORD_CHUNK_BYTES, MS_ASYNC);
+        munmap(mapBase, IQ_RECORD_CHUNK_BYTES);
+        mapBase = nullptr;
+    }
+}
+
+bool IQRecordFile::write(const void *data, size_t numBytes) {
+    const char *src = (const char *)data;
+
+    while (numBytes) {
+        if (!mapped) {
+            return writeDirect(src, numBytes);
+        }
+        if (!mapBase) {
+            return false;
+        }
+
+        uint64_t chunkPos = bytesWritten - mapOffset;
+        size_t n = (size_t)(IQ_RECORD_CHUNK_BYTES - chunkPos);
+        if (n > numBytes) {
+            n = numBytes;
+        }
+
+        memcpy(mapBase + chunkPos, src, n);
+        src += n;
+        numBytes -= n;
+        bytesWritten += n;
+
+        if (bytesWritten - mapOffset == IQ_RECORD_CHUNK_BYTES) {
+            unmapChunk();
+            mapOffset += IQ_RECORD_CHUNK_BYTES;
+            if (mapOffset + IQ_RECORD_CHUNK_BYTES > fileSize) {
+                IQRecordExtend reserved = extend(mapOffset + IQ_RECORD_CHUNK_BYTES);
+                if (reserved == IQ_RECORD_EXTEND_FULL) {
+                    diskFull = true;
+                    return false;
+                }
+                if (reserved == IQ_RECORD_EXTEND_UNSUPPORTED) {
+                    mapped = false;
+                    continue;
+                }
+            }
+            if (!mapChunk()) {
+                mapped = false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void IQRecordFile::close() {
+    if (fd < 0) {
+        return;
+    }
+    unmapChunk();
+    // drop the unused preallocated tail
+    if (ftruncate(fd, bytesWritten) != 0) {
+        std::cout << "IQ recording: unable to truncate file to " << bytesWritten << " bytes." << std::endl;
+    }
+    ::close(fd);
+    fd = -1;
+}
+
+bool IQRecordFile::isOpen() {
+    return fd >= 0;
+}
+
+#endif
+
+uint64_t IQRecordFile::getBytesWritten() {
+    return bytesWritten;
+}
+
+bool IQRecordFile::isDiskFull() {
+    return diskFull;
+}
+
+IQRecorderThread::IQRecorderThread() : IOThread(), fileFormat(IQ_RECORD_CF32), fileSampleRate(0), fileOpenTime(0), fileSamples(0), fileSequence(0) {
+    recording.store(false);
+    sessionStart.store(false);
+    rotateSize.store(IQ_RECORD_DEFAULT_ROTATE_MB);
+    rotateSeconds.store(IQ_RECORD_DEFAULT_ROTATE_SECONDS);
+    format.store(IQ_RECORD_CF32);
+}
+
+IQRecorderThread::~IQRecorderThread() {
+    closeFile();
+}
+
+void IQRecorderThread::startRecording(std::string path) {
+    std::lock_guard < std::mutex > lock(setting_busy);
+    recordPath = path;
+    sessionStart.store(true);
+    recording.store(true);
+}
+
+void IQRecorderThread::stopRecording() {
+    recording.store(false);
+}
+
+bool IQRecorderThread::isRecording() {
+    return recording.load();
+}
+
+std::string IQRecorderThread::getFileName() {
+    std::lock_guard < std::mutex > lock(setting_busy);
+    return fileName;
+}
+
+void IQRecorderThread::setFormat(std::string format) {
+    this->format.store((format == "CS16")?IQ_RECORD_CS16:IQ_RECORD_CF32);
+}
+
+std::string IQRecorderThread::getFormat() {
+    return (format.load() == IQ_RECORD_CS16)?"CS16":"CF32";
+}
+
+void IQRecorderThread::setRotateSize(int megabytes) {
+    rotateSize.store(megabytes);
+}
+
+void IQRecorderThread::setRotateSeconds(int seconds) {
+    rotateSeconds.store(seconds);
+}
+
+void IQRecorderThread::setDeviceInfo(std::string hardware, std::map<std::string, float> gains) {
+    std::lock_guard < std::mutex > lock(setting_busy);
+    this->hardware = hardware;
+    this->gains = gains;
+}
+
+std::string IQRecorderThread::dateTimeUTC(bool compact) {
+    std::time_t now = std::time(nullptr);
+    struct tm utc;
+#ifdef _WIN32
+    gmtime_s(&utc, &now);
+#else
+    gmtime_r(&now, &utc);
+#endif
+    char timeStr[32];
+    std::strftime(timeStr, sizeof(timeStr), compact?"%Y%m%d_%H%M%S":"%Y-%m-%dT%H:%M:%SZ", &utc);
+    return timeStr;
+}
+
+std::string IQRecorderThread::jsonEscape(std::string str) {
+    std::string escaped;
+    for (size_t i = 0; i < str.length(); i++) {
+        char c = str[i];
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if ((unsigned char)c < 0x20) {
+            escaped += ' ';
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+bool IQRecorderThread::openFile(SDRThreadIQData *data_in) {
+    std::string path;
+    {
+        std::lock_guard < std::mutex > lock(setting_busy);
+        path = recordPath;
+    }
+
+    std::stringstream baseName;
+    baseName << path;
+    if (path != "" && path[path.length() - 1] != '/' && path[path.length() - 1] != '\\') {
+        baseName << "/";
+    }
+    baseName << "iq_" << dateTimeUTC(true) << "_" << data_in->frequency << "Hz_" << std::setw(3) << std::setfill('0') << fileSequence;
+
+    fileFormat = format.load();
+    fileSampleRate = data_in->sampleRate;
+    fileSamples = 0;
+    fileOpenTime = PipelineStats::now();
+    captures.clear();
+
+    std::string dataFileName = baseName.str() + ".sigmf-data";
+    metaFileName = baseName.str() + ".sigmf-meta";
+
+    uint64_t preallocBytes = (uint64_t)rotateSize.load() * 1024 * 1024;
+    if (!dataFile.open(dataFileName, preallocBytes)) {
+        if (dataFile.isDiskFull()) {
+            std::cout << "IQ recording: disk full creating '" << dataFileName << "', recording stopped." << std::endl;
+            remove(dataFileName.c_str());
+        } else {
+            std::cout << "IQ recording: unable to create '" << dataFileName << "'." << std::endl;
+        }
+        return false;
+    }
+
+    {
+        std::lock_guard < std::mutex > lock(setting_busy);
+        fileName = dataFileName;
+    }
+
+    Capture capture;
+    capture.sampleStart = 0;
+    capture.frequency = data_in->frequency;
+    capture.dateTime = dateTimeUTC(false);
+    captures.push_back(capture);
+
+    // written up front so an interrupted recording is still readable
+    writeMeta();
+
+    std::cout << "IQ recording to '" << dataFileName << "'." << std::endl;
+    return true;
+}
+
+void IQRecorderThread::closeFile() {
+    if (!dataFile.isOpen()) {
+        return;
+    }
+    dataFile.close();
+    writeMeta();
+
+    std::cout << "IQ recording closed after " << fileSamples << " samples." << std::endl;
+}
+
+void IQRecorderThread::writeMeta() {
+    std::string hw;
+    std::map<std::string, float> gainValues;
+    {
+        std::lock_guard < std::mutex > lock(setting_busy);
+        hw = hardware;
+        gainValues = gains;
+    }
+
+    std::ofstream meta(metaFileName.c_str(), std::ios::out | std::ios::trunc);
+    if (!meta.is_open()) {
+        std::cout << "IQ recording: unable to write '" << metaFileName << "'." << std::endl;
+        return;
+    }
+
+    meta << "{" << std::endl;
+    meta << "    \"global\": {" << std::endl;
+    meta << "        \"core:datatype\": \"" << ((fileFormat == IQ_RECORD_CS16)?"ci16_le":"cf32_le") << "\"," << std::endl;
+    meta << "        \"core:sample_rate\": " << fileSampleRate << "," << std::endl;
+    meta << "        \"core:version\": \"1.0.0\"," << std::endl;
+    if (hw != "") {
+        meta << "        \"core:hw\": \"" << jsonEscape(hw) << "\"," << std::endl;
+    }
+    if (!gainValues.empty()) {
+        meta << "        \"cubicsdr:gains\": {";
+        for (std::map<std::string, float>::iterator gi = gainValues.begin(); gi != gainValues.end(); gi++) {
+            meta << ((gi == gainValues.begin())?" ":", ") << "\"" << jsonEscape(gi->first) << "\": " << gi->second;
+        }
+        meta << " }," << std::endl;
+    }
+#ifdef CUBICSDR_VERSION
+    meta << "        \"core:recorder\": \"CubicSDR " << CUBICSDR_VERSION << "\"" << std::endl;
+#else
+    meta << "        \"core:recorder\": \"CubicSDR\"" << std::endl;
+#endif
+    meta << "    }," << std::endl;
+
+    meta << "    \"captures\": [" << std::endl;
+    for (size_t i = 0; i < captures.size(); i++) {
+        meta << "        { \"core:sample_start\": " << captures[i].sampleStart
+             << ", \"core:frequency\": " << captures[i].frequency
+             << ", \"core:datetime\": \"" << captures[i].dateTime << "\" }"
+             << ((i + 1 < captures.size())?",":"") << std::endl;
+    }
+    meta << "    ]," << std::endl;
+    meta << "    \"annotations\": []" << std::endl;
+    meta << "}" << std::endl;
+}
+
+void IQRecorderThread::process(SDRThreadIQData *data_in) {
+    size_t numElems = data_in->data.size();
+
+    if (sessionStart.exchange(false)) {
+        closeFile();
+        fileSequence = 0;
+    }
+
+    if (dataFile.isOpen()) {
+        int rotateMB = rotateSize.load();
+        int rotateSec = rotateSeconds.load();
+
+        bool rotate = (data_in->sampleRate != fileSampleRate);
+        if (rotateMB > 0 && dataFile.getBytesWritten() >= (uint64_t)rotateMB * 1024 * 1024) {
+            rotate = true;
+        }
+        if (rotateSec > 0 && PipelineStats::now() - fileOpenTime >= (long long)rotateSec * 1000000) {
+            rotate = true;
+        }
+        if (rotate) {
+            closeFile();
+            fileSequence++;
+        }
+    }
+
+    if (!dataFile.isOpen() && !openFile(data_in)) {
+        recording.store(false);
+        return;
+    }
+
+    if (data_in->frequency != captures.back().frequency) {
+        Capture capture;
+        capture.sampleStart = fileSamples;
+        capture.frequency = data_in->frequency;
+        capture.dateTime = dateTimeUTC(false);
+        captures.push_back(capture);
+    }
+
+    bool written;
+    if (fileFormat == IQ_RECORD_CS16) {
+        if (convertBuffer.size() < numElems * 2) {
+            convertBuffer.resize(numElems * 2);
+        }
+        iqConvertToCS16(&data_in->data[0], &convertBuffer[0], numElems, 32767.0f);
+        written = dataFile.write(&convertBuffer[0], numElems * 2 * sizeof(int16_t));
+    } else {
+        written = dataFile.write(&data_in->data[0], numElems * sizeof(liquid_float_complex));
+    }
+
+    if (!written) {
+        if (dataFile.isDiskFull()) {
+            std::cout << "IQ recording: disk full, recording stopped." << std::endl;
+        } else {
+            std::cout << "IQ recording: write failed, recording stopped." << std::endl;
+        }
+        closeFile();
+        recording.store(false);
+        return;
+    }
+
+    fileSamples += numElems;
+}
+
+void IQRecorderThread::run() {
+    applyThreadPolicy("record");
+
+    SDRThreadIQDataQueue *iqDataInQueue = (SDRThreadIQDataQueue *)getInputQueue("IQDataInput");
+
+    while (!terminated) {
+        SDRThreadIQData *data_in;
+
+        if (!iqDataInQueue->timeout_pop(data_in, 100000)) {
+            // finalize promptly on stop even if the device has gone quiet
+            if (!recording.load()) {
+                closeFile();
+            }
+            continue;
+        }
+
+        if (!recording.load()) {
+            closeFile();
+        } else if (data_in->data.size()) {
+            process(data_in);
+        }
+
+        data_in->decRefCount();
+    }
+
+    SDRThreadIQData *leftover;
+    while (iqDataInQueue->try_pop(leftover)) {
+        leftover->decRefCount();
+    }
+
+    closeFile();
+}
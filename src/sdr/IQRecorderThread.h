@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+
+#if USE_RTL_SDR
+#include "SDRThread.h"
+#else
+#include "SoapySDRThread.h"
+#endif
+
+// blocks in flight between SDRPostThread and the recorder (~1s at the usual block rate)
+#define IQ_RECORD_QUEUE_SIZE 64
+// files are grown and mapped in chunks of this size; must be a multiple of the page size
+#define IQ_RECORD_CHUNK_BYTES (64 * 1024 * 1024)
+#define IQ_RECORD_DEFAULT_ROTATE_MB 2048
+#define IQ_RECORD_DEFAULT_ROTATE_SECONDS 0
+
+/**
+ * Append-only output file, preallocated up front and written through a memory-mapped
+ * window so the recorder never waits on write() buffering.  Only space with real
+ * extents behind it is ever mapped (a store into a hole on a full disk raises SIGBUS);
+ * where extents can't be reserved the file is written with pwrite() instead, and
+ * large buffered writes are used where mmap isn't available.
+ */
+class IQRecordFile {
+public:
+    IQRecordFile();
+    ~IQRecordFile();
+
+    bool open(std::string fileName, uint64_t preallocBytes);
+    bool write(const void *data, size_t numBytes);
+    void close();
+
+    bool isOpen();
+    uint64_t getBytesWritten();
+    // the last failed write ran out of disk space or quota
+    bool isDiskFull();
+
+private:
+    uint64_t bytesWritten;
+    bool diskFull;
+#ifdef _WIN32
+    FILE *fp;
+    std::vector<char> fileBuffer;
+#else
+    enum IQRecordExtend { IQ_RECORD_EXTEND_RESERVED, IQ_RECORD_EXTEND_UNSUPPORTED, IQ_RECORD_EXTEND_FULL };
+
+    IQRecordExtend extend(uint64_t newSize);
+    bool mapChunk();
+    void unmapChunk();
+    bool writeDirect(const char *src, size_t numBytes);
+
+    int fd;
+    char *mapBase;
+    // false once extents couldn't be reserved, the rest of the file goes through pwrite()
+    bool mapped;
+    uint64_t mapOffset, fileSize;
+#endif
+};
+
+/**
+ * Records the full-band IQ stream handed over by SDRPostThread to rotating SigMF
+ * recordings (.sigmf-data + .sigmf-meta) in CF32 or CS16.  The post thread only
+ * passes a reference to its input block through a ring queue; if the disk can't keep
+ * up blocks are dropped at that queue and the post thread never waits.
+ */
+class IQRecorderThread : public IOThread {
+public:
+    enum IQRecordFormat { IQ_RECORD_CF32, IQ_RECORD_CS16 };
+
+    IQRecorderThread();
+    ~IQRecorderThread();
+
+    void run();
+
+    void startRecording(std::string path);
+    void stopRecording();
+    bool isRecording();
+    std::string getFileName();
+
+    void setFormat(std::string format);
+    std::string getFormat();
+
+    void setRotateSize(int megabytes);
+    void setRotateSeconds(int seconds);
+
+    void setDeviceInfo(std::string hardware, std::map<std::string, float> gains);
+
+private:
+    class Capture {
+    public:
+        uint64_t sampleStart;
+        long long frequency;
+        std::string dateTime;
+    };
+
+    void process(SDRThreadIQData *data_in);
+    bool openFile(SDRThreadIQData *data_in);
+    void closeFile();
+    void writeMeta();
+    static std::string dateTimeUTC(bool compact);
+    static std::string jsonEscape(std::string str);
+
+    std::atomic_bool recording, sessionStart;
+    std::atomic_int rotateSize, rotateSeconds;
+    std::atomic<IQRecordFormat> format;
+
+    std::mutex setting_busy;
+    std::string recordPath, fileName, hardware;
+    std::map<std::string, float> gains;
+
+    IQRecordFile dataFile;
+    std::string metaFileName;
+    IQRecordFormat fileFormat;
+    long long fileSampleRate;
+    long long fileOpenTime;
+    uint64_t fileSamples;
+    int fileSequence;
+    std::vector<Capture> captures;
+    std::vector<int16_t> convertBuffer;
+};
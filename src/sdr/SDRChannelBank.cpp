@@ -0,0 +1,237 @@
+#include "SDRChannelBank.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+#ifndef M_PI
+#define M_PI        3.14159265358979323846
+#endif
+
+// Kaiser transition width, relative to the input rate, for the filter used at this decimation
+static float channelTransition(int decimation) {
+    unsigned int tapCount = decimation * CHANNEL_BANK_TAPS_PER_PHASE + 1;
+    return (CHANNEL_BANK_ATTENUATION - 7.95f) / (14.26f * (float)tapCount);
+}
+
+SDRBankChannel::SDRBankChannel() : frequency(0), offset(0), sampleRate(0), bandwidth(0), decimation(0), bound(false), historyLen(0), decimPhase(0), output(nullptr), outputPos(0) {
+    phase.real = 1.0f;
+    phase.imag = 0.0f;
+}
+
+void SDRBankChannel::tune(long long offset_in, int sampleRate_in) {
+    offset = offset_in;
+    sampleRate = sampleRate_in;
+
+    // per-sample rotation for one tile, plus the rotation across a whole tile at the end
+    double omega = -2.0 * M_PI * (double)offset / (double)sampleRate;
+
+    rotation.resize(CHANNEL_BANK_TILE_SIZE + 1);
+    for (int i = 0; i <= CHANNEL_BANK_TILE_SIZE; i++) {
+        rotation[i].real = cos(omega * (double)i);
+        rotation[i].imag = sin(omega * (double)i);
+    }
+}
+
+void SDRBankChannel::design(int decimation_in) {
+    decimation = decimation_in;
+
+    unsigned int tapCount = decimation * CHANNEL_BANK_TAPS_PER_PHASE + 1;
+    std::vector<float> h(tapCount);
+
+    // stopband starts at the output Nyquist rate, so everything that folds back is already attenuated
+    float cutoff = 0.5f / (float)decimation - channelTransition(decimation) * 0.5f;
+    liquid_firdes_kaiser(tapCount, cutoff, CHANNEL_BANK_ATTENUATION, 0.0f, &h[0]);
+
+    float gain = 0;
+    for (unsigned int i = 0; i < tapCount; i++) {
+        gain += h[i];
+    }
+
+    // stored reversed so the dot product walks both arrays forward
+    taps.resize(tapCount);
+    for (unsigned int i = 0; i < tapCount; i++) {
+        taps[i] = h[tapCount - 1 - i] / gain;
+    }
+
+    historyLen = tapCount - 1;
+    work.assign(historyLen + CHANNEL_BANK_TILE_SIZE, liquid_float_complex());
+    decimPhase = 0;
+}
+
+void SDRBankChannel::mix(const liquid_float_complex *in, size_t len) {
+    liquid_float_complex *out = &work[historyLen];
+    const liquid_float_complex *rot = &rotation[0];
+    float pr = phase.real, pi = phase.imag;
+
+    // no loop-carried state: rotation comes from the table, phase only advances per tile
+    for (size_t i = 0; i < len; i++) {
+        float rr = rot[i].real * pr - rot[i].imag * pi;
+        float ri = rot[i].real * pi + rot[i].imag * pr;
+        out[i].real = in[i].real * rr - in[i].imag * ri;
+        out[i].imag = in[i].real * ri + in[i].imag * rr;
+    }
+
+    float nr = rot[len].real * pr - rot[len].imag * pi;
+    float ni = rot[len].real * pi + rot[len].imag * pr;
+    float mag = sqrtf(nr * nr + ni * ni);
+    phase.real = nr / mag;
+    phase.imag = ni / mag;
+}
+
+void SDRBankChannel::decimate(size_t len) {
+    size_t tapCount = taps.size();
+    const float *h = &taps[0];
+    liquid_float_complex *out = &output->data[0];
+
+    // only the retained output samples are computed
+    while (decimPhase < len) {
+        const liquid_float_complex *x = &work[decimPhase];
+        float accR = 0, accI = 0;
+        for (size_t k = 0; k < tapCount; k++) {
+            accR += h[k] * x[k].real;
+            accI += h[k] * x[k].imag;
+        }
+        out[outputPos].real = accR;
+        out[outputPos].imag = accI;
+        outputPos++;
+        decimPhase += decimation;
+    }
+    decimPhase -= len;
+
+    // carry the filter history into the next tile
+    std::copy(work.begin() + len, work.begin() + len + historyLen, work.begin());
+}
+
+SDRChannelBank::SDRChannelBank() : buffers("SDRChannelBankBuffers") {
+
+}
+
+SDRChannelBank::~SDRChannelBank() {
+    clear();
+}
+
+void SDRChannelBank::clear() {
+    std::map<const void *, SDRBankChannel *>::iterator i;
+    for (i = channels.begin(); i != channels.end(); i++) {
+        delete i->second;
+    }
+    channels.clear();
+    active.clear();
+}
+
+SDRBankChannel *SDRChannelBank::bindChannel(DemodulatorChannelSpec &demod, long long frequency, int sampleRate) {
+    int bandwidth = demod.bandwidth;
+    long long demodFreq = demod.frequency;
+    long long offset = demodFreq - frequency;
+
+    if (bandwidth <= 0 || std::abs(offset) > (sampleRate / 2)) {
+        return nullptr;
+    }
+
+    // largest decimation whose passband (output Nyquist less the transition) still holds the channel
+    int decimation = 1;
+    while ((double)bandwidth * 0.5 <= (double)sampleRate * (0.5 / (double)(decimation * 2) - channelTransition(decimation * 2))) {
+        decimation *= 2;
+    }
+
+    if (decimation < 2) {
+        return nullptr;
+    }
+
+    SDRBankChannel *chan;
+    std::map<const void *, SDRBankChannel *>::iterator i = channels.find(demod.owner);
+
+    if (i == channels.end()) {
+        chan = new SDRBankChannel;
+        channels[demod.owner] = chan;
+    } else {
+        chan = i->second;
+    }
+
+    if (chan->offset != offset || chan->sampleRate != sampleRate || chan->rotation.empty()) {
+        chan->tune(offset, sampleRate);
+    }
+    if (chan->decimation != decimation) {
+        chan->design(decimation);
+    }
+
+    chan->frequency = demodFreq;
+    chan->bandwidth = bandwidth;
+    chan->bound = true;
+
+    return chan;
+}
+
+size_t SDRChannelBank::process(long long frequency, int sampleRate, liquid_float_complex *data, size_t dataSize,
+                               std::vector<DemodulatorChannelSpec> &demods, size_t numDemods, std::vector<DemodulatorThreadIQData *> &outputs) {
+    std::map<const void *, SDRBankChannel *>::iterator i;
+
+    for (i = channels.begin(); i != channels.end(); i++) {
+        i->second->bound = false;
+    }
+
+    if (outputs.size() < numDemods) {
+        outputs.resize(numDemods);
+    }
+
+    active.clear();
+
+    for (size_t j = 0; j < numDemods; j++) {
+        SDRBankChannel *chan = bindChannel(demods[j], frequency, sampleRate);
+        outputs[j] = nullptr;
+
+        if (!chan) {
+            continue;
+        }
+
+        size_t outSize = dataSize / chan->decimation + 1;
+
+        DemodulatorThreadIQData *out = buffers.getBuffer();
+        out->setRefCount(1);
+        out->frequency = chan->frequency;
+        out->sampleRate = sampleRate / chan->decimation;
+        if (out->data.size() < outSize) {
+            out->data.resize(outSize);
+        }
+
+        chan->output = out;
+        chan->outputPos = 0;
+
+        outputs[j] = out;
+        active.push_back(chan);
+    }
+
+    // drop state for demodulators that left the run
+    for (i = channels.begin(); i != channels.end();) {
+        if (!i->second->bound) {
+            delete i->second;
+            channels.erase(i++);
+        } else {
+            i++;
+        }
+    }
+
+    if (active.empty()) {
+        return 0;
+    }
+
+    for (size_t ofs = 0; ofs < dataSize; ofs += CHANNEL_BANK_TILE_SIZE) {
+        size_t len = dataSize - ofs;
+        if (len > CHANNEL_BANK_TILE_SIZE) {
+            len = CHANNEL_BANK_TILE_SIZE;
+        }
+
+        for (size_t j = 0, jMax = active.size(); j < jMax; j++) {
+            active[j]->mix(&data[ofs], len);
+            active[j]->decimate(len);
+        }
+    }
+
+    for (size_t j = 0, jMax = active.size(); j < jMax; j++) {
+        active[j]->output->data.resize(active[j]->outputPos);
+        active[j]->output = nullptr;
+    }
+
+    return active.size();
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+#include <map>
+
+#include "DemodDefs.h"
+
+// input samples processed per channel before moving to the next one; keeps the tile in L1
+#define CHANNEL_BANK_TILE_SIZE 2048
+// FIR length per unit of decimation
+#define CHANNEL_BANK_TAPS_PER_PHASE 12
+#define CHANNEL_BANK_ATTENUATION 60.0f
+
+class SDRBankChannel {
+public:
+    SDRBankChannel();
+
+    void tune(long long offset, int sampleRate);
+    void design(int decimation);
+    void mix(const liquid_float_complex *in, size_t len);
+    void decimate(size_t len);
+
+    long long frequency;
+    long long offset;
+    int sampleRate;
+    int bandwidth;
+    int decimation;
+    bool bound;
+
+    liquid_float_complex phase;
+    std::vector<liquid_float_complex> rotation;
+    std::vector<float> taps;
+    std::vector<liquid_float_complex> work;
+    size_t historyLen;
+    size_t decimPhase;
+
+    DemodulatorThreadIQData *output;
+    size_t outputPos;
+};
+
+/**
+ * Extracts a decimated baseband stream for every demodulator from one full-rate block.
+ * Each channel still mixes every input sample and its filter costs CHANNEL_BANK_TAPS_PER_PHASE MACs
+ * per input sample, so the work grows with channels x input rate; what it saves over
+ * N demodulators doing the same is their full-rate copies and queues.  The block is
+ * walked tile by tile and each tile is mixed and decimated for all channels while it
+ * is still hot in cache; demodulators that can't be narrowed (unknown or near
+ * full-rate bandwidth) are left to the caller.
+ */
+class SDRChannelBank {
+public:
+    SDRChannelBank();
+    ~SDRChannelBank();
+
+    size_t process(long long frequency, int sampleRate, liquid_float_complex *data, size_t dataSize,
+                   std::vector<DemodulatorChannelSpec> &demods, size_t numDemods, std::vector<DemodulatorThreadIQData *> &outputs);
+
+    void clear();
+
+private:
+    SDRBankChannel *bindChannel(DemodulatorChannelSpec &demod, long long frequency, int sampleRate);
+
+    std::map<const void *, SDRBankChannel *> channels;
+    std::vector<SDRBankChannel *> active;
+    ReBuffer<DemodulatorThreadIQData> buffers;
+};
@@ -175,6 +175,8 @@ std::vector<SDRDeviceInfo *> *SDREnumerator::enumerate_devices(std::string remot
         
         results = SoapySDR::Device::enumerate(enumArgs);
     } else {
+        // SigMF recordings in the recording folder are listed as playback devices
+        SDRFileDevice::setSearchPath(wxGetApp().getIQRecordingPath());
         results = SoapySDR::Device::enumerate();
     }
     
@@ -0,0 +1,347 @@
+#include "SDRFastChannelizer.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef M_PI
+#define M_PI        3.14159265358979323846
+#endif
+
+SDRFastChannel::SDRFastChannel() : frequency(0), offset(0), bandwidth(0), decimation(0), ifftSize(0), centerBin(0), bound(false),
+        ifftIn(nullptr), ifftOut(nullptr), ifftPlan(nullptr), blockPhase(0), output(nullptr), outputPos(0) {
+    finePhase.real = 1.0f;
+    finePhase.imag = 0.0f;
+    fineStep = finePhase;
+}
+
+SDRFastChannel::~SDRFastChannel() {
+    if (ifftPlan) {
+        FFTPlanner::destroyPlan(ifftPlan);
+    }
+    if (ifftIn) {
+        fftwf_free(ifftIn);
+    }
+    if (ifftOut) {
+        fftwf_free(ifftOut);
+    }
+}
+
+void SDRFastChannel::setup(int decimation_in, int ifftSize_in, std::vector<liquid_float_complex> &response) {
+    if (ifftSize != ifftSize_in) {
+        if (ifftPlan) {
+            FFTPlanner::destroyPlan(ifftPlan);
+            fftwf_free(ifftIn);
+            fftwf_free(ifftOut);
+        }
+        ifftSize = ifftSize_in;
+        ifftIn = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * ifftSize);
+        ifftOut = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * ifftSize);
+        ifftPlan = FFTPlanner::planDftRealtime(ifftSize, ifftIn, ifftOut, FFTW_BACKWARD);
+    }
+    decimation = decimation_in;
+    filter = response;
+}
+
+SDRFastChannelizer::SDRFastChannelizer() : sampleRate(0), fftSize(0), hopSize(0), inputFill(0), fftIn(nullptr), fftOut(nullptr), fftPlan(nullptr), buffers("SDRFastChannelizerBuffers") {
+
+}
+
+SDRFastChannelizer::~SDRFastChannelizer() {
+    clear();
+    if (fftPlan) {
+        FFTPlanner::destroyPlan(fftPlan);
+        fftwf_free(fftIn);
+        fftwf_free(fftOut);
+    }
+}
+
+void SDRFastChannelizer::clear() {
+    std::map<const void *, SDRFastChannel *>::iterator i;
+    for (i = channels.begin(); i != channels.end(); i++) {
+        delete i->second;
+    }
+    channels.clear();
+    active.clear();
+}
+
+int SDRFastChannelizer::getFFTSize() {
+    return fftSize;
+}
+
+void SDRFastChannelizer::init(int sampleRate_in) {
+    sampleRate = sampleRate_in;
+
+    int newSize = FASTCH_FFT_MIN;
+    while (newSize < FASTCH_FFT_MAX && (sampleRate / newSize) > FASTCH_BIN_HZ) {
+        newSize *= 2;
+    }
+
+    // every channel's filter and phase depend on the block geometry
+    clear();
+    responses.clear();
+
+    if (newSize != fftSize) {
+        if (fftPlan) {
+            FFTPlanner::destroyPlan(fftPlan);
+            fftwf_free(fftIn);
+            fftwf_free(fftOut);
+        }
+        fftSize = newSize;
+        fftIn = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * fftSize);
+        fftOut = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * fftSize);
+        fftPlan = FFTPlanner::planDftRealtime(fftSize, fftIn, fftOut, FFTW_FORWARD);
+    }
+
+    // 25% overlap; the prototype filter spans the discarded quarter
+    hopSize = (fftSize / 4) * 3;
+    memset(fftIn, 0, sizeof(fftwf_complex) * fftSize);
+    inputFill = fftSize - hopSize;
+
+    std::cout << "Fast channelizer using " << fftSize << " point FFT, " << (sampleRate / fftSize) << "Hz bins." << std::endl;
+}
+
+std::vector<liquid_float_complex> &SDRFastChannelizer::getResponse(int decimation) {
+    std::map<int, std::vector<liquid_float_complex> >::iterator i = responses.find(decimation);
+
+    if (i != responses.end()) {
+        return i->second;
+    }
+
+    int ifftSize = fftSize / decimation;
+    int tapCount = fftSize - hopSize + 1;
+
+    // flat to a quarter of the output rate, stopband reached at the edge of the kept bins
+    std::vector<float> h(tapCount);
+    liquid_firdes_kaiser(tapCount, 0.375f / (float)decimation, FASTCH_ATTENUATION, 0.0f, &h[0]);
+
+    float gain = 0;
+    for (int j = 0; j < tapCount; j++) {
+        gain += h[j];
+    }
+
+    // response of the causal prototype on the forward FFT grid, folded down to the channel's bins
+    fftwf_complex *hIn = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * fftSize);
+    fftwf_complex *hOut = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * fftSize);
+    fftwf_plan hPlan = FFTPlanner::planDftRealtime(fftSize, hIn, hOut, FFTW_FORWARD);
+
+    memset(hIn, 0, sizeof(fftwf_complex) * fftSize);
+    for (int j = 0; j < tapCount; j++) {
+        hIn[j][0] = h[j] / gain;
+    }
+    fftwf_execute(hPlan);
+
+    std::vector<liquid_float_complex> &response = responses[decimation];
+    response.resize(ifftSize);
+    for (int m = 0; m < ifftSize; m++) {
+        int bin = (m < ifftSize / 2) ? m : (fftSize - (ifftSize - m));
+        response[m].real = hOut[bin][0] / (float)fftSize;
+        response[m].imag = hOut[bin][1] / (float)fftSize;
+    }
+
+    FFTPlanner::destroyPlan(hPlan);
+    fftwf_free(hIn);
+    fftwf_free(hOut);
+
+    return response;
+}
+
+SDRFastChannel *SDRFastChannelizer::bindChannel(DemodulatorChannelSpec &demod, long long frequency) {
+    int bandwidth = demod.bandwidth;
+    long long demodFreq = demod.frequency;
+    long long offset = demodFreq - frequency;
+
+    if (std::abs(offset) > (sampleRate / 2)) {
+        return nullptr;
+    }
+
+    // not built yet; the pre-demod stage needs input before it reports a bandwidth
+    if (bandwidth <= 0) {
+        bandwidth = DEFAULT_DEMOD_BW;
+    }
+
+    int decimation = 1;
+    while ((fftSize / (decimation * 2)) >= FASTCH_IFFT_MIN && (sampleRate / (decimation * 2)) >= (bandwidth * FASTCH_OVERSAMPLE)) {
+        decimation *= 2;
+    }
+
+    SDRFastChannel *chan;
+    std::map<const void *, SDRFastChannel *>::iterator i = channels.find(demod.owner);
+
+    if (i == channels.end()) {
+        chan = new SDRFastChannel;
+        channels[demod.owner] = chan;
+    } else {
+        chan = i->second;
+    }
+
+    if (chan->decimation != decimation) {
+        chan->setup(decimation, fftSize / decimation, getResponse(decimation));
+        chan->offset = offset + 1;
+    }
+
+    if (chan->offset != offset) {
+        double binHz = (double)sampleRate / (double)fftSize;
+        int bin = (int)floor((double)offset / binHz + 0.5);
+        double residual = (double)offset - (double)bin * binHz;
+        double omega = -2.0 * M_PI * residual * (double)decimation / (double)sampleRate;
+
+        chan->offset = offset;
+        chan->centerBin = (bin + fftSize) % fftSize;
+        chan->blockPhase = 0;
+        chan->fineStep.real = cos(omega);
+        chan->fineStep.imag = sin(omega);
+    }
+
+    chan->frequency = demodFreq;
+    chan->bandwidth = bandwidth;
+    chan->bound = true;
+
+    return chan;
+}
+
+void SDRFastChannelizer::executeBlock() {
+    fftwf_execute(fftPlan);
+
+    // DC spur lives in bin 0
+    fftOut[0][0] = fftOut[0][1] = 0;
+
+    for (size_t c = 0, cMax = active.size(); c < cMax; c++) {
+        SDRFastChannel *chan = active[c];
+        int m_size = chan->ifftSize;
+        int half = m_size / 2;
+        const liquid_float_complex *H = &chan->filter[0];
+
+        for (int m = 0; m < m_size; m++) {
+            int bin = chan->centerBin + ((m < half) ? m : (m - m_size));
+            bin = (bin + fftSize) % fftSize;
+            float xr = fftOut[bin][0], xi = fftOut[bin][1];
+            chan->ifftIn[m][0] = xr * H[m].real - xi * H[m].imag;
+            chan->ifftIn[m][1] = xr * H[m].imag + xi * H[m].real;
+        }
+
+        fftwf_execute(chan->ifftPlan);
+
+        // block-relative mix to absolute time: rotate by the bin's phase at this block's start
+        double theta = -2.0 * M_PI * (double)chan->blockPhase / (double)fftSize;
+        float br = cos(theta), bi = sin(theta);
+        float fr = chan->finePhase.real, fi = chan->finePhase.imag;
+        float sr = chan->fineStep.real, si = chan->fineStep.imag;
+
+        liquid_float_complex *out = &chan->output->data[chan->outputPos];
+        int keep = hopSize / chan->decimation;
+
+        for (int n = m_size - keep, j = 0; n < m_size; n++, j++) {
+            float yr = chan->ifftOut[n][0] * br - chan->ifftOut[n][1] * bi;
+            float yi = chan->ifftOut[n][0] * bi + chan->ifftOut[n][1] * br;
+            out[j].real = yr * fr - yi * fi;
+            out[j].imag = yr * fi + yi * fr;
+            float nr = fr * sr - fi * si;
+            fi = fr * si + fi * sr;
+            fr = nr;
+        }
+
+        float mag = sqrtf(fr * fr + fi * fi);
+        chan->finePhase.real = fr / mag;
+        chan->finePhase.imag = fi / mag;
+        chan->outputPos += keep;
+        chan->blockPhase = (chan->blockPhase + (long long)chan->centerBin * hopSize) % fftSize;
+    }
+
+    // carry the overlap into the next block
+    memmove(fftIn, fftIn + hopSize, sizeof(fftwf_complex) * (fftSize - hopSize));
+    inputFill = fftSize - hopSize;
+}
+
+size_t SDRFastChannelizer::process(long long frequency, int sampleRate_in, liquid_float_complex *data, size_t dataSize,
+                                   std::vector<DemodulatorChannelSpec> &demods, size_t numDemods, std::vector<DemodulatorThreadIQData *> &outputs) {
+    if (sampleRate_in != sampleRate || !fftPlan) {
+        init(sampleRate_in);
+    }
+
+    std::map<const void *, SDRFastChannel *>::iterator i;
+
+    for (i = channels.begin(); i != channels.end(); i++) {
+        i->second->bound = false;
+    }
+
+    if (outputs.size() < numDemods) {
+        outputs.resize(numDemods);
+    }
+
+    active.clear();
+
+    size_t numBlocks = (inputFill + dataSize - (fftSize - hopSize)) / hopSize;
+
+    for (size_t j = 0; j < numDemods; j++) {
+        SDRFastChannel *chan = bindChannel(demods[j], frequency);
+        outputs[j] = nullptr;
+
+        if (!chan) {
+            continue;
+        }
+
+        size_t outSize = numBlocks * (hopSize / chan->decimation);
+
+        DemodulatorThreadIQData *out = buffers.getBuffer();
+        out->setRefCount(1);
+        out->frequency = chan->frequency;
+        out->sampleRate = sampleRate / chan->decimation;
+        if (out->data.size() < outSize) {
+            out->data.resize(outSize);
+        }
+
+        chan->output = out;
+        chan->outputPos = 0;
+
+        outputs[j] = out;
+        active.push_back(chan);
+    }
+
+    for (i = channels.begin(); i != channels.end();) {
+        if (!i->second->bound) {
+            delete i->second;
+            channels.erase(i++);
+        } else {
+            i++;
+        }
+    }
+
+    size_t pos = 0;
+    while (pos < dataSize) {
+        size_t len = fftSize - inputFill;
+        if (len > dataSize - pos) {
+            len = dataSize - pos;
+        }
+
+        memcpy(fftIn + inputFill, data + pos, sizeof(fftwf_complex) * len);
+        inputFill += len;
+        pos += len;
+
+        if (inputFill == (size_t)fftSize) {
+            executeBlock();
+        }
+    }
+
+    for (size_t j = 0, jMax = active.size(); j < jMax; j++) {
+        active[j]->output->data.resize(active[j]->outputPos);
+        active[j]->output = nullptr;
+    }
+
+    // channels with nothing to hand out this round go back to the pool
+    for (size_t j = 0; j < numDemods; j++) {
+        if (outputs[j] != nullptr && outputs[j]->data.empty()) {
+            buffers.returnBuffer(outputs[j]);
+            outputs[j] = nullptr;
+        }
+    }
+
+    size_t numOutputs = 0;
+    for (size_t j = 0; j < numDemods; j++) {
+        if (outputs[j] != nullptr) {
+            numOutputs++;
+        }
+    }
+
+    return numOutputs;
+}
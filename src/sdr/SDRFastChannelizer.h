@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+#include <map>
+
+#include "DemodDefs.h"
+#include "FFTPlanner.h"
+
+// forward FFT bin spacing target; FFT size is the power of two reaching it
+#define FASTCH_BIN_HZ 2000
+#define FASTCH_FFT_MIN 2048
+#define FASTCH_FFT_MAX 65536
+// smallest per-channel inverse FFT
+#define FASTCH_IFFT_MIN 64
+#define FASTCH_ATTENUATION 60.0f
+// minimum output rate as a multiple of the demodulator bandwidth
+#define FASTCH_OVERSAMPLE 2
+
+class SDRFastChannel {
+public:
+    SDRFastChannel();
+    ~SDRFastChannel();
+
+    void setup(int decimation, int ifftSize, std::vector<liquid_float_complex> &response);
+
+    long long frequency;
+    long long offset;
+    int bandwidth;
+    int decimation;
+    int ifftSize;
+    int centerBin;
+    bool bound;
+
+    std::vector<liquid_float_complex> filter;
+    fftwf_complex *ifftIn, *ifftOut;
+    fftwf_plan ifftPlan;
+
+    long long blockPhase;
+    liquid_float_complex finePhase, fineStep;
+
+    DemodulatorThreadIQData *output;
+    size_t outputPos;
+};
+
+/**
+ * Fast-convolution (FFT overlap-save) channelizer.
+ * One forward FFT per block is shared by all channels; each channel picks the bins
+ * around its own centre, applies its filter response and runs a small inverse FFT
+ * sized to its decimated rate.  The remaining sub-bin offset is removed at the
+ * output rate so every stream comes out centred exactly on its demodulator.
+ */
+class SDRFastChannelizer {
+public:
+    SDRFastChannelizer();
+    ~SDRFastChannelizer();
+
+    size_t process(long long frequency, int sampleRate, liquid_float_complex *data, size_t dataSize,
+                   std::vector<DemodulatorChannelSpec> &demods, size_t numDemods, std::vector<DemodulatorThreadIQData *> &outputs);
+
+    void clear();
+    int getFFTSize();
+
+private:
+    void init(int sampleRate);
+    SDRFastChannel *bindChannel(DemodulatorChannelSpec &demod, long long frequency);
+    std::vector<liquid_float_complex> &getResponse(int decimation);
+    void executeBlock();
+
+    int sampleRate;
+    int fftSize, hopSize;
+    size_t inputFill;
+    fftwf_complex *fftIn, *fftOut;
+    fftwf_plan fftPlan;
+
+    std::map<int, std::vector<liquid_float_complex> > responses;
+    std::map<const void *, SDRFastChannel *> channels;
+    std::vector<SDRFastChannel *> active;
+    ReBuffer<DemodulatorThreadIQData> buffers;
+};
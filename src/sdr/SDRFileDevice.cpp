@@ -0,0 +1,548 @@
+#include "SDRFileDevice.h"
+#include "IQConvert.h"
+
+#include <SoapySDR/Formats.h>
+#include <SoapySDR/Constants.h>
+#include <SoapySDR/Errors.h>
+
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <iostream>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+std::mutex SDRFileDevice::search_busy;
+std::string SDRFileDevice::searchPath;
+
+static SoapySDR::Registry registerFileDevice(SDR_FILE_DEVICE_DRIVER, &SDRFileDevice::findDevices, &SDRFileDevice::makeDevice, SOAPY_SDR_ABI_VERSION);
+
+// Just enough of a JSON reader for the flat keys of a .sigmf-meta file.
+static std::string sigmfValue(const std::string &meta, const std::string &key) {
+    size_t pos = meta.find("\"" + key + "\"");
+    if (pos == std::string::npos) {
+        return "";
+    }
+    pos = meta.find(':', pos + key.length() + 2);
+    if (pos == std::string::npos) {
+        return "";
+    }
+    pos = meta.find_first_not_of(" \t\r\n", pos + 1);
+    if (pos == std::string::npos) {
+        return "";
+    }
+    if (meta[pos] == '"') {
+        size_t end = meta.find('"', pos + 1);
+        return (end == std::string::npos)?"":meta.substr(pos + 1, end - pos - 1);
+    }
+    size_t end = meta.find_first_of(",}] \t\r\n", pos);
+    return meta.substr(pos, end - pos);
+}
+
+static bool endsWith(const std::string &str, const std::string &suffix) {
+    return str.length() >= suffix.length() && str.compare(str.length() - suffix.length(), suffix.length(), suffix) == 0;
+}
+
+SDRFileDevice::SDRFileDevice(const SoapySDR::Kwargs &args) : elemBytes(8), sampleRate(SDR_FILE_DEVICE_DEFAULT_RATE), centerFreq(0), fileData(nullptr), fileBytes(0), numElems(0), paceElems(0) {
+#ifdef _WIN32
+    fileHandle = INVALID_HANDLE_VALUE;
+    mapHandle = nullptr;
+#else
+    fd = -1;
+#endif
+    position.store(0);
+    speed.store(1.0);
+    loop.store(true);
+    active.store(false);
+    paceReset.store(true);
+
+    SoapySDR::Kwargs dev;
+    if (!args.count("file") || !describeFile(args.at("file"), args, dev)) {
+        throw std::runtime_error("cubicfile: no playable file given");
+    }
+
+    fileName = dev["file"];
+    parseFormat(dev["format"], fileFormat);
+    streamFormat = fileFormat;
+    sampleRate = atof(dev["rate"].c_str());
+    if (dev.count("freq")) {
+        centerFreq = atof(dev["freq"].c_str());
+    }
+    if (dev.count("speed")) {
+        speed.store(atof(dev["speed"].c_str()));
+    }
+    if (dev.count("loop")) {
+        loop.store(dev["loop"] != "false" && dev["loop"] != "0");
+    }
+
+    elemBytes = (fileFormat == FILE_FORMAT_CF32)?8:((fileFormat == FILE_FORMAT_CS16)?4:2);
+
+    if (!mapFile(fileName)) {
+        throw std::runtime_error("cubicfile: unable to map '" + fileName + "'");
+    }
+}
+
+SDRFileDevice::~SDRFileDevice() {
+    unmapFile();
+}
+
+void SDRFileDevice::setSearchPath(std::string path) {
+    std::lock_guard < std::mutex > lock(search_busy);
+    searchPath = path;
+}
+
+bool SDRFileDevice::parseFormat(std::string name, FileFormat &format) {
+    if (name == "CF32" || name == "cf32_le") {
+        format = FILE_FORMAT_CF32;
+    } else if (name == "CS16" || name == "ci16_le") {
+        format = FILE_FORMAT_CS16;
+    } else if (name == "CS8" || name == "ci8" || name == "ci8_le") {
+        format = FILE_FORMAT_CS8;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::string SDRFileDevice::formatName(FileFormat format) {
+    return (format == FILE_FORMAT_CF32)?SOAPY_SDR_CF32:((format == FILE_FORMAT_CS16)?SOAPY_SDR_CS16:SOAPY_SDR_CS8);
+}
+
+bool SDRFileDevice::describeFile(std::string fileName, const SoapySDR::Kwargs &args, SoapySDR::Kwargs &dev) {
+    std::ifstream dataFile(fileName.c_str(), std::ios::in | std::ios::binary);
+    if (!dataFile.is_open()) {
+        return false;
+    }
+    dataFile.close();
+
+    dev = args;
+    dev["driver"] = SDR_FILE_DEVICE_DRIVER;
+    dev["file"] = fileName;
+
+    // explicit arguments win over the SigMF sidecar, which wins over the file extension
+    std::string format = args.count("format")?args.at("format"):"";
+    std::string rate = args.count("rate")?args.at("rate"):"";
+    std::string freq = args.count("freq")?args.at("freq"):"";
+
+    if (endsWith(fileName, ".sigmf-data")) {
+        std::ifstream metaFile((fileName.substr(0, fileName.length() - 4) + "meta").c_str());
+        if (metaFile.is_open()) {
+            std::stringstream meta;
+            meta << metaFile.rdbuf();
+            if (format == "") {
+                format = sigmfValue(meta.str(), "core:datatype");
+            }
+            if (rate == "") {
+                rate = sigmfValue(meta.str(), "core:sample_rate");
+            }
+            if (freq == "") {
+                freq = sigmfValue(meta.str(), "core:frequency");
+            }
+        }
+    }
+
+    if (format == "") {
+        if (endsWith(fileName, ".cs16")) {
+            format = "CS16";
+        } else if (endsWith(fileName, ".cs8")) {
+            format = "CS8";
+        } else {
+            format = "CF32";
+        }
+    }
+
+    FileFormat fileFormat;
+    if (!parseFormat(format, fileFormat)) {
+        std::cout << "cubicfile: unsupported sample format '" << format << "' for " << fileName << std::endl;
+        return false;
+    }
+
+    dev["format"] = formatName(fileFormat);
+    dev["rate"] = (rate != "")?rate:std::to_string(SDR_FILE_DEVICE_DEFAULT_RATE);
+    if (freq != "") {
+        dev["freq"] = freq;
+    }
+
+    size_t sep = fileName.find_last_of("/\\");
+    dev["label"] = "File: " + ((sep == std::string::npos)?fileName:fileName.substr(sep + 1));
+
+    return true;
+}
+
+std::vector<SoapySDR::Kwargs> SDRFileDevice::findDevices(const SoapySDR::Kwargs &args) {
+    std::vector<SoapySDR::Kwargs> results;
+    SoapySDR::Kwargs dev;
+
+    if (args.count("file")) {
+        if (describeFile(args.at("file"), args, dev)) {
+            results.push_back(dev);
+        }
+        return results;
+    }
+
+    std::string path;
+    {
+        std::lock_guard < std::mutex > lock(search_busy);
+        path = searchPath;
+    }
+    if (path == "") {
+        return results;
+    }
+
+    std::vector<std::string> recordings;
+#ifdef _WIN32
+    WIN32_FIND_DATAA findData;
+    HANDLE findHandle = FindFirstFileA((path + "\\*.sigmf-data").c_str(), &findData);
+    if (findHandle != INVALID_HANDLE_VALUE) {
+        do {
+            recordings.push_back(path + "\\" + findData.cFileName);
+        } while (FindNextFileA(findHandle, &findData));
+        FindClose(findHandle);
+    }
+#else
+    DIR *dir = opendir(path.c_str());
+    if (dir) {
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            if (endsWith(entry->d_name, ".sigmf-data")) {
+                recordings.push_back(path + "/" + entry->d_name);
+            }
+        }
+        closedir(dir);
+    }
+#endif
+
+    for (std::vector<std::string>::iterator i = recordings.begin(); i != recordings.end(); i++) {
+        if (describeFile(*i, args, dev)) {
+            results.push_back(dev);
+        }
+    }
+
+    return results;
+}
+
+SoapySDR::Device *SDRFileDevice::makeDevice(const SoapySDR::Kwargs &args) {
+    return new SDRFileDevice(args);
+}
+
+bool SDRFileDevice::mapFile(std::string fileName) {
+#ifdef _WIN32
+    fileHandle = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(fileHandle, &size) || size.QuadPart == 0) {
+        unmapFile();
+        return false;
+    }
+    fileBytes = size.QuadPart;
+    mapHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapHandle) {
+        unmapFile();
+        return false;
+    }
+    fileData = (const char *)MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0);
+#else
+    fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        unmapFile();
+        return false;
+    }
+    fileBytes = st.st_size;
+    void *addr = mmap(nullptr, fileBytes, PROT_READ, MAP_SHARED, fd, 0);
+    fileData = (addr == MAP_FAILED)?nullptr:(const char *)addr;
+    if (fileData) {
+        madvise((void *)fileData, fileBytes, MADV_SEQUENTIAL);
+    }
+#endif
+    if (!fileData) {
+        unmapFile();
+        return false;
+    }
+
+    numElems = fileBytes / elemBytes;
+    return numElems > 0;
+}
+
+void SDRFileDevice::unmapFile() {
+#ifdef _WIN32
+    if (fileData) {
+        UnmapViewOfFile(fileData);
+    }
+    if (mapHandle) {
+        CloseHandle(mapHandle);
+        mapHandle = nullptr;
+    }
+    if (fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(fileHandle);
+        fileHandle = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (fileData) {
+        munmap((void *)fileData, fileBytes);
+    }
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+#endif
+    fileData = nullptr;
+}
+
+std::string SDRFileDevice::getDriverKey(void) const {
+    return SDR_FILE_DEVICE_DRIVER;
+}
+
+std::string SDRFileDevice::getHardwareKey(void) const {
+    return "IQ File";
+}
+
+SoapySDR::Kwargs SDRFileDevice::getHardwareInfo(void) const {
+    SoapySDR::Kwargs info;
+    info["hardware"] = "IQ File";
+    info["file"] = fileName;
+    info["format"] = formatName(fileFormat);
+    return info;
+}
+
+size_t SDRFileDevice::getNumChannels(const int direction) const {
+    return (direction == SOAPY_SDR_RX)?1:0;
+}
+
+std::vector<std::string> SDRFileDevice::getStreamFormats(const int /* direction */, const size_t /* channel */) const {
+    std::vector<std::string> formats;
+    formats.push_back(formatName(fileFormat));
+    if (fileFormat != FILE_FORMAT_CF32) {
+        formats.push_back(SOAPY_SDR_CF32);
+    } else {
+        formats.push_back(SOAPY_SDR_CS16);
+    }
+    return formats;
+}
+
+std::string SDRFileDevice::getNativeStreamFormat(const int /* direction */, const size_t /* channel */, double &fullScale) const {
+    fullScale = (fileFormat == FILE_FORMAT_CF32)?1.0:((fileFormat == FILE_FORMAT_CS16)?32768.0:128.0);
+    return formatName(fileFormat);
+}
+
+SoapySDR::Stream *SDRFileDevice::setupStream(const int direction, const std::string &format, const std::vector<size_t> & /* channels */, const SoapySDR::Kwargs & /* args */) {
+    if (direction != SOAPY_SDR_RX) {
+        throw std::runtime_error("cubicfile: playback only supports RX");
+    }
+    if (format == formatName(fileFormat)) {
+        streamFormat = fileFormat;
+    } else if (format == SOAPY_SDR_CF32) {
+        streamFormat = FILE_FORMAT_CF32;
+    } else if (format == SOAPY_SDR_CS16 && fileFormat == FILE_FORMAT_CF32) {
+        streamFormat = FILE_FORMAT_CS16;
+    } else {
+        throw std::runtime_error("cubicfile: unsupported stream format " + format);
+    }
+    return (SoapySDR::Stream *)this;
+}
+
+void SDRFileDevice::closeStream(SoapySDR::Stream * /* stream */) {
+    active.store(false);
+}
+
+size_t SDRFileDevice::getStreamMTU(SoapySDR::Stream * /* stream */) const {
+    return SDR_FILE_DEVICE_MTU;
+}
+
+int SDRFileDevice::activateStream(SoapySDR::Stream * /* stream */, const int /* flags */, const long long /* timeNs */, const size_t /* numElems */) {
+    paceReset.store(true);
+    active.store(true);
+    return 0;
+}
+
+int SDRFileDevice::deactivateStream(SoapySDR::Stream * /* stream */, const int /* flags */, const long long /* timeNs */) {
+    active.store(false);
+    return 0;
+}
+
+void SDRFileDevice::resetPacing() {
+    paceStart = std::chrono::steady_clock::now();
+    paceElems = 0;
+}
+
+int SDRFileDevice::readStream(SoapySDR::Stream * /* stream */, void * const *buffs, const size_t numElemsReq, int &flags, long long &timeNs, const long timeoutUs) {
+    if (!active.load()) {
+        std::this_thread::sleep_for(std::chrono::microseconds(timeoutUs));
+        return SOAPY_SDR_TIMEOUT;
+    }
+
+    uint64_t startPos = position.load();
+    uint64_t pos = startPos;
+    if (pos >= numElems) {
+        if (!loop.load()) {
+            std::this_thread::sleep_for(std::chrono::microseconds(timeoutUs));
+            return SOAPY_SDR_TIMEOUT;
+        }
+        pos = 0;
+    }
+
+    size_t n = (numElemsReq < SDR_FILE_DEVICE_MTU)?numElemsReq:SDR_FILE_DEVICE_MTU;
+    if (!loop.load() && pos + n > numElems) {
+        n = (size_t)(numElems - pos);
+    }
+
+    if (paceReset.exchange(false)) {
+        resetPacing();
+    }
+
+    double rateScale = speed.load();
+    if (rateScale > 0) {
+        std::chrono::steady_clock::time_point due = paceStart + std::chrono::microseconds((long long)((double)paceElems * 1000000.0 / (sampleRate * rateScale)));
+        std::chrono::steady_clock::time_point limit = std::chrono::steady_clock::now() + std::chrono::microseconds(timeoutUs);
+        if (due > limit) {
+            std::this_thread::sleep_until(limit);
+            return SOAPY_SDR_TIMEOUT;
+        }
+        std::this_thread::sleep_until(due);
+    }
+
+    timeNs = (long long)((double)pos * 1000000000.0 / sampleRate);
+    flags = SOAPY_SDR_HAS_TIME;
+
+    char *out = (char *)buffs[0];
+    size_t done = 0;
+
+    while (done < n) {
+        size_t chunk = n - done;
+        if (pos + chunk > numElems) {
+            chunk = (size_t)(numElems - pos);
+        }
+        const char *src = fileData + pos * elemBytes;
+
+        if (streamFormat == fileFormat) {
+            memcpy(out + done * elemBytes, src, chunk * elemBytes);
+        } else if (streamFormat == FILE_FORMAT_CS16) {
+            iqConvertToCS16((const liquid_float_complex *)src, (int16_t *)out + done * 2, chunk, 32767.0f);
+        } else if (fileFormat == FILE_FORMAT_CS16) {
+            iqConvertCS16((const int16_t *)src, (liquid_float_complex *)out + done, chunk, 1.0f / 32768.0f);
+        } else {
+            iqConvertCS8((const int8_t *)src, (liquid_float_complex *)out + done, chunk, 1.0f / 128.0f);
+        }
+
+        done += chunk;
+        pos += chunk;
+        if (pos >= numElems && loop.load()) {
+            pos = 0;
+        }
+    }
+
+    // a seek from writeSetting() during the read takes precedence
+    position.compare_exchange_strong(startPos, pos);
+    paceElems += n;
+
+    return (int)n;
+}
+
+std::vector<std::string> SDRFileDevice::listFrequencies(const int /* direction */, const size_t /* channel */) const {
+    std::vector<std::string> names;
+    names.push_back("RF");
+    return names;
+}
+
+void SDRFileDevice::setFrequency(const int /* direction */, const size_t /* channel */, const std::string & /* name */, const double /* frequency */, const SoapySDR::Kwargs & /* args */) {
+    // the recording's center frequency is fixed; retuning only moves the display
+}
+
+double SDRFileDevice::getFrequency(const int /* direction */, const size_t /* channel */, const std::string &name) const {
+    return (name == "RF")?centerFreq:0;
+}
+
+SoapySDR::RangeList SDRFileDevice::getFrequencyRange(const int /* direction */, const size_t /* channel */, const std::string & /* name */) const {
+    SoapySDR::RangeList ranges;
+    ranges.push_back(SoapySDR::Range(0, 6000000000.0));
+    return ranges;
+}
+
+void SDRFileDevice::setSampleRate(const int /* direction */, const size_t /* channel */, const double /* rate */) {
+    // samples play at the rate they were recorded at
+}
+
+double SDRFileDevice::getSampleRate(const int /* direction */, const size_t /* channel */) const {
+    return sampleRate;
+}
+
+std::vector<double> SDRFileDevice::listSampleRates(const int /* direction */, const size_t /* channel */) const {
+    std::vector<double> rates;
+    rates.push_back(sampleRate);
+    return rates;
+}
+
+SoapySDR::ArgInfoList SDRFileDevice::getSettingInfo(void) const {
+    SoapySDR::ArgInfoList settings;
+
+    SoapySDR::ArgInfo speedArg;
+    speedArg.key = "speed";
+    speedArg.value = "1";
+    speedArg.name = "Playback Speed";
+    speedArg.description = "Multiple of the recorded sample rate; 0 plays as fast as the pipeline accepts.";
+    speedArg.type = SoapySDR::ArgInfo::FLOAT;
+    speedArg.range = SoapySDR::Range(0, 64);
+    settings.push_back(speedArg);
+
+    SoapySDR::ArgInfo loopArg;
+    loopArg.key = "loop";
+    loopArg.value = "true";
+    loopArg.name = "Loop";
+    loopArg.description = "Restart from the beginning at the end of the file.";
+    loopArg.type = SoapySDR::ArgInfo::BOOL;
+    settings.push_back(loopArg);
+
+    SoapySDR::ArgInfo positionArg;
+    positionArg.key = "position";
+    positionArg.value = "0";
+    positionArg.name = "Position";
+    positionArg.description = "Seek to this many seconds into the recording.";
+    positionArg.units = "s";
+    positionArg.type = SoapySDR::ArgInfo::FLOAT;
+    positionArg.range = SoapySDR::Range(0, (double)numElems / sampleRate);
+    settings.push_back(positionArg);
+
+    return settings;
+}
+
+void SDRFileDevice::writeSetting(const std::string &key, const std::string &value) {
+    if (key == "speed") {
+        double val = atof(value.c_str());
+        speed.store((val > 0)?val:0);
+        paceReset.store(true);
+    } else if (key == "loop") {
+        loop.store(value == "true" || value == "1");
+    } else if (key == "position") {
+        double seconds = atof(value.c_str());
+        uint64_t pos = (seconds > 0)?(uint64_t)(seconds * sampleRate):0;
+        position.store((pos < numElems)?pos:numElems - 1);
+        paceReset.store(true);
+    }
+}
+
+std::string SDRFileDevice::readSetting(const std::string &key) const {
+    if (key == "speed") {
+        return std::to_string(speed.load());
+    } else if (key == "loop") {
+        return loop.load()?"true":"false";
+    } else if (key == "position") {
+        return std::to_string((double)position.load() / sampleRate);
+    }
+    return "";
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+#include <SoapySDR/Device.hpp>
+#include <SoapySDR/Registry.hpp>
+
+#define SDR_FILE_DEVICE_DRIVER "cubicfile"
+#define SDR_FILE_DEVICE_DEFAULT_RATE 2048000
+#define SDR_FILE_DEVICE_MTU 65536
+
+/**
+ * Plays back a raw CF32/CS16/CS8 or SigMF IQ recording as an RX-only SoapySDR device.
+ * It is registered in-process under the "cubicfile" driver, so SDREnumerator lists
+ * SigMF recordings from the recording folder next to the hardware, and manual
+ * devices ("cubicfile" factory, "file=...,format=CS16,rate=...,freq=...") cover raw
+ * captures.  SDRThread reads it through the regular readStream() path.
+ *
+ * The file is memory-mapped.  Reads are paced to the sample rate times the "speed"
+ * setting (0 = as fast as possible), "loop" wraps at the end and "position" seeks,
+ * all adjustable through the device settings.
+ */
+class SDRFileDevice : public SoapySDR::Device {
+public:
+    enum FileFormat { FILE_FORMAT_CF32, FILE_FORMAT_CS16, FILE_FORMAT_CS8 };
+
+    SDRFileDevice(const SoapySDR::Kwargs &args);
+    ~SDRFileDevice();
+
+    static std::vector<SoapySDR::Kwargs> findDevices(const SoapySDR::Kwargs &args);
+    static SoapySDR::Device *makeDevice(const SoapySDR::Kwargs &args);
+    static void setSearchPath(std::string path);
+
+    std::string getDriverKey(void) const;
+    std::string getHardwareKey(void) const;
+    SoapySDR::Kwargs getHardwareInfo(void) const;
+    size_t getNumChannels(const int direction) const;
+
+    std::vector<std::string> getStreamFormats(const int direction, const size_t channel) const;
+    std::string getNativeStreamFormat(const int direction, const size_t channel, double &fullScale) const;
+    SoapySDR::Stream *setupStream(const int direction, const std::string &format, const std::vector<size_t> &channels = std::vector<size_t>(), const SoapySDR::Kwargs &args = SoapySDR::Kwargs());
+    void closeStream(SoapySDR::Stream *stream);
+    size_t getStreamMTU(SoapySDR::Stream *stream) const;
+    int activateStream(SoapySDR::Stream *stream, const int flags = 0, const long long timeNs = 0, const size_t numElems = 0);
+    int deactivateStream(SoapySDR::Stream *stream, const int flags = 0, const long long timeNs = 0);
+    int readStream(SoapySDR::Stream *stream, void * const *buffs, const size_t numElems, int &flags, long long &timeNs, const long timeoutUs = 100000);
+
+    std::vector<std::string> listFrequencies(const int direction, const size_t channel) const;
+    void setFrequency(const int direction, const size_t channel, const std::string &name, const double frequency, const SoapySDR::Kwargs &args = SoapySDR::Kwargs());
+    double getFrequency(const int direction, const size_t channel, const std::string &name) const;
+    SoapySDR::RangeList getFrequencyRange(const int direction, const size_t channel, const std::string &name) const;
+
+    void setSampleRate(const int direction, const size_t channel, const double rate);
+    double getSampleRate(const int direction, const size_t channel) const;
+    std::vector<double> listSampleRates(const int direction, const size_t channel) const;
+
+    SoapySDR::ArgInfoList getSettingInfo(void) const;
+    void writeSetting(const std::string &key, const std::string &value);
+    std::string readSetting(const std::string &key) const;
+
+private:
+    static bool describeFile(std::string fileName, const SoapySDR::Kwargs &args, SoapySDR::Kwargs &dev);
+    static bool parseFormat(std::string name, FileFormat &format);
+    static std::string formatName(FileFormat format);
+
+    bool mapFile(std::string fileName);
+    void unmapFile();
+    void resetPacing();
+
+    static std::mutex search_busy;
+    static std::string searchPath;
+
+    std::string fileName;
+    FileFormat fileFormat, streamFormat;
+    size_t elemBytes;
+    double sampleRate, centerFreq;
+
+    const char *fileData;
+    uint64_t fileBytes, numElems;
+#ifdef _WIN32
+    void *fileHandle, *mapHandle;
+#else
+    int fd;
+#endif
+
+    std::atomic<uint64_t> position;
+    std::atomic<double> speed;
+    std::atomic_bool loop, active, paceReset;
+    std::chrono::steady_clock::time_point paceStart;
+    uint64_t paceElems;
+};
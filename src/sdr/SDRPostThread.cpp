@@ -9,6 +9,7 @@ SDRPostThread::SDRPostThread() : IOThread(), buffers("SDRPostThreadBuffers"), vi
     iqDataInQueue = NULL;
     iqDataOutQueue = NULL;
     iqVisualQueue = NULL;
+    iqRecordQueue = NULL;
 
     numChannels = 0;
     channelizer = NULL;
@@ -20,6 +21,7 @@ SDRPostThread::SDRPostThread() : IOThread(), buffers("SDRPostThreadBuffers"), vi
     visBandwidth.store(0);
     
     doRefresh.store(false);
+    iqRecording.store(false);
     dcFilter = iirfilt_crcf_create_dc_blocker(0.0005);
 }
 
@@ -73,7 +75,6 @@ void SDRPostThread::updateActiveDemodulators() {
     
     for (demod_i = demodulators.begin(); demod_i != demodulators.end(); demod_i++) {
         DemodulatorInstance *demod = *demod_i;
-        DemodulatorThreadInputQueue *demodQueue = demod->getIQInputDataPipe();
         
         // not in range?
         if (demod->isDeltaLock()) {
@@ -92,7 +93,9 @@ void SDRPostThread::updateActiveDemodulators() {
                 DemodulatorThreadIQData *dummyDataOut = new DemodulatorThreadIQData;
                 dummyDataOut->frequency = frequency;
                 dummyDataOut->sampleRate = sampleRate;
-                demodQueue->push(dummyDataOut);
+                if (!demod->pushIQInput(dummyDataOut)) {
+                    delete dummyDataOut;
+                }
             }
             
             // follow if follow mode
@@ -123,6 +126,19 @@ void SDRPostThread::updateActiveDemodulators() {
     }
 }
 
+void SDRPostThread::updateRunChannels() {
+    if (runChannels.size() < nRunDemods) {
+        runChannels.resize(nRunDemods);
+    }
+    
+    // demodulators can retune or change bandwidth between refreshes, so read them per block
+    for (size_t i = 0; i < nRunDemods; i++) {
+        runChannels[i].owner = runDemods[i];
+        runChannels[i].frequency = runDemods[i]->getFrequency();
+        runChannels[i].bandwidth = runDemods[i]->getBandwidth();
+    }
+}
+
 void SDRPostThread::updateChannels() {
     // calculate channel center frequencies, todo: cache
     for (int i = 0; i < numChannels/2; i++) {
@@ -151,13 +167,12 @@ void SDRPostThread::setIQVisualRange(long long frequency, int bandwidth) {
     visBandwidth.store(bandwidth);
 }
 
+void SDRPostThread::setIQRecording(bool recording) {
+    iqRecording.store(recording);
+}
+
 void SDRPostThread::run() {
-#ifdef __APPLE__
-    pthread_t tID = pthread_self();  // ID of this thread
-    int priority = sched_get_priority_max( SCHED_FIFO);
-    sched_param prio = {priority}; // scheduling priority of thread
-    pthread_setschedparam(tID, SCHED_FIFO, &prio);
-#endif
+    applyThreadPolicy("post");
 
     std::cout << "SDR post-processing thread started.." << std::endl;
 
@@ -165,6 +180,7 @@ void SDRPostThread::run() {
     iqDataOutQueue = (DemodulatorThreadInputQueue*)getOutputQueue("IQDataOutput");
     iqVisualQueue = (DemodulatorThreadInputQueue*)getOutputQueue("IQVisualDataOutput");
     iqActiveDemodVisualQueue = (DemodulatorThreadInputQueue*)getOutputQueue("IQActiveDemodVisualDataOutput");
+    iqRecordQueue = (SDRThreadIQDataQueue*)getOutputQueue("IQRecordDataOutput");
 
     iqDataInQueue->set_max_num_items(0);
     
@@ -174,11 +190,27 @@ void SDRPostThread::run() {
         iqDataInQueue->pop(data_in);
         //        std::lock_guard < std::mutex > lock(data_in->m_mutex);
 
+        if (!data_in) {
+            continue;
+        }
+
+        // the recorder takes its own reference to the raw block; if it has fallen behind the block is skipped
+        if (iqRecordQueue && iqRecording.load() && data_in->data.size()) {
+            data_in->setRefCount(2);
+            if (!iqRecordQueue->push(data_in)) {
+                data_in->setRefCount(1);
+            }
+        }
+
         busy_demod.lock();
 
-        if (data_in && data_in->data.size()) {
+        if (data_in->data.size()) {
             if(data_in->numChannels > 1) {
-                runPFBCH(data_in);
+                if (wxGetApp().getConfig()->getFastChannelizer()) {
+                    runFastCH(data_in);
+                } else {
+                    runPFBCH(data_in);
+                }
             } else {
                 runSingleCH(data_in);
             }
@@ -215,7 +247,7 @@ void SDRPostThread::run() {
 void SDRPostThread::terminate() {
     terminated = true;
     SDRThreadIQData *dummy = new SDRThreadIQData;
-    iqDataInQueue->push(dummy);
+    iqDataInQueue->push_external(dummy);
 }
 
 void SDRPostThread::runSingleCH(SDRThreadIQData *data_in) {
@@ -245,10 +277,10 @@ void SDRPostThread::runSingleCH(SDRThreadIQData *data_in) {
         doRefresh.store(false);
     }
     
-    size_t refCount = nRunDemods;
-    bool doIQDataOut = (iqDataOutQueue != NULL && !iqDataOutQueue->full());
-    bool doDemodVisOut = (nRunDemods && iqActiveDemodVisualQueue != NULL && !iqActiveDemodVisualQueue->full());
-    bool doVisOut = (iqVisualQueue != NULL && !iqVisualQueue->full());
+    size_t refCount = 0;
+    bool doIQDataOut = (iqDataOutQueue != NULL && !iqDataOutQueue->full_drop());
+    bool doDemodVisOut = (nRunDemods && iqActiveDemodVisualQueue != NULL && !iqActiveDemodVisualQueue->full_drop());
+    bool doVisOut = (iqVisualQueue != NULL && !iqVisualQueue->full_drop());
     
     if (doIQDataOut) {
         refCount++;
@@ -260,11 +292,11 @@ void SDRPostThread::runSingleCH(SDRThreadIQData *data_in) {
         refCount++;
     }
     
-    if (refCount) {
+    if (refCount || nRunDemods) {
         DemodulatorThreadIQData *demodDataOut = buffers.getBuffer();
-        demodDataOut->setRefCount(refCount);
         demodDataOut->frequency = frequency;
         demodDataOut->sampleRate = sampleRate;
+        demodDataOut->captureTime = data_in->captureTime;
         
         if (demodDataOut->data.size() != dataSize) {
             if (demodDataOut->data.capacity() < dataSize) {
@@ -275,20 +307,123 @@ void SDRPostThread::runSingleCH(SDRThreadIQData *data_in) {
         
         iirfilt_crcf_execute_block(dcFilter, &data_in->data[0], dataSize, &demodDataOut->data[0]);
 
-        if (doDemodVisOut) {
-            iqActiveDemodVisualQueue->push(demodDataOut);
+        // narrow each demodulator's stream here so only decimated blocks are queued downstream
+        size_t nBatched = 0;
+        if (nRunDemods) {
+            updateRunChannels();
+            nBatched = channelBank.process(frequency, sampleRate, &demodDataOut->data[0], dataSize, runChannels, nRunDemods, demodBatchOut);
+        }
+        
+        // hold a local reference until every consumer has been handed its share
+        demodDataOut->setRefCount(refCount + (nRunDemods - nBatched) + 1);
+
+        if (doDemodVisOut && !iqActiveDemodVisualQueue->push(demodDataOut)) {
+            demodDataOut->decRefCount();
         }
         
-        if (doIQDataOut) {
-            iqDataOutQueue->push(demodDataOut);
+        if (doIQDataOut && !iqDataOutQueue->push(demodDataOut)) {
+            demodDataOut->decRefCount();
         }
 
-        if (doVisOut) {
-            iqVisualQueue->push(demodDataOut);
+        if (doVisOut && !iqVisualQueue->push(demodDataOut)) {
+            demodDataOut->decRefCount();
         }
         
         for (size_t i = 0; i < nRunDemods; i++) {
-            runDemods[i]->getIQInputDataPipe()->push(demodDataOut);
+            if (nBatched && demodBatchOut[i] != nullptr) {
+                demodBatchOut[i]->captureTime = data_in->captureTime;
+                if (!runDemods[i]->pushIQInput(demodBatchOut[i])) {
+                    demodBatchOut[i]->decRefCount();
+                }
+                demodBatchOut[i] = nullptr;
+            } else if (!runDemods[i]->pushIQInput(demodDataOut)) {
+                demodDataOut->decRefCount();
+            }
+        }
+        
+        demodDataOut->decRefCount();
+    }
+}
+
+void SDRPostThread::runFullRateOut(SDRThreadIQData *data_in) {
+    size_t dataSize = data_in->data.size();
+
+    if (iqDataOutQueue != NULL && !iqDataOutQueue->full_drop()) {
+        DemodulatorThreadIQData *iqDataOut = visualDataBuffers.getBuffer();
+        
+        bool doVis = false;
+        
+        if (iqVisualQueue != NULL && !iqVisualQueue->full_drop()) {
+            doVis = true;
+        }
+        
+        iqDataOut->setRefCount(1 + (doVis?1:0));
+        
+        iqDataOut->frequency = data_in->frequency;
+        iqDataOut->sampleRate = data_in->sampleRate;
+        iqDataOut->captureTime = data_in->captureTime;
+        iqDataOut->data.assign(data_in->data.begin(), data_in->data.begin() + dataSize);
+        
+        if (!iqDataOutQueue->push(iqDataOut)) {
+            iqDataOut->decRefCount();
+        }
+        if (doVis && !iqVisualQueue->push(iqDataOut)) {
+            iqDataOut->decRefCount();
+        }
+    }
+}
+
+void SDRPostThread::runFastCH(SDRThreadIQData *data_in) {
+    if (sampleRate != data_in->sampleRate) {
+        sampleRate = data_in->sampleRate;
+        doRefresh.store(true);
+    }
+    // makes runPFBCH() rebuild its filterbank if the mode is switched back
+    numChannels = 0;
+
+    size_t dataSize = data_in->data.size();
+
+    runFullRateOut(data_in);
+
+    if (frequency != data_in->frequency) {
+        frequency = data_in->frequency;
+        doRefresh.store(true);
+    }
+    
+    if (doRefresh.load()) {
+        updateActiveDemodulators();
+        doRefresh.store(false);
+    }
+    
+    if (!nRunDemods) {
+        fastChannelizer.clear();
+        return;
+    }
+    
+    DemodulatorInstance *activeDemod = wxGetApp().getDemodMgr().getLastActiveDemodulator();
+
+    // one forward FFT for the block, then a small inverse FFT per demodulator at its own rate
+    updateRunChannels();
+    fastChannelizer.process(frequency, sampleRate, &data_in->data[0], dataSize, runChannels, nRunDemods, demodBatchOut);
+    
+    for (size_t i = 0; i < nRunDemods; i++) {
+        DemodulatorThreadIQData *demodDataOut = demodBatchOut[i];
+        
+        if (demodDataOut == nullptr) {
+            continue;
+        }
+        demodBatchOut[i] = nullptr;
+        demodDataOut->captureTime = data_in->captureTime;
+        
+        if (runDemods[i] == activeDemod && iqActiveDemodVisualQueue != NULL && !iqActiveDemodVisualQueue->full_drop()) {
+            demodDataOut->setRefCount(2);
+            if (!iqActiveDemodVisualQueue->push(demodDataOut)) {
+                demodDataOut->decRefCount();
+            }
+        }
+        
+        if (!runDemods[i]->pushIQInput(demodDataOut)) {
+            demodDataOut->decRefCount();
         }
     }
 }
@@ -311,26 +446,7 @@ void SDRPostThread::runPFBCH(SDRThreadIQData *data_in) {
         dataOut.resize(outSize);
     }
     
-    if (iqDataOutQueue != NULL && !iqDataOutQueue->full()) {
-        DemodulatorThreadIQData *iqDataOut = visualDataBuffers.getBuffer();
-        
-        bool doVis = false;
-        
-        if (iqVisualQueue != NULL && !iqVisualQueue->full()) {
-            doVis = true;
-        }
-        
-        iqDataOut->setRefCount(1 + (doVis?1:0));
-        
-        iqDataOut->frequency = data_in->frequency;
-        iqDataOut->sampleRate = data_in->sampleRate;
-        iqDataOut->data.assign(data_in->data.begin(), data_in->data.begin() + dataSize);
-        
-        iqDataOutQueue->push(iqDataOut);
-        if (doVis) {
-            iqVisualQueue->push(iqDataOut);
-        }
-    }
+    runFullRateOut(data_in);
     
     if (frequency != data_in->frequency) {
         frequency = data_in->frequency;
@@ -377,7 +493,7 @@ void SDRPostThread::runPFBCH(SDRThreadIQData *data_in) {
         
         // Run channels
         for (int i = 0; i < numChannels+1; i++) {
-            int doDemodVis = ((activeDemodChannel == i) && (iqActiveDemodVisualQueue != NULL) && !iqActiveDemodVisualQueue->full())?1:0;
+            int doDemodVis = ((activeDemodChannel == i) && (iqActiveDemodVisualQueue != NULL) && !iqActiveDemodVisualQueue->full_drop())?1:0;
             
             if (!doDemodVis && demodChannelActive[i] == 0) {
                 continue;
@@ -387,6 +503,7 @@ void SDRPostThread::runPFBCH(SDRThreadIQData *data_in) {
             demodDataOut->setRefCount(demodChannelActive[i] + doDemodVis);
             demodDataOut->frequency = chanCenters[i];
             demodDataOut->sampleRate = chanBw;
+            demodDataOut->captureTime = data_in->captureTime;
             
             // Calculate channel buffer size
             size_t chanDataSize = (outSize/numChannels);
@@ -423,14 +540,16 @@ void SDRPostThread::runPFBCH(SDRThreadIQData *data_in) {
                 }
             }
             
-            if (doDemodVis) {
-                iqActiveDemodVisualQueue->push(demodDataOut);
+            if (doDemodVis && !iqActiveDemodVisualQueue->push(demodDataOut)) {
+                demodDataOut->decRefCount();
             }
             
             for (size_t j = 0; j < nRunDemods; j++) {
                 if (demodChannel[j] == i) {
                     DemodulatorInstance *demod = runDemods[j];
-                    demod->getIQInputDataPipe()->push(demodDataOut);
+                    if (!demod->pushIQInput(demodDataOut)) {
+                        demodDataOut->decRefCount();
+                    }
                 }
             }
         }
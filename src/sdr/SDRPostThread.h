@@ -5,6 +5,8 @@
 #else
 #include "SoapySDRThread.h"
 #endif
+#include "SDRChannelBank.h"
+#include "SDRFastChannelizer.h"
 #include <algorithm>
 
 class SDRPostThread : public IOThread {
@@ -20,20 +22,25 @@ public:
 
     void runSingleCH(SDRThreadIQData *data_in);
     void runPFBCH(SDRThreadIQData *data_in);
+    void runFastCH(SDRThreadIQData *data_in);
     void setIQVisualRange(long long frequency, int bandwidth);
+    void setIQRecording(bool recording);
         
 protected:
     SDRThreadIQDataQueue *iqDataInQueue;
     DemodulatorThreadInputQueue *iqDataOutQueue;
     DemodulatorThreadInputQueue *iqVisualQueue;
     DemodulatorThreadInputQueue *iqActiveDemodVisualQueue;
+    SDRThreadIQDataQueue *iqRecordQueue;
     
     std::mutex busy_demod;
     std::vector<DemodulatorInstance *> demodulators;
 
 private:
     void initPFBChannelizer();
+    void runFullRateOut(SDRThreadIQData *data_in);
     void updateActiveDemodulators();
+    void updateRunChannels();
     void updateChannels();
     int getChannelAt(long long frequency);
 
@@ -45,11 +52,16 @@ private:
     
     size_t nRunDemods;
     std::vector<DemodulatorInstance *> runDemods;
+    std::vector<DemodulatorChannelSpec> runChannels;
     std::vector<int> demodChannel;
     std::vector<int> demodChannelActive;
+    SDRChannelBank channelBank;
+    SDRFastChannelizer fastChannelizer;
+    std::vector<DemodulatorThreadIQData *> demodBatchOut;
 
     ReBuffer<DemodulatorThreadIQData> visualDataBuffers;
     atomic_bool doRefresh;
+    atomic_bool iqRecording;
     atomic_llong visFrequency;
     atomic_int visBandwidth;
     int numChannels, sampleRate;
@@ -2,7 +2,10 @@
 #include "CubicSDRDefs.h"
 #include <vector>
 #include "CubicSDR.h"
+#include "IQConvert.h"
+#include "PipelineStats.h"
 #include <string>
+#include <algorithm>
 #include <SoapySDR/Logger.h>
 
 
@@ -37,6 +40,15 @@ SDRThread::SDRThread() : IOThread(), buffers("SDRThreadBuffers") {
     frequency_locked.store(false);
     lock_freq.store(0);
     iq_swap.store(false);
+
+    streamFormat = SOAPY_SDR_CF32;
+    streamFormatId = SDR_STREAM_CF32;
+    streamScale = 1.0f;
+    streamElemBytes = 8;
+    useDirectAccess = false;
+    directHandle = 0;
+    directElems = 0;
+    directOffset = 0;
 }
 
 SDRThread::~SDRThread() {
@@ -77,12 +89,13 @@ void SDRThread::init() {
     device = devInfo->getSoapyDevice();
     
     SoapySDR::Kwargs currentStreamArgs = combineArgs(devInfo->getStreamArgs(),streamArgs);
-    stream = device->setupStream(SOAPY_SDR_RX,"CF32", std::vector<size_t>(), currentStreamArgs);
+    selectStreamFormat();
+    stream = device->setupStream(SOAPY_SDR_RX, streamFormat, std::vector<size_t>(), currentStreamArgs);
     
     int streamMTU = device->getStreamMTU(stream);
     mtuElems.store(streamMTU);
     
-    std::cout << "Stream MTU: " << mtuElems.load() << std::endl << std::flush;
+    std::cout << "Stream MTU: " << mtuElems.load() << ", format: " << streamFormat << std::endl << std::flush;
     
     deviceInfo.load()->setStreamArgs(currentStreamArgs);
     deviceConfig.load()->setStreamOpts(currentStreamArgs);
@@ -112,11 +125,12 @@ void SDRThread::init() {
     if (!mtuElems.load()) {
         mtuElems.store(numElems.load());
     }
-    inpBuffer.data.resize(numElems.load());
-    overflowBuffer.data.resize(mtuElems.load());
     
-    buffs[0] = malloc(mtuElems.load() * 4 * sizeof(float));
-    numOverflow = 0;
+    useDirectAccess = (device->getNumDirectAccessBuffers(stream) > 0);
+    directElems = 0;
+    if (useDirectAccess) {
+        std::cout << "Stream supports direct buffer access." << std::endl << std::flush;
+    }
     
     SoapySDR::ArgInfoList settingsInfo = device->getSettingInfo();
     SoapySDR::ArgInfoList::const_iterator settings_i;
@@ -147,9 +161,87 @@ void SDRThread::init() {
 }
 
 void SDRThread::deinit() {
+    if (directElems) {
+        device->releaseReadBuffer(stream, directHandle);
+        directElems = 0;
+    }
     device->deactivateStream(stream);
     device->closeStream(stream);
-    free(buffs[0]);
+}
+
+void SDRThread::selectStreamFormat() {
+    std::string requested = deviceConfig.load()->getStreamFormat();
+    std::vector<std::string> formats = device->getStreamFormats(SOAPY_SDR_RX, 0);
+    double fullScale = 0;
+    std::string native = device->getNativeStreamFormat(SOAPY_SDR_RX, 0, fullScale);
+    
+    // prefer the wire format so the driver doesn't inflate it to floats for us
+    std::string format = (requested != "")?requested:native;
+    
+    if (format != SOAPY_SDR_CS16 && format != SOAPY_SDR_CS8) {
+        format = SOAPY_SDR_CF32;
+    }
+    if (format != SOAPY_SDR_CF32 && std::find(formats.begin(), formats.end(), format) == formats.end()) {
+        std::cout << "Stream format " << format << " not offered by device, using " << SOAPY_SDR_CF32 << std::endl;
+        format = SOAPY_SDR_CF32;
+    }
+    if (format != native || fullScale <= 0) {
+        fullScale = (format == SOAPY_SDR_CS16)?32768.0:((format == SOAPY_SDR_CS8)?128.0:1.0);
+    }
+    
+    streamFormat = format;
+    streamScale = (float)(1.0 / fullScale);
+    
+    if (format == SOAPY_SDR_CS16) {
+        streamFormatId = SDR_STREAM_CS16;
+        streamElemBytes = 2 * sizeof(int16_t);
+    } else if (format == SOAPY_SDR_CS8) {
+        streamFormatId = SDR_STREAM_CS8;
+        streamElemBytes = 2 * sizeof(int8_t);
+    } else {
+        streamFormatId = SDR_STREAM_CF32;
+        streamElemBytes = 2 * sizeof(float);
+    }
+}
+
+void SDRThread::convertStream(const void *src, liquid_float_complex *dest, int numElems) {
+    switch (streamFormatId) {
+    case SDR_STREAM_CS16:
+        iqConvertCS16((const int16_t *)src, dest, numElems, streamScale);
+        break;
+    case SDR_STREAM_CS8:
+        iqConvertCS8((const int8_t *)src, dest, numElems, streamScale);
+        break;
+    default:
+        memcpy(dest, src, numElems * sizeof(float) * 2);
+        break;
+    }
+}
+
+int SDRThread::readDirect(liquid_float_complex *dest, int numElems, int &flags, long long &timeNs) {
+    if (!directElems) {
+        int n_acquired = device->acquireReadBuffer(stream, directHandle, directBuffs, flags, timeNs);
+        if (n_acquired <= 0) {
+            return n_acquired;
+        }
+        directElems = n_acquired;
+        directOffset = 0;
+    }
+    
+    int n_copy = directElems - directOffset;
+    if (n_copy > numElems) {
+        n_copy = numElems;
+    }
+    
+    convertStream(((const char *)directBuffs[0]) + (size_t)directOffset * streamElemBytes, dest, n_copy);
+    directOffset += n_copy;
+    
+    if (directOffset == directElems) {
+        device->releaseReadBuffer(stream, directHandle);
+        directElems = 0;
+    }
+    
+    return n_copy;
 }
 
 void SDRThread::readStream(SDRThreadIQDataQueue* iqDataOutQueue) {
@@ -160,32 +252,36 @@ void SDRThread::readStream(SDRThreadIQDataQueue* iqDataOutQueue) {
     int nElems = numElems.load();
     int mtElems = mtuElems.load();
 
-    if (numOverflow > 0) {
-        int n_overflow = numOverflow;
-        if (n_overflow > nElems) {
-            n_overflow = nElems;
-        }
-        memcpy(&inpBuffer.data[0], &overflowBuffer.data[0], n_overflow * sizeof(float) * 2);
-        n_read = n_overflow;
-        numOverflow -= n_overflow;
-        
-        if (numOverflow) { // still some left..
-            memmove(&overflowBuffer.data[0], &overflowBuffer.data[n_overflow], numOverflow * sizeof(float) * 2);
-        }
+    // read straight into the pooled output buffer; integer formats land in a small staging buffer first
+    SDRThreadIQData *dataOut = buffers.getBuffer();
+    if (dataOut->data.size() != (size_t)nElems) {
+        dataOut->data.resize(nElems);
+    }
+    if (streamFormatId != SDR_STREAM_CF32 && rawBuffer.size() < (size_t)mtElems * streamElemBytes) {
+        rawBuffer.resize((size_t)mtElems * streamElemBytes);
     }
     
     while (n_read < nElems && !terminated) {
         int n_requested = nElems-n_read;
-        int n_stream_read = device->readStream(stream, buffs, mtElems, flags, timeNs);
-        if ((n_read + n_stream_read) > nElems) {
-            memcpy(&inpBuffer.data[n_read], buffs[0], n_requested * sizeof(float) * 2);
-            numOverflow = n_stream_read-n_requested;
-            liquid_float_complex **pp = (liquid_float_complex **)buffs[0];
-            pp += n_requested;
-            memcpy(&overflowBuffer.data[0], pp, numOverflow * sizeof(float) * 2);
-            n_read += n_requested;
-        } else if (n_stream_read > 0) {
-            memcpy(&inpBuffer.data[n_read], buffs[0], n_stream_read * sizeof(float) * 2);
+        if (n_requested > mtElems) {
+            n_requested = mtElems;
+        }
+        
+        int n_stream_read;
+        if (useDirectAccess) {
+            n_stream_read = readDirect(&dataOut->data[n_read], n_requested, flags, timeNs);
+        } else if (streamFormatId == SDR_STREAM_CF32) {
+            buffs[0] = &dataOut->data[n_read];
+            n_stream_read = device->readStream(stream, buffs, n_requested, flags, timeNs);
+        } else {
+            buffs[0] = &rawBuffer[0];
+            n_stream_read = device->readStream(stream, buffs, n_requested, flags, timeNs);
+            if (n_stream_read > 0) {
+                convertStream(&rawBuffer[0], &dataOut->data[n_read], n_stream_read);
+            }
+        }
+        
+        if (n_stream_read > 0) {
             n_read += n_stream_read;
         } else {
             break;
@@ -193,25 +289,26 @@ void SDRThread::readStream(SDRThreadIQDataQueue* iqDataOutQueue) {
     }
     
     if (n_read > 0 && !terminated) {
-        SDRThreadIQData *dataOut = buffers.getBuffer();
+        if (n_read != nElems) {
+            dataOut->data.resize(n_read);
+        }
 
         if (iq_swap.load()) {
-            dataOut->data.resize(n_read);
-            for (int i = 0; i < n_read; i++) {
-                dataOut->data[i].imag = inpBuffer.data[i].real;
-                dataOut->data[i].real = inpBuffer.data[i].imag;
-            }
-        } else {
-            dataOut->data.assign(inpBuffer.data.begin(), inpBuffer.data.begin()+n_read);
+            iqSwap(&dataOut->data[0], n_read);
         }
         
         dataOut->setRefCount(1);
         dataOut->frequency = frequency.load();
         dataOut->sampleRate = sampleRate.load();
+        dataOut->captureTime = PipelineStats::now();
         dataOut->dcCorrected = hasHardwareDC.load();
         dataOut->numChannels = numChannels.load();
         
-        iqDataOutQueue->push(dataOut);
+        if (!iqDataOutQueue->push(dataOut)) {
+            dataOut->setRefCount(0);
+        }
+    } else {
+        buffers.returnBuffer(dataOut);
     }
 }
 
@@ -268,11 +365,6 @@ void SDRThread::updateSettings() {
         if (!mtuElems.load()) {
             mtuElems.store(numElems.load());
         }
-        inpBuffer.data.resize(numElems.load());
-        overflowBuffer.data.resize(mtuElems.load());
-        free(buffs[0]);
-        buffs[0] = malloc(mtuElems.load() * 4 * sizeof(float));
-        numOverflow = 0;
         rate_changed.store(false);
         doUpdate = true;
     }
@@ -342,12 +434,7 @@ void SDRThread::updateSettings() {
 }
 
 void SDRThread::run() {
-//#ifdef __APPLE__
-//    pthread_t tID = pthread_self();  // ID of this thread
-//    int priority = sched_get_priority_max( SCHED_FIFO);
-//    sched_param prio = { priority }; // scheduling priority of thread
-//    pthread_setschedparam(tID, SCHED_FIFO, &prio);
-//#endif
+    applyThreadPolicy("sdr");
 
     std::cout << "SDR thread starting." << std::endl;
     terminated.store(false);
@@ -508,6 +595,13 @@ float SDRThread::getGain(std::string name) {
 	return val;
 }
 
+std::map<std::string, float> SDRThread::getGains() {
+	gain_busy.lock();
+	std::map<std::string, float> gains = gainValues;
+	gain_busy.unlock();
+	return gains;
+}
+
 void SDRThread::writeSetting(std::string name, std::string value) {
     setting_busy.lock();
     settings[name] = value;
@@ -11,6 +11,7 @@
 #include <SoapySDR/Modules.hpp>
 #include <SoapySDR/Registry.hpp>
 #include <SoapySDR/Device.hpp>
+#include <SoapySDR/Formats.h>
 
 
 class SDRThreadIQData: public ReferenceCounter {
@@ -19,15 +20,16 @@ public:
     long long sampleRate;
     bool dcCorrected;
     int numChannels;
+    long long captureTime;
     std::vector<liquid_float_complex> data;
 
     SDRThreadIQData() :
-            frequency(0), sampleRate(DEFAULT_SAMPLE_RATE), dcCorrected(true), numChannels(0) {
+            frequency(0), sampleRate(DEFAULT_SAMPLE_RATE), dcCorrected(true), numChannels(0), captureTime(0) {
 
     }
 
     SDRThreadIQData(long long bandwidth, long long frequency, std::vector<signed char> * /* data */) :
-            frequency(frequency), sampleRate(bandwidth) {
+            frequency(frequency), sampleRate(bandwidth), captureTime(0) {
 
     }
 
@@ -43,12 +45,16 @@ private:
     void init();
     void deinit();
     void readStream(SDRThreadIQDataQueue* iqDataOutQueue);
+    int readDirect(liquid_float_complex *dest, int numElems, int &flags, long long &timeNs);
+    void selectStreamFormat();
+    void convertStream(const void *src, liquid_float_complex *dest, int numElems);
     void readLoop();
 
 public:
     SDRThread();
     ~SDRThread();
     enum SDRThreadState { SDR_THREAD_MESSAGE, SDR_THREAD_INITIALIZED, SDR_THREAD_TERMINATED, SDR_THREAD_FAILED };
+    enum SDRStreamFormat { SDR_STREAM_CF32, SDR_STREAM_CS16, SDR_STREAM_CS8 };
     
     void run();
 
@@ -81,6 +87,7 @@ public:
 
     void setGain(std::string name, float value);
     float getGain(std::string name);
+    std::map<std::string, float> getGains();
     
     void writeSetting(std::string name, std::string value);
     std::string readSetting(std::string name);
@@ -96,9 +103,15 @@ protected:
     SoapySDR::Device *device;
     void *buffs[1];
     ReBuffer<SDRThreadIQData> buffers;
-    SDRThreadIQData inpBuffer;
-    SDRThreadIQData overflowBuffer;
-    int numOverflow;
+    std::string streamFormat;
+    SDRStreamFormat streamFormatId;
+    float streamScale;
+    int streamElemBytes;
+    std::vector<char> rawBuffer;
+    bool useDirectAccess;
+    size_t directHandle;
+    const void *directBuffs[1];
+    int directElems, directOffset;
     std::atomic<DeviceConfig *> deviceConfig;
     std::atomic<SDRDeviceInfo *> deviceInfo;
     
@@ -0,0 +1,409 @@
+#include "DSPKernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DSPKERNELS_SSE 1
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define DSPKERNELS_AVX2 1
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define DSPKERNELS_NEON 1
+#endif
+
+void dspFirExecute(const float *taps, size_t numTaps, const float *in, float *out, size_t numOut) {
+    size_t n = 0;
+    const float *base = in + numTaps - 1;
+
+    // several outputs per pass, taps broadcast; zero taps (half-band, Hilbert) are skipped
+#if DSPKERNELS_AVX2
+    for (; n + 8 <= numOut; n += 8) {
+        __m256 acc = _mm256_setzero_ps();
+        for (size_t k = 0; k < numTaps; k++) {
+            if (taps[k] != 0) {
+                acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(taps[k]), _mm256_loadu_ps(base + n - k)));
+            }
+        }
+        _mm256_storeu_ps(out + n, acc);
+    }
+#endif
+#if DSPKERNELS_SSE
+    for (; n + 4 <= numOut; n += 4) {
+        __m128 acc = _mm_setzero_ps();
+        for (size_t k = 0; k < numTaps; k++) {
+            if (taps[k] != 0) {
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(taps[k]), _mm_loadu_ps(base + n - k)));
+            }
+        }
+        _mm_storeu_ps(out + n, acc);
+    }
+#elif DSPKERNELS_NEON
+    for (; n + 4 <= numOut; n += 4) {
+        float32x4_t acc = vdupq_n_f32(0);
+        for (size_t k = 0; k < numTaps; k++) {
+            if (taps[k] != 0) {
+                acc = vmlaq_n_f32(acc, vld1q_f32(base + n - k), taps[k]);
+            }
+        }
+        vst1q_f32(out + n, acc);
+    }
+#endif
+
+    for (; n < numOut; n++) {
+        float acc = 0;
+        for (size_t k = 0; k < numTaps; k++) {
+            acc += taps[k] * base[n - k];
+        }
+        out[n] = acc;
+    }
+}
+
+void dspShiftQuarterRate(liquid_float_complex *data, size_t numElems, int &phase, bool up) {
+    // no multiplies needed: each step of j^n swaps I/Q and flips one sign
+    int k = up?(phase & 3):((4 - (phase & 3)) & 3);
+    int step = up?1:3;
+
+    for (size_t i = 0; i < numElems; i++) {
+        float re = data[i].real, im = data[i].imag;
+        switch (k) {
+            case 0:
+                break;
+            case 1:
+                data[i].real = -im;
+                data[i].imag = re;
+                break;
+            case 2:
+                data[i].real = -re;
+                data[i].imag = -im;
+                break;
+            case 3:
+                data[i].real = im;
+                data[i].imag = -re;
+                break;
+        }
+        k = (k + step) & 3;
+    }
+
+    phase = (int)((phase + numElems) & 3);
+}
+
+// bins [0, n) of ma/maa/peak against n contiguous complex values at src
+static void spectrumAccumulateRun(const float *src, size_t n, float rate, float *ma, float *maa, float *peak, float &ceil, float &floor) {
+    size_t i = 0;
+
+#if DSPKERNELS_AVX2
+    if (n >= 8) {
+        __m256 vRate = _mm256_set1_ps(rate);
+        __m256 vCeil = _mm256_set1_ps(ceil), vFloor = _mm256_set1_ps(floor);
+        for (; i + 8 <= n; i += 8) {
+            __m256 a = _mm256_loadu_ps(src + i * 2), b = _mm256_loadu_ps(src + i * 2 + 8);
+            // shuffle within lanes leaves bins as 0,1,4,5,2,3,6,7; the 64-bit permute restores the order
+            __m256 re = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            __m256 im = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            __m256 mag = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(re, re), _mm256_mul_ps(im, im)));
+            mag = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(mag), _MM_SHUFFLE(3, 1, 2, 0)));
+
+            __m256 vMa = _mm256_loadu_ps(ma + i), vMaa = _mm256_loadu_ps(maa + i);
+            vMaa = _mm256_blendv_ps(vMaa, mag, _mm256_cmp_ps(vMaa, vMaa, _CMP_UNORD_Q));
+            vMaa = _mm256_add_ps(vMaa, _mm256_mul_ps(_mm256_sub_ps(vMa, vMaa), vRate));
+            vMa = _mm256_blendv_ps(vMa, mag, _mm256_cmp_ps(vMa, vMa, _CMP_UNORD_Q));
+            vMa = _mm256_add_ps(vMa, _mm256_mul_ps(_mm256_sub_ps(mag, vMa), vRate));
+            _mm256_storeu_ps(ma + i, vMa);
+            _mm256_storeu_ps(maa + i, vMaa);
+
+            // max/min return the second operand for a NaN bin, so NaNs never reach ceil/floor/peak
+            vCeil = _mm256_max_ps(vMaa, vCeil);
+            vFloor = _mm256_min_ps(vMaa, vFloor);
+            if (peak) {
+                _mm256_storeu_ps(peak + i, _mm256_max_ps(vMaa, _mm256_loadu_ps(peak + i)));
+            }
+        }
+        float c[8], f[8];
+        _mm256_storeu_ps(c, vCeil);
+        _mm256_storeu_ps(f, vFloor);
+        for (int k = 0; k < 8; k++) {
+            ceil = (c[k] > ceil)?c[k]:ceil;
+            floor = (f[k] < floor)?f[k]:floor;
+        }
+    }
+#endif
+#if DSPKERNELS_SSE
+    if (n - i >= 4) {
+        __m128 vRate = _mm_set1_ps(rate);
+        __m128 vCeil = _mm_set1_ps(ceil), vFloor = _mm_set1_ps(floor);
+        for (; i + 4 <= n; i += 4) {
+            __m128 a = _mm_loadu_ps(src + i * 2), b = _mm_loadu_ps(src + i * 2 + 4);
+            __m128 re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            __m128 mag = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im)));
+
+            __m128 vMa = _mm_loadu_ps(ma + i), vMaa = _mm_loadu_ps(maa + i);
+            __m128 nan = _mm_cmpunord_ps(vMaa, vMaa);
+            vMaa = _mm_or_ps(_mm_and_ps(nan, mag), _mm_andnot_ps(nan, vMaa));
+            vMaa = _mm_add_ps(vMaa, _mm_mul_ps(_mm_sub_ps(vMa, vMaa), vRate));
+            nan = _mm_cmpunord_ps(vMa, vMa);
+            vMa = _mm_or_ps(_mm_and_ps(nan, mag), _mm_andnot_ps(nan, vMa));
+            vMa = _mm_add_ps(vMa, _mm_mul_ps(_mm_sub_ps(mag, vMa), vRate));
+            _mm_storeu_ps(ma + i, vMa);
+            _mm_storeu_ps(maa + i, vMaa);
+
+            vCeil = _mm_max_ps(vMaa, vCeil);
+            vFloor = _mm_min_ps(vMaa, vFloor);
+            if (peak) {
+                _mm_storeu_ps(peak + i, _mm_max_ps(vMaa, _mm_loadu_ps(peak + i)));
+            }
+        }
+        float c[4], f[4];
+        _mm_storeu_ps(c, vCeil);
+        _mm_storeu_ps(f, vFloor);
+        for (int k = 0; k < 4; k++) {
+            ceil = (c[k] > ceil)?c[k]:ceil;
+            floor = (f[k] < floor)?f[k]:floor;
+        }
+    }
+#elif DSPKERNELS_NEON && defined(__aarch64__)
+    if (n >= 4) {
+        float32x4_t vRate = vdupq_n_f32(rate);
+        float32x4_t vCeil = vdupq_n_f32(ceil), vFloor = vdupq_n_f32(floor);
+        for (; i + 4 <= n; i += 4) {
+            float32x4x2_t c = vld2q_f32(src + i * 2);
+            float32x4_t mag = vsqrtq_f32(vmlaq_f32(vmulq_f32(c.val[0], c.val[0]), c.val[1], c.val[1]));
+
+            float32x4_t vMa = vld1q_f32(ma + i), vMaa = vld1q_f32(maa + i);
+            vMaa = vbslq_f32(vceqq_f32(vMaa, vMaa), vMaa, mag);
+            vMaa = vmlaq_f32(vMaa, vsubq_f32(vMa, vMaa), vRate);
+            vMa = vbslq_f32(vceqq_f32(vMa, vMa), vMa, mag);
+            vMa = vmlaq_f32(vMa, vsubq_f32(mag, vMa), vRate);
+            vst1q_f32(ma + i, vMa);
+            vst1q_f32(maa + i, vMaa);
+
+            // the "nm" forms ignore a NaN operand
+            vCeil = vmaxnmq_f32(vCeil, vMaa);
+            vFloor = vminnmq_f32(vFloor, vMaa);
+            if (peak) {
+                vst1q_f32(peak + i, vmaxnmq_f32(vld1q_f32(peak + i), vMaa));
+            }
+        }
+        float cv = vmaxvq_f32(vCeil), fv = vminvq_f32(vFloor);
+        ceil = (cv > ceil)?cv:ceil;
+        floor = (fv < floor)?fv:floor;
+    }
+#endif
+
+    for (; i < n; i++) {
+        float a = src[i * 2], b = src[i * 2 + 1];
+        float mag = sqrtf(a * a + b * b);
+
+        if (maa[i] != maa[i]) maa[i] = mag;
+        maa[i] += (ma[i] - maa[i]) * rate;
+        if (ma[i] != ma[i]) ma[i] = mag;
+        ma[i] += (mag - ma[i]) * rate;
+
+        if (maa[i] > ceil) {
+            ceil = maa[i];
+        }
+        if (maa[i] < floor) {
+            floor = maa[i];
+        }
+        if (peak && maa[i] > peak[i]) {
+            peak[i] = maa[i];
+        }
+    }
+}
+
+void dspSpectrumAccumulate(const float *fftOut, size_t fftSize, size_t start, size_t end, float rate,
+                           float *ma, float *maa, float *peak, float &ceil, float &floor) {
+    size_t half = fftSize / 2;
+
+    // output bins below half read the upper half of the FFT and vice versa, each a contiguous run
+    if (start < half) {
+        size_t runEnd = (end < half)?end:half;
+        spectrumAccumulateRun(fftOut + (start + half) * 2, runEnd - start, rate, ma + start, maa + start, peak?(peak + start):nullptr, ceil, floor);
+        start = runEnd;
+    }
+    if (start < end) {
+        spectrumAccumulateRun(fftOut + (start - half) * 2, end - start, rate, ma + start, maa + start, peak?(peak + start):nullptr, ceil, floor);
+    }
+}
+
+void dspWindowComplex(const liquid_float_complex *in, const float *window, float *out, size_t numElems) {
+    const float *src = (const float *)in;
+    size_t i = 0;
+
+#if DSPKERNELS_SSE
+    for (; i + 4 <= numElems; i += 4) {
+        __m128 w = _mm_loadu_ps(window + i);
+        // w0 w0 w1 w1 / w2 w2 w3 w3 to match the interleaved pairs
+        __m128 wLo = _mm_unpacklo_ps(w, w), wHi = _mm_unpackhi_ps(w, w);
+        _mm_storeu_ps(out + i * 2, _mm_mul_ps(_mm_loadu_ps(src + i * 2), wLo));
+        _mm_storeu_ps(out + i * 2 + 4, _mm_mul_ps(_mm_loadu_ps(src + i * 2 + 4), wHi));
+    }
+#elif DSPKERNELS_NEON
+    for (; i + 4 <= numElems; i += 4) {
+        float32x4x2_t c = vld2q_f32(src + i * 2);
+        float32x4_t w = vld1q_f32(window + i);
+        c.val[0] = vmulq_f32(c.val[0], w);
+        c.val[1] = vmulq_f32(c.val[1], w);
+        vst2q_f32(out + i * 2, c);
+    }
+#endif
+
+    for (; i < numElems; i++) {
+        out[i * 2] = src[i * 2] * window[i];
+        out[i * 2 + 1] = src[i * 2 + 1] * window[i];
+    }
+}
+
+void dspPowerAccumulate(const float *fftOut, float *power, size_t numElems) {
+    size_t i = 0;
+
+#if DSPKERNELS_SSE
+    for (; i + 4 <= numElems; i += 4) {
+        __m128 a = _mm_loadu_ps(fftOut + i * 2), b = _mm_loadu_ps(fftOut + i * 2 + 4);
+        __m128 re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 p = _mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im));
+        _mm_storeu_ps(power + i, _mm_add_ps(_mm_loadu_ps(power + i), p));
+    }
+#elif DSPKERNELS_NEON
+    for (; i + 4 <= numElems; i += 4) {
+        float32x4x2_t c = vld2q_f32(fftOut + i * 2);
+        float32x4_t p = vmlaq_f32(vmulq_f32(c.val[0], c.val[0]), c.val[1], c.val[1]);
+        vst1q_f32(power + i, vaddq_f32(vld1q_f32(power + i), p));
+    }
+#endif
+
+    for (; i < numElems; i++) {
+        power[i] += fftOut[i * 2] * fftOut[i * 2] + fftOut[i * 2 + 1] * fftOut[i * 2 + 1];
+    }
+}
+
+float dspSum(const float *in, size_t numElems) {
+    size_t i = 0;
+    float sum = 0;
+
+#if DSPKERNELS_AVX2
+    __m256 acc8 = _mm256_setzero_ps();
+    for (; i + 8 <= numElems; i += 8) {
+        acc8 = _mm256_add_ps(acc8, _mm256_loadu_ps(in + i));
+    }
+    __m128 acc = _mm_add_ps(_mm256_castps256_ps128(acc8), _mm256_extractf128_ps(acc8, 1));
+#elif DSPKERNELS_SSE
+    __m128 acc = _mm_setzero_ps();
+#endif
+#if DSPKERNELS_SSE
+    for (; i + 4 <= numElems; i += 4) {
+        acc = _mm_add_ps(acc, _mm_loadu_ps(in + i));
+    }
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, _MM_SHUFFLE(1, 1, 1, 1)));
+    sum = _mm_cvtss_f32(acc);
+#elif DSPKERNELS_NEON
+    float32x4_t acc = vdupq_n_f32(0);
+    for (; i + 4 <= numElems; i += 4) {
+        acc = vaddq_f32(acc, vld1q_f32(in + i));
+    }
+    float32x2_t pair = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    sum = vget_lane_f32(vpadd_f32(pair, pair), 0);
+#endif
+
+    for (; i < numElems; i++) {
+        sum += in[i];
+    }
+    return sum;
+}
+
+void dspQuantizeU8(const float *in, unsigned char *out, size_t numElems) {
+    size_t i = 0;
+
+#if DSPKERNELS_SSE
+    const __m128 zero = _mm_setzero_ps(), top = _mm_set1_ps(0.99f), scale = _mm_set1_ps(255.0f);
+    for (; i + 16 <= numElems; i += 16) {
+        __m128i q[4];
+        for (int k = 0; k < 4; k++) {
+            // max returns its second operand for NaN, so NaN clamps to zero
+            __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i + k * 4), zero), top);
+            q[k] = _mm_cvttps_epi32(_mm_mul_ps(v, scale));
+        }
+        __m128i lo = _mm_packs_epi32(q[0], q[1]), hi = _mm_packs_epi32(q[2], q[3]);
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packus_epi16(lo, hi));
+    }
+#elif DSPKERNELS_NEON
+    const float32x4_t zero = vdupq_n_f32(0.0f), top = vdupq_n_f32(0.99f), scale = vdupq_n_f32(255.0f);
+    for (; i + 8 <= numElems; i += 8) {
+        // float to unsigned conversion turns NaN into zero
+        uint32x4_t a = vcvtq_u32_f32(vmulq_f32(vminq_f32(vmaxq_f32(vld1q_f32(in + i), zero), top), scale));
+        uint32x4_t b = vcvtq_u32_f32(vmulq_f32(vminq_f32(vmaxq_f32(vld1q_f32(in + i + 4), zero), top), scale));
+        vst1_u8(out + i, vmovn_u16(vcombine_u16(vmovn_u32(a), vmovn_u32(b))));
+    }
+#endif
+
+    for (; i < numElems; i++) {
+        float v = in[i];
+        v = (v > 0)?((v < 0.99f)?v:0.99f):0;
+        out[i] = (unsigned char)(v * 255.0f);
+    }
+}
+
+void dspMixGain(const float *in, float gain, float *out, size_t numSamples) {
+    size_t i = 0;
+
+#if DSPKERNELS_SSE
+    const __m128 g = _mm_set1_ps(gain);
+    for (; i + 8 <= numSamples; i += 8) {
+        __m128 a = _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_loadu_ps(in + i), g));
+        __m128 b = _mm_add_ps(_mm_loadu_ps(out + i + 4), _mm_mul_ps(_mm_loadu_ps(in + i + 4), g));
+        _mm_storeu_ps(out + i, a);
+        _mm_storeu_ps(out + i + 4, b);
+    }
+#elif DSPKERNELS_NEON
+    for (; i + 8 <= numSamples; i += 8) {
+        vst1q_f32(out + i, vmlaq_n_f32(vld1q_f32(out + i), vld1q_f32(in + i), gain));
+        vst1q_f32(out + i + 4, vmlaq_n_f32(vld1q_f32(out + i + 4), vld1q_f32(in + i + 4), gain));
+    }
+#endif
+
+    for (; i < numSamples; i++) {
+        out[i] += in[i] * gain;
+    }
+}
+
+void dspMixGainMonoToStereo(const float *in, float gain, float *out, size_t numFrames) {
+    size_t i = 0;
+
+#if DSPKERNELS_SSE
+    const __m128 g = _mm_set1_ps(gain);
+    for (; i + 4 <= numFrames; i += 4) {
+        __m128 v = _mm_mul_ps(_mm_loadu_ps(in + i), g);
+        _mm_storeu_ps(out + i * 2, _mm_add_ps(_mm_loadu_ps(out + i * 2), _mm_unpacklo_ps(v, v)));
+        _mm_storeu_ps(out + i * 2 + 4, _mm_add_ps(_mm_loadu_ps(out + i * 2 + 4), _mm_unpackhi_ps(v, v)));
+    }
+#elif DSPKERNELS_NEON
+    for (; i + 4 <= numFrames; i += 4) {
+        float32x4_t v = vmulq_n_f32(vld1q_f32(in + i), gain);
+        float32x4x2_t lr = vld2q_f32(out + i * 2);
+        lr.val[0] = vaddq_f32(lr.val[0], v);
+        lr.val[1] = vaddq_f32(lr.val[1], v);
+        vst2q_f32(out + i * 2, lr);
+    }
+#endif
+
+    for (; i < numFrames; i++) {
+        float v = in[i] * gain;
+        out[i * 2] += v;
+        out[i * 2 + 1] += v;
+    }
+}
+
+const char *dspKernelsIsa() {
+#if DSPKERNELS_AVX2
+    return "AVX2";
+#elif DSPKERNELS_SSE
+    return "SSE2";
+#elif DSPKERNELS_NEON
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cmath>
+
+#include "liquid/liquid.h"
+
+// Real FIR over a block: out[n] = sum(taps[k] * in[n + numTaps - 1 - k]), k = 0..numTaps-1.
+// in holds numTaps - 1 samples of history followed by the numOut new samples.
+void dspFirExecute(const float *taps, size_t numTaps, const float *in, float *out, size_t numOut);
+
+// Frequency shift by +fs/4 (up) or -fs/4 (down) in place, i.e. multiply sample n by
+// (+/-j)^(phase + n); phase (0..3) is advanced so consecutive blocks stay continuous.
+void dspShiftQuarterRate(liquid_float_complex *data, size_t numElems, int &phase, bool up);
+
+// Spectrum averaging over output bins [start, end) of an fftSize-point FFT; fftOut is interleaved
+// re/im with the halves swapped on read so DC lands at fftSize / 2. Per bin, with mag = |X|:
+// maa += (ma - maa) * rate, then ma += (mag - ma) * rate, a NaN average restarting from mag.
+// peak (optional) holds the largest maa seen; ceil/floor are raised/lowered to the range's maa extremes.
+void dspSpectrumAccumulate(const float *fftOut, size_t fftSize, size_t start, size_t end, float rate,
+                           float *ma, float *maa, float *peak, float &ceil, float &floor);
+
+// out (interleaved re/im) = in * window, one real window value per complex sample.
+void dspWindowComplex(const liquid_float_complex *in, const float *window, float *out, size_t numElems);
+
+// power[n] += re^2 + im^2 of interleaved complex values, for averaging spectra across FFTs.
+void dspPowerAccumulate(const float *fftOut, float *power, size_t numElems);
+
+// Sum of in[0..numElems), for reducing a run of spectrum bins to one display point; the order of
+// the additions differs from a sequential loop, so results can differ in the last bits.
+float dspSum(const float *in, size_t numElems);
+
+// out[n] = floor(clamp(in[n], 0, 0.99) * 255), i.e. 0..1 levels to 0..252 colour indices; NaN maps to 0.
+void dspQuantizeU8(const float *in, unsigned char *out, size_t numElems);
+
+// out[n] += in[n] * gain, for mixing a stream into an interleaved output buffer of the same layout.
+void dspMixGain(const float *in, float gain, float *out, size_t numSamples);
+
+// out[2n] += in[n] * gain and out[2n + 1] += in[n] * gain, mixing a mono stream into both stereo channels.
+void dspMixGainMonoToStereo(const float *in, float gain, float *out, size_t numFrames);
+
+// Instruction set the kernels were compiled for: "AVX2" (USE_AVX2), "SSE2", "NEON" or "scalar".
+const char *dspKernelsIsa();
+
+// atan2 approximation, max error ~2e-6 rad (cubicsdr_bench --micro checks it stays under 1e-5);
+// no special handling of NaN/inf.
+inline float dspFastAtan2(float y, float x) {
+    float ax = fabsf(x), ay = fabsf(y);
+    float mx = (ax > ay)?ax:ay, mn = (ax > ay)?ay:ax;
+    if (mx == 0) {
+        return 0;
+    }
+    float a = mn / mx;
+    float s = a * a;
+    float r = (((((-0.01172120f * s + 0.05265332f) * s - 0.11643287f) * s + 0.19354346f) * s - 0.33262347f) * s + 0.99997726f) * a;
+    if (ay > ax) {
+        r = 1.57079637f - r;
+    }
+    if (x < 0) {
+        r = 3.14159274f - r;
+    }
+    return (y < 0)?-r:r;
+}
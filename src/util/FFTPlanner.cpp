@@ -0,0 +1,148 @@
+#include "FFTPlanner.h"
+
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+std::atomic_uint FFTPlanner::flags(FFTW_ESTIMATE);
+std::atomic_int FFTPlanner::threads(0);
+std::mutex FFTPlanner::planner_busy;
+
+void FFTPlanner::setLevel(std::string level) {
+    if (level == "PATIENT") {
+        flags.store(FFTW_PATIENT);
+    } else if (level == "MEASURE") {
+        flags.store(FFTW_MEASURE);
+    } else {
+        flags.store(FFTW_ESTIMATE);
+    }
+}
+
+std::string FFTPlanner::getLevel() {
+    unsigned int f = flags.load();
+    if (f == FFTW_PATIENT) {
+        return "PATIENT";
+    }
+    if (f == FFTW_MEASURE) {
+        return "MEASURE";
+    }
+    return "ESTIMATE";
+}
+
+void FFTPlanner::setThreads(int threads) {
+    FFTPlanner::threads.store(threads);
+}
+
+int FFTPlanner::getThreads() {
+    int n = threads.load();
+    if (n <= 0) {
+        n = (int)std::thread::hardware_concurrency();
+    }
+    return (n > 0)?n:1;
+}
+
+void FFTPlanner::setPlannerThreads(int nthreads) {
+#if USE_FFTW_THREADS
+    static bool threadsReady = (fftwf_init_threads() != 0);
+    if (threadsReady) {
+        fftwf_plan_with_nthreads(nthreads);
+    }
+#else
+    (void)nthreads;
+#endif
+}
+
+fftwf_plan FFTPlanner::planDft(int n, fftwf_complex *in, fftwf_complex *out, int sign, bool threaded) {
+    unsigned int level = flags.load();
+    int nthreads = (threaded && n >= FFT_PLANNER_THREADED_MIN)?getThreads():1;
+
+    std::lock_guard < std::mutex > lock(planner_busy);
+    setPlannerThreads(nthreads);
+    fftwf_set_timelimit(FFT_PLANNER_TIME_LIMIT);
+    return fftwf_plan_dft_1d(n, in, out, sign, level);
+}
+
+fftwf_plan FFTPlanner::planDftR2C(int n, float *in, fftwf_complex *out) {
+    unsigned int level = flags.load();
+
+    std::lock_guard < std::mutex > lock(planner_busy);
+    // the thread count is planner-global state; don't inherit one left by a threaded planDft()
+    setPlannerThreads(1);
+    fftwf_set_timelimit(FFT_PLANNER_TIME_LIMIT);
+    return fftwf_plan_dft_r2c_1d(n, in, out, level);
+}
+
+fftwf_plan FFTPlanner::planDftRealtime(int n, fftwf_complex *in, fftwf_complex *out, int sign) {
+    unsigned int level = flags.load();
+    fftwf_plan plan = nullptr;
+
+    std::lock_guard < std::mutex > lock(planner_busy);
+    setPlannerThreads(1);
+    if (level != FFTW_ESTIMATE) {
+        plan = fftwf_plan_dft_1d(n, in, out, sign, level | FFTW_WISDOM_ONLY);
+    }
+    if (!plan) {
+        plan = fftwf_plan_dft_1d(n, in, out, sign, FFTW_ESTIMATE);
+    }
+    return plan;
+}
+
+void FFTPlanner::destroyPlan(fftwf_plan plan) {
+    if (!plan) {
+        return;
+    }
+    std::lock_guard < std::mutex > lock(planner_busy);
+    fftwf_destroy_plan(plan);
+}
+
+std::string FFTPlanner::wisdomFile(std::string path) {
+    if (path != "" && path[path.length() - 1] != '/' && path[path.length() - 1] != '\\') {
+        path += "/";
+    }
+    return path + FFT_PLANNER_WISDOM_FILE;
+}
+
+bool FFTPlanner::loadWisdom(std::string path) {
+    std::string fileName = wisdomFile(path);
+
+    FILE *fp = fopen(fileName.c_str(), "r");
+    if (!fp) {
+        return false;
+    }
+    std::string wisdom;
+    char buf[4096];
+    size_t numRead;
+    while ((numRead = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        wisdom.append(buf, numRead);
+    }
+    fclose(fp);
+
+    bool loaded;
+    {
+        std::lock_guard < std::mutex > lock(planner_busy);
+        loaded = fftwf_import_wisdom_from_string(wisdom.c_str()) != 0;
+    }
+
+    if (!loaded) {
+        // stale or from another FFTW build, it will be replaced on exit
+        std::cout << "FFTW wisdom in '" << fileName << "' could not be imported." << std::endl;
+    }
+    return loaded;
+}
+
+bool FFTPlanner::saveWisdom(std::string path) {
+    std::string fileName = wisdomFile(path);
+
+    FILE *fp = fopen(fileName.c_str(), "w");
+    if (!fp) {
+        std::cout << "Unable to save FFTW wisdom to '" << fileName << "'." << std::endl;
+        return false;
+    }
+    {
+        std::lock_guard < std::mutex > lock(planner_busy);
+        fftwf_export_wisdom_to_file(fp);
+    }
+    bool saved = !ferror(fp);
+    fclose(fp);
+    return saved;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#include "fftw3.h"
+
+#define FFT_PLANNER_WISDOM_FILE "fftw_wisdom.dat"
+// seconds a MEASURE/PATIENT plan may spend timing candidates, i.e. the longest it holds the planner
+#define FFT_PLANNER_TIME_LIMIT 0.25
+// below this size splitting an FFT or its post-processing across threads costs more than it saves
+#define FFT_PLANNER_THREADED_MIN (1 << 18)
+
+/**
+ * Creates every FFTW plan in the application with one planner level and keeps the
+ * accumulated wisdom between runs. The FFTW planner is not thread safe, so the FFTW
+ * calls that plan, destroy plans or move wisdom go through a single lock; executing a
+ * plan and the wisdom file I/O do not.
+ *
+ * ESTIMATE plans instantly, MEASURE and PATIENT time candidate algorithms on first
+ * use of a size (for at most FFT_PLANNER_TIME_LIMIT), which is cheap once the result
+ * is in the wisdom file. Threads that must not stall on that, or whose buffers hold
+ * live data, use planDftRealtime() which never measures.
+ * Buffers passed to the plan functions should come from fftwf_malloc so the plans
+ * can use aligned SIMD code paths; MEASURE/PATIENT overwrite them while planning.
+ */
+class FFTPlanner {
+public:
+    // "ESTIMATE", "MEASURE" or "PATIENT"; unknown names fall back to ESTIMATE
+    static void setLevel(std::string level);
+    static std::string getLevel();
+
+    // threads for large FFTs and their post-processing, <= 0 picks the core count
+    static void setThreads(int threads);
+    static int getThreads();
+
+    // threaded plans need a USE_FFTW_THREADS build and n >= FFT_PLANNER_THREADED_MIN
+    static fftwf_plan planDft(int n, fftwf_complex *in, fftwf_complex *out, int sign, bool threaded = false);
+    // always single-threaded
+    static fftwf_plan planDftR2C(int n, float *in, fftwf_complex *out);
+    // wisdom at the configured level if there is any, else ESTIMATE; never measures or touches the buffers
+    static fftwf_plan planDftRealtime(int n, fftwf_complex *in, fftwf_complex *out, int sign);
+    static void destroyPlan(fftwf_plan plan);
+
+    // import/export wisdom, path is a directory; no-op if the file is missing
+    static bool loadWisdom(std::string path);
+    static bool saveWisdom(std::string path);
+
+private:
+    static std::string wisdomFile(std::string path);
+    // threads for the next plan, planner lock held
+    static void setPlannerThreads(int nthreads);
+
+    static std::atomic_uint flags;
+    static std::atomic_int threads;
+    static std::mutex planner_busy;
+};
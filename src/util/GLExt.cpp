@@ -1,12 +1,13 @@
 #include "GLExt.h"
 #include <cstring>
+#include <cstdio>
 #include <iostream>
 
 #ifdef __APPLE__
 #include <OpenGL/OpenGL.h>
 #endif
 
-#ifdef __linux__
+#if defined(__linux__) || defined(__APPLE__)
 #include <dlfcn.h>
 #endif
 
@@ -16,16 +17,101 @@ PFNWGLGETEXTENSIONSSTRINGEXTPROC wglGetExtensionsStringEXT = NULL;
 PFNWGLSWAPINTERVALEXTPROC wglSwapIntervalEXT = NULL;
 PFNWGLGETSWAPINTERVALEXTPROC wglGetSwapIntervalEXT = NULL;
 
+#endif
+
 bool GLExtSupported(const char *extension_name) {
     const GLubyte *extensions = glGetString(GL_EXTENSIONS);
 
-    return (std::strstr((const char *)extensions, extension_name) != NULL);
+    return extensions && (std::strstr((const char *)extensions, extension_name) != NULL);
 }
 
-#endif
-
+GLExtCreateShaderProc GLExt_CreateShader = NULL;
+GLExtShaderSourceProc GLExt_ShaderSource = NULL;
+GLExtCompileShaderProc GLExt_CompileShader = NULL;
+GLExtGetShaderivProc GLExt_GetShaderiv = NULL;
+GLExtGetShaderInfoLogProc GLExt_GetShaderInfoLog = NULL;
+GLExtDeleteShaderProc GLExt_DeleteShader = NULL;
+GLExtCreateProgramProc GLExt_CreateProgram = NULL;
+GLExtAttachShaderProc GLExt_AttachShader = NULL;
+GLExtLinkProgramProc GLExt_LinkProgram = NULL;
+GLExtGetProgramivProc GLExt_GetProgramiv = NULL;
+GLExtGetProgramInfoLogProc GLExt_GetProgramInfoLog = NULL;
+GLExtDeleteProgramProc GLExt_DeleteProgram = NULL;
+GLExtUseProgramProc GLExt_UseProgram = NULL;
+GLExtGetUniformLocationProc GLExt_GetUniformLocation = NULL;
+GLExtUniform1iProc GLExt_Uniform1i = NULL;
+GLExtActiveTextureProc GLExt_ActiveTexture = NULL;
+GLExtGenBuffersProc GLExt_GenBuffers = NULL;
+GLExtDeleteBuffersProc GLExt_DeleteBuffers = NULL;
+GLExtBindBufferProc GLExt_BindBuffer = NULL;
+GLExtBufferDataProc GLExt_BufferData = NULL;
+GLExtMapBufferProc GLExt_MapBuffer = NULL;
+GLExtUnmapBufferProc GLExt_UnmapBuffer = NULL;
 
 bool GLExt_initialized = false;
+bool GLExt_shaders = false;
+bool GLExt_pixelBuffers = false;
+bool GLExt_textureRG = false;
+
+static void *GLExtProcAddress(const char *name) {
+#if defined(_WIN32)
+    return (void *) wglGetProcAddress(name);
+#elif defined(__linux__)
+    return (void *) glXGetProcAddressARB((const GLubyte *) name);
+#else
+    return dlsym(RTLD_DEFAULT, name);
+#endif
+}
+
+static void initGLProgrammable() {
+    int major = 0, minor = 0;
+    const char *version = (const char *) glGetString(GL_VERSION);
+    if (!version || sscanf(version, "%d.%d", &major, &minor) != 2) {
+        std::cout << "Unable to determine OpenGL version, using fixed function waterfall." << std::endl;
+        return;
+    }
+    int glVersion = major * 10 + minor;
+
+    GLExt_CreateShader = (GLExtCreateShaderProc) GLExtProcAddress("glCreateShader");
+    GLExt_ShaderSource = (GLExtShaderSourceProc) GLExtProcAddress("glShaderSource");
+    GLExt_CompileShader = (GLExtCompileShaderProc) GLExtProcAddress("glCompileShader");
+    GLExt_GetShaderiv = (GLExtGetShaderivProc) GLExtProcAddress("glGetShaderiv");
+    GLExt_GetShaderInfoLog = (GLExtGetShaderInfoLogProc) GLExtProcAddress("glGetShaderInfoLog");
+    GLExt_DeleteShader = (GLExtDeleteShaderProc) GLExtProcAddress("glDeleteShader");
+    GLExt_CreateProgram = (GLExtCreateProgramProc) GLExtProcAddress("glCreateProgram");
+    GLExt_AttachShader = (GLExtAttachShaderProc) GLExtProcAddress("glAttachShader");
+    GLExt_LinkProgram = (GLExtLinkProgramProc) GLExtProcAddress("glLinkProgram");
+    GLExt_GetProgramiv = (GLExtGetProgramivProc) GLExtProcAddress("glGetProgramiv");
+    GLExt_GetProgramInfoLog = (GLExtGetProgramInfoLogProc) GLExtProcAddress("glGetProgramInfoLog");
+    GLExt_DeleteProgram = (GLExtDeleteProgramProc) GLExtProcAddress("glDeleteProgram");
+    GLExt_UseProgram = (GLExtUseProgramProc) GLExtProcAddress("glUseProgram");
+    GLExt_GetUniformLocation = (GLExtGetUniformLocationProc) GLExtProcAddress("glGetUniformLocation");
+    GLExt_Uniform1i = (GLExtUniform1iProc) GLExtProcAddress("glUniform1i");
+    GLExt_ActiveTexture = (GLExtActiveTextureProc) GLExtProcAddress("glActiveTexture");
+
+    GLExt_shaders = (glVersion >= 20) && GLExt_CreateShader && GLExt_ShaderSource && GLExt_CompileShader &&
+        GLExt_GetShaderiv && GLExt_GetShaderInfoLog && GLExt_DeleteShader && GLExt_CreateProgram &&
+        GLExt_AttachShader && GLExt_LinkProgram && GLExt_GetProgramiv && GLExt_GetProgramInfoLog &&
+        GLExt_DeleteProgram && GLExt_UseProgram && GLExt_GetUniformLocation && GLExt_Uniform1i &&
+        GLExt_ActiveTexture;
+
+    GLExt_GenBuffers = (GLExtGenBuffersProc) GLExtProcAddress("glGenBuffers");
+    GLExt_DeleteBuffers = (GLExtDeleteBuffersProc) GLExtProcAddress("glDeleteBuffers");
+    GLExt_BindBuffer = (GLExtBindBufferProc) GLExtProcAddress("glBindBuffer");
+    GLExt_BufferData = (GLExtBufferDataProc) GLExtProcAddress("glBufferData");
+    GLExt_MapBuffer = (GLExtMapBufferProc) GLExtProcAddress("glMapBuffer");
+    GLExt_UnmapBuffer = (GLExtUnmapBufferProc) GLExtProcAddress("glUnmapBuffer");
+
+    GLExt_pixelBuffers = (glVersion >= 21 || GLExtSupported("GL_ARB_pixel_buffer_object")) &&
+        GLExt_GenBuffers && GLExt_DeleteBuffers && GLExt_BindBuffer && GLExt_BufferData &&
+        GLExt_MapBuffer && GLExt_UnmapBuffer;
+
+    GLExt_textureRG = (glVersion >= 30 || GLExtSupported("GL_ARB_texture_rg"));
+
+    std::cout << "OpenGL " << version << ": shaders " << (GLExt_shaders?"Yes":"No")
+        << ", pixel buffers " << (GLExt_pixelBuffers?"Yes":"No")
+        << ", R8 textures " << (GLExt_textureRG?"Yes":"No") << std::endl;
+}
 
 void initGLExtensions() {
     if (GLExt_initialized) {
@@ -96,5 +182,7 @@ void initGLExtensions() {
     }
 #endif
 
+    initGLProgrammable();
+
     GLExt_initialized = true;
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "wx/glcanvas.h"
+#include <cstddef>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -14,11 +15,107 @@ extern PFNWGLGETEXTENSIONSSTRINGEXTPROC _wglGetExtensionsStringEXT;
 extern PFNWGLSWAPINTERVALEXTPROC       wglSwapIntervalEXT;
 extern PFNWGLGETSWAPINTERVALEXTPROC    wglGetSwapIntervalEXT;
 
+#endif
+
 bool GLExtSupported(const char *extension_name);
 
+// GL 2.0+ entry points for shader and pixel buffer object support; legacy
+// headers (Windows gl.h is 1.1) don't declare them so they are loaded at runtime.
+#ifdef _WIN32
+#define GLEXT_APIENTRY APIENTRY
+#else
+#define GLEXT_APIENTRY
+#endif
+
+#ifndef GL_FRAGMENT_SHADER
+#define GL_FRAGMENT_SHADER 0x8B30
+#endif
+#ifndef GL_COMPILE_STATUS
+#define GL_COMPILE_STATUS 0x8B81
+#endif
+#ifndef GL_LINK_STATUS
+#define GL_LINK_STATUS 0x8B82
+#endif
+#ifndef GL_INFO_LOG_LENGTH
+#define GL_INFO_LOG_LENGTH 0x8B84
+#endif
+#ifndef GL_TEXTURE0
+#define GL_TEXTURE0 0x84C0
 #endif
+#ifndef GL_TEXTURE1
+#define GL_TEXTURE1 0x84C1
+#endif
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW 0x88E0
+#endif
+#ifndef GL_WRITE_ONLY
+#define GL_WRITE_ONLY 0x88B9
+#endif
+#ifndef GL_R8
+#define GL_R8 0x8229
+#endif
+#ifndef GL_RED
+#define GL_RED 0x1903
+#endif
+
+typedef GLuint (GLEXT_APIENTRY *GLExtCreateShaderProc)(GLenum type);
+typedef void (GLEXT_APIENTRY *GLExtShaderSourceProc)(GLuint shader, GLsizei count, const char *const *string, const GLint *length);
+typedef void (GLEXT_APIENTRY *GLExtCompileShaderProc)(GLuint shader);
+typedef void (GLEXT_APIENTRY *GLExtGetShaderivProc)(GLuint shader, GLenum pname, GLint *params);
+typedef void (GLEXT_APIENTRY *GLExtGetShaderInfoLogProc)(GLuint shader, GLsizei bufSize, GLsizei *length, char *infoLog);
+typedef void (GLEXT_APIENTRY *GLExtDeleteShaderProc)(GLuint shader);
+typedef GLuint (GLEXT_APIENTRY *GLExtCreateProgramProc)(void);
+typedef void (GLEXT_APIENTRY *GLExtAttachShaderProc)(GLuint program, GLuint shader);
+typedef void (GLEXT_APIENTRY *GLExtLinkProgramProc)(GLuint program);
+typedef void (GLEXT_APIENTRY *GLExtGetProgramivProc)(GLuint program, GLenum pname, GLint *params);
+typedef void (GLEXT_APIENTRY *GLExtGetProgramInfoLogProc)(GLuint program, GLsizei bufSize, GLsizei *length, char *infoLog);
+typedef void (GLEXT_APIENTRY *GLExtDeleteProgramProc)(GLuint program);
+typedef void (GLEXT_APIENTRY *GLExtUseProgramProc)(GLuint program);
+typedef GLint (GLEXT_APIENTRY *GLExtGetUniformLocationProc)(GLuint program, const char *name);
+typedef void (GLEXT_APIENTRY *GLExtUniform1iProc)(GLint location, GLint v0);
+typedef void (GLEXT_APIENTRY *GLExtActiveTextureProc)(GLenum texture);
+typedef void (GLEXT_APIENTRY *GLExtGenBuffersProc)(GLsizei n, GLuint *buffers);
+typedef void (GLEXT_APIENTRY *GLExtDeleteBuffersProc)(GLsizei n, const GLuint *buffers);
+typedef void (GLEXT_APIENTRY *GLExtBindBufferProc)(GLenum target, GLuint buffer);
+typedef void (GLEXT_APIENTRY *GLExtBufferDataProc)(GLenum target, ptrdiff_t size, const void *data, GLenum usage);
+typedef void *(GLEXT_APIENTRY *GLExtMapBufferProc)(GLenum target, GLenum access);
+typedef GLboolean (GLEXT_APIENTRY *GLExtUnmapBufferProc)(GLenum target);
+
+extern GLExtCreateShaderProc GLExt_CreateShader;
+extern GLExtShaderSourceProc GLExt_ShaderSource;
+extern GLExtCompileShaderProc GLExt_CompileShader;
+extern GLExtGetShaderivProc GLExt_GetShaderiv;
+extern GLExtGetShaderInfoLogProc GLExt_GetShaderInfoLog;
+extern GLExtDeleteShaderProc GLExt_DeleteShader;
+extern GLExtCreateProgramProc GLExt_CreateProgram;
+extern GLExtAttachShaderProc GLExt_AttachShader;
+extern GLExtLinkProgramProc GLExt_LinkProgram;
+extern GLExtGetProgramivProc GLExt_GetProgramiv;
+extern GLExtGetProgramInfoLogProc GLExt_GetProgramInfoLog;
+extern GLExtDeleteProgramProc GLExt_DeleteProgram;
+extern GLExtUseProgramProc GLExt_UseProgram;
+extern GLExtGetUniformLocationProc GLExt_GetUniformLocation;
+extern GLExtUniform1iProc GLExt_Uniform1i;
+extern GLExtActiveTextureProc GLExt_ActiveTexture;
+extern GLExtGenBuffersProc GLExt_GenBuffers;
+extern GLExtDeleteBuffersProc GLExt_DeleteBuffers;
+extern GLExtBindBufferProc GLExt_BindBuffer;
+extern GLExtBufferDataProc GLExt_BufferData;
+extern GLExtMapBufferProc GLExt_MapBuffer;
+extern GLExtUnmapBufferProc GLExt_UnmapBuffer;
 
 extern bool GLExt_initialized;
 
+// set by initGLExtensions() once a context is current
+extern bool GLExt_shaders;          // GLSL 1.10 programs with texture units
+extern bool GLExt_pixelBuffers;     // pixel unpack buffer objects
+extern bool GLExt_textureRG;        // single channel GL_R8 textures
+
 void initGLExtensions();
 
@@ -0,0 +1,172 @@
+#include "IQConvert.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define IQCONVERT_SSE 1
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define IQCONVERT_AVX2 1
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define IQCONVERT_NEON 1
+#endif
+
+void iqSwap(liquid_float_complex *data, size_t numElems) {
+    float *p = (float *)data;
+    size_t i = 0;
+
+#if IQCONVERT_SSE
+    // two samples per register: [I0 Q0 I1 Q1] -> [Q0 I0 Q1 I1]
+    for (; i + 2 <= numElems; i += 2) {
+        __m128 v = _mm_loadu_ps(p + i * 2);
+        _mm_storeu_ps(p + i * 2, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    }
+#elif IQCONVERT_NEON
+    for (; i + 2 <= numElems; i += 2) {
+        float32x4_t v = vld1q_f32(p + i * 2);
+        vst1q_f32(p + i * 2, vrev64q_f32(v));
+    }
+#endif
+
+    for (; i < numElems; i++) {
+        float t = data[i].real;
+        data[i].real = data[i].imag;
+        data[i].imag = t;
+    }
+}
+
+void iqConvertCS16(const int16_t *src, liquid_float_complex *dst, size_t numElems, float scale) {
+    float *out = (float *)dst;
+    size_t n = numElems * 2;
+    size_t i = 0;
+
+#if IQCONVERT_AVX2
+    __m256 vscale = _mm256_set1_ps(scale);
+    for (; i + 16 <= n; i += 16) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i lo = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(v));
+        __m256i hi = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(v, 1));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), vscale));
+        _mm256_storeu_ps(out + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), vscale));
+    }
+#endif
+#if IQCONVERT_SSE
+    __m128 sscale = _mm_set1_ps(scale);
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        // sign-extend by placing each value in the upper half and shifting back down
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), sscale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), sscale));
+    }
+#elif IQCONVERT_NEON
+    float32x4_t nscale = vdupq_n_f32(scale);
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t v = vld1q_s16(src + i);
+        vst1q_f32(out + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), nscale));
+        vst1q_f32(out + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), nscale));
+    }
+#endif
+
+    for (; i < n; i++) {
+        out[i] = (float)src[i] * scale;
+    }
+}
+
+void iqConvertCS8(const int8_t *src, liquid_float_complex *dst, size_t numElems, float scale) {
+    float *out = (float *)dst;
+    size_t n = numElems * 2;
+    size_t i = 0;
+
+#if IQCONVERT_AVX2
+    __m256 vscale = _mm256_set1_ps(scale);
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        __m256i lo = _mm256_cvtepi8_epi32(v);
+        __m256i hi = _mm256_cvtepi8_epi32(_mm_srli_si128(v, 8));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), vscale));
+        _mm256_storeu_ps(out + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), vscale));
+    }
+#endif
+#if IQCONVERT_SSE
+    __m128 sscale = _mm_set1_ps(scale);
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i w0 = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+        __m128i w1 = _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(w0, w0), 16)), sscale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(w0, w0), 16)), sscale));
+        _mm_storeu_ps(out + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(w1, w1), 16)), sscale));
+        _mm_storeu_ps(out + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(w1, w1), 16)), sscale));
+    }
+#elif IQCONVERT_NEON
+    float32x4_t nscale = vdupq_n_f32(scale);
+    for (; i + 16 <= n; i += 16) {
+        int8x16_t v = vld1q_s8(src + i);
+        int16x8_t w0 = vmovl_s8(vget_low_s8(v));
+        int16x8_t w1 = vmovl_s8(vget_high_s8(v));
+        vst1q_f32(out + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(w0))), nscale));
+        vst1q_f32(out + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(w0))), nscale));
+        vst1q_f32(out + i + 8, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(w1))), nscale));
+        vst1q_f32(out + i + 12, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(w1))), nscale));
+    }
+#endif
+
+    for (; i < n; i++) {
+        out[i] = (float)src[i] * scale;
+    }
+}
+
+void iqConvertToCS16(const liquid_float_complex *src, int16_t *dst, size_t numElems, float scale) {
+    const float *in = (const float *)src;
+    size_t n = numElems * 2;
+    size_t i = 0;
+
+#if IQCONVERT_SSE
+    __m128 sscale = _mm_set1_ps(scale);
+    for (; i + 8 <= n; i += 8) {
+        // cvtps rounds to nearest, packs saturates to the int16 range
+        __m128i lo = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(in + i), sscale));
+        __m128i hi = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(in + i + 4), sscale));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(lo, hi));
+    }
+#elif IQCONVERT_NEON
+    float32x4_t nscale = vdupq_n_f32(scale);
+#if defined(__aarch64__)
+    for (; i + 8 <= n; i += 8) {
+        // vcvtn rounds to nearest even like cvtps/lrintf; the narrowing moves saturate to the int16 range
+        int32x4_t lo = vcvtnq_s32_f32(vmulq_f32(vld1q_f32(in + i), nscale));
+        int32x4_t hi = vcvtnq_s32_f32(vmulq_f32(vld1q_f32(in + i + 4), nscale));
+        vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+    }
+#else
+    // ARMv7 only has the truncating conversion: add +/-0.5 with the value's sign first
+    // (exact halves round away from zero instead of to even)
+    uint32x4_t signMask = vdupq_n_u32(0x80000000);
+    uint32x4_t half = vreinterpretq_u32_f32(vdupq_n_f32(0.5f));
+    for (; i + 8 <= n; i += 8) {
+        float32x4_t vlo = vmulq_f32(vld1q_f32(in + i), nscale);
+        float32x4_t vhi = vmulq_f32(vld1q_f32(in + i + 4), nscale);
+        float32x4_t rlo = vreinterpretq_f32_u32(vorrq_u32(vandq_u32(vreinterpretq_u32_f32(vlo), signMask), half));
+        float32x4_t rhi = vreinterpretq_f32_u32(vorrq_u32(vandq_u32(vreinterpretq_u32_f32(vhi), signMask), half));
+        int32x4_t lo = vcvtq_s32_f32(vaddq_f32(vlo, rlo));
+        int32x4_t hi = vcvtq_s32_f32(vaddq_f32(vhi, rhi));
+        vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+    }
+#endif
+#endif
+
+    for (; i < n; i++) {
+        float v = in[i] * scale;
+        if (v > 32767.0f) {
+            v = 32767.0f;
+        } else if (v < -32768.0f) {
+            v = -32768.0f;
+        }
+        dst[i] = (int16_t)lrintf(v);
+    }
+}
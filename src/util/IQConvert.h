@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "liquid/liquid.h"
+
+// Swap I and Q of every sample in place.
+void iqSwap(liquid_float_complex *data, size_t numElems);
+
+// Interleaved signed 16-bit IQ to float, each component multiplied by scale.
+void iqConvertCS16(const int16_t *src, liquid_float_complex *dst, size_t numElems, float scale);
+
+// Interleaved signed 8-bit IQ to float, each component multiplied by scale.
+void iqConvertCS8(const int8_t *src, liquid_float_complex *dst, size_t numElems, float scale);
+
+// Float IQ to interleaved signed 16-bit, each component multiplied by scale, rounded to nearest
+// (even on ties; away from zero on ARMv7 NEON) and saturated.
+void iqConvertToCS16(const liquid_float_complex *src, int16_t *dst, size_t numElems, float scale);
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+#define SPSC_CACHE_LINE_SIZE 64
+
+/**
+ *  A bounded single-producer / single-consumer ring queue.
+ *
+ *  push() must only ever be called from one thread and pop() from one (other) thread;
+ *  neither side takes a lock or allocates.  Producer and consumer indices live on
+ *  separate cache lines, each side keeps a private copy of the other's index so the
+ *  shared line is only touched when the cached value says the ring is full/empty.
+ *
+ *  Capacity is rounded up to the next power of two.
+ */
+template<class T>
+class SPSCQueue {
+public:
+    explicit SPSCQueue(size_t capacity) {
+        size_t cap = 2;
+        while (cap < capacity) {
+            cap <<= 1;
+        }
+        m_mask = cap - 1;
+        m_items.resize(cap);
+        m_head.store(0);
+        m_tail.store(0);
+        m_head_cache = 0;
+        m_tail_cache = 0;
+    }
+
+    /**
+     *  Pushes the item into the ring (producer thread only).
+     * \param[in] item An item.
+     * \return false if the ring is full.
+     */
+    bool push(const T& item) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+
+        if (tail - m_head_cache > m_mask) {
+            m_head_cache = m_head.load(std::memory_order_acquire);
+            if (tail - m_head_cache > m_mask) {
+                return false;
+            }
+        }
+
+        m_items[tail & m_mask] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     *  Pops the oldest item from the ring (consumer thread only).
+     * \param[out] item The item.
+     * \return false if the ring is empty.
+     */
+    bool pop(T& item) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+
+        if (head == m_tail_cache) {
+            m_tail_cache = m_tail.load(std::memory_order_acquire);
+            if (head == m_tail_cache) {
+                return false;
+            }
+        }
+
+        item = std::move(m_items[head & m_mask]);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     *  Number of items in the ring; exact when called from either endpoint, a snapshot otherwise.
+     */
+    size_t size() const {
+        size_t head = m_head.load(std::memory_order_acquire);
+        size_t tail = m_tail.load(std::memory_order_acquire);
+        return tail - head;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    size_t capacity() const {
+        return m_mask + 1;
+    }
+
+private:
+    SPSCQueue(const SPSCQueue&);
+    SPSCQueue& operator=(const SPSCQueue&);
+
+    char m_pad0[SPSC_CACHE_LINE_SIZE];
+
+    // consumer side
+    std::atomic<size_t> m_head;
+    size_t m_tail_cache;
+    char m_pad1[SPSC_CACHE_LINE_SIZE];
+
+    // producer side
+    std::atomic<size_t> m_tail;
+    size_t m_head_cache;
+    char m_pad2[SPSC_CACHE_LINE_SIZE];
+
+    size_t m_mask;
+    std::vector<T> m_items;
+};
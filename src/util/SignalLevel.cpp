@@ -0,0 +1,275 @@
+#include "SignalLevel.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIGNALLEVEL_SSE 1
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIGNALLEVEL_AVX2 1
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SIGNALLEVEL_NEON 1
+#endif
+
+#if SIGNALLEVEL_SSE
+static inline float hsum128(__m128 v) {
+    __m128 s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(s);
+}
+
+static inline float hmax128(__m128 v) {
+    __m128 m = _mm_max_ps(v, _mm_movehl_ps(v, v));
+    m = _mm_max_ss(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(m);
+}
+#endif
+
+#if SIGNALLEVEL_NEON
+static inline float hsum128(float32x4_t v) {
+    float32x2_t s = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpadd_f32(s, s), 0);
+}
+
+static inline float hmax128(float32x4_t v) {
+    float32x2_t m = vmax_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpmax_f32(m, m), 0);
+}
+#endif
+
+float signalMagnitudeMean(const liquid_float_complex *data, size_t numElems) {
+    if (!numElems) {
+        return 0;
+    }
+
+    const float *p = (const float *)data;
+    size_t n = numElems * 2;
+    size_t i = 0;
+    // vector lanes hold the estimate of each sample twice (once per I/Q slot)
+    float vecAccum = 0;
+
+#if SIGNALLEVEL_AVX2
+    {
+        __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+        __m256 alpha = _mm256_set1_ps(SIGNAL_LEVEL_ALPHA), beta = _mm256_set1_ps(SIGNAL_LEVEL_BETA);
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+        for (; i + 16 <= n; i += 16) {
+            __m256 a = _mm256_and_ps(_mm256_loadu_ps(p + i), absMask);
+            __m256 b = _mm256_and_ps(_mm256_loadu_ps(p + i + 8), absMask);
+            __m256 as = _mm256_permute_ps(a, _MM_SHUFFLE(2, 3, 0, 1));
+            __m256 bs = _mm256_permute_ps(b, _MM_SHUFFLE(2, 3, 0, 1));
+            acc0 = _mm256_add_ps(acc0, _mm256_add_ps(_mm256_mul_ps(_mm256_max_ps(a, as), alpha), _mm256_mul_ps(_mm256_min_ps(a, as), beta)));
+            acc1 = _mm256_add_ps(acc1, _mm256_add_ps(_mm256_mul_ps(_mm256_max_ps(b, bs), alpha), _mm256_mul_ps(_mm256_min_ps(b, bs), beta)));
+        }
+        __m256 acc = _mm256_add_ps(acc0, acc1);
+        vecAccum += hsum128(_mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1)));
+    }
+#endif
+#if SIGNALLEVEL_SSE
+    {
+        __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        __m128 alpha = _mm_set1_ps(SIGNAL_LEVEL_ALPHA), beta = _mm_set1_ps(SIGNAL_LEVEL_BETA);
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+        for (; i + 8 <= n; i += 8) {
+            __m128 a = _mm_and_ps(_mm_loadu_ps(p + i), absMask);
+            __m128 b = _mm_and_ps(_mm_loadu_ps(p + i + 4), absMask);
+            __m128 as = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1));
+            __m128 bs = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 3, 0, 1));
+            acc0 = _mm_add_ps(acc0, _mm_add_ps(_mm_mul_ps(_mm_max_ps(a, as), alpha), _mm_mul_ps(_mm_min_ps(a, as), beta)));
+            acc1 = _mm_add_ps(acc1, _mm_add_ps(_mm_mul_ps(_mm_max_ps(b, bs), alpha), _mm_mul_ps(_mm_min_ps(b, bs), beta)));
+        }
+        vecAccum += hsum128(_mm_add_ps(acc0, acc1));
+    }
+#elif SIGNALLEVEL_NEON
+    {
+        float32x4_t alpha = vdupq_n_f32(SIGNAL_LEVEL_ALPHA), beta = vdupq_n_f32(SIGNAL_LEVEL_BETA);
+        float32x4_t acc0 = vdupq_n_f32(0), acc1 = vdupq_n_f32(0);
+        for (; i + 8 <= n; i += 8) {
+            float32x4_t a = vabsq_f32(vld1q_f32(p + i));
+            float32x4_t b = vabsq_f32(vld1q_f32(p + i + 4));
+            float32x4_t as = vrev64q_f32(a), bs = vrev64q_f32(b);
+            acc0 = vmlaq_f32(vmlaq_f32(acc0, vmaxq_f32(a, as), alpha), vminq_f32(a, as), beta);
+            acc1 = vmlaq_f32(vmlaq_f32(acc1, vmaxq_f32(b, bs), alpha), vminq_f32(b, bs), beta);
+        }
+        vecAccum += hsum128(vaddq_f32(acc0, acc1));
+    }
+#endif
+
+    float accum = vecAccum * 0.5f;
+    for (i /= 2; i < numElems; i++) {
+        float absI = fabsf(data[i].real), absQ = fabsf(data[i].imag);
+        accum += (absI > absQ)?(SIGNAL_LEVEL_ALPHA * absI + SIGNAL_LEVEL_BETA * absQ):(SIGNAL_LEVEL_ALPHA * absQ + SIGNAL_LEVEL_BETA * absI);
+    }
+
+    return accum / float(numElems);
+}
+
+float signalPowerMean(const liquid_float_complex *data, size_t numElems) {
+    if (!numElems) {
+        return 0;
+    }
+
+    const float *p = (const float *)data;
+    size_t n = numElems * 2;
+    size_t i = 0;
+    float accum = 0;
+
+#if SIGNALLEVEL_AVX2
+    {
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+        for (; i + 16 <= n; i += 16) {
+            __m256 a = _mm256_loadu_ps(p + i), b = _mm256_loadu_ps(p + i + 8);
+            acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(a, a));
+            acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(b, b));
+        }
+        __m256 acc = _mm256_add_ps(acc0, acc1);
+        accum += hsum128(_mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1)));
+    }
+#endif
+#if SIGNALLEVEL_SSE
+    {
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+        for (; i + 8 <= n; i += 8) {
+            __m128 a = _mm_loadu_ps(p + i), b = _mm_loadu_ps(p + i + 4);
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(a, a));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(b, b));
+        }
+        accum += hsum128(_mm_add_ps(acc0, acc1));
+    }
+#elif SIGNALLEVEL_NEON
+    {
+        float32x4_t acc0 = vdupq_n_f32(0), acc1 = vdupq_n_f32(0);
+        for (; i + 8 <= n; i += 8) {
+            float32x4_t a = vld1q_f32(p + i), b = vld1q_f32(p + i + 4);
+            acc0 = vmlaq_f32(acc0, a, a);
+            acc1 = vmlaq_f32(acc1, b, b);
+        }
+        accum += hsum128(vaddq_f32(acc0, acc1));
+    }
+#endif
+
+    for (; i < n; i++) {
+        accum += p[i] * p[i];
+    }
+
+    return accum / float(numElems);
+}
+
+float signalPeakAbs(const float *data, size_t numSamples) {
+    size_t i = 0;
+    float peak = 0;
+
+#if SIGNALLEVEL_AVX2
+    {
+        __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+        __m256 m = _mm256_setzero_ps();
+        for (; i + 8 <= numSamples; i += 8) {
+            m = _mm256_max_ps(m, _mm256_and_ps(_mm256_loadu_ps(data + i), absMask));
+        }
+        peak = hmax128(_mm_max_ps(_mm256_castps256_ps128(m), _mm256_extractf128_ps(m, 1)));
+    }
+#endif
+#if SIGNALLEVEL_SSE
+    {
+        __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        __m128 m = _mm_set1_ps(peak);
+        for (; i + 4 <= numSamples; i += 4) {
+            m = _mm_max_ps(m, _mm_and_ps(_mm_loadu_ps(data + i), absMask));
+        }
+        peak = hmax128(m);
+    }
+#elif SIGNALLEVEL_NEON
+    {
+        float32x4_t m = vdupq_n_f32(0);
+        for (; i + 4 <= numSamples; i += 4) {
+            m = vmaxq_f32(m, vabsq_f32(vld1q_f32(data + i)));
+        }
+        peak = hmax128(m);
+    }
+#endif
+
+    for (; i < numSamples; i++) {
+        float v = fabsf(data[i]);
+        if (v > peak) {
+            peak = v;
+        }
+    }
+
+    return peak;
+}
+
+float signalMax(const float *data, size_t numSamples, float floor) {
+    size_t i = 0;
+    float peak = floor;
+
+#if SIGNALLEVEL_AVX2
+    {
+        __m256 m = _mm256_set1_ps(peak);
+        for (; i + 8 <= numSamples; i += 8) {
+            m = _mm256_max_ps(m, _mm256_loadu_ps(data + i));
+        }
+        peak = hmax128(_mm_max_ps(_mm256_castps256_ps128(m), _mm256_extractf128_ps(m, 1)));
+    }
+#endif
+#if SIGNALLEVEL_SSE
+    {
+        __m128 m = _mm_set1_ps(peak);
+        for (; i + 4 <= numSamples; i += 4) {
+            m = _mm_max_ps(m, _mm_loadu_ps(data + i));
+        }
+        peak = hmax128(m);
+    }
+#elif SIGNALLEVEL_NEON
+    {
+        float32x4_t m = vdupq_n_f32(peak);
+        for (; i + 4 <= numSamples; i += 4) {
+            m = vmaxq_f32(m, vld1q_f32(data + i));
+        }
+        peak = hmax128(m);
+    }
+#endif
+
+    for (; i < numSamples; i++) {
+        if (data[i] > peak) {
+            peak = data[i];
+        }
+    }
+
+    return peak;
+}
+
+void signalScale(float *data, size_t numSamples, float gain) {
+    size_t i = 0;
+
+#if SIGNALLEVEL_AVX2
+    __m256 vgain = _mm256_set1_ps(gain);
+    for (; i + 8 <= numSamples; i += 8) {
+        _mm256_storeu_ps(data + i, _mm256_mul_ps(_mm256_loadu_ps(data + i), vgain));
+    }
+#endif
+#if SIGNALLEVEL_SSE
+    __m128 sgain = _mm_set1_ps(gain);
+    for (; i + 4 <= numSamples; i += 4) {
+        _mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), sgain));
+    }
+#elif SIGNALLEVEL_NEON
+    float32x4_t ngain = vdupq_n_f32(gain);
+    for (; i + 4 <= numSamples; i += 4) {
+        vst1q_f32(data + i, vmulq_f32(vld1q_f32(data + i), ngain));
+    }
+#endif
+
+    for (; i < numSamples; i++) {
+        data[i] *= gain;
+    }
+}
+
+float signalLinearToDb(float linear) {
+    if (linear <= 1e-20f) {
+        linear = 1e-20f;
+    }
+    return 20.0f * log10f(linear);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+#include "liquid/liquid.h"
+
+// alpha max plus beta min magnitude estimator, see http://dspguru.com/dsp/tricks/magnitude-estimator
+#define SIGNAL_LEVEL_ALPHA 0.948059448969f
+#define SIGNAL_LEVEL_BETA 0.392699081699f
+
+// Mean of the estimated magnitude alpha * max(|I|, |Q|) + beta * min(|I|, |Q|) over all samples.
+float signalMagnitudeMean(const liquid_float_complex *data, size_t numElems);
+
+// Mean power I^2 + Q^2 over all samples.
+float signalPowerMean(const liquid_float_complex *data, size_t numElems);
+
+// Largest absolute value, 0 for an empty buffer.
+float signalPeakAbs(const float *data, size_t numSamples);
+
+// Largest value, or floor if every value is below it.
+float signalMax(const float *data, size_t numSamples, float floor);
+
+// Multiply every value by gain in place.
+void signalScale(float *data, size_t numSamples, float gain);
+
+// 20 * log10(linear), clamped to -400 dB for silence.
+float signalLinearToDb(float linear);
@@ -1 +1,74 @@
-#include <ThreadQueue.h>
\ No newline at end of file
+#include <ThreadQueue.h>
+
+#include <map>
+#include <algorithm>
+
+std::mutex ThreadQueueBase::registry_busy;
+std::vector<ThreadQueueBase *> ThreadQueueBase::registry;
+
+ThreadQueueBase::ThreadQueueBase() {
+    m_stat_pushed.store(0);
+    m_stat_popped.store(0);
+    m_stat_dropped.store(0);
+    m_stat_high_water.store(0);
+
+    std::lock_guard < std::mutex > lock(registry_busy);
+    registry.push_back(this);
+}
+
+ThreadQueueBase::~ThreadQueueBase() {
+    std::lock_guard < std::mutex > lock(registry_busy);
+    std::vector<ThreadQueueBase *>::iterator i = std::find(registry.begin(), registry.end(), this);
+    if (i != registry.end()) {
+        registry.erase(i);
+    }
+}
+
+void ThreadQueueBase::set_stats_name(std::string name) {
+    std::lock_guard < std::mutex > lock(m_stats_name_busy);
+    m_stats_name = name;
+}
+
+std::string ThreadQueueBase::get_stats_name() {
+    std::lock_guard < std::mutex > lock(m_stats_name_busy);
+    return m_stats_name;
+}
+
+ThreadQueueStats ThreadQueueBase::get_stats() {
+    ThreadQueueStats stats;
+    stats.name = get_stats_name();
+    stats.queues = 1;
+    stats.popped = m_stat_popped.load();
+    stats.pushed = m_stat_pushed.load();
+    stats.dropped = m_stat_dropped.load();
+    stats.depth = (stats.pushed > stats.popped)?(size_t)(stats.pushed - stats.popped):0;
+    stats.highWater = (size_t)m_stat_high_water.load();
+    return stats;
+}
+
+std::vector<ThreadQueueStats> ThreadQueueBase::get_all_stats() {
+    std::map<std::string, ThreadQueueStats> statsByName;
+
+    registry_busy.lock();
+    for (std::vector<ThreadQueueBase *>::iterator i = registry.begin(); i != registry.end(); i++) {
+        ThreadQueueStats queueStats = (*i)->get_stats();
+        if (queueStats.name.empty()) {
+            queueStats.name = "(unbound)";
+        }
+        ThreadQueueStats &nameStats = statsByName[queueStats.name];
+        nameStats.name = queueStats.name;
+        nameStats.queues += queueStats.queues;
+        nameStats.pushed += queueStats.pushed;
+        nameStats.popped += queueStats.popped;
+        nameStats.dropped += queueStats.dropped;
+        nameStats.depth += queueStats.depth;
+        nameStats.highWater = std::max(nameStats.highWater, queueStats.highWater);
+    }
+    registry_busy.unlock();
+
+    std::vector<ThreadQueueStats> result;
+    for (std::map<std::string, ThreadQueueStats>::iterator i = statsByName.begin(); i != statsByName.end(); i++) {
+        result.push_back(i->second);
+    }
+    return result;
+}
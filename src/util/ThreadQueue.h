@@ -15,12 +15,96 @@
 #include <cstdint>
 #include <condition_variable>
 #include <atomic>
+#include <string>
+#include <vector>
 
+#include "SPSCQueue.h"
+
+class ThreadQueueStats {
+public:
+    std::string name;
+    size_t queues;
+    uint64_t pushed;
+    uint64_t popped;
+    uint64_t dropped;
+    size_t depth;
+    size_t highWater;
+
+    ThreadQueueStats() : queues(0), pushed(0), popped(0), dropped(0), depth(0), highWater(0) {
+
+    }
+};
+
+/**
+ *  Untyped part of ThreadQueue: traffic counters and the registry used to read them.
+ *  Counters are relaxed atomics bumped by the producer/consumer on every push and pop;
+ *  the stats name is assigned when the queue is bound to an IOThread.
+ */
 class ThreadQueueBase {
-    
+public:
+    ThreadQueueBase();
+    virtual ~ThreadQueueBase();
+
+    void set_stats_name(std::string name);
+    std::string get_stats_name();
+
+    /*! Record an item the producer skipped without calling push(). */
+    void count_drop() {
+        m_stat_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    ThreadQueueStats get_stats();
+
+    // counters of all live queues, summed per stats name
+    static std::vector<ThreadQueueStats> get_all_stats();
+
+protected:
+    bool count_push(bool pushed) {
+        if (!pushed) {
+            m_stat_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        uint64_t depth = m_stat_pushed.fetch_add(1, std::memory_order_relaxed) + 1 - m_stat_popped.load(std::memory_order_relaxed);
+        uint64_t highWater = m_stat_high_water.load(std::memory_order_relaxed);
+        // the consumer may count its pop before we count this push; ignore the wrapped depth
+        while (depth > highWater && depth < (1ULL << 62) && !m_stat_high_water.compare_exchange_weak(highWater, depth, std::memory_order_relaxed)) { }
+        return true;
+    }
+
+    void count_flush(size_t flushed) {
+        m_stat_popped.fetch_add(flushed, std::memory_order_relaxed);
+    }
+
+    bool count_pop(bool popped) {
+        if (popped) {
+            m_stat_popped.fetch_add(1, std::memory_order_relaxed);
+        }
+        return popped;
+    }
+
+private:
+    std::mutex m_stats_name_busy;
+    std::string m_stats_name;
+    std::atomic<uint64_t> m_stat_pushed;
+    std::atomic<uint64_t> m_stat_popped;
+    std::atomic<uint64_t> m_stat_dropped;
+    std::atomic<uint64_t> m_stat_high_water;
+
+    static std::mutex registry_busy;
+    static std::vector<ThreadQueueBase *> registry;
 };
 
-/** A thread-safe asynchronous queue */
+/**
+ *  A thread-safe asynchronous queue
+ *
+ *  By default items are kept in a mutex-protected std::queue<T, Container>.  A queue constructed
+ *  with a ring capacity is instead backed by a bounded SPSCQueue: push/pop never take the mutex
+ *  or allocate, the mutex/condition is only used to park a consumer on an empty ring.  Ring mode
+ *  is meant for the one-producer/one-consumer sample pipes: push() must only be called by the
+ *  owning producer and the pops/flush() by the current consumer, with nothing but the ring's
+ *  acquire/release indices between them.  Pushes from any other thread (terminate nudges) go
+ *  through push_external() into a mutex-protected side queue that consumers drain first.
+ */
 template<class T, class Container = std::list<T>>
 class ThreadQueue : public ThreadQueueBase {
 
@@ -31,22 +115,49 @@ class ThreadQueue : public ThreadQueueBase {
 public:
 
     /*! Create safe queue. */
-    ThreadQueue() {
+    ThreadQueue() : m_ring(nullptr) {
         m_max_num_items.store(0);
+        init_ring_state();
     };
-    ThreadQueue(ThreadQueue&& sq) {
+
+    /**
+     *  Create a ring-backed queue.
+     * \param[in] ring_capacity Number of slots (rounded up to a power of two); push() fails when full.
+     */
+    explicit ThreadQueue(size_t ring_capacity) : m_ring(new SPSCQueue<T>(ring_capacity)) {
+        m_max_num_items.store(0);
+        init_ring_state();
+    }
+
+    ThreadQueue(ThreadQueue&& sq) : m_ring(sq.m_ring) {
+        sq.m_ring = nullptr;
         m_queue = std::move(sq.m_queue);
         m_max_num_items.store(0);
+        init_ring_state();
     }
-    ThreadQueue(const ThreadQueue& sq) {
+
+    /*! Copying a ring-backed queue yields an empty ring of the same capacity. */
+    ThreadQueue(const ThreadQueue& sq) : m_ring(nullptr) {
         std::lock_guard < std::mutex > lock(sq.m_mutex);
+        if (sq.m_ring) {
+            m_ring = new SPSCQueue<T>(sq.m_ring->capacity());
+        }
         m_queue = sq.m_queue;
         m_max_num_items.store(0);
+        init_ring_state();
     }
 
     /*! Destroy safe queue. */
     ~ThreadQueue() {
         std::lock_guard < std::mutex > lock(m_mutex);
+        delete m_ring;
+    }
+
+    /**
+     *  Check if this queue is backed by a lock-free ring.
+     */
+    bool is_ring() const {
+        return m_ring != nullptr;
     }
 
     /**
@@ -66,14 +177,18 @@ public:
      * \return true if an item was pushed into the queue
      */
     bool push(const value_type& item) {
+        if (m_ring) {
+            return count_push(ring_push(item));
+        }
+
         std::lock_guard < std::mutex > lock(m_mutex);
 
         if (m_max_num_items.load() > 0 && m_queue.size() > m_max_num_items.load())
-            return false;
+            return count_push(false);
 
         m_queue.push(item);
         m_condition.notify_one();
-        return true;
+        return count_push(true);
     }
 
     /**
@@ -82,14 +197,37 @@ public:
      * \return true if an item was pushed into the queue
      */
     bool push(const value_type&& item) {
+        if (m_ring) {
+            return count_push(ring_push(item));
+        }
+
         std::lock_guard < std::mutex > lock(m_mutex);
 
         if (m_max_num_items.load() > 0 && m_queue.size() > m_max_num_items.load())
-            return false;
+            return count_push(false);
 
         m_queue.push(item);
         m_condition.notify_one();
-        return true;
+        return count_push(true);
+    }
+
+    /**
+     *  Pushes the item from a thread that isn't the queue's producer, e.g. to nudge a blocked
+     *  consumer on terminate.  Ring-backed queues take it through the mutex into a side queue,
+     *  keeping the ring itself single-producer; it is never dropped for being full.
+     * \param[in] item An item.
+     */
+    void push_external(const value_type& item) {
+        if (!m_ring) {
+            push(item);
+            return;
+        }
+
+        std::lock_guard < std::mutex > lock(m_mutex);
+        m_queue.push(item);
+        m_side_count++;
+        count_push(true);
+        m_condition.notify_all();
     }
 
     /**
@@ -97,6 +235,11 @@ public:
      * \param[out] item The item.
      */
     void pop(value_type& item) {
+        if (m_ring) {
+            count_pop(ring_wait_pop(item, 0, true));
+            return;
+        }
+
         std::unique_lock < std::mutex > lock(m_mutex);
         m_condition.wait(lock, [this]() // Lambda funct
                 {
@@ -104,6 +247,7 @@ public:
                 });
         item = m_queue.front();
         m_queue.pop();
+        count_pop(true);
     }
 
     /**
@@ -113,6 +257,11 @@ public:
      * \param[out] item The item.
      */
     void move_pop(value_type& item) {
+        if (m_ring) {
+            count_pop(ring_wait_pop(item, 0, true));
+            return;
+        }
+
         std::unique_lock < std::mutex > lock(m_mutex);
         m_condition.wait(lock, [this]() // Lambda funct
                 {
@@ -120,6 +269,7 @@ public:
                 });
         item = std::move(m_queue.front());
         m_queue.pop();
+        count_pop(true);
     }
 
     /**
@@ -128,6 +278,10 @@ public:
      * \return False is returned if no item is available.
      */
     bool try_pop(value_type& item) {
+        if (m_ring) {
+            return count_pop(ring_try_pop(item, false));
+        }
+
         std::unique_lock < std::mutex > lock(m_mutex);
 
         if (m_queue.empty())
@@ -135,7 +289,7 @@ public:
 
         item = m_queue.front();
         m_queue.pop();
-        return true;
+        return count_pop(true);
     }
 
     /**
@@ -145,6 +299,10 @@ public:
      * \return False is returned if no item is available.
      */
     bool try_move_pop(value_type& item) {
+        if (m_ring) {
+            return count_pop(ring_try_pop(item, false));
+        }
+
         std::unique_lock < std::mutex > lock(m_mutex);
 
         if (m_queue.empty())
@@ -152,7 +310,35 @@ public:
 
         item = std::move(m_queue.front());
         m_queue.pop();
-        return true;
+        return count_pop(true);
+    }
+
+    /**
+     *  Tries to pop item from the queue without ever waiting: unlike try_pop() this gives up on
+     *  the mutex-protected items (the whole queue, or a ring's side queue) while another thread
+     *  holds the mutex.  For realtime consumers.
+     * \param[out] item The item.
+     * \return False is returned if no item is available right now.
+     */
+    bool try_pop_nowait(value_type& item) {
+        if (m_ring && !m_side_count.load()) {
+            return count_pop(m_ring->pop(item));
+        }
+
+        std::unique_lock < std::mutex > lock(m_mutex, std::try_to_lock);
+
+        if (!lock.owns_lock()) {
+            return m_ring ? count_pop(m_ring->pop(item)) : false;
+        }
+        if (m_ring) {
+            return count_pop(ring_try_pop(item, true));
+        }
+        if (m_queue.empty())
+            return false;
+
+        item = m_queue.front();
+        m_queue.pop();
+        return count_pop(true);
     }
 
     /**
@@ -162,6 +348,10 @@ public:
      * \return true if get an item from the queue, false if no item is received before the timeout.
      */
     bool timeout_pop(value_type& item, std::uint64_t timeout) {
+        if (m_ring) {
+            return count_pop(ring_wait_pop(item, timeout, false));
+        }
+
         std::unique_lock < std::mutex > lock(m_mutex);
 
         if (m_queue.empty()) {
@@ -174,7 +364,7 @@ public:
 
         item = m_queue.front();
         m_queue.pop();
-        return true;
+        return count_pop(true);
     }
 
     /**
@@ -186,6 +376,10 @@ public:
      * \return true if get an item from the queue, false if no item is received before the timeout.
      */
     bool timeout_move_pop(value_type& item, std::uint64_t timeout) {
+        if (m_ring) {
+            return count_pop(ring_wait_pop(item, timeout, false));
+        }
+
         std::unique_lock < std::mutex > lock(m_mutex);
 
         if (m_queue.empty()) {
@@ -198,7 +392,40 @@ public:
 
         item = std::move(m_queue.front());
         m_queue.pop();
-        return true;
+        return count_pop(true);
+    }
+
+    /**
+     *  Blocks until the queue holds an item without removing it, for at most timeout microseconds
+     *  or until wake() is called.  For consumers that process the queue through another interface.
+     * \param[in] timeout The number of microseconds to wait.
+     * \return true if the queue is not empty.
+     */
+    bool wait_not_empty(std::uint64_t timeout) {
+        std::unique_lock < std::mutex > lock(m_mutex);
+        if (m_ring) {
+            // counted before the empty check, see ring_push()
+            m_ring_waiters++;
+        }
+
+        unsigned int wake_count = m_wake_count;
+        m_condition.wait_for(lock, std::chrono::microseconds(timeout), [this, wake_count]() {
+            return !unlocked_empty() || m_wake_count != wake_count;
+        });
+
+        if (m_ring) {
+            m_ring_waiters--;
+        }
+        return !unlocked_empty();
+    }
+
+    /**
+     *  Releases every thread blocked in wait_not_empty(), e.g. so it can see a terminate flag.
+     */
+    void wake() {
+        std::lock_guard < std::mutex > lock(m_mutex);
+        m_wake_count++;
+        m_condition.notify_all();
     }
 
     /**
@@ -206,6 +433,10 @@ public:
      * \return Number of items in the queue.
      */
     size_type size() const {
+        if (m_ring) {
+            return m_ring->size() + m_side_count.load();
+        }
+
         std::lock_guard < std::mutex > lock(m_mutex);
         return m_queue.size();
     }
@@ -215,6 +446,10 @@ public:
      * \return true if queue is empty.
      */
     bool empty() const {
+        if (m_ring) {
+            return m_ring->empty() && !m_side_count.load();
+        }
+
         std::lock_guard < std::mutex > lock(m_mutex);
         return m_queue.empty();
     }
@@ -224,17 +459,45 @@ public:
      * \return true if queue is full.
      */
     bool full() const {
+        if (m_ring) {
+            // nudges parked in the side queue are still waiting to be popped, so they count
+            size_t num_items = m_ring->size() + m_side_count.load();
+            return (num_items >= m_ring->capacity()) || ((m_max_num_items.load() != 0) && (num_items >= m_max_num_items.load()));
+        }
+
         std::lock_guard < std::mutex > lock(m_mutex);
         return (m_max_num_items.load() != 0) && (m_queue.size() >= m_max_num_items.load());
     }
 
     /**
-     *  Remove any items in the queue.
+     *  Check if the queue is full, counting a full result as a dropped item.
+     *  For producers that skip their push instead of letting it fail.
+     * \return true if queue is full.
      */
-    void flush() const {
+    bool full_drop() {
+        if (full()) {
+            count_drop();
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     *  Remove any items in the queue.  Ring-backed queues: consumer thread only.
+     */
+    void flush() {
+        if (m_ring) {
+            value_type item;
+            while (m_ring->pop(item)) {
+                count_pop(true);
+            }
+        }
+
         std::lock_guard < std::mutex > lock(m_mutex);
+        count_flush(m_queue.size());
         std::queue<T, Container> emptyQueue;
         std::swap(m_queue, emptyQueue);
+        m_side_count.store(0);
     }
 
     /**
@@ -246,11 +509,14 @@ public:
             std::lock_guard < std::mutex > lock1(m_mutex);
             std::lock_guard < std::mutex > lock2(sq.m_mutex);
             m_queue.swap(sq.m_queue);
+            std::swap(m_ring, sq.m_ring);
+            m_side_count.store(m_ring ? m_queue.size() : 0);
+            sq.m_side_count.store(sq.m_ring ? sq.m_queue.size() : 0);
 
-            if (!m_queue.empty())
+            if (!m_queue.empty() || m_ring)
                 m_condition.notify_all();
 
-            if (!sq.m_queue.empty())
+            if (!sq.m_queue.empty() || sq.m_ring)
                 sq.m_condition.notify_all();
         }
     }
@@ -262,6 +528,7 @@ public:
             std::lock_guard < std::mutex > lock2(sq.m_mutex);
             std::queue<T, Container> temp { sq.m_queue };
             m_queue.swap(temp);
+            m_side_count.store(m_ring ? m_queue.size() : 0);
 
             if (!m_queue.empty())
                 m_condition.notify_all();
@@ -274,8 +541,10 @@ public:
     ThreadQueue& operator=(ThreadQueue && sq) {
         std::lock_guard < std::mutex > lock(m_mutex);
         m_queue = std::move(sq.m_queue);
+        std::swap(m_ring, sq.m_ring);
+        m_side_count.store(m_ring ? m_queue.size() : 0);
 
-        if (!m_queue.empty())
+        if (!m_queue.empty() || m_ring)
             m_condition.notify_all();
 
         return *this;
@@ -283,10 +552,92 @@ public:
 
 private:
 
+    bool unlocked_empty() const {
+        return m_ring ? (m_ring->empty() && m_queue.empty()) : m_queue.empty();
+    }
+
+    // after m_queue has been set up by the constructor
+    void init_ring_state() {
+        m_wake_count = 0;
+        m_side_count.store(m_ring ? m_queue.size() : 0);
+        m_ring_waiters.store(0);
+    }
+
+    bool ring_push(const value_type& item) {
+        if (m_max_num_items.load() > 0 && size() > m_max_num_items.load()) {
+            return false;
+        }
+
+        bool pushed = m_ring->push(item);
+
+        if (pushed) {
+            // pairs with the waiter increment in ring_wait_pop(); a parked consumer is only woken
+            // through the mutex so it can't miss the notify between its empty check and wait()
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_ring_waiters.load() > 0) {
+                std::lock_guard < std::mutex > lock(m_mutex);
+                m_condition.notify_all();
+            }
+        }
+
+        return pushed;
+    }
+
+    // side queue first so a nudge isn't stuck behind a ring that never drains; the mutex is
+    // only taken when push_external() has left something there
+    bool ring_try_pop(value_type& item, bool locked) {
+        if (m_side_count.load() > 0) {
+            std::unique_lock < std::mutex > lock(m_mutex, std::defer_lock);
+            if (!locked) {
+                lock.lock();
+            }
+            if (!m_queue.empty()) {
+                item = m_queue.front();
+                m_queue.pop();
+                m_side_count--;
+                return true;
+            }
+        }
+        return m_ring->pop(item);
+    }
+
+    bool ring_wait_pop(value_type& item, std::uint64_t timeout, bool forever) {
+        if (ring_try_pop(item, false)) {
+            return true;
+        }
+
+        if (!forever && timeout == 0) {
+            return false;
+        }
+
+        std::unique_lock < std::mutex > lock(m_mutex);
+        m_ring_waiters++;
+
+        bool popped = ring_try_pop(item, true);
+        while (!popped) {
+            if (forever) {
+                m_condition.wait(lock);
+            } else if (m_condition.wait_for(lock, std::chrono::microseconds(timeout)) == std::cv_status::timeout) {
+                popped = ring_try_pop(item, true);
+                break;
+            }
+            popped = ring_try_pop(item, true);
+        }
+
+        m_ring_waiters--;
+        return popped;
+    }
+
     std::queue<T, Container> m_queue;
     mutable std::mutex m_mutex;
     std::condition_variable m_condition;
     std::atomic_uint m_max_num_items;
+    unsigned int m_wake_count;
+
+    SPSCQueue<T> *m_ring;
+    // items push_external() left in m_queue, read without the mutex to skip it when zero
+    std::atomic_uint m_side_count;
+    std::atomic_int m_ring_waiters;
 };
 
 /*! Swaps the contents of two ThreadQueue objects. */
@@ -0,0 +1,266 @@
+#include "WaterfallHistory.h"
+#include "DSPKernels.h"
+
+#include <cstring>
+
+// deltas wrap mod 256, small positive and negative steps both map to small codes
+static inline unsigned char zigzag(int d) {
+    unsigned char u = (unsigned char)d;
+    return (unsigned char)((u << 1) ^ ((u & 0x80) ? 0xff : 0));
+}
+
+static inline unsigned char unzigzag(unsigned char z) {
+    return (unsigned char)((z >> 1) ^ -(z & 1));
+}
+
+WaterfallHistory::WaterfallHistory() : retentionSeconds(WATERFALL_HISTORY_DEFAULT_SECONDS), memoryLimitMB(WATERFALL_HISTORY_DEFAULT_MB),
+    width(0), firstIndex(0), totalRows(0), bytes(0), decodedFirst(0), decodedRows(0) {
+
+}
+
+void WaterfallHistory::setRetention(int seconds) {
+    retentionSeconds = seconds;
+}
+
+int WaterfallHistory::getRetention() {
+    return retentionSeconds;
+}
+
+void WaterfallHistory::setMemoryLimit(int megabytes) {
+    memoryLimitMB = megabytes;
+}
+
+int WaterfallHistory::getMemoryLimit() {
+    return memoryLimitMB;
+}
+
+void WaterfallHistory::reset(size_t rowWidth) {
+    blocks.clear();
+    width = rowWidth;
+    firstIndex = 0;
+    totalRows = 0;
+    bytes = 0;
+    decodedRows = 0;
+    lastRow.assign(width, 0);
+    quantized.assign(width, 0);
+    zeroRow.assign(width, 0);
+}
+
+void WaterfallHistory::push(const float *points, size_t numPoints) {
+    if (retentionSeconds <= 0 || memoryLimitMB <= 0) {
+        if (!blocks.empty()) {
+            reset(width);
+        }
+        return;
+    }
+    if (numPoints != width || !width) {
+        reset(numPoints);
+        if (!width) {
+            return;
+        }
+    }
+
+    dspQuantizeU8(points, &quantized[0], width);
+
+    if (blocks.empty() || blocks.back().rows == WATERFALL_HISTORY_BLOCK_ROWS) {
+        if (!blocks.empty()) {
+            // closed blocks never grow again, release the vector slack against the budget
+            Block &closed = blocks.back();
+            bytes -= closed.data.capacity();
+            closed.data.shrink_to_fit();
+            bytes += closed.data.capacity();
+        }
+        blocks.push_back(Block());
+    }
+
+    Block &block = blocks.back();
+    size_t before = block.data.capacity();
+
+    // the first row of a block is coded against zeros so every block decodes on its own
+    encodeRow(&quantized[0], block.rows ? &lastRow[0] : &zeroRow[0], block.data);
+    block.rows++;
+    block.lastRow = std::chrono::steady_clock::now();
+    bytes += block.data.capacity() - before;
+
+    lastRow.swap(quantized);
+    totalRows++;
+
+    trim();
+}
+
+void WaterfallHistory::trim() {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    size_t limit = (size_t)memoryLimitMB * 1024 * 1024;
+
+    // always keep the block being written
+    while (blocks.size() > 1) {
+        Block &front = blocks.front();
+        bool expired = std::chrono::duration_cast<std::chrono::seconds>(now - front.lastRow).count() > retentionSeconds;
+
+        if (!expired && bytes <= limit) {
+            break;
+        }
+
+        bytes -= front.data.capacity();
+        firstIndex += front.rows;
+        blocks.pop_front();
+    }
+}
+
+bool WaterfallHistory::empty() {
+    return totalRows == firstIndex;
+}
+
+size_t WaterfallHistory::getRowWidth() {
+    return width;
+}
+
+uint64_t WaterfallHistory::newest() {
+    return totalRows ? (totalRows - 1) : 0;
+}
+
+uint64_t WaterfallHistory::oldest() {
+    return firstIndex;
+}
+
+size_t WaterfallHistory::bytesUsed() {
+    return bytes;
+}
+
+void WaterfallHistory::encodeRow(const unsigned char *row, const unsigned char *above, std::vector<unsigned char> &out) {
+    unsigned char dAbove[WATERFALL_HISTORY_GROUP], dLeft[WATERFALL_HISTORY_GROUP];
+
+    for (size_t g = 0; g < width; g += WATERFALL_HISTORY_GROUP) {
+        size_t n = width - g;
+        if (n > WATERFALL_HISTORY_GROUP) {
+            n = WATERFALL_HISTORY_GROUP;
+        }
+
+        unsigned char orAbove = 0, orLeft = 0;
+        for (size_t i = 0; i < n; i++) {
+            size_t x = g + i;
+            dAbove[i] = zigzag(row[x] - above[x]);
+            dLeft[i] = zigzag(row[x] - (x ? row[x - 1] : above[x]));
+            orAbove |= dAbove[i];
+            orLeft |= dLeft[i];
+        }
+
+        int bitsAbove = 0, bitsLeft = 0;
+        while (orAbove >> bitsAbove) {
+            bitsAbove++;
+        }
+        while (orLeft >> bitsLeft) {
+            bitsLeft++;
+        }
+
+        bool left = bitsLeft < bitsAbove;
+        int bits = left ? bitsLeft : bitsAbove;
+        const unsigned char *d = left ? dLeft : dAbove;
+
+        out.push_back((unsigned char)((left ? 0x80 : 0) | bits));
+
+        unsigned int acc = 0;
+        int accBits = 0;
+        for (size_t i = 0; i < n; i++) {
+            acc |= (unsigned int)d[i] << accBits;
+            accBits += bits;
+            while (accBits >= 8) {
+                out.push_back((unsigned char)(acc & 0xff));
+                acc >>= 8;
+                accBits -= 8;
+            }
+        }
+        if (accBits) {
+            out.push_back((unsigned char)(acc & 0xff));
+        }
+    }
+}
+
+void WaterfallHistory::decodeBlock(const Block &block, unsigned char *out) {
+    const unsigned char *src = block.data.empty() ? NULL : &block.data[0];
+    const unsigned char *above = &zeroRow[0];
+
+    for (int r = 0; r < block.rows; r++) {
+        unsigned char *row = out + r * width;
+
+        for (size_t g = 0; g < width; g += WATERFALL_HISTORY_GROUP) {
+            size_t n = width - g;
+            if (n > WATERFALL_HISTORY_GROUP) {
+                n = WATERFALL_HISTORY_GROUP;
+            }
+
+            unsigned char header = *src++;
+            bool left = (header & 0x80) != 0;
+            int bits = header & 0x0f;
+            unsigned int mask = (1u << bits) - 1;
+
+            unsigned int acc = 0;
+            int accBits = 0;
+            for (size_t i = 0; i < n; i++) {
+                while (accBits < bits) {
+                    acc |= (unsigned int)(*src++) << accBits;
+                    accBits += 8;
+                }
+                unsigned char d = unzigzag((unsigned char)(acc & mask));
+                acc >>= bits;
+                accBits -= bits;
+
+                size_t x = g + i;
+                unsigned char pred = left ? (x ? row[x - 1] : above[x]) : above[x];
+                row[x] = (unsigned char)(pred + d);
+            }
+        }
+        above = row;
+    }
+}
+
+const unsigned char *WaterfallHistory::getRow(uint64_t index) {
+    uint64_t blockIndex = (index - firstIndex) / WATERFALL_HISTORY_BLOCK_ROWS;
+    uint64_t blockFirst = firstIndex + blockIndex * WATERFALL_HISTORY_BLOCK_ROWS;
+    const Block &block = blocks[blockIndex];
+
+    // the open block may have grown since it was cached
+    if (!decodedRows || decodedFirst != blockFirst || decodedRows != block.rows) {
+        decoded.resize(WATERFALL_HISTORY_BLOCK_ROWS * width);
+        decodeBlock(block, &decoded[0]);
+        decodedFirst = blockFirst;
+        decodedRows = block.rows;
+    }
+
+    return &decoded[(index - blockFirst) * width];
+}
+
+void WaterfallHistory::read(uint64_t top, int count, int timeScale, unsigned char *out) {
+    if (timeScale < 1) {
+        timeScale = 1;
+    }
+    memset(out, 0, count * width);
+
+    if (empty()) {
+        return;
+    }
+
+    for (int r = 0; r < count; r++) {
+        unsigned char *dst = out + r * width;
+
+        for (int s = 0; s < timeScale; s++) {
+            uint64_t back = (uint64_t)r * timeScale + s;
+            if (back > top || top - back < firstIndex) {
+                return;
+            }
+            uint64_t index = top - back;
+            if (index >= totalRows) {
+                continue;
+            }
+
+            const unsigned char *src = getRow(index);
+            if (timeScale == 1) {
+                memcpy(dst, src, width);
+            } else {
+                for (size_t x = 0; x < width; x++) {
+                    dst[x] = (src[x] > dst[x]) ? src[x] : dst[x];
+                }
+            }
+        }
+    }
+}
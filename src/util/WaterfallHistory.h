@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#define WATERFALL_HISTORY_DEFAULT_SECONDS 300
+#define WATERFALL_HISTORY_DEFAULT_MB 64
+// rows per compressed block, blocks are the unit of retention and decoding
+#define WATERFALL_HISTORY_BLOCK_ROWS 64
+// values per compression group, each group picks its own predictor and bit width
+#define WATERFALL_HISTORY_GROUP 16
+// coarsest time zoom, history rows per displayed line
+#define WATERFALL_HISTORY_MAX_SCALE 64
+
+/**
+ * Scrollback store for waterfall rows. Rows are quantized the same way as the
+ * waterfall textures and appended to blocks of WATERFALL_HISTORY_BLOCK_ROWS; the
+ * oldest blocks are released once they exceed the retention time or the memory
+ * budget.
+ *
+ * Each row is delta coded in groups of WATERFALL_HISTORY_GROUP values against
+ * either the row above or the value to the left, whichever needs fewer bits, and
+ * the zigzagged deltas are bit packed behind a one byte group header. Clipped
+ * noise floor and steady carriers pack to a few bits per value; rows are decoded
+ * a block at a time and only when scrolled into view.
+ *
+ * Rows are addressed by their absolute index, counting every row ever pushed
+ * since the last reset. Not thread safe, owned by the waterfall canvas.
+ */
+class WaterfallHistory {
+public:
+    WaterfallHistory();
+
+    // seconds <= 0 disables the history; both take effect on the next push
+    void setRetention(int seconds);
+    int getRetention();
+    void setMemoryLimit(int megabytes);
+    int getMemoryLimit();
+
+    // drops every row; rows pushed afterwards must be rowWidth values wide
+    void reset(size_t rowWidth);
+    void push(const float *points, size_t numPoints);
+
+    bool empty();
+    size_t getRowWidth();
+    // absolute index of the newest / oldest row still held
+    uint64_t newest();
+    uint64_t oldest();
+    size_t bytesUsed();
+
+    // count rows newest first, starting at absolute row top and stepping back timeScale
+    // rows per output row (the maximum of each step is kept so short bursts stay visible);
+    // rows outside the history read as zero. out holds count * rowWidth bytes.
+    void read(uint64_t top, int count, int timeScale, unsigned char *out);
+
+private:
+    class Block {
+    public:
+        std::vector<unsigned char> data;
+        int rows;
+        std::chrono::steady_clock::time_point lastRow;
+
+        Block() : rows(0) {
+        }
+    };
+
+    void encodeRow(const unsigned char *row, const unsigned char *above, std::vector<unsigned char> &out);
+    void decodeBlock(const Block &block, unsigned char *out);
+    const unsigned char *getRow(uint64_t index);
+    void trim();
+
+    int retentionSeconds, memoryLimitMB;
+    size_t width;
+    uint64_t firstIndex, totalRows;
+    size_t bytes;
+    std::deque<Block> blocks;
+
+    std::vector<unsigned char> lastRow, quantized, zeroRow;
+
+    // most recently decoded block, firstIndex based so it survives trimming
+    std::vector<unsigned char> decoded;
+    uint64_t decodedFirst;
+    int decodedRows;
+};
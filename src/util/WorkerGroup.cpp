@@ -0,0 +1,76 @@
+#include "WorkerGroup.h"
+#include "IOThread.h"
+#include "PipelineStats.h"
+
+WorkerGroup::WorkerGroup(std::string role) : role(role), parts(0), pending(0), generation(0), terminated(false) {
+
+}
+
+WorkerGroup::~WorkerGroup() {
+    {
+        std::lock_guard < std::mutex > lock(job_busy);
+        terminated = true;
+    }
+    job_start.notify_all();
+
+    for (std::vector<std::thread *>::iterator i = workers.begin(); i != workers.end(); i++) {
+        (*i)->join();
+        delete (*i);
+    }
+}
+
+void WorkerGroup::run(int parts, std::function<void(int part)> job) {
+    if (parts <= 1) {
+        job(0);
+        return;
+    }
+
+    while ((int)workers.size() < parts - 1) {
+        workers.push_back(new std::thread(&WorkerGroup::worker, this, (int)workers.size() + 1));
+    }
+
+    {
+        std::lock_guard < std::mutex > lock(job_busy);
+        this->job = job;
+        this->parts = parts;
+        pending = parts - 1;
+        generation++;
+    }
+    job_start.notify_all();
+
+    job(0);
+
+    std::unique_lock < std::mutex > lock(job_busy);
+    job_done.wait(lock, [this] { return pending == 0; });
+    this->job = nullptr;
+}
+
+void WorkerGroup::worker(int index) {
+    IOThread::applyThreadPolicy(role);
+
+    unsigned long long seen = 0;
+    std::unique_lock < std::mutex > lock(job_busy);
+
+    while (true) {
+        job_start.wait(lock, [this, seen] { return terminated || generation != seen; });
+        if (terminated) {
+            break;
+        }
+        seen = generation;
+        if (index >= parts) {
+            continue;
+        }
+
+        std::function<void(int part)> myJob = job;
+        lock.unlock();
+        myJob(index);
+        lock.lock();
+
+        if (--pending == 0) {
+            job_done.notify_one();
+        }
+    }
+
+    lock.unlock();
+    PipelineStats::threadEnd();
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * Fork/join helper for splitting one large block of work across a few threads.
+ * run() hands parts 1..n-1 to the workers, runs part 0 on the calling thread and
+ * returns once every part has finished. Workers are started on first use, take the
+ * scheduling policy of the given thread role and sleep between runs.
+ * Only one thread may call run() at a time.
+ */
+class WorkerGroup {
+public:
+    WorkerGroup(std::string role);
+    ~WorkerGroup();
+
+    void run(int parts, std::function<void(int part)> job);
+
+private:
+    void worker(int index);
+
+    std::string role;
+    std::vector<std::thread *> workers;
+
+    std::mutex job_busy;
+    std::condition_variable job_start, job_done;
+    std::function<void(int part)> job;
+    int parts;
+    int pending;
+    unsigned long long generation;
+    bool terminated;
+};
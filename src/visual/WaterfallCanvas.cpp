@@ -46,6 +46,10 @@ WaterfallCanvas::WaterfallCanvas(wxWindow *parent, int *attribList) :
     scaleMove = 0;
     minBandwidth = 30000;
     fft_size_changed.store(false);
+    historyLive = true;
+    historyRepage = false;
+    historyTop = 0;
+    historyScale = 1;
 }
 
 WaterfallCanvas::~WaterfallCanvas() {
@@ -59,6 +63,9 @@ void WaterfallCanvas::setup(unsigned int fft_size_in, int waterfall_lines_in) {
     waterfall_lines = waterfall_lines_in;
 
     waterfallPanel.setup(fft_size, waterfall_lines);
+    historyLive = true;
+    historyRepage = false;
+    historyScale = 1;
     gTimer.start();
 }
 
@@ -101,8 +108,11 @@ void WaterfallCanvas::processInputQueue() {
                     if (vData) {
                         if (vData->spectrum_points.size() == fft_size * 2) {
                             waterfallPanel.setPoints(vData->spectrum_points);
+                            history.push(&(waterfallPanel.getPoints()[0]), fft_size);
+                        }
+                        if (historyLive) {
+                            waterfallPanel.step();
                         }
-                        waterfallPanel.step();
                         vData->decRefCount();
                         updated = true;
                     }
@@ -113,10 +123,24 @@ void WaterfallCanvas::processInputQueue() {
             }
         }
     }
-    if (updated) {
+    if (!historyLive) {
+        if (history.empty() || history.getRowWidth() != fft_size) {
+            // history was disabled or restarted for a new FFT size
+            resumeLive();
+        } else if (historyTop < history.oldest()) {
+            // retention caught up with the rows on screen
+            historyTop = history.oldest();
+            historyRepage = true;
+        }
+    }
+    if (updated || historyRepage) {
         wxClientDC(this);
         glContext->SetCurrent(*this);
-        waterfallPanel.update();
+        if (historyRepage) {
+            pageHistory();
+        } else if (historyLive) {
+            waterfallPanel.update();
+        }
     }
     tex_update.unlock();
 }
@@ -252,6 +276,9 @@ void WaterfallCanvas::OnPaint(wxPaintEvent& WXUNUSED(event)) {
     if (fft_size_changed.load()) {
         fft_size = new_fft_size;
         waterfallPanel.setup(fft_size, waterfall_lines);
+        historyLive = true;
+        historyRepage = false;
+        historyScale = 1;
         fft_size_changed.store(false);
     }
 
@@ -434,6 +461,12 @@ void WaterfallCanvas::OnKeyDown(wxKeyEvent& event) {
         }
         activeDemod->setMuted(!activeDemod->isMuted());
         break;
+    case 'R':
+        if (!activeDemod) {
+            break;
+        }
+        activeDemod->setRecording(!activeDemod->isRecording());
+        break;
     case 'B':
         if (spectrumCanvas) {
             spectrumCanvas->setShowDb(!spectrumCanvas->getShowDb());
@@ -442,6 +475,30 @@ void WaterfallCanvas::OnKeyDown(wxKeyEvent& event) {
     case WXK_SPACE:
         wxGetApp().showFrequencyInput();
         break;
+    case WXK_PAGEUP:
+    case WXK_NUMPAD_PAGEUP:
+        scrollHistory((long long)(waterfall_lines * 3 / 4) * historyScale);
+        break;
+    case WXK_PAGEDOWN:
+    case WXK_NUMPAD_PAGEDOWN:
+        scrollHistory(-(long long)(waterfall_lines * 3 / 4) * historyScale);
+        break;
+    case WXK_HOME:
+    case WXK_NUMPAD_HOME:
+        if (!history.empty()) {
+            scrollHistory((long long)(history.newest() - history.oldest()));
+        }
+        break;
+    case WXK_END:
+    case WXK_NUMPAD_END:
+        resumeLive();
+        break;
+    case '[':
+        setHistoryScale(historyScale * 2);
+        break;
+    case ']':
+        setHistoryScale(historyScale / 2);
+        break;
     case 'C':
         if (wxGetApp().getDemodMgr().getActiveDemodulator()) {
             wxGetApp().setFrequency(wxGetApp().getDemodMgr().getActiveDemodulator()->getFrequency());
@@ -657,6 +714,17 @@ void WaterfallCanvas::OnMouseDown(wxMouseEvent& event) {
 
 void WaterfallCanvas::OnMouseWheelMoved(wxMouseEvent& event) {
     InteractiveCanvas::OnMouseWheelMoved(event);
+
+    if (event.ControlDown()) {
+        float notches = (float)event.GetWheelRotation() / (float)event.GetWheelDelta();
+        if (event.ShiftDown()) {
+            setHistoryScale((notches > 0)?(historyScale * 2):(historyScale / 2));
+        } else {
+            scrollHistory((long long)(notches * (waterfall_lines / 8) * historyScale));
+        }
+        return;
+    }
+
     float movement = (float)event.GetWheelRotation() / (float)event.GetLinesPerAction();
 
     mouseZoom = 1.0f - movement/1000.0f;
@@ -916,3 +984,67 @@ void WaterfallCanvas::setLinesPerSecond(int lps) {
 void WaterfallCanvas::setMinBandwidth(int min) {
     minBandwidth = min;
 }
+
+void WaterfallCanvas::setHistory(int seconds, int megabytes) {
+    tex_update.lock();
+    history.setRetention(seconds);
+    history.setMemoryLimit(megabytes);
+    tex_update.unlock();
+}
+
+void WaterfallCanvas::scrollHistory(long long rows) {
+    if (history.empty() || history.getRowWidth() != fft_size) {
+        return;
+    }
+
+    long long top = (long long)(historyLive?history.newest():historyTop) - rows;
+    if (top > (long long)history.newest()) {
+        top = history.newest();
+    }
+    if (top < (long long)history.oldest()) {
+        top = history.oldest();
+    }
+
+    historyTop = top;
+    historyLive = (historyTop == history.newest() && historyScale == 1);
+    historyRepage = true;
+}
+
+void WaterfallCanvas::setHistoryScale(int scale) {
+    if (history.empty() || history.getRowWidth() != fft_size) {
+        return;
+    }
+    if (scale < 1) {
+        scale = 1;
+    }
+    if (scale > WATERFALL_HISTORY_MAX_SCALE) {
+        scale = WATERFALL_HISTORY_MAX_SCALE;
+    }
+    if (historyLive) {
+        historyTop = history.newest();
+    }
+
+    historyScale = scale;
+    historyLive = (historyTop == history.newest() && historyScale == 1);
+    historyRepage = true;
+}
+
+void WaterfallCanvas::resumeLive() {
+    if (historyLive && historyScale == 1) {
+        return;
+    }
+    historyScale = 1;
+    historyLive = true;
+    historyRepage = true;
+}
+
+void WaterfallCanvas::pageHistory() {
+    historyPage.assign(fft_size * waterfall_lines, 0);
+    if (history.getRowWidth() == fft_size) {
+        history.read(historyLive?history.newest():historyTop, waterfall_lines, historyScale, &historyPage[0]);
+    }
+
+    if (waterfallPanel.setRows(&historyPage[0], waterfall_lines)) {
+        historyRepage = false;
+    }
+}
@@ -10,6 +10,7 @@
 #include "MouseTracker.h"
 #include "SpectrumCanvas.h"
 #include "WaterfallPanel.h"
+#include "WaterfallHistory.h"
 #include "Timer.h"
 
 class WaterfallCanvas: public InteractiveCanvas {
@@ -33,6 +34,9 @@ public:
     void setLinesPerSecond(int lps);
     void setMinBandwidth(int min);
 
+    // scrollback retention in seconds (0 disables) and memory budget in MB
+    void setHistory(int seconds, int megabytes);
+
     void OnKeyDown(wxKeyEvent& event);
     void OnKeyUp(wxKeyEvent& event);
 
@@ -52,6 +56,12 @@ private:
     void OnMouseLeftWindow(wxMouseEvent& event);
 
     void updateCenterFrequency(long long freq);
+
+    // positive rows scroll back in time
+    void scrollHistory(long long rows);
+    void setHistoryScale(int scale);
+    void resumeLive();
+    void pageHistory();
     
     std::vector<float> spectrum_points;
 
@@ -81,6 +91,13 @@ private:
     std::mutex tex_update;
     int minBandwidth;
     std::atomic_bool fft_size_changed;
+
+    // while not live the panel shows history rows from historyTop back, historyScale rows per line
+    WaterfallHistory history;
+    std::vector<unsigned char> historyPage;
+    bool historyLive, historyRepage;
+    uint64_t historyTop;
+    int historyScale;
     // event table
 wxDECLARE_EVENT_TABLE();
 };